@@ -0,0 +1,131 @@
+#include "DecoderBackend.h"
+#include "MetricsRegistry.h"
+#include "fmt/core.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Runs every backend that supports a file on the same inputs, for each
+// output kind, and reports the fastest backend per (extension, output).
+// Usage: decoder_bench [--runs N] [--target-edge px] [--json metrics.json] files or folders
+// Feed the winners to DecoderRegistry::prefer() when they disagree with
+// the built-in costs.
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    int runs = 3;
+    int targetEdge = 0;
+    std::string jsonPath;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc)
+            runs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--target-edge" && i + 1 < argc)
+            targetEdge = std::atoi(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (std::filesystem::is_directory(arg))
+        {
+            for (const auto &entry : std::filesystem::directory_iterator(arg))
+                if (entry.is_regular_file())
+                    paths.push_back(entry.path().string());
+        }
+        else
+            paths.push_back(arg);
+    }
+    if (paths.empty())
+    {
+        fmt::print("usage: decoder_bench [--runs N] [--target-edge px] [--json metrics.json] files or folders\n");
+        return 1;
+    }
+    std::sort(paths.begin(), paths.end());
+
+    DecoderRegistry registry;
+    registerDefaultDecoders(registry);
+    MetricsRegistry metrics;
+
+    fmt::print("{:<28} {:<10} {:<18} {:>10} {:>12}\n", "file", "output", "backend", "median ms", "size");
+    for (const std::string &path : paths)
+    {
+        const std::string extension = decodeExtension(path);
+        for (DecodeOutput output : {DecodeOutput::Thumbnail, DecodeOutput::Preview, DecodeOutput::Full})
+        {
+            const DecodeRequest request{path, output, targetEdge, {}};
+            for (const auto &backend : registry.backends())
+            {
+                if (!backend->supports(extension, output))
+                    continue;
+
+                std::vector<double> times;
+                std::optional<ImageData> image;
+                for (int run = 0; run < runs; ++run)
+                {
+                    const auto start = Clock::now();
+                    image = backend->decode(request);
+                    times.push_back(millisecondsSince(start));
+                }
+                std::sort(times.begin(), times.end());
+                const double median = times[times.size() / 2];
+
+                const std::string key = extension + "." + decodeOutputName(output) + "." + backend->name();
+                if (image)
+                {
+                    metrics.histogram(key + "_ms").record(median);
+                }
+                else
+                {
+                    metrics.counter(key + "_failed").add();
+                }
+                fmt::print("{:<28} {:<10} {:<18} {:>10.1f} {:>12}\n",
+                           std::filesystem::path(path).filename().string(), decodeOutputName(output),
+                           backend->name(), median,
+                           image ? fmt::format("{}x{}", image->width, image->height) : std::string("failed"));
+            }
+        }
+    }
+
+    // Fastest backend by mean of the per-file medians.
+    fmt::print("\n{:<8} {:<10} {:<18} {:>10}  {}\n", "format", "output", "fastest", "mean ms", "current route");
+    std::map<std::pair<std::string, std::string>, std::pair<std::string, double>> fastest;
+    const MetricsSnapshot snapshot = metrics.snapshot();
+    for (const auto &[name, summary] : snapshot.histograms)
+    {
+        // ".arw.full.libraw_ms"
+        const size_t outputEnd = name.find('.', 1);
+        const size_t backendStart = name.find('.', outputEnd + 1);
+        const std::string extension = name.substr(0, outputEnd);
+        const std::string output = name.substr(outputEnd + 1, backendStart - outputEnd - 1);
+        const std::string backend = name.substr(backendStart + 1, name.size() - backendStart - 4);
+        auto &best = fastest[{extension, output}];
+        if (best.first.empty() || summary.mean < best.second)
+            best = {backend, summary.mean};
+    }
+    for (const auto &[route, best] : fastest)
+    {
+        const DecodeOutput output = route.second == "thumbnail" ? DecodeOutput::Thumbnail
+                                    : route.second == "preview" ? DecodeOutput::Preview
+                                                                : DecodeOutput::Full;
+        const auto current = registry.route({"x" + route.first, output, targetEdge, {}});
+        fmt::print("{:<8} {:<10} {:<18} {:>10.1f}  {}\n", route.first, route.second, best.first, best.second,
+                   current.empty() ? "-" : current.front()->name());
+    }
+
+    if (!jsonPath.empty())
+        std::ofstream(jsonPath) << toJson(snapshot) << "\n";
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "Demosaic.h"
+#include "fmt/core.h"
+
+#include <libraw/libraw.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <thread>
+
+// Compares LibRaw's dcraw_process() with the in-house tiled demosaic.
+// Usage: demosaic_bench [--min-psnr dB] file.ARW [file.RAF ...]
+// LibRaw runs with camera white balance and without auto brightening so
+// both paths develop the same way; the in-house result is checked against it.
+// Exits non-zero when any file falls below the PSNR threshold.
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Same settings as the in-house path, orientation left untouched so the
+// images line up with demosaicMosaic() output.
+static std::optional<ImageData> decodeWithLibRaw(const std::string &path, double &processMs)
+{
+    LibRaw raw;
+    raw.imgdata.params.output_bps = 16;
+    raw.imgdata.params.use_camera_wb = 1;
+    raw.imgdata.params.no_auto_bright = 1;
+    raw.imgdata.params.user_qual = 3; // AHD
+
+    if (raw.open_file(path.c_str()) != LIBRAW_SUCCESS || raw.unpack() != LIBRAW_SUCCESS)
+        return std::nullopt;
+    raw.imgdata.sizes.flip = 0;
+
+    const auto start = Clock::now();
+    if (raw.dcraw_process() != LIBRAW_SUCCESS)
+        return std::nullopt;
+    processMs = millisecondsSince(start);
+
+    libraw_processed_image_t *img = raw.dcraw_make_mem_image();
+    if (!img)
+        return std::nullopt;
+
+    ImageData result;
+    result.width = img->width;
+    result.height = img->height;
+    result.is16Bit = true;
+    const uint16_t *src = reinterpret_cast<const uint16_t *>(img->data);
+    result.pixels16.assign(src, src + static_cast<size_t>(img->width) * img->height * 3);
+    LibRaw::dcraw_clear_mem(img);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    double minimumPsnr = 30.0;
+    int failures = 0;
+    int files = 0;
+
+    fmt::print("{} hardware threads\n", std::thread::hardware_concurrency());
+    fmt::print("{:<32} {:>8} {:>12} {:>12} {:>10}\n", "file", "MP", "method", "ms", "PSNR dB");
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--min-psnr" && i + 1 < argc)
+        {
+            minimumPsnr = std::atof(argv[++i]);
+            continue;
+        }
+        ++files;
+
+        double libRawMs = 0.0;
+        const std::optional<ImageData> reference = decodeWithLibRaw(arg, libRawMs);
+        const std::optional<RawMosaic> mosaic = extractRawMosaic(arg);
+        if (!reference || !mosaic)
+        {
+            fmt::print("{:<32} could not be decoded\n", arg);
+            ++failures;
+            continue;
+        }
+
+        const double megapixels = mosaic->width * static_cast<double>(mosaic->height) / 1e6;
+        fmt::print("{:<32} {:>8.1f} {:>12} {:>12.1f} {:>10}\n", arg, megapixels, "libraw", libRawMs, "-");
+
+        for (DemosaicQuality quality : {DemosaicQuality::Bilinear, DemosaicQuality::EdgeDirected})
+        {
+            DemosaicOptions options;
+            options.quality = quality;
+
+            const auto start = Clock::now();
+            const ImageData image = demosaicMosaic(*mosaic, options);
+            const double ms = millisecondsSince(start);
+
+            // LibRaw may crop a few border pixels differently; compare only
+            // when the sizes agree.
+            const double psnr = imagePsnr(image, *reference);
+            const bool comparable = image.width == reference->width && image.height == reference->height;
+            const bool pass = !comparable || psnr >= minimumPsnr;
+            if (!pass)
+                ++failures;
+
+            fmt::print("{:<32} {:>8} {:>12} {:>12.1f} {:>10}{}\n", "", "",
+                       quality == DemosaicQuality::Bilinear ? "bilinear" : "edge", ms,
+                       comparable ? fmt::format("{:.1f}", psnr) : std::string("size differs"),
+                       pass ? "" : "  FAIL");
+        }
+    }
+
+    if (files == 0)
+    {
+        fmt::print("usage: demosaic_bench [--min-psnr dB] file [file ...]\n");
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+#include "DevelopLut.h"
+#include "fmt/core.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Compares direct evaluation of the develop pass with the baked 3D LUT.
+// Usage: develop_lut_bench [megapixels]
+// A filmic-style curve is added after the default stages so the comparison
+// includes a non-linear stage (exposure and white balance alone bake exactly).
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static DevelopPipeline makeBenchPipeline()
+{
+    DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+
+    DevelopStage curve;
+    curve.name = "Bench Curve";
+    curve.parameterHash = [](const DevelopSettings &) { return uint64_t{1}; };
+    curve.applyPixels = [](const DevelopSettings &, float *rgb, size_t pixelCount) {
+        for (size_t i = 0; i < pixelCount * 3; ++i)
+        {
+            const float x = std::max(rgb[i], 0.0f);
+            rgb[i] = std::pow(x / (x + 0.6f) * 1.6f, 1.0f / 2.2f);
+        }
+    };
+    pipeline.addStage(std::move(curve));
+    return pipeline;
+}
+
+int main(int argc, char **argv)
+{
+    const double megapixels = argc > 1 ? std::atof(argv[1]) : 24.0;
+    const size_t pixelCount = static_cast<size_t>(megapixels * 1000000.0);
+
+    std::vector<float> source(pixelCount * 3);
+    std::srand(1);
+    for (float &value : source)
+        value = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
+
+    const DevelopPipeline pipeline = makeBenchPipeline();
+    DevelopSettings settings;
+    settings.exposure = 0.5f;
+    settings.whiteBalance[0] = 1.2f;
+    settings.whiteBalance[2] = 0.8f;
+
+    std::vector<float> direct = source;
+    auto start = Clock::now();
+    pipeline.applyPerPixelPass(0, settings, direct.data(), pixelCount);
+    const double directMs = millisecondsSince(start);
+
+    fmt::print("{:.1f} MP, {} per-pixel stages\n", megapixels, pipeline.stages().size());
+    fmt::print("{:<10} {:>10} {:>10} {:>12} {:>10}\n", "method", "bake ms", "apply ms", "max error", "PSNR dB");
+    fmt::print("{:<10} {:>10} {:>10.1f} {:>12} {:>10}\n", "direct", "-", directMs, "-", "-");
+
+    for (int size : {17, 33, 65})
+    {
+        start = Clock::now();
+        const DevelopLut lut = bakeDevelopLut(pipeline, settings, size);
+        const double bakeMs = millisecondsSince(start);
+
+        std::vector<float> viaLut(source.size());
+        start = Clock::now();
+        applyDevelopLut(lut, source.data(), viaLut.data(), pixelCount);
+        const double applyMs = millisecondsSince(start);
+
+        // Errors on the displayed (clamped) values.
+        double maxError = 0.0;
+        double squaredError = 0.0;
+        for (size_t i = 0; i < source.size(); ++i)
+        {
+            const double error = std::clamp(direct[i], 0.0f, 1.0f) - std::clamp(viaLut[i], 0.0f, 1.0f);
+            maxError = std::max(maxError, std::fabs(error));
+            squaredError += error * error;
+        }
+        const double mse = squaredError / static_cast<double>(source.size());
+        const double psnr = mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : 999.0;
+
+        fmt::print("{:<10} {:>10.1f} {:>10.1f} {:>12.6f} {:>10.1f}\n", "lut " + std::to_string(size), bakeMs,
+                   applyMs, maxError, psnr);
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "DevelopPipeline.h"
+#include "ImageView.h"
+#include "PreviewCache.h"
+#include "fmt/core.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+// Compares the kernels on typed views (one instantiation per pixel format,
+// chosen once by dispatchImage()) with the loops they replaced, which read
+// ImageData directly and branched on is16Bit / channels for every value.
+// Usage: image_view_bench [megapixels] [repeats]
+// For RGB8, RGBA8, RGB16 and RGBA16 prints the best time of each kernel:
+// normalizing to the develop buffer, the CPU develop (normalize + exposure
+// and white balance) and the box downscale of the preview cache, and checks
+// that both versions give the same result.
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// toDevelopImage() as it was.
+static DevelopImage branchingToDevelop(const ImageData &image)
+{
+    DevelopImage result;
+    result.width = image.width;
+    result.height = image.height;
+
+    const size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+    result.pixels.resize(pixelCount * 3);
+
+    const int channels = image.channels;
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            const size_t source = i * channels + c;
+            result.pixels[i * 3 + c] = image.is16Bit ? image.pixels16[source] / 65535.0f
+                                                     : image.pixels8[source] / 255.0f;
+        }
+    }
+    return result;
+}
+
+// downscaleToRgb8() as it was.
+static ImageData branchingDownscale(const ImageData &image, int maxEdge)
+{
+    ImageData result;
+    result.kind = ImageKind::Preview;
+    result.channels = 3;
+    const double factor = std::max(1.0, static_cast<double>(std::max(image.width, image.height)) / maxEdge);
+    result.width = std::max(1, static_cast<int>(image.width / factor));
+    result.height = std::max(1, static_cast<int>(image.height / factor));
+    result.pixels8.resize(static_cast<size_t>(result.width) * result.height * 3);
+
+    const int shift = image.is16Bit ? 8 : 0;
+    for (int y = 0; y < result.height; ++y)
+    {
+        const int y0 = static_cast<int>(y * factor);
+        const int y1 = std::max(y0 + 1, std::min(image.height, static_cast<int>((y + 1) * factor)));
+        for (int x = 0; x < result.width; ++x)
+        {
+            const int x0 = static_cast<int>(x * factor);
+            const int x1 = std::max(x0 + 1, std::min(image.width, static_cast<int>((x + 1) * factor)));
+
+            uint32_t sum[3] = {0, 0, 0};
+            for (int sy = y0; sy < y1; ++sy)
+                for (int sx = x0; sx < x1; ++sx)
+                {
+                    const size_t source = (static_cast<size_t>(sy) * image.width + sx) * image.channels;
+                    for (int c = 0; c < 3; ++c)
+                        sum[c] += image.is16Bit ? image.pixels16[source + c] >> shift : image.pixels8[source + c];
+                }
+
+            const uint32_t count = static_cast<uint32_t>((y1 - y0) * (x1 - x0));
+            const size_t target = (static_cast<size_t>(y) * result.width + x) * 3;
+            for (int c = 0; c < 3; ++c)
+                result.pixels8[target + c] = static_cast<uint8_t>(sum[c] / count);
+        }
+    }
+    return result;
+}
+
+static ImageData makeSource(int width, int height, int channels, bool is16Bit)
+{
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.is16Bit = is16Bit;
+    const size_t values = static_cast<size_t>(width) * height * channels;
+    std::srand(1);
+    if (is16Bit)
+    {
+        image.pixels16.resize(values);
+        for (uint16_t &value : image.pixels16)
+            value = static_cast<uint16_t>(std::rand() & 0xffff);
+    }
+    else
+    {
+        image.pixels8.resize(values);
+        for (uint8_t &value : image.pixels8)
+            value = static_cast<uint8_t>(std::rand() & 0xff);
+    }
+    return image;
+}
+
+// Best of repeats runs.
+template <typename F>
+static double bestOf(int repeats, F &&run)
+{
+    double best = 1e30;
+    for (int i = 0; i < repeats; ++i)
+    {
+        const auto start = Clock::now();
+        run();
+        best = std::min(best, millisecondsSince(start));
+    }
+    return best;
+}
+
+static float maxDifference(const std::vector<float> &a, const std::vector<float> &b)
+{
+    float difference = a.size() == b.size() ? 0.0f : 1e30f;
+    for (size_t i = 0; i < std::min(a.size(), b.size()); ++i)
+        difference = std::max(difference, std::abs(a[i] - b[i]));
+    return difference;
+}
+
+int main(int argc, char **argv)
+{
+    const double megapixels = argc > 1 ? std::atof(argv[1]) : 24.0;
+    const int repeats = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+    const int width = static_cast<int>(std::sqrt(megapixels * 1e6 * 1.5));
+    const int height = static_cast<int>(width / 1.5);
+
+    DevelopSettings settings;
+    settings.exposure = 0.5f;
+    settings.whiteBalance[0] = 1.8f;
+    settings.whiteBalance[2] = 1.3f;
+
+    fmt::print("{}x{}, best of {}\n", width, height, repeats);
+    fmt::print("{:<8} {:<12} {:>12} {:>12} {:>8} {:>10}\n", "format", "kernel", "branching ms", "typed ms",
+               "speedup", "max diff");
+
+    struct Format
+    {
+        const char *name;
+        int channels;
+        bool is16Bit;
+    };
+    for (const Format &format : {Format{"RGB8", 3, false}, Format{"RGBA8", 4, false}, Format{"RGB16", 3, true},
+                                 Format{"RGBA16", 4, true}})
+    {
+        const ImageData source = makeSource(width, height, format.channels, format.is16Bit);
+        auto report = [&](const char *kernel, double branchingMs, double typedMs, double difference) {
+            fmt::print("{:<8} {:<12} {:>12.1f} {:>12.1f} {:>7.2f}x {:>10.2g}\n", format.name, kernel, branchingMs,
+                       typedMs, branchingMs / std::max(typedMs, 1e-6), difference);
+        };
+
+        DevelopImage branching;
+        DevelopImage typed;
+        const double branchingMs = bestOf(repeats, [&]() { branching = branchingToDevelop(source); });
+        const double typedMs = bestOf(repeats, [&]() { typed = toDevelopImage(source); });
+        report("normalize", branchingMs, typedMs, maxDifference(branching.pixels, typed.pixels));
+
+        // A fresh pipeline per run, so nothing comes from its pass cache.
+        const double branchingDevelopMs = bestOf(repeats, [&]() {
+            DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+            branching = pipeline.process(branchingToDevelop(source), 1, settings);
+        });
+        const double typedDevelopMs = bestOf(repeats, [&]() {
+            DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+            typed = pipeline.process(toDevelopImage(source), 1, settings);
+        });
+        report("develop", branchingDevelopMs, typedDevelopMs, maxDifference(branching.pixels, typed.pixels));
+
+        ImageData branchingSmall;
+        ImageData typedSmall;
+        const double branchingDownscaleMs =
+            bestOf(repeats, [&]() { branchingSmall = branchingDownscale(source, kPreviewCacheMaxEdge); });
+        const double typedDownscaleMs =
+            bestOf(repeats, [&]() { typedSmall = downscaleToRgb8(source, kPreviewCacheMaxEdge); });
+        report("downscale", branchingDownscaleMs, typedDownscaleMs,
+               branchingSmall.pixels8 == typedSmall.pixels8 ? 0.0 : 1.0);
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "ImportPipeline.h"
+#include "MetricsRegistry.h"
+#include "Parallel.h"
+#include "fmt/core.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Card import against the bandwidth of the card itself: first a plain read
+// of every source file (same chunk size and files in flight, nothing else),
+// then the import (read, hash, write, thumbnail, verify) into
+// destination/import_bench.
+// Usage: import_bench [--json metrics.json] [--files-in-flight N]
+//                     [--chunk-kb N] [--no-verify] [--pause] source destination
+// Drop the page cache before each pass (echo 3 > /proc/sys/vm/drop_caches)
+// for numbers that mean anything; the bench pauses for it with --pause.
+
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void report(const char *pass, uint64_t bytes, double seconds)
+{
+    fmt::print("{:<12} {:>10.1f} MB {:>8.2f} s {:>8.1f} MB/s\n", pass, bytes / 1.0e6, seconds,
+               bytes / 1.0e6 / seconds);
+}
+
+// What the card gives without any work on the bytes.
+static uint64_t readOnly(const std::vector<fs::path> &sources, const ImportOptions &options)
+{
+    std::atomic<uint64_t> bytes{0};
+    parallelFor(
+        0, static_cast<int>(sources.size()), 1,
+        [&](int begin, int end) {
+            std::vector<char> buffer(options.chunkBytes);
+            for (int i = begin; i < end; ++i)
+            {
+                std::ifstream file(sources[i], std::ios::binary);
+                while (file.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || file.gcount() > 0)
+                    bytes += static_cast<uint64_t>(file.gcount());
+            }
+        },
+        options.filesInFlight);
+    return bytes;
+}
+
+int main(int argc, char **argv)
+{
+    std::string jsonPath;
+    std::vector<std::string> folders;
+    ImportOptions options;
+    bool pause = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (arg == "--files-in-flight" && i + 1 < argc)
+            options.filesInFlight = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+        else if (arg == "--chunk-kb" && i + 1 < argc)
+            options.chunkBytes = static_cast<size_t>(std::max(4, std::stoi(argv[++i]))) * 1024;
+        else if (arg == "--no-verify")
+            options.verify = false;
+        else if (arg == "--pause")
+            pause = true;
+        else
+            folders.push_back(arg);
+    }
+    if (folders.size() != 2)
+    {
+        fmt::print("usage: import_bench [--json metrics.json] [--files-in-flight N] [--chunk-kb N] [--no-verify] "
+                   "[--pause] source destination\n");
+        return 1;
+    }
+
+    const std::vector<fs::path> sources = findImportSources(folders[0]);
+    if (sources.empty())
+    {
+        fmt::print("no raw files in {}\n", folders[0]);
+        return 1;
+    }
+    const fs::path destination = fs::path(folders[1]) / "import_bench";
+    std::error_code error;
+    fs::remove_all(destination, error);
+
+    MetricsRegistry metrics;
+    metrics.gauge("files").set(static_cast<int64_t>(sources.size()));
+    fmt::print("{} files, {} in flight, {} KiB chunks\n", sources.size(), options.filesInFlight,
+               options.chunkBytes / 1024);
+
+    auto start = Clock::now();
+    const uint64_t readBytes = readOnly(sources, options);
+    const double readSeconds = secondsSince(start);
+    report("read only", readBytes, readSeconds);
+    metrics.histogram("read_only.pass_ms").record(readSeconds * 1000.0);
+
+    if (pause)
+    {
+        fmt::print("drop the page cache, then press enter\n");
+        std::getchar();
+    }
+
+    Histogram &readMs = metrics.histogram("import.read_ms");
+    Histogram &writeMs = metrics.histogram("import.write_ms");
+    Histogram &verifyMs = metrics.histogram("import.verify_ms");
+    std::atomic<int> thumbnails{0};
+    const ImportSummary summary = importFiles(sources, destination, options, [&](const ImportedFile &file) {
+        readMs.record(file.readMs);
+        writeMs.record(file.writeMs);
+        verifyMs.record(file.verifyMs);
+        if (file.thumbnail)
+            ++thumbnails;
+        if (file.status == ImportStatus::Failed)
+            fmt::print("{}: {}\n", file.source.string(), file.error);
+    });
+    report("import", summary.bytes, summary.seconds);
+    fmt::print("{} copied, {} failed, {} thumbnails, {:.0f}% of read-only bandwidth\n", summary.copied,
+               summary.failed, thumbnails.load(),
+               100.0 * summary.megabytesPerSecond() / (readBytes / 1.0e6 / readSeconds));
+    metrics.histogram("import.pass_ms").record(summary.seconds * 1000.0);
+    metrics.counter("import.bytes").add(static_cast<int64_t>(summary.bytes));
+    metrics.counter("import.failed").add(static_cast<int64_t>(summary.failed));
+
+    fs::remove_all(destination, error);
+    if (!jsonPath.empty())
+        std::ofstream(jsonPath) << toJson(metrics.snapshot()) << "\n";
+    return summary.failed == 0 ? 0 : 1;
+}
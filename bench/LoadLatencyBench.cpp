@@ -0,0 +1,255 @@
+#include "DecoderBackend.h"
+#include "ImageLoadPipeline.h"
+#include "MetricsRegistry.h"
+#include "fmt/core.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// End-to-end load latency under rapid switching.
+// Drives ImageLoadPipeline the way the viewer does (open, then poll once per
+// frame) without a window: opens a file, switches to the next one every
+// --switch-ms across a folder, and lets every --full-every'th request (and
+// the last) finish. Per request it records time to preview; time to full
+// image only for the requests that were let finish, since a switched one
+// only gets there when it happens to be fast. Over the run it reports the
+// work thrown away for superseded files and the peak RSS.
+// Usage: load_latency_bench [--switch-ms 150] [--requests 50] [--frame-ms 16]
+//        [--full-every 5] [--mode 0] [--decode-cache dir] [--json metrics.json]
+//        [--slo-preview-p95 ms] [--slo-full-p95 ms] folder
+// Exits with 2 when a p95 is over its SLO, so a release check can run it.
+// For the SLO a request that never showed its preview (or, when let finish,
+// its full image) counts as slower than any that did.
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static double peakRssMegabytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+struct RequestTiming
+{
+    std::string path;
+    double previewMs = -1.0;
+    double fullMs = -1.0;
+};
+
+static void printLatency(const char *what, const HistogramSummary &summary, size_t requests)
+{
+    fmt::print("{:<16} {:>6}/{:<6} {:>9.1f} {:>9.1f} {:>9.1f} {:>9.1f}\n", what, summary.count, requests,
+               summary.p50, summary.p95, summary.p99, summary.max);
+}
+
+// Nearest-rank p95 with each miss as an infinitely slow sample, so requests
+// that never got there cannot make the run look faster than it was.
+static double p95CountingMisses(std::vector<double> samples, size_t missed)
+{
+    samples.insert(samples.end(), missed, std::numeric_limits<double>::infinity());
+    if (samples.empty())
+        return std::numeric_limits<double>::infinity();
+    std::sort(samples.begin(), samples.end());
+    const size_t rank = static_cast<size_t>(std::ceil(0.95 * samples.size()));
+    return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+}
+
+int main(int argc, char **argv)
+{
+    int switchMs = 150;
+    int requestCount = 50;
+    int frameMs = 16;
+    int fullEvery = 5;
+    LoadOptions options;
+    std::string folder;
+    std::string cacheDir;
+    std::string jsonPath;
+    double previewSlo = 0.0;
+    double fullSlo = 0.0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--switch-ms" && hasValue)
+            switchMs = std::atoi(argv[++i]);
+        else if (arg == "--requests" && hasValue)
+            requestCount = std::atoi(argv[++i]);
+        else if (arg == "--frame-ms" && hasValue)
+            frameMs = std::atoi(argv[++i]);
+        else if (arg == "--full-every" && hasValue)
+            fullEvery = std::atoi(argv[++i]);
+        else if (arg == "--mode" && hasValue)
+            options.demosaicMode = std::clamp(std::atoi(argv[++i]), 0, 2);
+        else if (arg == "--decode-cache" && hasValue)
+            cacheDir = argv[++i];
+        else if (arg == "--json" && hasValue)
+            jsonPath = argv[++i];
+        else if (arg == "--slo-preview-p95" && hasValue)
+            previewSlo = std::atof(argv[++i]);
+        else if (arg == "--slo-full-p95" && hasValue)
+            fullSlo = std::atof(argv[++i]);
+        else if (arg.rfind("--", 0) != 0 && folder.empty())
+            folder = arg;
+        else
+        {
+            // A misspelled or valueless option must not become the folder
+            folder.clear();
+            break;
+        }
+    }
+    if (folder.empty() || requestCount <= 0 || fullEvery <= 0)
+    {
+        fmt::print("usage: load_latency_bench [--switch-ms N] [--requests N] [--frame-ms N] [--full-every N]\n"
+                   "       [--mode 0-2] [--decode-cache dir] [--json metrics.json] [--slo-preview-p95 ms]\n"
+                   "       [--slo-full-p95 ms] folder\n");
+        return 1;
+    }
+
+    DecoderRegistry decoders;
+    registerDefaultDecoders(decoders);
+
+    std::vector<std::string> files;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(folder, error))
+    {
+        const std::string path = entry.path().string();
+        if (entry.is_regular_file() && !decoders.route({path, DecodeOutput::Full, 0, {}}).empty())
+            files.push_back(path);
+    }
+    std::sort(files.begin(), files.end());
+    if (files.empty())
+    {
+        fmt::print("no decodable files in {}\n", folder);
+        return 1;
+    }
+
+    MetricsRegistry metrics;
+    std::optional<DecodeCache> decodeCache;
+    ImageLoadPipeline loader(decoders, metrics);
+    if (!cacheDir.empty())
+    {
+        decodeCache.emplace(cacheDir, 4ull << 30);
+        loader.setDecodeCache(&*decodeCache);
+    }
+
+    std::vector<RequestTiming> timings;
+    std::vector<double> previewSamples;
+    std::vector<double> fullSamples;
+    Histogram &previewLatency = metrics.histogram("request.preview_ms");
+    Histogram &fullLatency = metrics.histogram("request.full_ms");
+    Counter &previewMissed = metrics.counter("request.preview_missed");
+    Counter &fullMissed = metrics.counter("request.full_missed");
+    size_t finishedRequests = 0;
+    const auto runStart = Clock::now();
+    for (int i = 0; i < requestCount; ++i)
+    {
+        RequestTiming timing;
+        timing.path = files[i % files.size()];
+        const auto opened = Clock::now();
+        loader.open(timing.path, options);
+
+        // Every fullEvery'th request and the last run to the end; the others
+        // get switchMs.
+        const bool finish = (i + 1) % fullEvery == 0 || i + 1 == requestCount;
+        while (finish ? loader.loading() : millisecondsSince(opened) < switchMs)
+        {
+            while (auto result = loader.takeResult())
+            {
+                if (result->image.kind == ImageKind::Preview && timing.previewMs < 0.0)
+                    timing.previewMs = millisecondsSince(opened);
+                else if (result->image.kind == ImageKind::Full)
+                    timing.fullMs = millisecondsSince(opened);
+            }
+            loader.collect();
+            std::this_thread::sleep_for(std::chrono::milliseconds(frameMs));
+        }
+        if (timing.previewMs >= 0.0)
+        {
+            previewLatency.record(timing.previewMs);
+            previewSamples.push_back(timing.previewMs);
+        }
+        else
+            previewMissed.add();
+        if (finish)
+        {
+            ++finishedRequests;
+            if (timing.fullMs >= 0.0)
+            {
+                fullLatency.record(timing.fullMs);
+                fullSamples.push_back(timing.fullMs);
+            }
+            else
+                fullMissed.add();
+        }
+        timings.push_back(std::move(timing));
+    }
+    const double runMs = millisecondsSince(runStart);
+    loader.wait();
+    loader.collect();
+
+    const HistogramSummary preview = previewLatency.summary();
+    const HistogramSummary full = fullLatency.summary();
+    const HistogramSummary staleWork = metrics.histogram("loader.stale_work_ms").summary();
+    const double peakRss = peakRssMegabytes();
+    metrics.gauge("memory.peak_rss_bytes").set(static_cast<int64_t>(peakRss * 1024.0 * 1024.0));
+
+    fmt::print("{} files, {} requests, switch every {} ms, full every {}, frame {} ms, mode {}\n", files.size(),
+               requestCount, switchMs, fullEvery, frameMs, options.demosaicMode);
+    fmt::print("{:<16} {:>13} {:>9} {:>9} {:>9} {:>9}\n", "latency ms", "reached", "p50", "p95", "p99", "max");
+    printLatency("to preview", preview, timings.size());
+    printLatency("to full", full, finishedRequests);
+    fmt::print("stale work: {} superseded loads, {:.0f} ms of worker time, {} results / {:.1f} MB dropped\n",
+               staleWork.count, staleWork.mean * staleWork.count, metrics.counter("loader.stale_results").value(),
+               metrics.counter("loader.stale_bytes").value() / (1024.0 * 1024.0));
+    fmt::print("peak RSS {:.1f} MB, run {:.0f} ms\n", peakRss, runMs);
+
+    if (!jsonPath.empty())
+        std::ofstream(jsonPath) << toJson(metrics.snapshot()) << "\n";
+
+    bool withinSlo = true;
+    const double previewP95 = p95CountingMisses(previewSamples, static_cast<size_t>(previewMissed.value()));
+    if (previewSlo > 0.0 && previewP95 > previewSlo)
+    {
+        fmt::print("SLO: preview p95 {:.1f} ms > {:.1f} ms ({} never shown)\n", previewP95, previewSlo,
+                   previewMissed.value());
+        withinSlo = false;
+    }
+    const double fullP95 = p95CountingMisses(fullSamples, static_cast<size_t>(fullMissed.value()));
+    if (fullSlo > 0.0 && fullP95 > fullSlo)
+    {
+        fmt::print("SLO: full p95 {:.1f} ms > {:.1f} ms ({} never shown)\n", fullP95, fullSlo, fullMissed.value());
+        withinSlo = false;
+    }
+    return withinSlo ? 0 : 2;
+}
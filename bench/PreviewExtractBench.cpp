@@ -0,0 +1,113 @@
+#include "ImageLoader.h"
+#include "MetricsRegistry.h"
+#include "StbImageDecoder.h"
+#include "fmt/core.h"
+
+#include <libraw/libraw.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Filmstrip fill: LibRaw open_file() + unpack_thumb() per file against the
+// byte-range JPEG reader at several I/O depths.
+// Usage: preview_extract_bench [--json metrics.json] folder
+// Run after dropping the page cache (echo 3 > /proc/sys/vm/drop_caches) for
+// cold numbers; otherwise every pass after the first reads from memory.
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// The previous extractEmbeddedPreviewImage(), JPEG thumbnails only.
+static bool extractWithLibRaw(const std::string &path)
+{
+    LibRaw raw;
+    if (raw.open_file(path.c_str()) != LIBRAW_SUCCESS || raw.unpack_thumb() != LIBRAW_SUCCESS)
+        return false;
+
+    libraw_processed_image_t *thumb = raw.dcraw_make_mem_thumb();
+    if (!thumb)
+        return false;
+    const bool decoded = thumb->type == LIBRAW_IMAGE_JPEG &&
+                         decodeJpegMemoryToRgb(thumb->data, thumb->data_size, ImageKind::Preview).has_value();
+    LibRaw::dcraw_clear_mem(thumb);
+    return decoded;
+}
+
+static void report(const char *method, size_t files, size_t decoded, double ms)
+{
+    fmt::print("{:<20} {:>8} {:>10.1f} {:>10.1f}\n", method, decoded, ms, files / (ms / 1000.0));
+}
+
+int main(int argc, char **argv)
+{
+    std::string folder;
+    std::string jsonPath;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else
+            folder = arg;
+    }
+    if (folder.empty())
+    {
+        fmt::print("usage: preview_extract_bench [--json metrics.json] folder\n");
+        return 1;
+    }
+
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(folder, error))
+        if (entry.is_regular_file())
+            paths.push_back(entry.path().string());
+    if (paths.empty())
+    {
+        fmt::print("no files in {}\n", folder);
+        return 1;
+    }
+
+    MetricsRegistry metrics;
+    metrics.gauge("files").set(static_cast<int64_t>(paths.size()));
+
+    fmt::print("{} files\n", paths.size());
+    fmt::print("{:<20} {:>8} {:>10} {:>10}\n", "method", "decoded", "ms", "files/s");
+
+    auto start = Clock::now();
+    size_t decoded = 0;
+    Histogram &libRawFile = metrics.histogram("libraw.file_ms");
+    for (const std::string &path : paths)
+    {
+        const auto fileStart = Clock::now();
+        decoded += extractWithLibRaw(path) ? 1 : 0;
+        libRawFile.record(millisecondsSince(fileStart));
+    }
+    report("libraw", paths.size(), decoded, millisecondsSince(start));
+    metrics.counter("libraw.decoded").add(static_cast<int64_t>(decoded));
+
+    for (unsigned inFlight : {1u, 4u, 16u})
+    {
+        std::atomic<size_t> count{0};
+        start = Clock::now();
+        extractEmbeddedPreviewImages(paths, inFlight, [&](size_t, std::optional<ImageData> preview) {
+            if (preview)
+                ++count;
+        });
+        const double ms = millisecondsSince(start);
+        report(fmt::format("byte range x{}", inFlight).c_str(), paths.size(), count, ms);
+        metrics.histogram(fmt::format("byte_range_x{}.pass_ms", inFlight)).record(ms);
+        metrics.counter(fmt::format("byte_range_x{}.decoded", inFlight)).add(static_cast<int64_t>(count.load()));
+    }
+
+    if (!jsonPath.empty())
+        std::ofstream(jsonPath) << toJson(metrics.snapshot()) << "\n";
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "Resample.h"
+#include "fmt/core.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Compares the table-driven, vectorised resampler with a naive scalar one
+// that evaluates the filter for every tap of every output pixel.
+// Usage: resample_bench [megapixels] [output edge]
+// Shrinks a synthetic 8-bit and 16-bit RGB image with every filter and
+// prints the time of each implementation and the largest difference.
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static double naiveWeight(ResampleFilter filter, double x)
+{
+    switch (filter)
+    {
+    case ResampleFilter::Box:
+        return x >= -0.5 && x < 0.5 ? 1.0 : 0.0;
+    case ResampleFilter::Triangle:
+        return std::max(0.0, 1.0 - std::abs(x));
+    case ResampleFilter::Lanczos3:
+    {
+        if (std::abs(x) >= 3.0)
+            return 0.0;
+        if (x == 0.0)
+            return 1.0;
+        const double pi = 3.14159265358979323846;
+        return 3.0 * std::sin(pi * x) * std::sin(pi * x / 3.0) / (pi * pi * x * x);
+    }
+    }
+    return 0.0;
+}
+
+// One axis at a time straight from the image, weights recomputed per pixel.
+template <typename T>
+static std::vector<T> naiveResample(const std::vector<T> &source, int sourceWidth, int sourceHeight, int width,
+                                    int height, ResampleFilter filter, double maxValue)
+{
+    const double radius = filter == ResampleFilter::Box ? 0.5 : filter == ResampleFilter::Triangle ? 1.0 : 3.0;
+    auto axis = [&](const std::vector<double> &in, int inWidth, int inHeight, int outSize, bool horizontal) {
+        const int inSize = horizontal ? inWidth : inHeight;
+        const double scale = static_cast<double>(inSize) / outSize;
+        const double filterScale = std::max(scale, 1.0);
+        const double support = radius * filterScale;
+        const int outWidth = horizontal ? outSize : inWidth;
+        const int outHeight = horizontal ? inHeight : outSize;
+        std::vector<double> out(static_cast<size_t>(outWidth) * outHeight * 3);
+        for (int y = 0; y < outHeight; ++y)
+            for (int x = 0; x < outWidth; ++x)
+            {
+                const int i = horizontal ? x : y;
+                const double center = (i + 0.5) * scale;
+                const int begin = std::max(0, static_cast<int>(center - support + 0.5));
+                const int end = std::min(inSize, static_cast<int>(center + support + 0.5));
+                double sum[3] = {0.0, 0.0, 0.0};
+                double total = 0.0;
+                for (int k = begin; k < end; ++k)
+                {
+                    const double weight = naiveWeight(filter, (k + 0.5 - center) / filterScale);
+                    const size_t index = horizontal ? (static_cast<size_t>(y) * inWidth + k) * 3
+                                                    : (static_cast<size_t>(k) * inWidth + x) * 3;
+                    for (int c = 0; c < 3; ++c)
+                        sum[c] += weight * in[index + c];
+                    total += weight;
+                }
+                for (int c = 0; c < 3; ++c)
+                    out[(static_cast<size_t>(y) * outWidth + x) * 3 + c] = total != 0.0 ? sum[c] / total : 0.0;
+            }
+        return out;
+    };
+
+    const std::vector<double> widened(source.begin(), source.end());
+    const std::vector<double> rows = axis(widened, sourceWidth, sourceHeight, width, true);
+    const std::vector<double> both = axis(rows, width, sourceHeight, height, false);
+    std::vector<T> output(both.size());
+    for (size_t i = 0; i < both.size(); ++i)
+        output[i] = static_cast<T>(std::clamp(both[i], 0.0, maxValue) + 0.5);
+    return output;
+}
+
+static ImageData makeSource(int width, int height, bool is16Bit)
+{
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.channels = 3;
+    image.is16Bit = is16Bit;
+    const size_t values = static_cast<size_t>(width) * height * 3;
+    std::srand(1);
+    if (is16Bit)
+    {
+        image.pixels16.resize(values);
+        for (uint16_t &value : image.pixels16)
+            value = static_cast<uint16_t>(std::rand() & 0xffff);
+    }
+    else
+    {
+        image.pixels8.resize(values);
+        for (uint8_t &value : image.pixels8)
+            value = static_cast<uint8_t>(std::rand() & 0xff);
+    }
+    return image;
+}
+
+int main(int argc, char **argv)
+{
+    const double megapixels = argc > 1 ? std::atof(argv[1]) : 24.0;
+    const int outputEdge = argc > 2 ? std::atoi(argv[2]) : 1024;
+    const int sourceWidth = static_cast<int>(std::sqrt(megapixels * 1e6 * 1.5));
+    const int sourceHeight = static_cast<int>(sourceWidth / 1.5);
+    const int width = outputEdge;
+    const int height = static_cast<int>(std::lround(outputEdge / 1.5));
+
+    fmt::print("{}x{} -> {}x{}\n", sourceWidth, sourceHeight, width, height);
+    fmt::print("{:<8} {:<10} {:>10} {:>12} {:>12} {:>10}\n", "depth", "filter", "naive ms", "1 thread ms",
+               "all ms", "max diff");
+
+    for (bool is16Bit : {false, true})
+    {
+        const ImageData source = makeSource(sourceWidth, sourceHeight, is16Bit);
+        for (ResampleFilter filter : {ResampleFilter::Box, ResampleFilter::Triangle, ResampleFilter::Lanczos3})
+        {
+            auto start = Clock::now();
+            std::vector<int> naive;
+            if (is16Bit)
+            {
+                const auto out = naiveResample(source.pixels16, sourceWidth, sourceHeight, width, height, filter,
+                                               65535.0);
+                naive.assign(out.begin(), out.end());
+            }
+            else
+            {
+                const auto out = naiveResample(source.pixels8, sourceWidth, sourceHeight, width, height, filter,
+                                               255.0);
+                naive.assign(out.begin(), out.end());
+            }
+            const double naiveMs = millisecondsSince(start);
+
+            ResampleOptions options;
+            options.filter = filter;
+            options.threads = 1;
+            start = Clock::now();
+            resampleImage(source, width, height, options);
+            const double singleMs = millisecondsSince(start);
+
+            options.threads = 0;
+            start = Clock::now();
+            const auto parallel = resampleImage(source, width, height, options);
+            const double parallelMs = millisecondsSince(start);
+
+            int maxDifference = 0;
+            for (size_t i = 0; i < naive.size(); ++i)
+            {
+                const int fast = is16Bit ? parallel->pixels16[i] : parallel->pixels8[i];
+                maxDifference = std::max(maxDifference, std::abs(fast - naive[i]));
+            }
+            fmt::print("{:<8} {:<10} {:>10.1f} {:>12.1f} {:>12.1f} {:>10}\n", is16Bit ? "16-bit" : "8-bit",
+                       resampleFilterName(filter), naiveMs, singleMs, parallelMs, maxDifference);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Heap allocation tracking (opt-in)
+// Built with PHOTOCRISPY_TRACK_ALLOCATIONS (CMake option of the same name),
+// AllocationTracker.cpp replaces the global operator new / delete and counts
+// every allocation, per thread and attributed to the innermost
+// AllocationScope open on that thread. The UI loop brackets each frame with
+// beginAllocationFrame() / endAllocationFrame() and shows the result in the
+// Allocations window; a steady frame with nothing happening should allocate
+// nothing. Without the option the functions exist but count nothing.
+
+struct AllocationCount
+{
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;
+};
+
+// Scopes per frame report. Allocations under more distinct scopes than this
+// are added to the last one.
+constexpr size_t kMaxAllocationScopes = 32;
+
+struct AllocationScopeCount
+{
+    // The name given to AllocationScope, "(unscoped)" for the rest
+    const char *scope = nullptr;
+    AllocationCount count;
+};
+
+// Fixed size, so taking a report allocates nothing itself.
+struct AllocationFrame
+{
+    AllocationCount total;
+    std::array<AllocationScopeCount, kMaxAllocationScopes> scopes{};
+    size_t scopeCount = 0;
+};
+
+// Attributes the calling thread's allocations to name until destroyed.
+// name must outlive the frame report (a string literal).
+class AllocationScope
+{
+public:
+    explicit AllocationScope(const char *name);
+    ~AllocationScope();
+    AllocationScope(const AllocationScope &) = delete;
+    AllocationScope &operator=(const AllocationScope &) = delete;
+};
+
+// False when built without PHOTOCRISPY_TRACK_ALLOCATIONS.
+bool allocationTrackingEnabled();
+
+// Resets the calling thread's frame counts.
+void beginAllocationFrame();
+// The calling thread's allocations since beginAllocationFrame().
+AllocationFrame endAllocationFrame();
+
+// Every thread, since the start of the process.
+AllocationCount processAllocations();
@@ -1,14 +1,41 @@
 #pragma once
+#include "AllocationTracker.h"
+#include "AutoAdjust.h"
+#include "BatchRender.h"
+#include "Culling.h"
+#include "DecodeCache.h"
+#include "DecoderBackend.h"
+#include "Demosaic.h"
+#include "DetailFilters.h"
+#include "DevelopLut.h"
+#include "DevelopPipeline.h"
 #include "FileBrowser.h"
+#include "FolderWatcher.h"
+#include "ImageLoadPipeline.h"
 #include "ImageLoader.h"
+#include "ImportPipeline.h"
 #include "LoadResultQueue.h"
+#include "MetricsRegistry.h"
+#include "SessionRecording.h"
+#include "ViewportTiles.h"
+#include "graphics/asyncReadback.h"
+#include "graphics/gpuDetailFilters.h"
+#include "graphics/frameTimer.h"
+#include "graphics/gpuDemosaic.h"
+#include "graphics/renderTarget.h"
+#include "graphics/shaderBinaryCache.h"
 #include "graphics/shaderProgram.h"
 #include "graphics/triangleRenderer.h"
 #include <GLFW/glfw3.h>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <future>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /*
@@ -17,15 +44,55 @@ std::ptional - to return a valor when its needed but if not, there's no problem
 
 */
 
+// Timing of one processImage() call, shown in the Develop panel.
+struct ProcessingStepTiming {
+  double cpuMs = 0.0;
+  double gpuMs = 0.0;
+  int width = 0;
+  int height = 0;
+  bool proxy = false;
+};
+
+// Startup timings in ms since the App was constructed, shown in About and
+// recorded as the startup.* metrics.
+struct StartupMetrics {
+  // Window, GL context, ImGui and the cached preview
+  double criticalInitMs = 0.0;
+  double firstFrameMs = 0.0;
+  // Shader compiles and the like, run after the first frame
+  double deferredInitMs = 0.0;
+  // 0 until the reopened last file is on screen; stays 0 when there was
+  // none, as a file opened later by hand says nothing about startup
+  double firstImageMs = 0.0;
+  bool reopenedLastFile = false;
+  bool restoredFromCache = false;
+};
+
+// Command line, see main.cpp
+struct AppOptions {
+  // Appends every frame's input to this file (SessionRecording.h)
+  fs::path recordSession;
+  // Drives the app from a recording instead of the user, then quits.
+  // Headless: LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -a photocrispy --replay ...
+  fs::path replaySession;
+  // Per-frame CPU and GPU times as CSV, written when run() returns
+  fs::path frameTimes;
+  // This program, started with --batch-worker for Export Folder
+  std::string executable;
+};
+
 class App {
 
 public:
-  bool init();
+  bool init(const AppOptions &options = {});
   void run();
   void shutdown();
 
 private:
   std::string m_lastDir = ".";
+  // Restored on launch from its cached preview
+  std::string m_lastFile;
+  fs::path m_previewCacheFile;
   fs::path m_filmstripDir;
   void renderUI();
   void renderMenuBar();
@@ -34,45 +101,254 @@ private:
   void photoViewer();
   void filmStrip();
   void drawAboutWindow();
+  void drawGpuMemoryWindow();
+  void drawPerformanceWindow();
+  void drawImportWindow();
+  void drawExportWindow();
+  void drawAllocationWindow();
 
   void registerSettingsHandler();
+  void restoreLastImage();
+  void runDeferredInit();
+  double millisecondsSinceLaunch() const;
   void clearImage();
+  std::optional<RawImage> developMosaic(const RawMosaic &mosaic);
 
   bool initImageProcessing();
   void resizeProcessedImage(int width, int height);
   void processImage();
+  // sourceRegion: part of the source in texture coordinates, nullptr = all
+  void renderDevelopPass(RenderTarget &target,
+                         const float *sourceRegion = nullptr);
+  void renderDetailPasses(RenderTarget &target);
+  uint64_t tileRevision() const;
+  void renderTile(size_t slot, const TileKey &key);
+  void drawImageTiles(float originX, float originY, float scale,
+                      const ImageRect &visible);
+  void pollProcessingTiming();
+  void setDevelopUniforms(GLuint program, size_t passIndex);
+  void uploadDevelopLut(const DevelopLut &lut);
   void destroyImageProcessing();
 
-  void openNewFile(const fs::path &path);
+  // Why a file is opened, which picks its loader options
+  enum class OpenReason {
+    Browse,   // picked by the user
+    Capture,  // newest file of the watch folder, see pollWatchFolder()
+    CullDwell // culling rested on it; the ring already shows its preview
+  };
+  void openNewFile(const fs::path &path,
+                   OpenReason reason = OpenReason::Browse);
+
+  // Watch folder (File > Watch Folder), for tethered shooting: files the
+  // camera software finishes in the filmstrip folder are listed without a
+  // rescan and the newest is opened, preview first. Latencies run from the
+  // file's last write to the frame that uploads it.
+  void pollWatchFolder();
+  void recordCaptureLatency(const LoadResult &result);
+  FolderWatcher m_folderWatcher;
+  // Reused every frame so an idle poll allocates nothing
+  std::vector<CapturedFile> m_captures;
+  CapturedFile m_capture;
+  // Loader generation of m_capture; 0 once its full image is shown
+  uint64_t m_captureGeneration = 0;
+  struct CaptureLatency {
+    double seenMs = 0.0;
+    double previewMs = 0.0;
+    double fullMs = 0.0;
+  } m_captureLatency;
+
+  // Card import (File > Import). importFiles() runs on m_import; files with
+  // a thumbnail come back through m_importedFiles and the thumbnails are
+  // uploaded for the filmstrip, so nothing is read from the card twice.
+  void startImport();
+  void collectImportedFiles();
+  static constexpr int kThumbnailEdge = 160;
+  std::future<ImportSummary> m_import;
+  std::atomic<bool> m_importCancel{false};
+  std::atomic<size_t> m_importTotal{0};
+  std::atomic<size_t> m_importDone{0};
+  std::atomic<uint64_t> m_importBytes{0};
+  std::chrono::steady_clock::time_point m_importStart;
+  std::optional<ImportSummary> m_importSummary;
+  fs::path m_importSource;
+  fs::path m_importDestination;
+  LoadResultQueue<ImportedFile> m_importedFiles;
+  bool m_showImportWindow = false;
+
+  // Folder export (File > Export Folder). runBatchRender() runs on m_export
+  // and renders the filmstrip files with the current develop settings on
+  // worker processes of this program.
+  void startExport();
+  std::future<BatchSummary> m_export;
+  std::atomic<bool> m_exportCancel{false};
+  std::atomic<size_t> m_exportTotal{0};
+  std::atomic<size_t> m_exportDone{0};
+  std::atomic<size_t> m_exportFailed{0};
+  std::chrono::steady_clock::time_point m_exportStart;
+  std::optional<BatchSummary> m_exportSummary;
+  fs::path m_exportDestination;
+  bool m_showExportWindow = false;
+  struct FilmstripThumbnail {
+    RawImage image;
+    TextureBudget::Handle handle = 0;
+  };
+  std::unordered_map<std::string, FilmstripThumbnail> m_thumbnails;
+  // Evicted or replaced during the frame, deleted after its draw data is
+  // rendered (the filmstrip may already have drawn them)
+  std::vector<unsigned int> m_retiredThumbnails;
+  void releaseThumbnail(const std::string &path);
+  void destroyRetiredThumbnails();
+
+  // Session record / replay and per-frame timing
+  void recordInputEvents();
+  bool replayInputEvents();
+  void finishSession();
+  AppOptions m_options;
+  SessionWriter m_sessionWriter;
+  std::optional<SessionRecording> m_replay;
+  size_t m_replayFrame = 0;
+  FrameTimer m_frameTimer;
+  bool m_timingFrames = false;
+  std::vector<FrameTiming> m_frameTimings;
 
   GLFWwindow *m_window = nullptr;
   std::optional<RawImage> m_image;
+  // Every texture allocation is reported here (GPU Memory window)
+  TextureBudget m_textureBudget;
+  TextureBudget::Handle m_imageTextureHandle = 0;
+  bool m_showGpuMemoryWindow = false;
+  // Counters, gauges and latencies (Performance window). Updated from the
+  // loader threads too.
+  MetricsRegistry m_metrics;
+  // Set every frame; a lookup by name would allocate the name
+  Gauge &m_textureBytesGauge = m_metrics.gauge("memory.texture_bytes");
+  // Heap allocations of the last frame on the UI thread, by scope
+  // (AllocationTracker.h, needs PHOTOCRISPY_TRACK_ALLOCATIONS)
+  AllocationFrame m_frameAllocations;
+  bool m_showAllocationWindow = false;
+  std::chrono::steady_clock::time_point m_lastFrameStart;
+  bool m_showPerformanceWindow = false;
   // editing the image
   ShaderProgram m_imageProcessingShader;
   GLuint m_processingVao = 0;
-  GLuint m_processingFramebuffer = 0;
-  GLuint m_processedTexture = 0;
-  int m_processedWidth = 0;
-  int m_processedHeight = 0;
+  RenderTarget m_processedTarget;
   bool m_processingReady = false;
   bool m_processingDirty = false;
+  // Screen-sized target rendered while an adjustment slider is dragged
+  RenderTarget m_proxyTarget;
+  bool m_useProxyWhileDragging = true;
+  bool m_adjustmentActive = false;
+  bool m_showingProxy = false;
+  float m_viewerImageWidth = 0.0f;
+  float m_viewerImageHeight = 0.0f;
+  // Zoomed-in viewer: only the tiles around the visible rectangle are
+  // developed, cached per (tile, image, settings). The cache grows with the
+  // viewer, see tileSlotsForView().
+  static constexpr int kTileSize = 512;
+  static constexpr int kMarginTilesPerFrame = 2;
+  TileCache m_tileCache{48};
+  std::vector<RenderTarget> m_tileTargets;
+  // Evicted during the frame, deleted after its draw data is rendered
+  std::vector<RenderTarget> m_retiredTiles;
+  void destroyRetiredTiles();
+  bool m_useRoiProcessing = true;
+  bool m_roiActive = false;
+  int m_tilesRendered = 0;
+  uint64_t m_imageRevision = 0;
+  // Slider step latency
+  GLuint m_processingQuery = 0;
+  bool m_processingQueryPending = false;
+  ProcessingStepTiming m_pendingStep;
+  ProcessingStepTiming m_lastStep;
+  // Luminance histogram of the developed image, read back without
+  // stalling and binned on a worker (Develop panel).
+  static constexpr int kHistogramBins = 64;
+  AsyncReadback m_readback;
+  bool m_readbackReady = false;
+  std::mutex m_histogramMutex;
+  std::array<float, kHistogramBins> m_histogram{};
+  // Callbacks may finish out of order; older results are dropped.
+  uint64_t m_histogramRequests = 0;
+  uint64_t m_histogramShown = 0;
+  void requestHistogram(const RenderTarget &target);
   // FileBrowser
   FileBrowser browser;
-  // Background loading emits preview and full images into this queue.
-  std::vector<std::future<void>> m_loadFutures;
-  LoadResultQueue<LoadResult> m_loadResults;
-  LoadResultQueue<uint64_t> m_completedLoads;
-  uint64_t m_loadGeneration = 0;
+  // Full decodes from earlier sessions, shared by the loader threads
+  static constexpr uint64_t kDecodeCacheBudgetBytes = 4ull << 30;
+  std::optional<DecodeCache> m_decodeCache;
+  // Every decode goes through here (DecoderBackend.h)
+  DecoderRegistry m_decoders;
+  // Background loading emits preview and full images, see
+  // ImageLoadPipeline.h
+  ImageLoadPipeline m_loader{m_decoders, m_metrics};
+
+  // Culling (View > Culling): the arrow keys step through the filmstrip on
+  // embedded previews, each ring slot of m_cull pinned as a texture, so a
+  // step only changes the texture drawn. 0-5 rate, X rejects, Esc leaves.
+  // Resting on an image opens it; its full image then replaces the preview.
+  void startCulling();
+  void stopCulling();
+  // Keys, extraction, uploads and dwell; once per frame before the viewer
+  void updateCulling();
+  // False when the viewer should draw m_image instead
+  bool drawCullView();
+  void releaseCullTexture(size_t slot);
+  CullSession m_cull{m_decoders, m_metrics};
+  struct CullTexture {
+    RawImage image;
+    TextureBudget::Handle handle = 0;
+    // Stands in for the loader's, which the dwell open skips
+    std::shared_ptr<const AutoAdjustment> autoAdjust;
+  };
+  std::vector<std::optional<CullTexture>> m_cullTextures;
+  // Loader generation of the dwell open; 0 after the cursor moved
+  uint64_t m_cullGeneration = 0;
+  bool m_cullFullShown = false;
+  bool m_cullSwitchRecorded = false;
+  // Suggestion for the image on screen, nullptr until its preview arrived
+  std::shared_ptr<const AutoAdjustment> m_autoAdjust;
+  // Full decode: 0 = LibRaw dcraw_process(), 1 = in-house bilinear,
+  // 2 = in-house edge-directed, 3 = GPU. Applies to the next opened file.
+  // LibRaw unless the in-house path is picked in the Develop panel.
+  int m_demosaicMode = 0;
+  // GPU demosaic: the mosaic is developed once into a new target, which
+  // replaces m_demosaicTarget on success and then serves as the source
+  // texture.
+  GpuDemosaic m_gpuDemosaic;
+  RenderTarget m_demosaicTarget;
+  bool m_gpuDemosaicReady = false;
+  // Linked programs from earlier runs, see ShaderProgram::useBinaryCache()
+  std::optional<ShaderBinaryCache> m_shaderCache;
+  bool m_imageOnDemosaicTarget = false;
 
-  // renderer
+  // renderer. Only needed by the About window, created when first shown.
   TriangleRenderer newTriangle;
-  // shows "Loading..." in photoViewer()
-  bool m_loading = false;
+  bool m_triangleReady = false;
+
+  const std::chrono::steady_clock::time_point m_launchTime =
+      std::chrono::steady_clock::now();
+  StartupMetrics m_startup;
+  bool m_deferredInitDone = false;
   bool m_showingPreview = false;
   bool m_showAboutWindow = false;
 
-  // Adjustments
-  float m_exposure = 0.0f;
-  float m_color[3] = {1.0f, 1.0f, 1.0f};
+  // Adjustments. The pipeline turns m_develop into the processing shader.
+  DevelopSettings m_develop;
+  DevelopPipeline m_developPipeline = makeDetailDevelopPipeline();
+  // Sharpening and noise reduction run after the develop pass, which then
+  // renders into m_developedTarget. It is kept while only detail settings
+  // change.
+  GpuDetailFilters m_detailFilters;
+  bool m_detailFiltersReady = false;
+  RenderTarget m_developedTarget;
+  uint64_t m_developedKey = 0;
+  // Baked 3D LUT of the develop pass. Used once ready, the generated shader
+  // is used while it bakes.
+  DevelopLutBaker m_lutBaker{m_developPipeline};
+  ShaderProgram m_lutShader;
+  GLuint m_lutTexture = 0;
+  uint64_t m_lutTextureKey = 0;
+  TextureBudget::Handle m_lutTextureHandle = 0;
+  bool m_useDevelopLut = true;
   float m_zoom = 1.0f;
 };
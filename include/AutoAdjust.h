@@ -0,0 +1,48 @@
+#pragma once
+#include "DevelopPipeline.h"
+#include "ImageLoader.h"
+#include <optional>
+
+struct RawMosaic;
+
+// Auto exposure and white balance
+// Suggests DevelopSettings from a strided subsample of the image (a few
+// tens of thousands of pixels), so it costs a millisecond or two instead of
+// a full-resolution pass. Statistics are taken on the values the develop
+// stages see (display-referred 0..1), so the suggestion can be applied as is.
+// No GL; the loader runs it on the preview and batch tools can call it
+// directly.
+
+struct AutoAdjustOptions
+{
+    // Roughly how many pixels to look at; the stride follows from it.
+    int targetSamples = 1 << 16;
+    // Where the median luminance should land after the exposure change.
+    float targetMedian = 0.42f;
+    // Luminance percentile kept below 1 so highlights don't clip.
+    float highlightPercentile = 0.99f;
+    // Channels at or above this are clipped, at or below blackLevel noise;
+    // neither counts towards the white balance.
+    float clipLevel = 0.97f;
+    float blackLevel = 0.02f;
+};
+
+struct AutoAdjustment
+{
+    // DevelopSettings units: stops, and multipliers with green at 1.
+    float exposure = 0.0f;
+    float whiteBalance[3] = {1.0f, 1.0f, 1.0f};
+    // Pixels looked at.
+    int samples = 0;
+};
+
+// nullopt for empty or malformed input (needs 3 or 4 channels) and for
+// images too thin to sample. A black frame gets no exposure change.
+std::optional<AutoAdjustment> estimateAutoAdjustment(const ImageData &image, const AutoAdjustOptions &options = {});
+// Straight from the sensor data: averages each CFA cell of the subsample,
+// then applies the mosaic's white balance, colour matrix and the BT.709
+// curve the demosaic uses, so the result matches its output.
+std::optional<AutoAdjustment> estimateAutoAdjustment(const RawMosaic &mosaic, const AutoAdjustOptions &options = {});
+
+// Copies exposure and white balance into settings.
+void applyAutoAdjustment(const AutoAdjustment &adjustment, DevelopSettings &settings);
@@ -0,0 +1,136 @@
+#pragma once
+#include "DevelopPipeline.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Batch render
+// Exports many raw files through separate worker processes instead of
+// threads: each worker has its own heap and runs LibRaw single-threaded
+// stages in parallel with the others, and a file that crashes the decoder
+// only takes its worker down. The coordinator hands out one job at a time
+// per worker, starts a new worker when one dies, retries failed jobs and
+// reports every finished one.
+//
+// Workers talk to the coordinator over a stream socket, one text line per
+// message (fields separated by a space, paths and errors after a tab):
+//   worker      -> coordinator  HELLO <version>
+//   coordinator -> worker       JOB <id> <targetEdge> <settings...>\t<input>\t<output>
+//   worker      -> coordinator  DONE <id> <renderMs>
+//   worker      -> coordinator  FAIL <id>\t<error>
+//   coordinator -> worker       QUIT
+// Nothing in it is specific to a local process, so a worker on another host
+// only needs a connected socket and the same paths (shared storage).
+
+constexpr int kBatchProtocolVersion = 1;
+
+struct BatchJob
+{
+    uint64_t id = 0;
+    std::string input;
+    std::string output;
+    DevelopSettings settings;
+    // > 0: longest edge of the output, 0 keeps the full size
+    int targetEdge = 0;
+};
+
+enum class BatchMessageType
+{
+    Hello,
+    Job,
+    Done,
+    Failed,
+    Quit
+};
+
+struct BatchMessage
+{
+    BatchMessageType type = BatchMessageType::Quit;
+    // Hello
+    int version = kBatchProtocolVersion;
+    // Job; Done and Failed only use job.id
+    BatchJob job;
+    double renderMs = 0.0;
+    std::string error;
+};
+
+// One line, '\n' included. Tabs, newlines and backslashes in paths and
+// errors are escaped.
+std::string formatBatchMessage(const BatchMessage &message);
+// line without its '\n'. std::nullopt for anything malformed.
+std::optional<BatchMessage> parseBatchMessage(const std::string &line);
+
+// Renders one job, true on success. Runs in the worker process.
+using BatchRenderFunction = std::function<bool(const BatchJob &job, std::string &error)>;
+
+// decodeFullRawImage(), the develop pipeline with the detail stages, then
+// writeDevelopedPpm() (BatchRenderJob.cpp).
+bool renderBatchJob(const BatchJob &job, std::string &error);
+
+// 16-bit binary PPM, values clamped to 0..1. Written to "<path>.part" and
+// renamed, so an interrupted export leaves no complete looking file.
+bool writeDevelopedPpm(const DevelopImage &image, const std::filesystem::path &path);
+
+// Worker side: says HELLO on fd, then renders jobs until QUIT or the
+// coordinator goes away. Returns the process exit code.
+int runBatchWorker(int fd, const BatchRenderFunction &render = renderBatchJob);
+
+// One job per file, written to destination as "<stem>.ppm" (clashing stems
+// get a "-2" style suffix).
+std::vector<BatchJob> makeExportJobs(const std::vector<std::filesystem::path> &files,
+                                     const std::filesystem::path &destination, const DevelopSettings &settings,
+                                     int targetEdge = 0);
+
+// The running program, for BatchOptions::workerCommand: /proc/self/exe where
+// there is one, argv0 otherwise.
+std::string batchWorkerExecutable(const char *argv0);
+
+struct BatchOptions
+{
+    // Program and arguments of a worker; "--batch-worker <fd>" is appended.
+    std::vector<std::string> workerCommand;
+    // Worker processes, 0 = half the hardware threads (at least 1).
+    unsigned workers = 0;
+    // Tries per job, crashes and reported failures alike.
+    int maxAttempts = 3;
+    // A job running longer kills its worker and counts as a failed try;
+    // 0 = no limit.
+    double jobTimeoutSeconds = 0.0;
+};
+
+struct BatchJobResult
+{
+    BatchJob job;
+    bool ok = false;
+    int attempts = 0;
+    // Of the last try when not ok
+    std::string error;
+    double renderMs = 0.0;
+};
+
+struct BatchSummary
+{
+    size_t rendered = 0;
+    size_t failed = 0;
+    // Tries that failed and were handed out again
+    size_t retries = 0;
+    // Workers that died with a job (crash, kill or timeout)
+    size_t workerCrashes = 0;
+    size_t workersStarted = 0;
+    double seconds = 0.0;
+    // Stopped early through the cancel flag
+    bool cancelled = false;
+};
+
+// Renders jobs on local worker processes. onResult is called on the calling
+// thread as each job finishes for good. Jobs not handed out when *cancel
+// turns true are left out; running ones are waited for. Jobs fail without
+// running if no worker can be started (POSIX only).
+BatchSummary runBatchRender(const std::vector<BatchJob> &jobs, const BatchOptions &options,
+                            const std::function<void(const BatchJobResult &)> &onResult = {},
+                            const std::atomic<bool> *cancel = nullptr);
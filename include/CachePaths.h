@@ -0,0 +1,8 @@
+#pragma once
+#include <filesystem>
+
+// Per-user cache directory for PhotoCrispy (created on first call).
+// $XDG_CACHE_HOME/photocrispy or ~/.cache/photocrispy on Linux,
+// ~/Library/Caches/PhotoCrispy on macOS, %LOCALAPPDATA%\PhotoCrispy\Cache on
+// Windows. Falls back to the temp directory when none of these is usable.
+std::filesystem::path userCacheDirectory();
@@ -0,0 +1,192 @@
+#pragma once
+#include "DecoderBackend.h"
+#include "LoadResultQueue.h"
+#include "MetricsRegistry.h"
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct AutoAdjustment;
+
+// Rapid culling
+// Steps through a folder on embedded previews only. A ring of slots around
+// the cursor holds the neighbours' previews, extracted in the background;
+// the owner keeps one GPU texture per slot, so moving the cursor onto a
+// resident neighbour only changes which texture is drawn. Ratings and
+// rejects go to one sidecar file in the folder. The full decode is left to
+// the owner, once the cursor rests on an image (dwell).
+
+// Which file each slot holds. A file's slot is file % capacity, so the
+// 2 * radius + 1 files around the cursor never share one; a slot is reused
+// once its file has left the window.
+class CullRing
+{
+public:
+    CullRing(size_t fileCount, size_t radius);
+
+    void setCursor(size_t file);
+    size_t cursor() const { return m_cursor; }
+    size_t capacity() const { return m_slots.size(); }
+
+    // Slot holding file's preview, std::nullopt if it is not resident.
+    std::optional<size_t> resident(size_t file) const;
+    // Nearest file to the cursor (ahead first) whose preview is neither
+    // resident, requested nor failed; its slot is claimed for it.
+    std::optional<size_t> nextMissing();
+    // A requested preview arrived: the slot to store it in. std::nullopt
+    // if the slot was claimed by another file since.
+    std::optional<size_t> place(size_t file);
+    // No preview for file: not requested again while it holds the slot.
+    void fail(size_t file);
+    bool failed(size_t file) const;
+
+private:
+    enum class State
+    {
+        Empty,
+        Requested,
+        Resident,
+        Failed
+    };
+    struct Slot
+    {
+        size_t file = 0;
+        State state = State::Empty;
+    };
+
+    const Slot &slotOf(size_t file) const { return m_slots[file % m_slots.size()]; }
+    Slot &slotOf(size_t file) { return m_slots[file % m_slots.size()]; }
+
+    std::vector<Slot> m_slots;
+    size_t m_fileCount;
+    size_t m_radius;
+    size_t m_cursor = 0;
+};
+
+// rating 0 - 5 stars
+struct CullMark
+{
+    int rating = 0;
+    bool rejected = false;
+
+    bool operator==(const CullMark &other) const { return rating == other.rating && rejected == other.rejected; }
+};
+
+// By file name
+using CullMarks = std::map<std::string, CullMark>;
+
+// folder / "photocrispy-cull.txt"
+std::filesystem::path cullSidecarPath(const std::filesystem::path &folder);
+// Empty when the sidecar is missing or unreadable; bad lines are skipped.
+CullMarks loadCullMarks(const std::filesystem::path &sidecar);
+// One "rating flag name" line per marked file. Writes atomically (temp
+// file + rename). False on I/O errors.
+bool saveCullMarks(const std::filesystem::path &sidecar, const CullMarks &marks);
+
+struct CullOptions
+{
+    // Previews kept on each side of the cursor
+    size_t radius = 4;
+    // Longest edge of a ring preview; bigger embedded previews are resampled
+    // down with resampleToFit()
+    int maxEdge = 2048;
+    // Extractions running at once
+    size_t workers = 2;
+    // Resting this long on an image asks for its full decode
+    double dwellMs = 600.0;
+};
+
+struct CullPreview
+{
+    size_t file = 0;
+    size_t slot = 0;
+    ImageData image;
+    // Estimated from the preview on the extraction thread, so the dwell open
+    // does not need the loader's preview for it. nullptr if it could not be.
+    std::shared_ptr<const AutoAdjustment> autoAdjust;
+};
+
+class CullSession
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // decoders and metrics must outlive the session.
+    CullSession(const DecoderRegistry &decoders, MetricsRegistry &metrics);
+    ~CullSession();
+    CullSession(const CullSession &) = delete;
+    CullSession &operator=(const CullSession &) = delete;
+
+    // Culls files (all in one folder) starting at cursor. Marks are read
+    // from the folder's sidecar.
+    void start(std::vector<std::filesystem::path> files, size_t cursor, const CullOptions &options = {});
+    // Waits for running extractions.
+    void stop();
+    bool active() const { return m_ring.has_value(); }
+
+    // Moves the cursor by step, clamped to the list. False if it did not move.
+    bool move(int step);
+    size_t cursor() const { return m_ring ? m_ring->cursor() : 0; }
+    size_t fileCount() const { return m_files.size(); }
+    const std::filesystem::path &file(size_t index) const { return m_files[index]; }
+    const std::filesystem::path &currentFile() const { return m_files[cursor()]; }
+    // file(index).filename(), made once by start()
+    const std::string &fileName(size_t index) const { return m_names[index]; }
+    // When the cursor last moved (or the session started)
+    Clock::time_point movedAt() const { return m_movedAt; }
+
+    // Reaps finished extractions and starts the nearest missing ones. Call
+    // once per frame.
+    void update();
+    // Next extracted preview that still has its slot.
+    std::optional<CullPreview> takePreview();
+    std::optional<size_t> residentSlot(size_t file) const;
+    bool previewFailed(size_t file) const;
+    size_t inFlight() const { return m_workers.size(); }
+
+    // True once per cursor position, when it has rested there for dwellMs.
+    bool takeDwell(Clock::time_point now);
+
+    const CullMark &mark(size_t file) const { return m_marks[file]; }
+    // Both save the sidecar; false if that failed.
+    bool setRating(int rating);
+    bool toggleReject();
+
+private:
+    struct Extracted
+    {
+        uint64_t session = 0;
+        size_t file = 0;
+        std::optional<ImageData> image;
+        std::shared_ptr<const AutoAdjustment> autoAdjust;
+    };
+
+    void extract(size_t file, const std::string &path, uint64_t session);
+    bool setMark(const CullMark &mark);
+
+    const DecoderRegistry &m_decoders;
+    MetricsRegistry &m_metrics;
+    CullOptions m_options;
+    std::vector<std::filesystem::path> m_files;
+    std::vector<std::string> m_names;
+    std::optional<CullRing> m_ring;
+    Clock::time_point m_movedAt;
+    bool m_dwellTaken = false;
+
+    std::filesystem::path m_sidecar;
+    // Everything in the sidecar, including files no longer in the folder
+    CullMarks m_sidecarMarks;
+    // Per file, looked up without building the name every frame
+    std::vector<CullMark> m_marks;
+
+    // Results of an earlier start() are dropped
+    uint64_t m_session = 0;
+    std::vector<std::future<void>> m_workers;
+    LoadResultQueue<Extracted> m_results;
+};
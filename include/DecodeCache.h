@@ -0,0 +1,58 @@
+#pragma once
+#include "ImageLoader.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Developed-image cache
+// Full 16-bit decodes (LibRaw or in-house demosaic) kept on disk so reopening
+// a file skips unpack and demosaic. Entries are keyed by the source path and
+// the decode parameters, and stamped with the source size and modification
+// time. Pixels are stored in bands of rows, each compressed on its own with
+// the lossless codec below, so bands are read and decoded in parallel
+// straight into the pixel buffer that gets uploaded.
+// The directory is kept under a size budget by evicting the least recently
+// used entries (a hit refreshes the entry's modification time).
+
+// Rows per independently compressed band.
+constexpr int kDecodeCacheBandRows = 64;
+
+// Lossless codec for one band of interleaved 16-bit pixels.
+// Each channel is coded separately: LOCO-I (MED) prediction, zig-zag
+// residuals, then blocks of 32 residuals bit-packed at the width of the
+// largest one. No compression library needed, and decoding is a few shifts
+// per sample.
+std::vector<uint8_t> encodeBand16(const uint16_t *pixels, int width, int rows, int channels);
+// False when data is truncated or malformed.
+bool decodeBand16(const uint8_t *data, size_t size, int width, int rows, int channels, uint16_t *out);
+
+class DecodeCache
+{
+public:
+    DecodeCache(std::filesystem::path directory, uint64_t budgetBytes);
+
+    // std::nullopt on a miss, or when the entry is stale or damaged (the
+    // entry is then deleted).
+    std::optional<ImageData> load(const std::string &sourcePath, const std::string &parameters);
+    // 16-bit images only. Evicts old entries afterwards if over budget.
+    bool store(const std::string &sourcePath, const std::string &parameters, const ImageData &image);
+
+    void setBudgetBytes(uint64_t bytes);
+    uint64_t budgetBytes() const { return m_budgetBytes; }
+    // Total size of the entries on disk.
+    uint64_t sizeBytes() const;
+    // Deletes least recently used entries until the cache fits the budget.
+    void trim();
+
+private:
+    std::filesystem::path entryPath(const std::string &sourcePath, const std::string &parameters) const;
+
+    std::filesystem::path m_directory;
+    std::atomic<uint64_t> m_budgetBytes;
+    std::mutex m_trimMutex;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include "ImageLoader.h"
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Decoder backends
+// Every way of turning a file into pixels (LibRaw, the in-house demosaic,
+// the embedded JPEG reader, stb) sits behind DecoderBackend. The registry
+// routes a request by file extension and wanted output to the cheapest
+// backend that supports it, falling back to the next one when a decode
+// fails. Tests register stub backends; decoder_bench times every backend on
+// the same files to set costs and preferences from measurements.
+
+enum class DecodeOutput
+{
+    // Filmstrip sized
+    Thumbnail,
+    // Fast screen sized image, usually an embedded JPEG
+    Preview,
+    // Every pixel, 16-bit when the source has it
+    Full,
+};
+
+const char *decodeOutputName(DecodeOutput output);
+
+struct DecodeRequest
+{
+    std::string path;
+    DecodeOutput output = DecodeOutput::Full;
+    // Longest edge the caller needs, 0 for native size. A hint: backends
+    // may return anything at least this big (and never upscale), except
+    // thumbnails, which the built-in backends shrink to fit it.
+    int targetEdge = 0;
+    // Tried first when it supports the request (Develop panel choice).
+    std::string preferredBackend;
+};
+
+// Lower-case extension with the dot, ".arw".
+std::string decodeExtension(const std::string &path);
+
+// Implementations must allow concurrent decode() calls.
+class DecoderBackend
+{
+public:
+    virtual ~DecoderBackend() = default;
+
+    virtual const char *name() const = 0;
+    virtual bool supports(const std::string &extension, DecodeOutput output) const = 0;
+    // Rough relative cost, lower is faster. Only compared between backends
+    // supporting the same request.
+    virtual int cost(const std::string &extension, DecodeOutput output) const = 0;
+    virtual std::optional<ImageData> decode(const DecodeRequest &request) const = 0;
+};
+
+class DecoderRegistry
+{
+public:
+    void add(std::shared_ptr<const DecoderBackend> backend);
+    // Routes (extension, output) to the named backend ahead of the cost
+    // order, e.g. from decoder_bench results. "*" matches any extension.
+    void prefer(const std::string &extension, DecodeOutput output, const std::string &backendName);
+
+    // Backends to try for a request, in order.
+    std::vector<std::shared_ptr<const DecoderBackend>> route(const DecodeRequest &request) const;
+    // First successful decode along route().
+    std::optional<ImageData> decode(const DecodeRequest &request) const;
+
+    std::vector<std::shared_ptr<const DecoderBackend>> backends() const;
+    std::shared_ptr<const DecoderBackend> find(const std::string &name) const;
+
+private:
+    struct Preference
+    {
+        std::string extension;
+        DecodeOutput output;
+        std::string backend;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<std::shared_ptr<const DecoderBackend>> m_backends;
+    std::vector<Preference> m_preferences;
+};
+
+// Adds the LibRaw, in-house demosaic (bilinear and edge-directed), embedded
+// JPEG, LibRaw thumbnail and stb backends (DecoderBackends.cpp).
+void registerDefaultDecoders(DecoderRegistry &registry);
@@ -0,0 +1,75 @@
+#pragma once
+#include "ImageLoader.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// In-house demosaic
+// Alternative to LibRaw's dcraw_process() that runs after unpack() on the raw
+// sensor data. The sensor is split into overlapping tiles that are processed
+// in parallel: black/white levels, white balance, demosaic, camera matrix and
+// output gamma all happen per tile while it is in cache.
+
+// Single-channel sensor data plus what is needed to develop it.
+struct RawMosaic
+{
+    std::vector<uint16_t> pixels;
+    int width = 0;
+    int height = 0;
+    // CFA colour (0 = R, 1 = G, 2 = B) of (row, col) is
+    // pattern[(row % patternHeight) * patternWidth + col % patternWidth].
+    // 2x2 for Bayer, 6x6 for X-Trans.
+    int patternWidth = 2;
+    int patternHeight = 2;
+    uint8_t pattern[36] = {0, 1, 1, 2};
+    // Per-colour black level and the sensor white level.
+    float black[3] = {0.0f, 0.0f, 0.0f};
+    float white = 65535.0f;
+    // White balance multipliers, smallest one is 1.
+    float whiteBalance[3] = {1.0f, 1.0f, 1.0f};
+    // Camera RGB to linear sRGB.
+    float cameraToRgb[3][3] = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+    // LibRaw orientation code (0 none, 3 = 180, 5 = 90 CCW, 6 = 90 CW).
+    int flip = 0;
+};
+
+enum class DemosaicQuality
+{
+    // Average of the same-colour neighbours. Any CFA layout.
+    Bilinear,
+    // Hamilton-Adams gradient-directed green plus colour-difference red/blue
+    // (AHD class). Bayer only; other layouts fall back to Bilinear.
+    EdgeDirected
+};
+
+struct DemosaicOptions
+{
+    DemosaicQuality quality = DemosaicQuality::EdgeDirected;
+    int tileSize = 256;
+    // 0 = all hardware threads.
+    unsigned threads = 0;
+    // BT.709 curve like LibRaw's default output; off gives linear output.
+    bool applyGamma = true;
+};
+
+inline int mosaicColor(const RawMosaic &mosaic, int row, int col)
+{
+    return mosaic.pattern[(row % mosaic.patternHeight) * mosaic.patternWidth + col % mosaic.patternWidth];
+}
+
+// 16-bit RGB ImageData (kind Full), same size as the mosaic. Orientation
+// (flip) is not applied here.
+ImageData demosaicMosaic(const RawMosaic &mosaic, const DemosaicOptions &options = {});
+
+// Peak signal-to-noise ratio in dB between two images of the same layout.
+// Used to validate the demosaic against LibRaw and the GPU path.
+double imagePsnr(const ImageData &a, const ImageData &b);
+
+// LibRaw side, defined in ImageLoader.cpp.
+// Opens and unpacks path and copies the visible sensor area with its CFA
+// layout, levels, camera white balance and colour matrix.
+std::optional<RawMosaic> extractRawMosaic(const std::string &path);
+// decodeFullRawImage() with demosaicMosaic() in place of dcraw_process().
+// The orientation is applied so the result matches LibRaw's.
+std::optional<ImageData> decodeRawWithDemosaic(const std::string &path, const DemosaicOptions &options = {});
@@ -0,0 +1,64 @@
+#pragma once
+#include "DevelopPipeline.h"
+
+// Detail filters
+// Capture sharpening and luminance / chroma noise reduction. Both work on a
+// luma and colour-difference split of the developed RGB,
+//   Y = (R + 2G + B) / 4, Cb = B - Y, Cr = R - Y,
+// which converts back exactly. The kernels are separable (a horizontal then a
+// vertical pass) and edge-aware: noise reduction weights neighbours by how
+// close their luma is, sharpening leaves detail below a threshold alone.
+// The CPU path filters tiles whose working set stays in L2, each with a halo
+// of kernel radius pixels, on parallelFor(). shaders/detailFilters.frag runs
+// the same kernels on the GPU (graphics/gpuDetailFilters.h).
+
+struct DetailFilterOptions
+{
+    // Output pixels per tile edge. A 128 tile with the largest halo works on
+    // about 300 KB of planes.
+    int tileSize = 128;
+    unsigned threads = 0;
+};
+
+// Kernel parameters derived from DevelopSettings, shared by the CPU and GPU
+// paths. Sigmas and radii are in output pixels: scale < 1 shrinks them for a
+// downscaled proxy.
+struct NoiseReductionKernel
+{
+    bool luma = false;
+    float lumaSigma = 1.0f;
+    // Luma difference at which a neighbour's weight halves
+    float lumaRange = 0.01f;
+    int lumaRadius = 0;
+    bool chroma = false;
+    float chromaSigma = 1.0f;
+    float chromaRange = 0.02f;
+    int chromaRadius = 0;
+};
+
+struct SharpenKernel
+{
+    bool active = false;
+    float sigma = 1.0f;
+    int radius = 0;
+    float amount = 0.0f;
+    float threshold = 0.0f;
+};
+
+NoiseReductionKernel noiseReductionKernel(const DevelopSettings &settings, float scale = 1.0f);
+SharpenKernel sharpenKernel(const DevelopSettings &settings, float scale = 1.0f);
+bool detailFiltersActive(const DevelopSettings &settings);
+
+// Both write every pixel of destination, which must have the size of source.
+// With the filter off the source is copied.
+void reduceNoise(const DevelopSettings &settings, const DevelopImage &source, DevelopImage &destination,
+                 const DetailFilterOptions &options = {});
+void sharpen(const DevelopSettings &settings, const DevelopImage &source, DevelopImage &destination,
+             const DetailFilterOptions &options = {});
+
+// Appends Noise Reduction and Sharpening as Neighborhood stages, so each is a
+// pass of its own whose output is cached until its parameters change.
+void addDetailStages(DevelopPipeline &pipeline, const DetailFilterOptions &options = {});
+
+// makeDefaultDevelopPipeline() followed by the detail stages.
+DevelopPipeline makeDetailDevelopPipeline();
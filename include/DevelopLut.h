@@ -0,0 +1,66 @@
+#pragma once
+#include "DevelopPipeline.h"
+#include "LoadResultQueue.h"
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// 3D LUT of a PerPixel develop pass.
+// Every per-pixel adjustment (exposure, white balance, curves...) is baked into
+// one size^3 table, so evaluating the whole stack costs one texture fetch in
+// the shader and one trilinear lookup on the CPU, regardless of stage count.
+// Entries are RGBA floats (alpha unused) so a CPU lookup is one 16-byte load.
+// Layout: index = (b * size + g) * size + r, matching a GL_TEXTURE_3D (x=r, y=g, z=b).
+struct DevelopLut
+{
+    int size = 0;
+    uint64_t key = 0;
+    std::vector<float> rgba;
+};
+
+// Evaluates pass passIndex of the pipeline on a size^3 grid over [0, 1].
+DevelopLut bakeDevelopLut(const DevelopPipeline &pipeline, const DevelopSettings &settings,
+                          int size, size_t passIndex = 0);
+
+// Trilinear lookup of pixelCount RGB triples. in and out may alias.
+// Uses SSE on x86, scalar code elsewhere.
+void applyDevelopLut(const DevelopLut &lut, const float *in, float *out, size_t pixelCount);
+
+// Bakes LUTs on a worker thread and keeps the most recent ones keyed by the
+// pass parameters. Only one bake runs at a time; while it runs, requests for
+// other settings replace each other so a slider drag doesn't queue up work.
+class DevelopLutBaker
+{
+public:
+    explicit DevelopLutBaker(DevelopPipeline pipeline, int size = 33, size_t cacheCapacity = 8);
+    ~DevelopLutBaker();
+
+    // Returns the cached LUT for settings, or nullptr after scheduling a bake.
+    std::shared_ptr<const DevelopLut> request(const DevelopSettings &settings);
+    // Moves finished bakes into the cache and starts the pending one.
+    // Call once per frame from the thread that calls request().
+    void collect();
+    // Blocks until nothing is baking. Tests and shutdown.
+    void wait();
+
+    int size() const { return m_size; }
+
+private:
+    void startBake(const DevelopSettings &settings, uint64_t key);
+
+    const DevelopPipeline m_pipeline;
+    const int m_size;
+    const size_t m_cacheCapacity;
+
+    // Most recently used first.
+    std::list<std::shared_ptr<const DevelopLut>> m_cache;
+    std::future<void> m_bake;
+    uint64_t m_bakingKey = 0;
+    LoadResultQueue<std::shared_ptr<const DevelopLut>> m_baked;
+    std::optional<std::pair<DevelopSettings, uint64_t>> m_pending;
+};
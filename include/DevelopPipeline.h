@@ -0,0 +1,136 @@
+#pragma once
+#include "ImageLoader.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Develop pipeline
+// DevelopSettings is the adjustment state edited by the Develop panel.
+// DevelopPipeline is the ordered list of stages that turns a source image
+// into the developed result. The pipeline only reads the settings, so the UI,
+// headless tools and tests can all drive the same stages.
+
+struct DevelopSettings
+{
+    float exposure = 0.0f;
+    float whiteBalance[3] = {1.0f, 1.0f, 1.0f};
+    // Detail (DetailFilters.h). Amounts of 0 turn a filter off.
+    float sharpenAmount = 0.0f;
+    // Gaussian sigma in pixels
+    float sharpenRadius = 1.0f;
+    // Luma detail below this is left unsharpened
+    float sharpenThreshold = 0.01f;
+    // 0..1
+    float lumaNoise = 0.0f;
+    float chromaNoise = 0.0f;
+};
+
+// Float RGB working buffer for the CPU path (3 floats per pixel, 0..1 range).
+struct DevelopImage
+{
+    std::vector<float> pixels;
+    int width = 0;
+    int height = 0;
+};
+
+// PerPixel stages only look at the pixel they write, so adjacent ones are
+// fused into one shader / one CPU pass.
+// Neighborhood stages read a window around each pixel. They run as their own
+// pass and their output is cached.
+enum class DevelopStageKind
+{
+    PerPixel,
+    Neighborhood
+};
+
+// One uniform value handed to the generated shader. components is 1..4.
+struct DevelopUniform
+{
+    std::string name;
+    int components = 1;
+    float values[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+struct DevelopStage
+{
+    std::string name;
+    DevelopStageKind kind = DevelopStageKind::PerPixel;
+
+    // GLSL for PerPixel stages.
+    // glslDeclarations goes above main(), glslBody modifies `vec3 color`.
+    std::string glslDeclarations;
+    std::string glslBody;
+    std::function<void(const DevelopSettings &, std::vector<DevelopUniform> &)> uniforms;
+
+    // Hash of the settings this stage reads. Drives the pass cache.
+    std::function<uint64_t(const DevelopSettings &)> parameterHash;
+
+    // CPU PerPixel: modify pixelCount RGB triples in place.
+    std::function<void(const DevelopSettings &, float *rgb, size_t pixelCount)> applyPixels;
+    // CPU Neighborhood: read source, write destination (same size).
+    std::function<void(const DevelopSettings &, const DevelopImage &source, DevelopImage &destination)> applyImage;
+};
+
+// A run of stages executed together.
+struct DevelopPass
+{
+    size_t firstStage = 0;
+    size_t stageCount = 0;
+    DevelopStageKind kind = DevelopStageKind::PerPixel;
+};
+
+class DevelopPipeline
+{
+public:
+    void addStage(DevelopStage stage);
+    const std::vector<DevelopStage> &stages() const { return m_stages; }
+
+    // Adjacent PerPixel stages are grouped into one pass,
+    // every Neighborhood stage gets a pass of its own.
+    const std::vector<DevelopPass> &passes() const { return m_passes; }
+
+    // Replaces the "// @DEVELOP_DECLARATIONS@" and "// @DEVELOP_BODY@" markers
+    // of shaderTemplate with the fused stages of a PerPixel pass.
+    std::string fragmentShaderSource(const std::string &shaderTemplate, size_t passIndex) const;
+    std::vector<DevelopUniform> uniforms(const DevelopSettings &settings, size_t passIndex) const;
+
+    // Runs the fused stages of a PerPixel pass over pixelCount RGB triples in place.
+    void applyPerPixelPass(size_t passIndex, const DevelopSettings &settings, float *rgb,
+                           size_t pixelCount) const;
+
+    // Hash of the settings read by the stages of passes [0, passIndex].
+    uint64_t passKey(const DevelopSettings &settings, size_t passIndex) const;
+
+    // CPU path. The output of every pass is cached under its key plus
+    // sourceRevision, so a change only re-runs the first changed pass and
+    // everything after it. Callers bump sourceRevision when the source changes.
+    const DevelopImage &process(const DevelopImage &source, uint64_t sourceRevision,
+                                const DevelopSettings &settings);
+    // Passes actually executed by the last process() call.
+    size_t lastExecutedPasses() const { return m_lastExecutedPasses; }
+    void invalidate();
+
+private:
+    struct PassCache
+    {
+        bool valid = false;
+        uint64_t key = 0;
+        DevelopImage output;
+    };
+
+    std::vector<DevelopStage> m_stages;
+    std::vector<DevelopPass> m_passes;
+    std::vector<PassCache> m_cache;
+    size_t m_lastExecutedPasses = 0;
+};
+
+// FNV-1a over raw floats, used by the stage parameter hashes.
+uint64_t hashDevelopValues(const float *values, size_t count, uint64_t seed = 1469598103934665603ull);
+
+// Exposure followed by white balance.
+DevelopPipeline makeDefaultDevelopPipeline();
+
+// Normalizes 8-bit or 16-bit ImageData into the CPU working buffer.
+DevelopImage toDevelopImage(const ImageData &image);
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Embedded JPEG locator
+// Finds the preview JPEGs inside a raw file by reading only the container
+// structure (TIFF IFDs for ARW/DNG/NEF/CR2/RW2, the RAF header) instead of
+// letting LibRaw parse all metadata. Only a few hundred bytes are read before
+// the JPEG itself.
+
+struct ByteRange
+{
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+// Reads size bytes at offset into out. Returns false on a short read.
+using ByteReader = std::function<bool(uint64_t offset, size_t size, uint8_t *out)>;
+
+// Positional reads on one open file (pread, so one reader can be shared by
+// threads). Falls back to std::ifstream where pread is not available.
+class FileRangeReader
+{
+public:
+    explicit FileRangeReader(const std::string &path);
+    ~FileRangeReader();
+    FileRangeReader(const FileRangeReader &) = delete;
+    FileRangeReader &operator=(const FileRangeReader &) = delete;
+
+    bool isOpen() const;
+    bool read(uint64_t offset, size_t size, uint8_t *out) const;
+    ByteReader reader() const;
+
+private:
+#ifdef _WIN32
+    std::string m_path;
+    bool m_open = false;
+#else
+    int m_fd = -1;
+#endif
+};
+
+// Baseline or progressive JPEGs only (lossless raw strips are skipped),
+// largest first. Empty for unknown layouts.
+std::vector<ByteRange> findEmbeddedJpegs(const ByteReader &read);
+std::vector<ByteRange> findEmbeddedJpegs(const uint8_t *data, size_t size);
+
+// Bytes of the largest embedded JPEG no bigger than maxBytes (the smallest
+// one when all are bigger). Empty when none is found.
+std::vector<uint8_t> readEmbeddedJpeg(const std::string &path, uint64_t maxBytes = UINT64_MAX);
@@ -1,4 +1,7 @@
+#include <cstdint>
 #include <filesystem>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -7,12 +10,40 @@ class FileBrowser
 {
 private:
     std::vector<std::filesystem::path> files;
+    // files[i].filename(), made once per Refresh() rather than every frame
+    std::vector<std::string> names;
     bool IsSupportedImage(const fs::path &path) const;
     fs::path selectedFile;
 
+    struct Thumbnail
+    {
+        unsigned int textureId = 0;
+        int width = 0;
+        int height = 0;
+        uint64_t tag = 0;
+    };
+    // Keyed by native() so the lookup in Draw() allocates nothing
+    std::unordered_map<fs::path::string_type, Thumbnail> thumbnails;
+    // Refilled by every Draw(); keeps its capacity
+    std::vector<uint64_t> drawnThumbnails;
+
 public:
     const fs::path& GetSelectedFile() const;
+    // In filmstrip order
+    const std::vector<fs::path> &GetFiles() const;
     bool Refresh(const std::filesystem::path &folder);
+    // Lists one new file without rescanning the folder (watch folder
+    // captures). False if it is not a supported image; already listed files
+    // are not added twice.
+    bool AddFile(const fs::path &file);
     bool Draw();
 
+    // Drawn next to the file name, e.g. thumbnails made during an import.
+    // The caller owns the textures; tag is its own id for one.
+    void SetThumbnail(const fs::path &file, unsigned int textureId, int width, int height, uint64_t tag = 0);
+    void RemoveThumbnail(const fs::path &file);
+    // Tags of the thumbnails the last Draw() put on screen (scrolled out
+    // ones are clipped), e.g. to keep them in a texture cache.
+    const std::vector<uint64_t> &GetDrawnThumbnails() const;
+
 };
@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+// Tethered shooting folder watch
+// Reports files that appear in a folder once they are completely written:
+// inotify IN_CLOSE_WRITE (the writer closed the file) or IN_MOVED_TO (the
+// writer renamed a finished temp file into place). Files still being
+// written produce nothing, so no size polling or settle delay is needed.
+// poll() never blocks and is meant to be called once per frame; events of
+// one burst are coalesced so each file is reported once. Linux only;
+// start() fails elsewhere.
+
+struct CapturedFile
+{
+    std::filesystem::path path;
+    // When poll() saw the finished file
+    std::chrono::steady_clock::time_point seen;
+    // From the file's last modification to poll() seeing it
+    double writeToSeenMs = 0.0;
+};
+
+class FolderWatcher
+{
+public:
+    FolderWatcher() = default;
+    ~FolderWatcher();
+    FolderWatcher(const FolderWatcher &) = delete;
+    FolderWatcher &operator=(const FolderWatcher &) = delete;
+
+    // Stops watching any previous folder. False when the folder can't be
+    // watched (or not on Linux).
+    bool start(const std::filesystem::path &folder);
+    void stop();
+    bool watching() const { return m_fd >= 0; }
+    const std::filesystem::path &folder() const { return m_folder; }
+
+    // Replaces captured with the files finished since the last call, oldest
+    // first, each once. Subfolders are ignored. False when nothing is new;
+    // then nothing is allocated either.
+    bool poll(std::vector<CapturedFile> &captured);
+    // True once after the kernel dropped events (queue overflow); the caller
+    // should list the folder again.
+    bool takeOverflow();
+
+private:
+    std::filesystem::path m_folder;
+    int m_fd = -1;
+    bool m_overflowed = false;
+    // read() buffer, allocated by start()
+    std::vector<char> m_events;
+};
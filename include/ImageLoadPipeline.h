@@ -0,0 +1,90 @@
+#pragma once
+#include "DecodeCache.h"
+#include "DecoderBackend.h"
+#include "ImageLoader.h"
+#include "LoadResultQueue.h"
+#include "MetricsRegistry.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Background loading of the image being viewed
+// open() starts a worker that pushes the preview, then the full image (or
+// the unpacked mosaic for the GPU path). Opening another file supersedes the
+// current one: the old worker runs to the end but its results are dropped by
+// takeResult(). No GL in here, so load_latency_bench drives the same code
+// the viewer does without a window.
+
+struct LoadOptions
+{
+    // Full decode: 0 = LibRaw dcraw_process(), 1 = in-house bilinear,
+    // 2 = in-house edge-directed, 3 = GPU (unpack only).
+    int demosaicMode = 0;
+    // The preview is saved here for the next launch; empty skips it.
+    std::filesystem::path previewCacheFile;
+    // Stop after the preview once a newer open() superseded this one, so a
+    // burst of tethered captures leaves the full decode to the newest.
+    bool skipFullWhenSuperseded = false;
+    // The caller already shows this file's preview (the culling ring): only
+    // the full image is pushed.
+    bool skipPreview = false;
+};
+
+class ImageLoadPipeline
+{
+public:
+    // decoders and metrics must outlive the pipeline.
+    ImageLoadPipeline(const DecoderRegistry &decoders, MetricsRegistry &metrics);
+    // Waits for the workers.
+    ~ImageLoadPipeline();
+
+    ImageLoadPipeline(const ImageLoadPipeline &) = delete;
+    ImageLoadPipeline &operator=(const ImageLoadPipeline &) = delete;
+
+    // Full decodes are looked up in / stored to cache (nullptr turns it off).
+    // Set before the first open(); the cache must outlive the pipeline.
+    void setDecodeCache(DecodeCache *cache);
+
+    // Starts loading path and returns its generation.
+    uint64_t open(const std::string &path, const LoadOptions &options);
+    // Next result of the current file, in the order the worker produced
+    // them. Results of superseded files are counted and dropped.
+    std::optional<LoadResult> takeResult();
+    // Reaps finished workers and updates the loader gauges. Call once per
+    // frame after draining takeResult().
+    void collect();
+    // Blocks until every worker has finished.
+    void wait();
+
+    // From open() until the current file's full image was taken or its
+    // worker gave up.
+    bool loading() const { return m_loading; }
+    uint64_t generation() const { return m_generation; }
+    size_t inFlight() const { return m_workers.size(); }
+
+    // Route, try each backend in turn and time the one that succeeds.
+    // Thread-safe.
+    std::optional<ImageData> decode(const DecodeRequest &request);
+
+private:
+    void load(const std::string &path, uint64_t generation, const LoadOptions &options);
+    void push(LoadResult result);
+
+    const DecoderRegistry &m_decoders;
+    MetricsRegistry &m_metrics;
+    // Set every frame by collect(); looked up once so that allocates nothing
+    Gauge &m_inFlightGauge;
+    Gauge &m_queueDepthGauge;
+    DecodeCache *m_decodeCache = nullptr;
+
+    std::vector<std::future<void>> m_workers;
+    LoadResultQueue<LoadResult> m_results;
+    LoadResultQueue<uint64_t> m_completed;
+    // Read by the workers to tell whether their work still matters.
+    std::atomic<uint64_t> m_generation{0};
+    bool m_loading = false;
+};
@@ -3,6 +3,8 @@
 #include <optional>
 #include <vector>
 #include <cstdint>
+#include <functional>
+#include <memory>
 
 // Preview or full image. To make notice to the UI of what's loading
 enum class ImageKind
@@ -27,12 +29,23 @@ struct ImageData
     bool is16Bit = false;
     ImageKind kind = ImageKind::Full;
 };
+// Sensor data for the demosaic paths, see Demosaic.h
+struct RawMosaic;
+// Suggested exposure / white balance, see AutoAdjust.h
+struct AutoAdjustment;
+
 // If the user opens file A, then quickly opens file B, the app can discard late results from file A
 // by checking the generation. That prevents stale preview/full results from replacing the newer image.
 struct LoadResult
 {
     uint64_t generation = 0;
     ImageData image;
+    // GPU demosaic path: the unpacked sensor data instead of pixels.
+    // image then only carries the size and kind.
+    std::shared_ptr<const RawMosaic> mosaic;
+    // Previews: estimated from the preview on the loader thread, offered by
+    // the Develop panel's Auto button.
+    std::shared_ptr<const AutoAdjustment> autoAdjust;
 };
 
 struct RawImage
@@ -43,6 +56,15 @@ struct RawImage
     ImageKind kind = ImageKind::Full;
 };
 // Decode and Extract - Exctrat Run first, then full decode of raw
-std::optional<ImageData> decodeFullRawImage(const std::string &path);
-std::optional<ImageData> extractEmbeddedPreviewImage(const std::string &path);
+// targetEdge > 0: decodes at half size (LibRaw half_size, much faster) when
+// that still gives a longest edge of at least targetEdge.
+std::optional<ImageData> decodeFullRawImage(const std::string &path, int targetEdge = 0);
+// Reads only the embedded JPEG when the layout is known (EmbeddedJpeg.h),
+// LibRaw otherwise. maxBytes picks a smaller JPEG when the file has several.
+std::optional<ImageData> extractEmbeddedPreviewImage(const std::string &path, uint64_t maxBytes = UINT64_MAX);
+// Previews of many files with at most maxInFlight being read at once.
+// onResult(index, preview) is called from the worker threads.
+void extractEmbeddedPreviewImages(const std::vector<std::string> &paths, unsigned maxInFlight,
+                                  const std::function<void(size_t, std::optional<ImageData>)> &onResult,
+                                  uint64_t maxBytes = UINT64_MAX);
 RawImage uploadTexture(const ImageData &data);
@@ -0,0 +1,187 @@
+#pragma once
+#include "ImageLoader.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+// Typed image views
+// ImageData is what decoders, caches and the loader pass around: 8 or 16-bit
+// values, 3 or 4 channels, decided at run time. Kernels take an
+// ImageView<T, Channels> instead, with the value type and channel count
+// known at compile time, so their loops have no per-value branches and
+// constant pixel strides. dispatchImage() is the one place that turns the
+// run-time format into a type: each kernel is instantiated once per format.
+
+// value type T (const for read-only views), Channels values per pixel.
+template <typename T, int Channels>
+struct ImageView
+{
+    static_assert(Channels >= 1 && Channels <= 4, "1 to 4 channels");
+    using Value = T;
+    static constexpr int channels = Channels;
+
+    T *data = nullptr;
+    int width = 0;
+    int height = 0;
+    // Values (not bytes) from the start of one row to the next
+    size_t stride = 0;
+
+    T *row(int y) const { return data + static_cast<size_t>(y) * stride; }
+    T *pixel(int x, int y) const { return row(y) + static_cast<size_t>(x) * Channels; }
+    bool empty() const { return width <= 0 || height <= 0; }
+
+    // A writable view converts to a read-only one.
+    template <typename U = T, typename = std::enable_if_t<!std::is_const_v<U>>>
+    operator ImageView<const T, Channels>() const
+    {
+        return {data, width, height, stride};
+    }
+};
+
+template <typename T, int Channels>
+using ConstImageView = ImageView<const T, Channels>;
+
+// Every row of an Image starts on this boundary (a cache line, and enough
+// for any vector load).
+constexpr size_t kImageRowAlignment = 64;
+
+// Owning image with aligned, padded rows. Zero-filled, move only.
+template <typename T, int Channels>
+class Image
+{
+public:
+    Image() = default;
+    Image(int width, int height) : m_width(width), m_height(height)
+    {
+        if (width <= 0 || height <= 0)
+        {
+            m_width = m_height = 0;
+            return;
+        }
+        constexpr size_t valuesPerAlignment = kImageRowAlignment / sizeof(T);
+        const size_t rowValues = static_cast<size_t>(width) * Channels;
+        m_stride = (rowValues + valuesPerAlignment - 1) / valuesPerAlignment * valuesPerAlignment;
+        const size_t bytes = m_stride * height * sizeof(T);
+        m_pixels.reset(static_cast<T *>(::operator new(bytes, std::align_val_t(kImageRowAlignment))));
+        std::memset(m_pixels.get(), 0, bytes);
+    }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    size_t stride() const { return m_stride; }
+    ImageView<T, Channels> view() { return {m_pixels.get(), m_width, m_height, m_stride}; }
+    ConstImageView<T, Channels> view() const { return {m_pixels.get(), m_width, m_height, m_stride}; }
+
+private:
+    struct Free
+    {
+        void operator()(T *pixels) const { ::operator delete(pixels, std::align_val_t(kImageRowAlignment)); }
+    };
+
+    std::unique_ptr<T, Free> m_pixels;
+    int m_width = 0;
+    int m_height = 0;
+    size_t m_stride = 0;
+};
+
+namespace detail
+{
+template <typename T>
+auto &imagePixels(ImageData &image)
+{
+    if constexpr (sizeof(std::remove_const_t<T>) == 1)
+        return image.pixels8;
+    else
+        return image.pixels16;
+}
+
+template <typename T>
+const auto &imagePixels(const ImageData &image)
+{
+    if constexpr (sizeof(std::remove_const_t<T>) == 1)
+        return image.pixels8;
+    else
+        return image.pixels16;
+}
+} // namespace detail
+
+// View of an ImageData buffer (packed rows). std::nullopt when its depth or
+// channel count is not (T, Channels) or the buffer is too small.
+template <typename T, int Channels>
+std::optional<ConstImageView<T, Channels>> imageView(const ImageData &image)
+{
+    static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>, "ImageData holds 8 or 16-bit values");
+    const size_t values = static_cast<size_t>(std::max(image.width, 0)) * std::max(image.height, 0) * Channels;
+    const auto &pixels = detail::imagePixels<T>(image);
+    if (image.is16Bit != (sizeof(T) == 2) || image.channels != Channels || image.width <= 0 ||
+        image.height <= 0 || pixels.size() < values)
+        return std::nullopt;
+    return ConstImageView<T, Channels>{pixels.data(), image.width, image.height,
+                                       static_cast<size_t>(image.width) * Channels};
+}
+
+template <typename T, int Channels>
+std::optional<ImageView<T, Channels>> imageView(ImageData &image)
+{
+    const std::optional<ConstImageView<T, Channels>> view = imageView<T, Channels>(std::as_const(image));
+    if (!view)
+        return std::nullopt;
+    return ImageView<T, Channels>{detail::imagePixels<T>(image).data(), view->width, view->height, view->stride};
+}
+
+// Packed copy, for the loaders, caches and uploadTexture().
+template <typename T, int Channels>
+ImageData toImageData(ConstImageView<T, Channels> view, ImageKind kind = ImageKind::Full)
+{
+    static_assert(std::is_same_v<T, uint8_t> || std::is_same_v<T, uint16_t>, "ImageData holds 8 or 16-bit values");
+    ImageData image;
+    image.width = view.width;
+    image.height = view.height;
+    image.channels = Channels;
+    image.is16Bit = sizeof(T) == 2;
+    image.kind = kind;
+    auto &pixels = detail::imagePixels<T>(image);
+    const size_t rowValues = static_cast<size_t>(view.width) * Channels;
+    pixels.resize(rowValues * std::max(view.height, 0));
+    for (int y = 0; y < view.height; ++y)
+        std::memcpy(pixels.data() + y * rowValues, view.row(y), rowValues * sizeof(T));
+    return image;
+}
+
+template <typename T, int Channels>
+ImageData toImageData(const Image<T, Channels> &image, ImageKind kind = ImageKind::Full)
+{
+    return toImageData<T, Channels>(image.view(), kind);
+}
+
+// Calls kernel(view) with the read-only view matching image: 8 or 16-bit,
+// 3 or 4 channels. False, without calling it, for any other layout.
+template <typename Kernel>
+bool dispatchImage(const ImageData &image, Kernel &&kernel)
+{
+    if (auto rgb16 = imageView<uint16_t, 3>(image))
+        kernel(*rgb16);
+    else if (auto rgba16 = imageView<uint16_t, 4>(image))
+        kernel(*rgba16);
+    else if (auto rgb8 = imageView<uint8_t, 3>(image))
+        kernel(*rgb8);
+    else if (auto rgba8 = imageView<uint8_t, 4>(image))
+        kernel(*rgba8);
+    else
+        return false;
+    return true;
+}
+
+// Largest value of T, as the float kernels normalize by it.
+template <typename T>
+constexpr float imageValueMax()
+{
+    return static_cast<float>(std::numeric_limits<std::remove_const_t<T>>::max());
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Runtime metrics shared by the UI loop and the loader threads.
+// Metrics are created on first use by name and live as long as the registry,
+// so a reference can be looked up once and updated from any thread.
+// snapshot() copies everything for display (Performance window) or for
+// toJson() in the headless tools.
+
+class Counter
+{
+public:
+    void add(int64_t amount = 1) { m_value.fetch_add(amount, std::memory_order_relaxed); }
+    int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value{0};
+};
+
+// Current level of something: bytes held, futures in flight.
+class Gauge
+{
+public:
+    void set(int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+    void add(int64_t amount) { m_value.fetch_add(amount, std::memory_order_relaxed); }
+    int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value{0};
+};
+
+struct HistogramSummary
+{
+    // All samples ever recorded
+    int64_t count = 0;
+    double mean = 0.0;
+    // Over the most recent samples (Histogram::kWindow)
+    double min = 0.0;
+    double max = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+};
+
+// Keeps the last kWindow samples, so percentiles follow what happens now
+// rather than the whole session.
+class Histogram
+{
+public:
+    static constexpr size_t kWindow = 1024;
+
+    void record(double value);
+    HistogramSummary summary() const;
+    // Oldest first, for plotting.
+    std::vector<float> recent() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<double> m_samples;
+    size_t m_next = 0;
+    int64_t m_count = 0;
+    double m_sum = 0.0;
+};
+
+struct MetricsSnapshot
+{
+    // Sorted by name
+    std::vector<std::pair<std::string, int64_t>> counters;
+    std::vector<std::pair<std::string, int64_t>> gauges;
+    std::vector<std::pair<std::string, HistogramSummary>> histograms;
+};
+
+class MetricsRegistry
+{
+public:
+    Counter &counter(const std::string &name);
+    Gauge &gauge(const std::string &name);
+    Histogram &histogram(const std::string &name);
+
+    MetricsSnapshot snapshot() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::map<std::string, std::unique_ptr<Counter>> m_counters;
+    std::map<std::string, std::unique_ptr<Gauge>> m_gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> m_histograms;
+};
+
+// {"counters": {...}, "gauges": {...}, "histograms": {"name": {"count": ...}}}
+std::string toJson(const MetricsSnapshot &snapshot);
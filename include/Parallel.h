@@ -0,0 +1,41 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+// Runs fn(chunkBegin, chunkEnd) over [begin, end) in chunks of grain items.
+// Workers pull chunks from a shared counter, so uneven chunks balance out.
+// The calling thread works too; the call returns when every chunk is done.
+// threads = 0 uses every hardware thread.
+template <typename Fn>
+void parallelFor(int begin, int end, int grain, Fn &&fn, unsigned threads = 0)
+{
+    if (end <= begin)
+        return;
+
+    grain = std::max(grain, 1);
+    const int chunkCount = (end - begin + grain - 1) / grain;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, static_cast<unsigned>(chunkCount));
+
+    std::atomic<int> nextChunk{0};
+    auto worker = [&]() {
+        for (int chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+        {
+            const int chunkBegin = begin + chunk * grain;
+            fn(chunkBegin, std::min(end, chunkBegin + grain));
+        }
+    };
+
+    std::vector<std::future<void>> helpers;
+    helpers.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i)
+        helpers.push_back(std::async(std::launch::async, worker));
+
+    worker();
+    for (auto &helper : helpers)
+        helper.get();
+}
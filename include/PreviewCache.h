@@ -0,0 +1,24 @@
+#pragma once
+#include "ImageLoader.h"
+#include <filesystem>
+#include <optional>
+#include <string>
+
+// Last-image preview cache
+// A downscaled 8-bit copy of the last preview shown, stored with the source
+// path, size and modification time so a changed or moved file is never
+// restored from a stale copy. Read at startup before any decoder runs, so the
+// previous image is on screen in the first frames.
+
+// Longest edge of the stored copy.
+constexpr int kPreviewCacheMaxEdge = 1280;
+
+// Writes atomically (temp file + rename). False on I/O errors.
+bool savePreviewCache(const std::filesystem::path &cacheFile, const std::string &sourcePath,
+                      const ImageData &preview);
+// std::nullopt when the cache is missing, corrupt or older than the source.
+std::optional<ImageData> loadPreviewCache(const std::filesystem::path &cacheFile, const std::string &sourcePath);
+
+// Box-filtered 8-bit RGB copy with the longest edge at most maxEdge.
+// Works on 8 or 16-bit, RGB or RGBA input.
+ImageData downscaleToRgb8(const ImageData &image, int maxEdge);
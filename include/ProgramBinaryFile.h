@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// On-disk format of cached GL program binaries (see graphics/shaderBinaryCache.h).
+// Header: magic, version, key, binary format, payload size, payload checksum.
+// Anything that doesn't match (other key, truncated, flipped bits) is
+// rejected so the caller compiles from source instead.
+
+struct ProgramBinary
+{
+    uint32_t format = 0;
+    std::vector<uint8_t> data;
+};
+
+// FNV-1a over the shader sources and the driver identification. A new
+// driver version or any source change gives a new key.
+uint64_t programCacheKey(const std::string &vertexSource, const std::string &fragmentSource,
+                         const std::string &vendor, const std::string &renderer, const std::string &version);
+
+bool writeProgramBinaryFile(const std::filesystem::path &path, uint64_t key, const ProgramBinary &binary);
+std::optional<ProgramBinary> readProgramBinaryFile(const std::filesystem::path &path, uint64_t key);
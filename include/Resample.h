@@ -0,0 +1,55 @@
+#pragma once
+#include "ImageLoader.h"
+#include <optional>
+#include <vector>
+
+// Separable image resampling
+// Thumbnails, proxies and pyramid levels are made on the CPU with a real
+// filter instead of GL_LINEAR minification, which only looks at 4 texels and
+// aliases once the scale drops below one half.
+// Works on ImageData as it comes out of the decoders: 8 or 16 bits, 3 or 4
+// channels. Output has the same depth and channel count.
+
+enum class ResampleFilter
+{
+    // Area average; cheapest, slightly soft.
+    Box,
+    // Tent of radius 1 (bilinear when enlarging).
+    Triangle,
+    // Windowed sinc of radius 3. Sharpest, small ringing on hard edges.
+    Lanczos3
+};
+
+const char *resampleFilterName(ResampleFilter filter);
+
+// Filter taps of one axis, computed once per (source size, output size).
+// Output pixel i reads source pixels first[i] .. first[i] + taps - 1 with
+// weights[i * taps ...]; the weights sum to 1. Every output pixel has the
+// same tap count (short ones are padded with zeros) so the inner loops have
+// no per-pixel bounds.
+struct ResampleTaps
+{
+    int taps = 0;
+    std::vector<int> first;
+    std::vector<float> weights;
+};
+
+ResampleTaps computeResampleTaps(int sourceSize, int outputSize, ResampleFilter filter);
+
+struct ResampleOptions
+{
+    ResampleFilter filter = ResampleFilter::Lanczos3;
+    // Output rows per parallel band.
+    int bandRows = 32;
+    // 0 = all hardware threads.
+    unsigned threads = 0;
+};
+
+// Resamples to exactly width x height. nullopt for empty input, a zero
+// output size or a channel count other than 3 or 4.
+std::optional<ImageData> resampleImage(const ImageData &source, int width, int height,
+                                       const ResampleOptions &options = {});
+
+// Shrinks so the longest edge is at most maxEdge, keeping the aspect ratio.
+// Images that already fit are returned as they are.
+std::optional<ImageData> resampleToFit(const ImageData &source, int maxEdge, const ResampleOptions &options = {});
@@ -0,0 +1,99 @@
+#pragma once
+#include "MetricsRegistry.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// UI session recording
+// Every frame's ImGui input events (mouse, wheel, keys, text, focus) with the
+// frame's delta time and display size, plus the ImGui settings the session
+// started from (window layout, last file). Replaying feeds the same events to
+// the same layout frame by frame, so zooms, slider drags and filmstrip clicks
+// land on the same widgets and frame times of two builds can be compared.
+// Text format, one line per frame or event:
+//   photocrispy-session 1
+//   window <width> <height>
+//   settings <bytes>\n<ImGui .ini text>
+//   frame <delta time s> <display width> <display height>
+//   mouse_pos <x> <y> | mouse_button <button> <down> | wheel <x> <y>
+//   key <ImGuiKey> <down> | char <codepoint> | focus <focused>
+
+enum class SessionEventType
+{
+    MousePos,
+    MouseButton,
+    MouseWheel,
+    Key,
+    Char,
+    Focus
+};
+
+struct SessionEvent
+{
+    SessionEventType type = SessionEventType::MousePos;
+    // Button, ImGuiKey or codepoint
+    int code = 0;
+    // Pressed / focused
+    bool down = false;
+    // Position or wheel delta
+    float x = 0.0f;
+    float y = 0.0f;
+};
+
+struct SessionFrame
+{
+    float deltaTime = 0.0f;
+    float displayWidth = 0.0f;
+    float displayHeight = 0.0f;
+    std::vector<SessionEvent> events;
+};
+
+struct SessionRecording
+{
+    int windowWidth = 0;
+    int windowHeight = 0;
+    std::string settings;
+    std::vector<SessionFrame> frames;
+};
+
+// Appends frames as they happen, so a session that ends in a crash is kept
+// up to the last frame.
+class SessionWriter
+{
+public:
+    bool open(const std::filesystem::path &path, int windowWidth, int windowHeight, const std::string &settings);
+    bool isOpen() const { return m_file.is_open(); }
+    void writeFrame(const SessionFrame &frame);
+    // False if any write failed.
+    bool close();
+
+private:
+    std::ofstream m_file;
+};
+
+// std::nullopt when the file is missing, of another version or malformed.
+std::optional<SessionRecording> loadSessionRecording(const std::filesystem::path &path);
+
+// Per-frame times of a live or replayed session. gpuMs is -1 when the GPU
+// time could not be measured.
+struct FrameTiming
+{
+    double cpuMs = 0.0;
+    double gpuMs = -1.0;
+};
+
+struct FrameTimeSummary
+{
+    HistogramSummary cpu;
+    // Over the frames with a GPU time
+    HistogramSummary gpu;
+    // Frames whose CPU time exceeded the hitch threshold
+    int hitches = 0;
+};
+
+FrameTimeSummary summarizeFrameTimes(const std::vector<FrameTiming> &frames, double hitchMs = 1000.0 / 30.0);
+// CSV with a header: frame,cpu_ms,gpu_ms
+bool writeFrameTimes(const std::filesystem::path &path, const std::vector<FrameTiming> &frames);
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Viewport region-of-interest processing
+// When the viewer is zoomed in, only the tiles under the visible rectangle
+// (plus a margin) are developed. Tiles at level n cover tileSize << n image
+// pixels and are rendered at tileSize, so a zoomed-out view needs fewer of them.
+
+// Rectangle in image pixels.
+struct ImageRect
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+struct TileKey
+{
+    int level = 0;
+    int column = 0;
+    int row = 0;
+
+    bool operator==(const TileKey &other) const
+    {
+        return level == other.level && column == other.column && row == other.row;
+    }
+};
+
+// Coarsest level whose tiles still have at least one texel per screen pixel.
+// displayScale is screen pixels per image pixel.
+int tileLevelForScale(float displayScale);
+
+// Image area covered by a tile, clipped to the image.
+ImageRect tileRect(const TileKey &key, int tileSize, int imageWidth, int imageHeight);
+
+// Tiles of the given level intersecting visible grown by margin on every side.
+std::vector<TileKey> tilesForView(const ImageRect &visible, int margin, int tileSize, int level,
+                                  int imageWidth, int imageHeight);
+
+// Most tiles a view of viewWidth x viewHeight screen pixels can touch, with a
+// margin of half a tile, at any scale and scroll position: at the level
+// picked by tileLevelForScale() a tile covers more than tileSize / 2 screen
+// pixels, and the margin adds at most one tile on each side.
+size_t tileSlotsForView(int viewWidth, int viewHeight, int tileSize);
+
+// Fixed number of tile slots with least-recently-used replacement.
+// The owner maps slot indices onto its render targets. A tile is valid for one
+// content revision (image + develop settings); a new revision makes every
+// cached tile stale without freeing it.
+class TileCache
+{
+public:
+    explicit TileCache(size_t capacity);
+
+    // Starts a frame. Slots used during the current frame are never evicted.
+    void beginFrame();
+    // Slot holding key rendered at revision, marked as used this frame.
+    std::optional<size_t> find(const TileKey &key, uint64_t revision);
+    // Slot to render key into: a free slot or the least recently used one.
+    // std::nullopt when every slot is already in use this frame.
+    std::optional<size_t> acquire(const TileKey &key, uint64_t revision);
+    // Forgets one slot (its texture was evicted).
+    void release(size_t slot);
+    void clear();
+    // Adds empty slots up to capacity. Never shrinks, so slot indices held
+    // by the owner stay valid.
+    void grow(size_t capacity);
+
+    size_t capacity() const { return m_slots.size(); }
+
+private:
+    struct Slot
+    {
+        bool used = false;
+        TileKey key;
+        uint64_t revision = 0;
+        uint64_t lastFrame = 0;
+    };
+
+    std::vector<Slot> m_slots;
+    uint64_t m_frame = 1;
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include "graphics/renderTarget.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <glad/glad.h>
+#include <vector>
+
+// Reads render targets back to the CPU without stalling the GL thread.
+// request() blits the region (optionally downsampled) and starts a
+// glReadPixels into a pixel buffer object guarded by a fence. poll(), once
+// per frame, maps the buffers whose fence has signalled and hands the pixels
+// to the callback on a worker thread.
+
+enum class ReadbackFormat {
+  RGBA8,
+  // 4 floats per pixel, for HDR targets (RGBA16F/32F)
+  RGBA32F,
+};
+
+// Pixels are in GL order: bottom row first.
+struct ReadbackImage {
+  int width = 0;
+  int height = 0;
+  ReadbackFormat format = ReadbackFormat::RGBA8;
+  std::vector<uint8_t> bytes;
+
+  const float *floats() const {
+    return reinterpret_cast<const float *>(bytes.data());
+  }
+};
+
+struct ReadbackRegion {
+  int x = 0;
+  int y = 0;
+  // 0 means up to the edge of the target
+  int width = 0;
+  int height = 0;
+};
+
+class AsyncReadback {
+public:
+  using Callback = std::function<void(ReadbackImage)>;
+
+  bool create();
+  // Must be called on the GL thread. downsample > 1 reduces each side by
+  // that factor (rounded up) with 2x2 averaging steps. The target may be
+  // drawn to again right away.
+  bool request(const RenderTarget &source, ReadbackRegion region,
+               int downsample, ReadbackFormat format, Callback callback);
+  // Delivers finished reads; never waits on the GPU.
+  void poll();
+  // Waits for every queued read and callback (shutdown, tests).
+  void flush();
+  void destroy();
+
+  size_t pending() const { return m_pending.size(); }
+
+private:
+  struct Pending {
+    GLuint buffer = 0;
+    GLsync fence = nullptr;
+    size_t bytes = 0;
+    ReadbackImage image;
+    Callback callback;
+  };
+
+  GLuint acquireBuffer();
+  void deliver(Pending &pending);
+  void reapCallbacks(bool wait);
+
+  RenderTarget m_scratch[2];
+  std::vector<Pending> m_pending;
+  std::vector<GLuint> m_freeBuffers;
+  std::vector<std::future<void>> m_callbacks;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <glad/glad.h>
+
+// GPU time of whole frames.
+// Timestamp queries rather than GL_TIME_ELAPSED, which can't nest and is
+// already used around the develop pass. Results are read a few frames
+// later so measuring doesn't stall the frame; the difference of the two
+// timestamps includes any time the GPU sat idle waiting for commands.
+class FrameTimer {
+public:
+  bool create();
+  // Around the GL work of frame `frame`
+  void begin(uint64_t frame);
+  void end();
+  // Calls done(frame, gpuMs) for every frame whose result is in, oldest
+  // first. wait = block until every frame is in (end of a session).
+  void collect(const std::function<void(uint64_t, double)> &done,
+               bool wait = false);
+  void destroy();
+
+private:
+  struct Slot {
+    GLuint begin = 0;
+    GLuint end = 0;
+    uint64_t frame = 0;
+    bool pending = false;
+  };
+  // Frames in flight. A frame that finds the next slot still pending is
+  // not measured.
+  static constexpr size_t kSlots = 8;
+  std::array<Slot, kSlots> m_slots{};
+  size_t m_next = 0;
+  size_t m_oldest = 0;
+  bool m_created = false;
+  bool m_measuring = false;
+
+  bool read(Slot &slot, bool wait,
+            const std::function<void(uint64_t, double)> &done);
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include "Demosaic.h"
+#include "graphics/renderTarget.h"
+#include "graphics/shaderProgram.h"
+#include "graphics/textureBudget.h"
+#include <glad/glad.h>
+
+// Demosaic on the GPU.
+// Only the single-channel sensor data is uploaded (GL_R16, 2 bytes per pixel
+// instead of 6 for RGB16). Levels, white balance, demosaic, camera matrix,
+// output curve and orientation run in shaders/demosaic.frag, which mirrors
+// demosaicMosaic() with DemosaicQuality::Bilinear.
+class GpuDemosaic {
+public:
+  // Compiles the shader. Returns false when it doesn't link.
+  bool create();
+  void trackMemory(TextureBudget *budget);
+  // Uploads the mosaic and keeps it resident until releaseMosaic(), so the
+  // image can be developed again (per tile, after a target was evicted...).
+  bool upload(const RawMosaic &mosaic);
+  // Renders sourceRegion (whole image when null) of the oriented image into
+  // target, which is sized by the caller. False when nothing is uploaded.
+  bool develop(RenderTarget &target, const float *sourceRegion = nullptr);
+  void releaseMosaic();
+  void destroy();
+
+  // Size after orientation, i.e. what develop() produces for the whole image.
+  int width() const;
+  int height() const;
+  bool hasMosaic() const { return m_mosaicTexture != 0; }
+
+private:
+  ShaderProgram m_shader;
+  GLuint m_vao = 0;
+  GLuint m_mosaicTexture = 0;
+  RawMosaic m_parameters;
+
+  TextureBudget *m_budget = nullptr;
+  TextureBudget::Handle m_budgetHandle = 0;
+};
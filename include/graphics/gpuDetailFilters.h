@@ -0,0 +1,40 @@
+#pragma once
+#include "DetailFilters.h"
+#include "graphics/renderTarget.h"
+#include "graphics/shaderProgram.h"
+#include "graphics/textureBudget.h"
+#include <cstdint>
+#include <glad/glad.h>
+
+// Noise reduction and sharpening on the GPU.
+// shaders/detailFilters.frag runs the kernels of src/DetailFilters.cpp, each
+// as a horizontal and a vertical pass through a half-float intermediate (the
+// colour differences are signed). When sharpening follows, the noise reduced
+// image is kept, so a sharpening slider only re-runs the sharpening passes.
+class GpuDetailFilters {
+public:
+  // Compiles the shader. Returns false when it doesn't link.
+  bool create();
+  void trackMemory(TextureBudget *budget);
+  // Filters input into output, which must have the size of input.
+  // inputKey changes whenever the content of input does. scale is output
+  // pixels per full-resolution pixel (proxy, downscaled tiles).
+  void apply(const RenderTarget &input, uint64_t inputKey,
+             RenderTarget &output, const DevelopSettings &settings,
+             float scale);
+  // Frees the intermediates; apply() allocates them again.
+  void release();
+  void destroy();
+
+private:
+  void runPass(int mode, GLuint source, GLuint guide, RenderTarget &target);
+  bool prepare(RenderTarget &target, int width, int height);
+
+  ShaderProgram m_shader;
+  GLuint m_vao = 0;
+  TextureBudget *m_budget = nullptr;
+  // Output of the horizontal passes
+  RenderTarget m_horizontal;
+  RenderTarget m_denoised;
+  uint64_t m_denoisedKey = 0;
+};
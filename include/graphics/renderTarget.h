@@ -1,11 +1,46 @@
 #pragma once
+#include "graphics/textureBudget.h"
+#include <functional>
 #include <glad/glad.h>
 
+GLenum textureInternalFormat(TextureFormat format);
+
+// Framebuffer with one colour texture attachment.
+// Like TriangleRenderer, GL objects are created and destroyed explicitly
+// because they need a current context.
 class RenderTarget {
 public:
-  RenderTarget();
-  ~RenderTarget();
+  bool create();
+  // Report the colour texture to budget. evict is called when the budget
+  // wants the memory back (cache targets only).
+  void trackMemory(TextureBudget *budget, TextureRole role,
+                   std::function<void()> evict = {});
+  // (Re)allocates the colour texture when the size or format changes.
+  // Returns false if the framebuffer is incomplete.
+  bool resize(int width, int height,
+              TextureFormat format = TextureFormat::RGBA8);
+  // Marks the texture as recently used for budget eviction.
+  void touch();
+  // Binds the framebuffer and sets the viewport to the whole target.
+  void bind() const;
+  void destroy();
+
+  GLuint texture() const { return m_texture; }
+  GLuint framebuffer() const { return m_framebuffer; }
+  int width() const { return m_width; }
+  int height() const { return m_height; }
+  TextureFormat format() const { return m_format; }
 
 private:
-  // Private members
+  GLuint m_framebuffer = 0;
+  GLuint m_texture = 0;
+  int m_width = 0;
+  int m_height = 0;
+  TextureFormat m_format = TextureFormat::RGBA8;
+  bool m_allocated = false;
+
+  TextureBudget *m_budget = nullptr;
+  TextureRole m_role = TextureRole::Ui;
+  std::function<void()> m_evict;
+  TextureBudget::Handle m_budgetHandle = 0;
 };
\ No newline at end of file
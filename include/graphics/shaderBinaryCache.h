@@ -0,0 +1,51 @@
+#pragma once
+#include "ProgramBinaryFile.h"
+#include <filesystem>
+#include <glad/glad.h>
+#include <string>
+
+// Linked GL programs saved with glGetProgramBinary and restored with
+// glProgramBinary on the next launch, skipping compile and link.
+// Files are keyed by programCacheKey() (sources + GL vendor, renderer and
+// version). A missing, corrupt or driver-rejected binary counts as a miss and
+// the caller compiles from source as before.
+struct ShaderCacheStats {
+  int hits = 0;
+  int misses = 0;
+  // Binaries the driver refused (glProgramBinary failed to link)
+  int rejected = 0;
+  double loadMs = 0.0;
+  double compileMs = 0.0;
+};
+
+class ShaderBinaryCache {
+public:
+  // directory is created when needed.
+  explicit ShaderBinaryCache(std::filesystem::path directory);
+
+  // Needs a current context (queries the driver strings once).
+  uint64_t key(const std::string &vertexSource,
+               const std::string &fragmentSource);
+  // Linked program for key, or 0 on a miss.
+  GLuint load(uint64_t key);
+  // Saves a linked program. Set GL_PROGRAM_BINARY_RETRIEVABLE_HINT before
+  // linking (ShaderProgram does) or some drivers return nothing.
+  void store(GLuint program, uint64_t key);
+  void recordCompile(double milliseconds);
+
+  // False when the driver supports no binary formats.
+  bool supported();
+  const ShaderCacheStats &stats() const { return m_stats; }
+
+private:
+  std::filesystem::path fileFor(uint64_t key) const;
+  void queryDriver();
+
+  std::filesystem::path m_directory;
+  bool m_driverQueried = false;
+  bool m_supported = false;
+  std::string m_vendor;
+  std::string m_renderer;
+  std::string m_version;
+  ShaderCacheStats m_stats;
+};
@@ -2,6 +2,8 @@
 #include <glad/glad.h>
 #include <string>
 
+class ShaderBinaryCache;
+
 // std::string (introduced in C++17) is a lightweight, non-owning reference
 // to a string or a character sequence. It is essentially a pointer to existing
 // character data paired with a size, designed to provide fast, read-only access
@@ -11,10 +13,19 @@ class ShaderProgram {
 public:
   unsigned int ID = 0;
   void create_shader(std::string vertexSource, std::string fragmentSource);
+  // Same as create_shader() but takes GLSL code instead of file paths.
+  // Used for shaders generated at runtime (develop pipeline).
+  void create_shader_from_source(const std::string &vertexCode,
+                                 const std::string &fragmentCode);
+  static std::string read_source(const std::string &path);
+  // Programs created after this call are looked up in / saved to cache
+  // (nullptr turns it off). The cache must outlive the programs' creation.
+  static void useBinaryCache(ShaderBinaryCache *cache);
 
   void use();
   void setFloat(const std::string &name, float value) const;
 
 private:
+  static ShaderBinaryCache *s_binaryCache;
   void checkCompileErrors(unsigned int shader, std::string type);
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Accounting for every GPU texture the app allocates.
+// No GL calls here: owners report allocations, the budget keeps the totals,
+// picks formats by role and evicts cached textures when memory runs short.
+
+enum class TextureRole
+{
+    Source,     // decoded preview / full image
+    Processed,  // developed full-resolution result
+    Proxy,      // screen-sized result while dragging
+    Tile,       // viewport tiles (evictable cache)
+    Lut,        // baked develop LUT
+    Detail,     // sharpening / noise reduction intermediates
+    Thumbnail,  // filmstrip previews (evictable cache)
+    Preview,    // culling ring previews (pinned)
+    Ui          // about window, misc
+};
+
+enum class TextureFormat
+{
+    RGB8,
+    RGBA8,
+    RGB16,
+    RGB10A2,
+    RGBA16F,
+    RGBA32F,
+    R16
+};
+
+// Bytes per texel as drivers store them: 3-channel formats are padded to 4.
+size_t textureFormatBytesPerPixel(TextureFormat format);
+const char *textureFormatName(TextureFormat format);
+const char *textureRoleName(TextureRole role);
+
+class TextureBudget
+{
+public:
+    using Handle = uint64_t;
+
+    struct Entry
+    {
+        Handle handle = 0;
+        TextureRole role = TextureRole::Ui;
+        TextureFormat format = TextureFormat::RGBA8;
+        int width = 0;
+        int height = 0;
+        int depth = 1;
+        size_t bytes = 0;
+        uint64_t lastUse = 0;
+        // Frees the texture when the budget needs the memory back.
+        // Empty for textures that must stay resident.
+        std::function<void()> evict;
+    };
+
+    explicit TextureBudget(size_t budgetBytes = size_t{1024} * 1024 * 1024);
+
+    // Records an allocation; evicts cached textures first if it would not fit.
+    Handle track(TextureRole role, TextureFormat format, int width, int height, int depth = 1,
+                 std::function<void()> evict = {});
+    // The texture behind handle was reallocated.
+    void update(Handle handle, TextureFormat format, int width, int height, int depth = 1);
+    void release(Handle handle);
+    // Marks the texture as recently used (eviction order).
+    void touch(Handle handle);
+
+    // Evicts least recently used evictable textures until bytes more fit.
+    // Returns the number of bytes freed.
+    size_t reserve(size_t bytes);
+
+    // Best format for a new texture of role: higher precision when the budget
+    // has room for it, cheaper formats as memory gets short.
+    TextureFormat chooseFormat(TextureRole role, int width, int height) const;
+
+    size_t usedBytes() const { return m_usedBytes; }
+    size_t budgetBytes() const { return m_budgetBytes; }
+    void setBudgetBytes(size_t bytes);
+    size_t bytesForRole(TextureRole role) const;
+    size_t evictionCount() const { return m_evictions; }
+    const std::vector<Entry> &entries() const { return m_entries; }
+
+private:
+    Entry *find(Handle handle);
+    // reserve() that never evicts keep (the texture being resized).
+    size_t reserveExcept(size_t bytes, Handle keep);
+
+    std::vector<Entry> m_entries;
+    size_t m_budgetBytes;
+    size_t m_usedBytes = 0;
+    size_t m_evictions = 0;
+    Handle m_nextHandle = 1;
+    uint64_t m_clock = 0;
+};
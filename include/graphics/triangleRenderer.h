@@ -1,5 +1,6 @@
 #pragma once
 #include "graphics/shaderProgram.h"
+#include "graphics/textureBudget.h"
 #include <GLFW/glfw3.h>
 #include <cmath>
 #include <glad/glad.h>
@@ -11,6 +12,8 @@ public:
   void createFramebuffer();
   void renderTriangle(int width, int height);
   void destroy();
+  // Report the framebuffer texture to budget.
+  void trackMemory(TextureBudget *budget) { textureBudget = budget; }
   GLuint texture() const { return texture_id; }
   // void bind_framebuffer();
   // void unbind_framebuffer();
@@ -24,4 +27,6 @@ private:
   GLuint texture_id = 0;
   int width = 0;
   int height = 0;
+  TextureBudget *textureBudget = nullptr;
+  TextureBudget::Handle budgetHandle = 0;
 };
\ No newline at end of file
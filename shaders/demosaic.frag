@@ -0,0 +1,91 @@
+#version 430 core
+in vec2 textureCoordinates;
+out vec4 fragmentColor;
+
+// Single-channel sensor data (GL_R16), read with texelFetch only.
+uniform sampler2D mosaic;
+uniform ivec2 mosaicSize;
+// CFA colour of (row, col) is pattern[(row % patternSize.y) * patternSize.x + col % patternSize.x].
+uniform ivec2 patternSize;
+uniform int pattern[36];
+// Levels are in sensor units, whiteBalance is applied after normalizing.
+uniform vec3 black;
+uniform float white;
+uniform vec3 whiteBalance;
+uniform mat3 cameraToRgb;
+// LibRaw orientation bits: 4 transposes, 2 mirrors rows, 1 mirrors columns.
+uniform int flip;
+uniform bool applyGamma;
+
+// Same as the CPU path (src/Demosaic.cpp) so both give the same result.
+int reflectCoordinate(int i, int size)
+{
+    if (i < 0)
+        i = -i;
+    if (i >= size)
+        i = 2 * size - 2 - i;
+    return clamp(i, 0, size - 1);
+}
+
+int colorAt(ivec2 position)
+{
+    return pattern[(position.y % patternSize.y) * patternSize.x + position.x % patternSize.x];
+}
+
+float sampleAt(ivec2 position, int color)
+{
+    const float raw = texelFetch(mosaic, position, 0).r * 65535.0;
+    return clamp((raw - black[color]) * whiteBalance[color] / max(white - black[color], 1.0), 0.0, 1.0);
+}
+
+vec3 bt709(vec3 x)
+{
+    return mix(1.099 * pow(x, vec3(0.45)) - 0.099, 4.5 * x, lessThan(x, vec3(0.018)));
+}
+
+void main(){
+    const ivec2 outputSize = (flip & 4) != 0 ? mosaicSize.yx : mosaicSize;
+    ivec2 position = min(ivec2(textureCoordinates * vec2(outputSize)), outputSize - 1);
+    if ((flip & 4) != 0)
+        position = position.yx;
+    if ((flip & 2) != 0)
+        position.y = mosaicSize.y - 1 - position.y;
+    if ((flip & 1) != 0)
+        position.x = mosaicSize.x - 1 - position.x;
+
+    // Bilinear: mean of the same-colour samples in the 3x3 neighbourhood,
+    // widened to 5x5 when the 3x3 has none (X-Trans).
+    const int own = colorAt(position);
+    vec3 camera;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (c == own)
+        {
+            camera[c] = sampleAt(position, c);
+            continue;
+        }
+
+        float sum = 0.0;
+        int count = 0;
+        for (int radius = 1; radius <= 2 && count == 0; ++radius)
+        {
+            for (int dy = -radius; dy <= radius; ++dy)
+                for (int dx = -radius; dx <= radius; ++dx)
+                {
+                    const ivec2 neighbour = ivec2(reflectCoordinate(position.x + dx, mosaicSize.x),
+                                                  reflectCoordinate(position.y + dy, mosaicSize.y));
+                    if (colorAt(neighbour) == c)
+                    {
+                        sum += sampleAt(neighbour, c);
+                        ++count;
+                    }
+                }
+        }
+        camera[c] = count > 0 ? sum / float(count) : 0.0;
+    }
+
+    vec3 color = clamp(cameraToRgb * camera, 0.0, 1.0);
+    if (applyGamma)
+        color = bt709(color);
+    fragmentColor = vec4(color, 1.0);
+}
@@ -0,0 +1,132 @@
+#version 430 core
+in vec2 textureCoordinates;
+out vec4 fragmentColor;
+
+// One pass of the detail filters, same kernels as src/DetailFilters.cpp.
+// The target has the size of the source, read with texelFetch only.
+//   0: noise reduction, horizontal. source = guide = RGB, writes (Y, Cb, Cr)
+//   1: noise reduction, vertical. source = pass 0, guide = its RGB input
+//   2: sharpening blur, horizontal. source = RGB, writes (blurred Y)
+//   3: sharpening, vertical. source = pass 2, guide = its RGB input
+uniform int mode;
+uniform sampler2D source;
+uniform sampler2D guide;
+
+uniform bool filterLuma;
+uniform float lumaSigma;
+uniform float lumaRange;
+uniform int lumaRadius;
+uniform bool filterChroma;
+uniform float chromaSigma;
+uniform float chromaRange;
+uniform int chromaRadius;
+
+uniform float sharpenSigma;
+uniform int sharpenRadius;
+uniform float sharpenAmount;
+uniform float sharpenThreshold;
+
+float toLuma(vec3 rgb)
+{
+    return (rgb.r + 2.0 * rgb.g + rgb.b) * 0.25;
+}
+
+vec3 toYCbCr(vec3 rgb)
+{
+    const float y = toLuma(rgb);
+    return vec3(y, rgb.b - y, rgb.r - y);
+}
+
+vec3 toRgb(vec3 ycc)
+{
+    const float r = ycc.x + ycc.z;
+    const float b = ycc.x + ycc.y;
+    return vec3(r, (4.0 * ycc.x - r - b) * 0.5, b);
+}
+
+// k pixels along the pass direction, clamped at the border like the CPU
+// tiles.
+vec4 fetch(sampler2D image, int k)
+{
+    const ivec2 direction = (mode == 0 || mode == 2) ? ivec2(1, 0) : ivec2(0, 1);
+    const ivec2 position = ivec2(gl_FragCoord.xy) + direction * k;
+    return texelFetch(image, clamp(position, ivec2(0), textureSize(image, 0) - 1), 0);
+}
+
+float spatialWeight(int k, float sigma)
+{
+    return exp(-float(k * k) / (2.0 * sigma * sigma));
+}
+
+float rangeWeight(float difference, float range)
+{
+    return 1.0 / (1.0 + difference * difference / (range * range));
+}
+
+// Noise reduction. In the horizontal pass values come from RGB, in the
+// vertical one from the (Y, Cb, Cr) of the horizontal pass. Chroma always
+// takes its range weights from the unfiltered luma.
+vec3 reduceNoise(bool fromRgb)
+{
+    const vec4 centreSample = fetch(source, 0);
+    const vec3 centre = fromRgb ? toYCbCr(centreSample.rgb) : centreSample.rgb;
+    const float guideCentre = toLuma(fetch(guide, 0).rgb);
+    vec3 result = centre;
+
+    if (filterLuma) {
+        float sum = 0.0;
+        float weights = 0.0;
+        for (int k = -lumaRadius; k <= lumaRadius; ++k) {
+            const vec4 tap = fetch(source, k);
+            const float value = fromRgb ? toLuma(tap.rgb) : tap.r;
+            const float weight = spatialWeight(k, lumaSigma) * rangeWeight(value - centre.x, lumaRange);
+            sum += weight * value;
+            weights += weight;
+        }
+        result.x = sum / weights;
+    }
+
+    if (filterChroma) {
+        vec2 sum = vec2(0.0);
+        float weights = 0.0;
+        for (int k = -chromaRadius; k <= chromaRadius; ++k) {
+            const vec4 tap = fetch(source, k);
+            const vec2 chroma = fromRgb ? toYCbCr(tap.rgb).yz : tap.gb;
+            const float guideLuma = toLuma(fetch(guide, k).rgb);
+            const float weight =
+                spatialWeight(k, chromaSigma) * rangeWeight(guideLuma - guideCentre, chromaRange);
+            sum += weight * chroma;
+            weights += weight;
+        }
+        result.yz = sum / weights;
+    }
+    return result;
+}
+
+float blurLuma(bool fromRgb)
+{
+    float sum = 0.0;
+    float weights = 0.0;
+    for (int k = -sharpenRadius; k <= sharpenRadius; ++k) {
+        const vec4 tap = fetch(source, k);
+        const float weight = spatialWeight(k, sharpenSigma);
+        sum += weight * (fromRgb ? toLuma(tap.rgb) : tap.r);
+        weights += weight;
+    }
+    return sum / weights;
+}
+
+void main(){
+    if (mode == 0) {
+        fragmentColor = vec4(reduceNoise(true), 1.0);
+    } else if (mode == 1) {
+        fragmentColor = vec4(clamp(toRgb(reduceNoise(false)), 0.0, 1.0), 1.0);
+    } else if (mode == 2) {
+        fragmentColor = vec4(blurLuma(true), 0.0, 0.0, 1.0);
+    } else {
+        const vec3 rgb = fetch(guide, 0).rgb;
+        const float detail = toLuma(rgb) - blurLuma(false);
+        const float mask = clamp((abs(detail) - sharpenThreshold) / max(sharpenThreshold, 1e-6), 0.0, 1.0);
+        fragmentColor = vec4(clamp(rgb + sharpenAmount * detail * mask, 0.0, 1.0), 1.0);
+    }
+}
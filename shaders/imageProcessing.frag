@@ -3,11 +3,11 @@ in vec2 textureCoordinates;
 out vec4 fragmentColor;
 
 uniform sampler2D sourceImage;
-uniform float exposure;
-uniform vec3 whiteBalance;
+// Stage declarations are generated by DevelopPipeline::fragmentShaderSource()
+// @DEVELOP_DECLARATIONS@
 
 void main(){
-    vec3 source = texture(sourceImage, textureCoordinates).rgb;
-    vec3 adjusted = source * exp2(exposure) * whiteBalance;
-    fragmentColor = vec4(clamp(adjusted, 0.0, 1.0), 1.0);
+    vec3 color = texture(sourceImage, textureCoordinates).rgb;
+    // @DEVELOP_BODY@
+    fragmentColor = vec4(clamp(color, 0.0, 1.0), 1.0);
 }
\ No newline at end of file
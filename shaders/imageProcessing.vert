@@ -2,6 +2,10 @@
 
 out vec2 textureCoordinates;
 
+// Part of the source image to render, in texture coordinates (x, y, width, height).
+// (0, 0, 1, 1) for the whole image, smaller for viewport tiles.
+uniform vec4 sourceRegion;
+
 const vec2 positions[3] = vec2[](
     vec2(-1.0, -1.0),
     vec2( 3.0, -1.0),
@@ -11,6 +15,6 @@ const vec2 positions[3] = vec2[](
 void main(){
     vec2 position = positions[gl_VertexID];
     gl_Position = vec4(position, 0.0, 1.0);
-    textureCoordinates = position * 0.5 + 0.5;
+    textureCoordinates = sourceRegion.xy + (position * 0.5 + 0.5) * sourceRegion.zw;
     
 }
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 430 core
+in vec2 textureCoordinates;
+out vec4 fragmentColor;
+
+uniform sampler2D sourceImage;
+// Baked develop pass (DevelopLut). lutScale/lutOffset map 0..1 onto texel
+// centres so the lattice end points are sampled exactly.
+uniform sampler3D developLut;
+uniform float lutScale;
+uniform float lutOffset;
+
+void main(){
+    vec3 source = texture(sourceImage, textureCoordinates).rgb;
+    vec3 color = texture(developLut, clamp(source, 0.0, 1.0) * lutScale + lutOffset).rgb;
+    fragmentColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "AllocationTracker.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// AllocationTracker does the following
+// 1. Keeps a stack of scope names and the frame counts per thread, in
+//    thread_local storage that needs no allocation itself.
+// 2. With PHOTOCRISPY_TRACK_ALLOCATIONS, replaces every form of the global
+//    operator new / delete with malloc / free plus counting.
+
+namespace
+{
+constexpr const char *kUnscoped = "(unscoped)";
+constexpr size_t kMaxScopeDepth = 16;
+
+struct ThreadAllocations
+{
+    // Deeper scopes count towards the deepest one kept.
+    const char *stack[kMaxScopeDepth];
+    size_t depth;
+    AllocationFrame frame;
+};
+
+// Constant initialized: the first allocation of a thread must not allocate.
+thread_local ThreadAllocations t_allocations{};
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_frees{0};
+std::atomic<uint64_t> g_bytes{0};
+
+[[maybe_unused]] AllocationCount &currentScope(ThreadAllocations &thread)
+{
+    const char *name = thread.depth > 0 ? thread.stack[std::min(thread.depth, kMaxScopeDepth) - 1] : kUnscoped;
+    AllocationFrame &frame = thread.frame;
+    for (size_t i = 0; i < frame.scopeCount; ++i)
+    {
+        if (frame.scopes[i].scope == name || std::strcmp(frame.scopes[i].scope, name) == 0)
+            return frame.scopes[i].count;
+    }
+    if (frame.scopeCount == kMaxAllocationScopes)
+        return frame.scopes[kMaxAllocationScopes - 1].count;
+    frame.scopes[frame.scopeCount].scope = name;
+    return frame.scopes[frame.scopeCount++].count;
+}
+} // namespace
+
+AllocationScope::AllocationScope(const char *name)
+{
+    ThreadAllocations &thread = t_allocations;
+    if (thread.depth < kMaxScopeDepth)
+        thread.stack[thread.depth] = name;
+    ++thread.depth;
+}
+
+AllocationScope::~AllocationScope()
+{
+    --t_allocations.depth;
+}
+
+bool allocationTrackingEnabled()
+{
+#ifdef PHOTOCRISPY_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void beginAllocationFrame()
+{
+    t_allocations.frame = AllocationFrame{};
+}
+
+AllocationFrame endAllocationFrame()
+{
+    return t_allocations.frame;
+}
+
+AllocationCount processAllocations()
+{
+    AllocationCount count;
+    count.allocations = g_allocations.load(std::memory_order_relaxed);
+    count.frees = g_frees.load(std::memory_order_relaxed);
+    count.bytes = g_bytes.load(std::memory_order_relaxed);
+    return count;
+}
+
+#ifdef PHOTOCRISPY_TRACK_ALLOCATIONS
+namespace
+{
+void *allocate(std::size_t size, std::size_t alignment)
+{
+    size = std::max<std::size_t>(size, 1);
+    void *memory = nullptr;
+    if (alignment <= alignof(std::max_align_t))
+        memory = std::malloc(size);
+    else
+#ifdef _WIN32
+        memory = _aligned_malloc(size, alignment);
+#else
+        memory = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    if (!memory)
+        return nullptr;
+
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+    ThreadAllocations &thread = t_allocations;
+    ++thread.frame.total.allocations;
+    thread.frame.total.bytes += size;
+    AllocationCount &scope = currentScope(thread);
+    ++scope.allocations;
+    scope.bytes += size;
+    return memory;
+}
+
+void *allocateOrThrow(std::size_t size, std::size_t alignment)
+{
+    if (void *memory = allocate(size, alignment))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void release(void *memory, std::size_t alignment) noexcept
+{
+    if (!memory)
+        return;
+    g_frees.fetch_add(1, std::memory_order_relaxed);
+    ThreadAllocations &thread = t_allocations;
+    ++thread.frame.total.frees;
+    ++currentScope(thread).frees;
+#ifdef _WIN32
+    if (alignment > alignof(std::max_align_t))
+    {
+        _aligned_free(memory);
+        return;
+    }
+#else
+    (void)alignment;
+#endif
+    std::free(memory);
+}
+} // namespace
+
+void *operator new(std::size_t size)
+{
+    return allocateOrThrow(size, 0);
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocateOrThrow(size, 0);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size, 0);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *memory) noexcept
+{
+    release(memory, 0);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    release(memory, 0);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    release(memory, 0);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    release(memory, 0);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept
+{
+    release(memory, 0);
+}
+
+void operator delete[](void *memory, const std::nothrow_t &) noexcept
+{
+    release(memory, 0);
+}
+
+void operator delete(void *memory, std::align_val_t alignment) noexcept
+{
+    release(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *memory, std::align_val_t alignment) noexcept
+{
+    release(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    release(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    release(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *memory, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    release(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *memory, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    release(memory, static_cast<std::size_t>(alignment));
+}
+#endif
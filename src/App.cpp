@@ -1,6 +1,8 @@
 #include "App.h"
+#include "CachePaths.h"
 #include "ImGuiFileDialog.h"
 #include "ImageLoader.h"
+#include "PreviewCache.h"
 #include "fmt/core.h"
 #include "graphics/shaderProgram.h"
 #include "imgui.h"
@@ -9,6 +11,7 @@
 #include "imgui_internal.h"
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <filesystem>
@@ -16,13 +19,35 @@
 #include <future>
 #include <utility>
 
-bool App::init() {
+namespace {
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+} // namespace
+
+bool App::init(const AppOptions &options) {
   // Setup
+  m_options = options;
+  if (!options.replaySession.empty()) {
+    m_replay = loadSessionRecording(options.replaySession);
+    if (!m_replay) {
+      fmt::print(stderr, "Can't read session {}\n",
+                 options.replaySession.string());
+      return false;
+    }
+  }
+  m_timingFrames = m_replay.has_value() || !options.frameTimes.empty();
 
   if (!glfwInit())
     return false;
 
-  m_window = glfwCreateWindow(1280, 720, "PhotoCrispy", NULL, NULL);
+  // Replay: the recorded window size, so clicks land on the same widgets
+  const int windowWidth = m_replay ? m_replay->windowWidth : 1280;
+  const int windowHeight = m_replay ? m_replay->windowHeight : 720;
+  m_window =
+      glfwCreateWindow(windowWidth, windowHeight, "PhotoCrispy", NULL, NULL);
 
   if (!m_window)
     return false;
@@ -31,7 +56,8 @@ bool App::init() {
   if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
     return false;
 
-  glfwSwapInterval(1); // Enable vsync
+  // Enable vsync. Replays run as fast as they can.
+  glfwSwapInterval(m_replay ? 0 : 1);
 
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
@@ -45,21 +71,116 @@ bool App::init() {
   ImGui_ImplGlfw_InitForOpenGL(m_window, true);
   ImGui_ImplOpenGL3_Init("#version 430");
 
-  // Triangle
-  newTriangle.createTriangle();
-  newTriangle.createFramebuffer();
+  // Settings are needed now (LastFile), not at the first NewFrame().
+  // A replay starts from the recorded ones and writes nothing back.
+  if (m_replay) {
+    io.IniFilename = nullptr;
+    ImGui::LoadIniSettingsFromMemory(m_replay->settings.c_str(),
+                                     m_replay->settings.size());
+  } else if (io.IniFilename) {
+    ImGui::LoadIniSettingsFromDisk(io.IniFilename);
+  }
+  if (!options.recordSession.empty() &&
+      !m_sessionWriter.open(options.recordSession, windowWidth, windowHeight,
+                            ImGui::SaveIniSettingsToMemory()))
+    fmt::print(stderr, "Can't record to {}\n",
+               options.recordSession.string());
+  if (m_timingFrames && !m_frameTimer.create())
+    fmt::print(stderr, "No GPU timer queries, frame times are CPU only\n");
+
+  newTriangle.trackMemory(&m_textureBudget);
+  m_gpuDemosaic.trackMemory(&m_textureBudget);
+  m_detailFilters.trackMemory(&m_textureBudget);
+  m_demosaicTarget.trackMemory(&m_textureBudget, TextureRole::Source);
+
+  // Everything else (shaders, render targets) waits for runDeferredInit()
+  m_previewCacheFile = userCacheDirectory() / "last-preview.bin";
+  m_shaderCache.emplace(userCacheDirectory() / "shaders");
+  m_decodeCache.emplace(userCacheDirectory() / "decoded",
+                        kDecodeCacheBudgetBytes);
+  registerDefaultDecoders(m_decoders);
+  m_loader.setDecodeCache(&*m_decodeCache);
+  ShaderProgram::useBinaryCache(&*m_shaderCache);
+  restoreLastImage();
+  m_startup.criticalInitMs = millisecondsSinceLaunch();
+
+  return true;
+}
+
+// Runs once, after the first frame was presented.
+void App::runDeferredInit() {
+  const auto start = std::chrono::steady_clock::now();
 
   // image processing start
   m_processingReady = initImageProcessing();
 
-  return true;
+  m_readbackReady = m_readback.create();
+
+  // Optional: without it the "GPU" demosaic mode isn't offered.
+  m_gpuDemosaicReady = m_gpuDemosaic.create() && m_demosaicTarget.create();
+  // Optional too: the detail sliders do nothing without it.
+  m_detailFiltersReady = m_detailFilters.create();
+
+  // An image may already be showing (cached preview, fast loads)
+  if (m_image.has_value()) {
+    resizeProcessedImage(m_image->width, m_image->height);
+    m_processingDirty = true;
+  }
+
+  m_deferredInitDone = true;
+  m_startup.deferredInitMs = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+  m_metrics.histogram("startup.critical_ms").record(m_startup.criticalInitMs);
+  m_metrics.histogram("startup.first_frame_ms")
+      .record(m_startup.firstFrameMs);
+  m_metrics.histogram("startup.deferred_ms").record(m_startup.deferredInitMs);
+
+  // Everything linked during startup; About shows the same numbers
+  const ShaderCacheStats &shaders = m_shaderCache->stats();
+  m_metrics.counter("shader_cache.hits").add(shaders.hits);
+  m_metrics.counter("shader_cache.misses").add(shaders.misses);
+  m_metrics.counter("shader_cache.rejected").add(shaders.rejected);
+  m_metrics.histogram("shader_cache.load_ms").record(shaders.loadMs);
+  m_metrics.histogram("shader_cache.compile_ms").record(shaders.compileMs);
+}
+
+// Shows the cached preview of the last file right away and reopens the file
+// itself in the background.
+void App::restoreLastImage() {
+  std::error_code error;
+  if (m_lastFile.empty() || !fs::is_regular_file(m_lastFile, error))
+    return;
+
+  openNewFile(m_lastFile);
+  m_startup.reopenedLastFile = true;
+
+  if (auto preview = loadPreviewCache(m_previewCacheFile, m_lastFile)) {
+    m_image = uploadTexture(*preview);
+    m_imageTextureHandle =
+        m_textureBudget.track(TextureRole::Source, TextureFormat::RGB8,
+                              m_image->width, m_image->height);
+    ++m_imageRevision;
+    m_showingPreview = true;
+    m_startup.restoredFromCache = true;
+  }
+}
+
+double App::millisecondsSinceLaunch() const {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - m_launchTime)
+      .count();
 }
 
 bool App::initImageProcessing() {
 
-  m_imageProcessingShader.create_shader(
-      PHOTOCRISPY_SHADER_DIR "/imageProcessing.vert",
+  // The fragment shader is a template; the pipeline fills in its stages.
+  const std::string fragmentTemplate = ShaderProgram::read_source(
       PHOTOCRISPY_SHADER_DIR "/imageProcessing.frag");
+  m_imageProcessingShader.create_shader_from_source(
+      ShaderProgram::read_source(PHOTOCRISPY_SHADER_DIR
+                                 "/imageProcessing.vert"),
+      m_developPipeline.fragmentShaderSource(fragmentTemplate, 0));
 
   GLint linked = false;
   glGetProgramiv(m_imageProcessingShader.ID, GL_LINK_STATUS, &linked);
@@ -70,114 +191,468 @@ bool App::initImageProcessing() {
     return false;
   }
   glGenVertexArrays(1, &m_processingVao);
-  glGenFramebuffers(1, &m_processingFramebuffer);
-  glGenTextures(1, &m_processedTexture);
-
-  glBindTexture(GL_TEXTURE_2D, m_processedTexture);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-  glBindFramebuffer(GL_FRAMEBUFFER, m_processingFramebuffer);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                         m_processedTexture, 0);
+  if (!m_processedTarget.create() || !m_proxyTarget.create())
+    return false;
+  m_processedTarget.trackMemory(&m_textureBudget, TextureRole::Processed);
+  m_proxyTarget.trackMemory(&m_textureBudget, TextureRole::Proxy);
+  // Times each processing step (slider latency)
+  glGenQueries(1, &m_processingQuery);
+
   // use the shader
   m_imageProcessingShader.use();
   glUniform1i(glGetUniformLocation(m_imageProcessingShader.ID, "sourceImage"),
               0);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
   glUseProgram(0);
 
+  // LUT variant of the develop pass. Optional: without it the generated
+  // shader is always used.
+  m_lutShader.create_shader(PHOTOCRISPY_SHADER_DIR "/imageProcessing.vert",
+                            PHOTOCRISPY_SHADER_DIR "/imageProcessingLut.frag");
+  glGetProgramiv(m_lutShader.ID, GL_LINK_STATUS, &linked);
+  if (linked != GL_TRUE) {
+    glDeleteProgram(m_lutShader.ID);
+    m_lutShader.ID = 0;
+    return true;
+  }
+  m_lutShader.use();
+  glUniform1i(glGetUniformLocation(m_lutShader.ID, "sourceImage"), 0);
+  glUniform1i(glGetUniformLocation(m_lutShader.ID, "developLut"), 1);
+  glUseProgram(0);
+
+  glGenTextures(1, &m_lutTexture);
+  glBindTexture(GL_TEXTURE_3D, m_lutTexture);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_3D, 0);
+
   return true;
 }
 
 void App::resizeProcessedImage(int width, int height) {
   // onlye when image dimensions changes
-  // TODO = NECESARRY?
   if (!m_processingReady || width <= 0 || height <= 0)
     return;
 
-  if (width == m_processedWidth && height == m_processedHeight)
-    return;
+  // Format depends on how much of the budget is left
+  const TextureFormat format =
+      m_textureBudget.chooseFormat(TextureRole::Processed, width, height);
+  if (!m_processedTarget.resize(width, height, format))
+    m_processingReady = false;
+}
 
-  glBindTexture(GL_TEXTURE_2D, m_processedTexture);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, nullptr);
-  glBindFramebuffer(GL_FRAMEBUFFER, m_processingFramebuffer);
-  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  glBindTexture(GL_TEXTURE_2D, 0);
+void App::processImage() {
+  pollProcessingTiming();
 
-  if (status != GL_FRAMEBUFFER_COMPLETE) {
-    fmt::print(stderr, "Image processing framebuffer incomplete: {:#x}\n",
-               status);
-    m_processingReady = false;
+  if (!m_processingReady || !m_processingDirty || !m_image.has_value())
+    return;
+  // Zoomed in: the viewer develops visible tiles instead. The full image is
+  // brought up to date once the view zooms back out.
+  if (m_roiActive)
     return;
+  if (m_processedTarget.width() != m_image->width ||
+      m_processedTarget.height() != m_image->height)
+    return;
+
+  // While an adjustment widget is held, render at the size the viewer shows
+  // the image at. renderDevelopPanel() asks for the full-resolution pass once
+  // the widget is released.
+  RenderTarget *target = &m_processedTarget;
+  m_showingProxy = false;
+  if (m_useProxyWhileDragging && m_adjustmentActive) {
+    const int proxyWidth = std::min(
+        m_image->width, static_cast<int>(std::ceil(m_viewerImageWidth)));
+    const int proxyHeight = std::min(
+        m_image->height, static_cast<int>(std::ceil(m_viewerImageHeight)));
+    // Not worth it unless the proxy has at most half the pixels
+    const bool smallEnough =
+        static_cast<int64_t>(proxyWidth) * proxyHeight * 2 <=
+        static_cast<int64_t>(m_image->width) * m_image->height;
+    if (proxyWidth > 0 && proxyHeight > 0 && smallEnough &&
+        m_proxyTarget.resize(proxyWidth, proxyHeight,
+                             m_processedTarget.format())) {
+      target = &m_proxyTarget;
+      m_showingProxy = true;
+    }
   }
 
-  m_processedWidth = width;
-  m_processedHeight = height;
+  // One GPU timer query in flight; steps submitted while it is pending only
+  // get a CPU time.
+  const bool timed = m_processingQuery != 0 && !m_processingQueryPending;
+  const auto start = std::chrono::steady_clock::now();
+  if (timed)
+    glBeginQuery(GL_TIME_ELAPSED, m_processingQuery);
+
+  if (m_detailFiltersReady && detailFiltersActive(m_develop)) {
+    renderDetailPasses(*target);
+  } else {
+    renderDevelopPass(*target);
+    // Filters off: give their intermediates back.
+    if (m_developedTarget.texture() != 0) {
+      m_developedTarget.destroy();
+      m_detailFilters.release();
+    }
+  }
+
+  if (timed) {
+    glEndQuery(GL_TIME_ELAPSED);
+    m_processingQueryPending = true;
+  }
+
+  ProcessingStepTiming step;
+  step.cpuMs = std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+  step.width = target->width();
+  step.height = target->height();
+  step.proxy = m_showingProxy;
+  if (timed)
+    m_pendingStep = step;
+  else
+    m_lastStep = step;
+
+  // Outside the timed step: the downsample and readback are not develop work
+  requestHistogram(*target);
+  m_processingDirty = false;
 }
 
-void App::processImage() {
-  if (!m_processingReady || !m_processingDirty || !m_image.has_value())
-    return;
-  if (m_processedWidth != m_image->width ||
-      m_processedHeight != m_image->height)
+void App::requestHistogram(const RenderTarget &target) {
+  if (!m_readbackReady)
     return;
+  // A few hundred pixels across is plenty for a histogram
+  constexpr int kHistogramEdge = 256;
+  const int downsample =
+      std::max(1, std::max(target.width(), target.height()) / kHistogramEdge);
+  m_readback.request(
+      target, {}, downsample, ReadbackFormat::RGBA8,
+      [this, sequence = ++m_histogramRequests](ReadbackImage image) {
+        std::array<float, kHistogramBins> bins{};
+        const size_t pixels = image.bytes.size() / 4;
+        for (size_t i = 0; i < pixels; ++i) {
+          const uint8_t *rgba = &image.bytes[i * 4];
+          const int luma = (54 * rgba[0] + 183 * rgba[1] + 19 * rgba[2]) >> 8;
+          bins[luma * kHistogramBins / 256] += 1.0f;
+        }
+        const float peak = *std::max_element(bins.begin(), bins.end());
+        if (peak > 0.0f)
+          for (float &bin : bins)
+            bin /= peak;
+        std::lock_guard<std::mutex> lock(m_histogramMutex);
+        if (sequence > m_histogramShown) {
+          m_histogram = bins;
+          m_histogramShown = sequence;
+        }
+      });
+}
 
-  glBindFramebuffer(GL_FRAMEBUFFER, m_processingFramebuffer);
-  glViewport(0, 0, m_processedWidth, m_processedHeight);
+void App::renderDevelopPass(RenderTarget &target, const float *sourceRegion) {
+  static const float kWholeImage[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+  if (!sourceRegion)
+    sourceRegion = kWholeImage;
+
+  // Prefer the baked LUT; request() schedules a bake when it isn't cached.
+  m_lutBaker.collect();
+  std::shared_ptr<const DevelopLut> lut;
+  if (m_useDevelopLut && m_lutShader.ID != 0)
+    lut = m_lutBaker.request(m_develop);
+
+  target.bind();
 
-  m_imageProcessingShader.use();
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, m_image->textureId);
-  glUniform1f(glGetUniformLocation(m_imageProcessingShader.ID, "exposure"),
-              m_exposure);
-  glUniform3fv(glGetUniformLocation(m_imageProcessingShader.ID, "whiteBalance"),
-               1, m_color);
+  if (lut) {
+    uploadDevelopLut(*lut);
+    m_lutShader.use();
+    const float size = static_cast<float>(lut->size);
+    m_lutShader.setFloat("lutScale", (size - 1.0f) / size);
+    m_lutShader.setFloat("lutOffset", 0.5f / size);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, m_lutTexture);
+    glUniform4fv(glGetUniformLocation(m_lutShader.ID, "sourceRegion"), 1,
+                 sourceRegion);
+  } else {
+    m_imageProcessingShader.use();
+    setDevelopUniforms(m_imageProcessingShader.ID, 0);
+    glUniform4fv(
+        glGetUniformLocation(m_imageProcessingShader.ID, "sourceRegion"), 1,
+        sourceRegion);
+  }
 
   glBindVertexArray(m_processingVao);
   glDrawArrays(GL_TRIANGLES, 0, 3);
 
   glBindVertexArray(0);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_3D, 0);
+  glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, 0);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
   glUseProgram(0);
+}
 
-  m_processingDirty = false;
+// Develops into m_developedTarget, then filters that into target. The
+// develop pass is skipped while its settings and the image stay the same, so
+// a detail slider only re-runs the detail passes.
+void App::renderDetailPasses(RenderTarget &target) {
+  if (m_developedTarget.texture() == 0) {
+    if (!m_developedTarget.create()) {
+      renderDevelopPass(target);
+      return;
+    }
+    m_developedTarget.trackMemory(&m_textureBudget, TextureRole::Detail);
+    m_developedKey = 0;
+  }
+  if (!m_developedTarget.resize(target.width(), target.height(),
+                                TextureFormat::RGBA16F)) {
+    renderDevelopPass(target);
+    return;
+  }
+
+  const uint64_t key =
+      tileRevision() ^ (static_cast<uint64_t>(target.width()) << 32 |
+                        static_cast<uint32_t>(target.height()));
+  if (key != m_developedKey) {
+    renderDevelopPass(m_developedTarget);
+    m_developedKey = key;
+  }
+  const float scale = static_cast<float>(target.width()) /
+                      static_cast<float>(m_image->width);
+  m_detailFilters.apply(m_developedTarget, key, target, m_develop, scale);
+}
+
+uint64_t App::tileRevision() const {
+  return m_developPipeline.passKey(m_develop, 0) ^
+         (m_imageRevision * 0x9e3779b97f4a7c15ull);
+}
+
+void App::renderTile(size_t slot, const TileKey &key) {
+  RenderTarget &target = m_tileTargets[slot];
+  if (target.texture() == 0) {
+    if (!target.create())
+      return;
+    // Tiles are a cache: under memory pressure the budget drops them. The
+    // victim may already be in this frame's draw list, so its GL objects
+    // are only deleted once the frame is rendered.
+    target.trackMemory(&m_textureBudget, TextureRole::Tile, [this, slot]() {
+      m_tileCache.release(slot);
+      m_retiredTiles.push_back(m_tileTargets[slot]);
+      m_tileTargets[slot] = RenderTarget();
+    });
+  }
+
+  const ImageRect rect =
+      tileRect(key, kTileSize, m_image->width, m_image->height);
+  const int scale = 1 << key.level;
+  const int width = (rect.width + scale - 1) / scale;
+  const int height = (rect.height + scale - 1) / scale;
+  if (!target.resize(width, height,
+                     m_textureBudget.chooseFormat(TextureRole::Tile, width,
+                                                  height)))
+    return;
+
+  const float region[4] = {
+      static_cast<float>(rect.x) / static_cast<float>(m_image->width),
+      static_cast<float>(rect.y) / static_cast<float>(m_image->height),
+      static_cast<float>(rect.width) / static_cast<float>(m_image->width),
+      static_cast<float>(rect.height) / static_cast<float>(m_image->height)};
+  renderDevelopPass(target, region);
+}
+
+void App::destroyRetiredTiles() {
+  for (RenderTarget &tile : m_retiredTiles)
+    tile.destroy();
+  m_retiredTiles.clear();
+}
+
+void App::drawImageTiles(float originX, float originY, float scale,
+                         const ImageRect &visible) {
+  const int level = tileLevelForScale(scale);
+  const int margin = (kTileSize << level) / 2;
+  const uint64_t revision = tileRevision();
+
+  // A visible tile without a slot would leave a hole, so there are always
+  // enough for the whole view and its margin ring
+  m_tileCache.grow(tileSlotsForView(
+      static_cast<int>(std::ceil(visible.width * scale)),
+      static_cast<int>(std::ceil(visible.height * scale)), kTileSize));
+  m_tileTargets.resize(m_tileCache.capacity());
+  m_tileCache.beginFrame();
+  m_tilesRendered = 0;
+
+  // Visible tiles are always brought up to date and drawn.
+  ImDrawList *drawList = ImGui::GetWindowDrawList();
+  for (const TileKey &key : tilesForView(visible, 0, kTileSize, level,
+                                         m_image->width, m_image->height)) {
+    std::optional<size_t> slot = m_tileCache.find(key, revision);
+    if (!slot) {
+      slot = m_tileCache.acquire(key, revision);
+      if (!slot)
+        continue;
+      renderTile(*slot, key);
+      ++m_tilesRendered;
+    }
+    // Keep on-screen tiles at the back of the eviction queue
+    m_tileTargets[*slot].touch();
+
+    const ImageRect rect =
+        tileRect(key, kTileSize, m_image->width, m_image->height);
+    const ImVec2 topLeft(originX + rect.x * scale, originY + rect.y * scale);
+    const ImVec2 bottomRight(originX + (rect.x + rect.width) * scale,
+                             originY + (rect.y + rect.height) * scale);
+    drawList->AddImage((ImTextureID)(uintptr_t)m_tileTargets[*slot].texture(),
+                       topLeft, bottomRight);
+  }
+
+  // The margin ring is prepared a few tiles per frame so panning finds it
+  // ready without stalling the current frame.
+  int marginBudget = kMarginTilesPerFrame;
+  for (const TileKey &key : tilesForView(visible, margin, kTileSize, level,
+                                         m_image->width, m_image->height)) {
+    if (marginBudget == 0)
+      break;
+    if (m_tileCache.find(key, revision))
+      continue;
+    if (const std::optional<size_t> slot = m_tileCache.acquire(key, revision)) {
+      renderTile(*slot, key);
+      ++m_tilesRendered;
+      --marginBudget;
+    }
+  }
+}
+
+void App::pollProcessingTiming() {
+  if (!m_processingQueryPending)
+    return;
+
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv(m_processingQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (available != GL_TRUE)
+    return;
+
+  GLuint64 elapsedNs = 0;
+  glGetQueryObjectui64v(m_processingQuery, GL_QUERY_RESULT, &elapsedNs);
+  m_lastStep = m_pendingStep;
+  m_lastStep.gpuMs = static_cast<double>(elapsedNs) / 1.0e6;
+  m_processingQueryPending = false;
+}
+
+void App::setDevelopUniforms(GLuint program, size_t passIndex) {
+  for (const DevelopUniform &uniform :
+       m_developPipeline.uniforms(m_develop, passIndex)) {
+    const GLint location = glGetUniformLocation(program, uniform.name.c_str());
+    switch (uniform.components) {
+    case 1:
+      glUniform1fv(location, 1, uniform.values);
+      break;
+    case 2:
+      glUniform2fv(location, 1, uniform.values);
+      break;
+    case 3:
+      glUniform3fv(location, 1, uniform.values);
+      break;
+    default:
+      glUniform4fv(location, 1, uniform.values);
+      break;
+    }
+  }
+}
+
+void App::uploadDevelopLut(const DevelopLut &lut) {
+  // Only when the baked parameters changed
+  if (lut.key == m_lutTextureKey)
+    return;
+
+  glBindTexture(GL_TEXTURE_3D, m_lutTexture);
+  glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, lut.size, lut.size, lut.size, 0,
+               GL_RGBA, GL_FLOAT, lut.rgba.data());
+  glBindTexture(GL_TEXTURE_3D, 0);
+  m_lutTextureKey = lut.key;
+
+  if (m_lutTextureHandle == 0)
+    m_lutTextureHandle =
+        m_textureBudget.track(TextureRole::Lut, TextureFormat::RGBA16F,
+                              lut.size, lut.size, lut.size);
+  else
+    m_textureBudget.update(m_lutTextureHandle, TextureFormat::RGBA16F,
+                           lut.size, lut.size, lut.size);
 }
 
 void App::destroyImageProcessing() {
   if (m_imageProcessingShader.ID != 0)
     glDeleteProgram(m_imageProcessingShader.ID);
-  if (m_processedTexture != 0)
-    glDeleteTextures(1, &m_processedTexture);
-  if (m_processingFramebuffer != 0)
-    glDeleteFramebuffers(1, &m_processingFramebuffer);
+  m_detailFilters.destroy();
+  m_developedTarget.destroy();
+  m_processedTarget.destroy();
+  m_proxyTarget.destroy();
+  for (RenderTarget &tile : m_tileTargets)
+    tile.destroy();
+  m_tileTargets.clear();
+  m_tileCache.clear();
+  destroyRetiredTiles();
+  if (m_processingQuery != 0)
+    glDeleteQueries(1, &m_processingQuery);
   if (m_processingVao != 0)
     glDeleteVertexArrays(1, &m_processingVao);
+  if (m_lutShader.ID != 0)
+    glDeleteProgram(m_lutShader.ID);
+  if (m_lutTexture != 0)
+    glDeleteTextures(1, &m_lutTexture);
+  m_textureBudget.release(m_lutTextureHandle);
+  m_lutTextureHandle = 0;
 
   m_imageProcessingShader.ID = 0;
-  m_processedTexture = 0;
-  m_processingFramebuffer = 0;
+  m_lutShader.ID = 0;
+  m_lutTexture = 0;
+  m_lutTextureKey = 0;
+  m_processingQuery = 0;
+  m_processingQueryPending = false;
+  m_showingProxy = false;
   m_processingVao = 0;
   m_processingReady = false;
 }
 
 void App::run() {
+  Histogram &frameTimes = m_metrics.histogram("frame.ms");
   while (!glfwWindowShouldClose(m_window)) {
+    m_frameAllocations = endAllocationFrame();
+    beginAllocationFrame();
+    const auto frameStart = std::chrono::steady_clock::now();
+    if (m_deferredInitDone)
+      frameTimes.record(std::chrono::duration<double, std::milli>(
+                            frameStart - m_lastFrameStart)
+                            .count());
+    m_lastFrameStart = frameStart;
+
     glfwPollEvents();
+    // Replay: background loads and LUT bakes finish between frames, so they
+    // show up on the same frame every time.
+    if (m_replay) {
+      m_loader.wait();
+      m_lutBaker.wait();
+    }
+    const auto workStart = std::chrono::steady_clock::now();
 
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
+    if (m_replay && !replayInputEvents())
+      break;
+    if (m_sessionWriter.isOpen())
+      recordInputEvents();
+    if (m_timingFrames)
+      m_frameTimer.begin(m_frameTimings.size());
+    {
+      AllocationScope scope("ImGui::NewFrame");
+      ImGui::NewFrame();
+    }
 
     renderUI();
 
-    ImGui::Render();
+    {
+      AllocationScope scope("ImGui::Render");
+      ImGui::Render();
+    }
     int display_w, display_h;
     glfwGetFramebufferSize(m_window, &display_w, &display_h);
     glViewport(0, 0, display_w, display_h);
@@ -185,18 +660,163 @@ void App::run() {
     glClear(GL_COLOR_BUFFER_BIT);
 
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    destroyRetiredTiles();
+    destroyRetiredThumbnails();
+    // CPU time up to here; the swap only waits for vsync.
+    if (m_timingFrames) {
+      m_frameTimer.end();
+      m_frameTimings.push_back(FrameTiming{millisecondsSince(workStart)});
+      m_frameTimer.collect([this](uint64_t frame, double gpuMs) {
+        m_frameTimings[frame].gpuMs = gpuMs;
+        m_metrics.histogram("frame.gpu_ms").record(gpuMs);
+      });
+    }
     glfwSwapBuffers(m_window);
+    if (m_readbackReady)
+      m_readback.poll();
+
+    if (!m_deferredInitDone) {
+      m_startup.firstFrameMs = millisecondsSinceLaunch();
+      runDeferredInit();
+    }
   }
+  finishSession();
 }
 
-void App::shutdown() {
-  for (auto &future : m_loadFutures) {
-    if (future.valid())
-      future.wait();
+// Copies the input ImGui is about to process this frame to the recording.
+void App::recordInputEvents() {
+  const ImGuiIO &io = ImGui::GetIO();
+  SessionFrame frame;
+  frame.deltaTime = io.DeltaTime;
+  frame.displayWidth = io.DisplaySize.x;
+  frame.displayHeight = io.DisplaySize.y;
+  for (const ImGuiInputEvent &input : GImGui->InputEventsQueue) {
+    SessionEvent event;
+    switch (input.Type) {
+    case ImGuiInputEventType_MousePos:
+      event.type = SessionEventType::MousePos;
+      event.x = input.MousePos.PosX;
+      event.y = input.MousePos.PosY;
+      break;
+    case ImGuiInputEventType_MouseWheel:
+      event.type = SessionEventType::MouseWheel;
+      event.x = input.MouseWheel.WheelX;
+      event.y = input.MouseWheel.WheelY;
+      break;
+    case ImGuiInputEventType_MouseButton:
+      event.type = SessionEventType::MouseButton;
+      event.code = input.MouseButton.Button;
+      event.down = input.MouseButton.Down;
+      break;
+    case ImGuiInputEventType_Key:
+      event.type = SessionEventType::Key;
+      event.code = static_cast<int>(input.Key.Key);
+      event.down = input.Key.Down;
+      break;
+    case ImGuiInputEventType_Text:
+      event.type = SessionEventType::Char;
+      event.code = static_cast<int>(input.Text.Char);
+      break;
+    case ImGuiInputEventType_Focus:
+      event.type = SessionEventType::Focus;
+      event.down = input.AppFocused.Focused;
+      break;
+    default:
+      continue;
+    }
+    frame.events.push_back(event);
   }
+  m_sessionWriter.writeFrame(frame);
+}
 
+// Replaces this frame's live input with the next recorded frame. False once
+// the recording is used up.
+bool App::replayInputEvents() {
+  if (m_replayFrame >= m_replay->frames.size())
+    return false;
+  const SessionFrame &frame = m_replay->frames[m_replayFrame++];
+  ImGuiIO &io = ImGui::GetIO();
+  io.DeltaTime = frame.deltaTime > 0.0f ? frame.deltaTime : 1.0f / 60.0f;
+  io.DisplaySize = ImVec2(frame.displayWidth, frame.displayHeight);
+  GImGui->InputEventsQueue.resize(0);
+  for (const SessionEvent &event : frame.events) {
+    switch (event.type) {
+    case SessionEventType::MousePos:
+      io.AddMousePosEvent(event.x, event.y);
+      break;
+    case SessionEventType::MouseWheel:
+      io.AddMouseWheelEvent(event.x, event.y);
+      break;
+    case SessionEventType::MouseButton:
+      io.AddMouseButtonEvent(event.code, event.down);
+      break;
+    case SessionEventType::Key:
+      io.AddKeyEvent(static_cast<ImGuiKey>(event.code), event.down);
+      break;
+    case SessionEventType::Char:
+      io.AddInputCharacter(static_cast<unsigned int>(event.code));
+      break;
+    case SessionEventType::Focus:
+      io.AddFocusEvent(event.down);
+      break;
+    }
+  }
+  return true;
+}
+
+// End of run(): closes the recording, writes and summarizes frame times.
+void App::finishSession() {
+  if (m_sessionWriter.isOpen() && !m_sessionWriter.close())
+    fmt::print(stderr, "Writing {} failed\n",
+               m_options.recordSession.string());
+  if (m_frameTimings.empty())
+    return;
+
+  m_frameTimer.collect(
+      [this](uint64_t frame, double gpuMs) {
+        m_frameTimings[frame].gpuMs = gpuMs;
+      },
+      true);
+  if (!m_options.frameTimes.empty() &&
+      !writeFrameTimes(m_options.frameTimes, m_frameTimings))
+    fmt::print(stderr, "Writing {} failed\n",
+               m_options.frameTimes.string());
+
+  const FrameTimeSummary summary = summarizeFrameTimes(m_frameTimings);
+  fmt::print("Frames: {}, {} over 33 ms\n", summary.cpu.count,
+             summary.hitches);
+  fmt::print("CPU ms: p50 {:.2f}  p95 {:.2f}  p99 {:.2f}  max {:.2f}\n",
+             summary.cpu.p50, summary.cpu.p95, summary.cpu.p99,
+             summary.cpu.max);
+  if (summary.gpu.count > 0)
+    fmt::print("GPU ms: p50 {:.2f}  p95 {:.2f}  p99 {:.2f}  max {:.2f}\n",
+               summary.gpu.p50, summary.gpu.p95, summary.gpu.p99,
+               summary.gpu.max);
+}
+
+void App::shutdown() {
+  m_loader.wait();
+  m_lutBaker.wait();
+  if (m_readbackReady)
+    m_readback.destroy();
   clearImage();
   destroyImageProcessing();
+  m_gpuDemosaic.destroy();
+  m_demosaicTarget.destroy();
+  m_frameTimer.destroy();
+  m_folderWatcher.stop();
+  m_cull.stop();
+  for (size_t slot = 0; slot < m_cullTextures.size(); ++slot)
+    releaseCullTexture(slot);
+  m_importCancel = true;
+  if (m_import.valid())
+    m_import.wait();
+  m_exportCancel = true;
+  if (m_export.valid())
+    m_export.wait();
+  while (!m_thumbnails.empty())
+    releaseThumbnail(m_thumbnails.begin()->first);
+  destroyRetiredThumbnails();
   newTriangle.destroy();
 
   // Destroying context and data freeing up memory
@@ -209,11 +829,37 @@ void App::shutdown() {
 
 void App::renderUI() {
   // where to render different ui spaces
-  renderDockSpace();
-  renderMenuBar();
-  photoViewer();
-  renderDevelopPanel();
-  filmStrip();
+  {
+    AllocationScope scope("dock space and menu");
+    renderDockSpace();
+    renderMenuBar();
+  }
+  {
+    AllocationScope scope("watch folder");
+    pollWatchFolder();
+  }
+  {
+    AllocationScope scope("culling");
+    updateCulling();
+  }
+  {
+    AllocationScope scope("viewer");
+    photoViewer();
+  }
+  {
+    AllocationScope scope("develop panel");
+    renderDevelopPanel();
+  }
+  {
+    AllocationScope scope("filmstrip");
+    filmStrip();
+  }
+  AllocationScope scope("tool windows");
+  drawGpuMemoryWindow();
+  drawPerformanceWindow();
+  drawImportWindow();
+  drawExportWindow();
+  drawAllocationWindow();
 }
 
 // Saving app settings. Last used dir for example
@@ -231,45 +877,560 @@ void App::registerSettingsHandler() {
     char buf[512];
     if (std::sscanf(line, "LastDir=%511[^\n]", buf) == 1)
       app->m_lastDir = buf;
+    else if (std::sscanf(line, "LastFile=%511[^\n]", buf) == 1)
+      app->m_lastFile = buf;
   };
   IniHandler.WriteAllFn = [](ImGuiContext *, ImGuiSettingsHandler *h,
                              ImGuiTextBuffer *buf) {
     App *app = (App *)h->UserData;
-    buf->appendf("[PhotoCrispy][Settings]\nLastDir=%s\n",
-                 app->m_lastDir.c_str());
+    buf->appendf("[PhotoCrispy][Settings]\nLastDir=%s\nLastFile=%s\n",
+                 app->m_lastDir.c_str(), app->m_lastFile.c_str());
   };
   ImGui::AddSettingsHandler(&IniHandler);
 }
 
-void App::openNewFile(const fs::path &path) {
+void App::startImport() {
+  m_importCancel = false;
+  m_importTotal = 0;
+  m_importDone = 0;
+  m_importBytes = 0;
+  m_importSummary.reset();
+  m_importStart = std::chrono::steady_clock::now();
+  m_showImportWindow = true;
+  m_import = std::async(
+      std::launch::async,
+      [this, source = m_importSource, destination = m_importDestination]() {
+        // Listing a card can take a moment too, so it happens here
+        const std::vector<fs::path> sources = findImportSources(source);
+        m_importTotal = sources.size();
+        ImportOptions options;
+        options.thumbnailEdge = kThumbnailEdge;
+        auto onFile = [this](const ImportedFile &file) {
+          if (file.status == ImportStatus::Copied) {
+            m_importBytes += file.bytes;
+            m_metrics.histogram("import.read_ms").record(file.readMs);
+            m_metrics.histogram("import.write_ms").record(file.writeMs);
+          } else if (file.status == ImportStatus::Failed) {
+            fmt::print(stderr, "Import of {} failed: {}\n",
+                       file.source.string(), file.error);
+          }
+          ++m_importDone;
+          if (file.thumbnail)
+            m_importedFiles.push(file);
+        };
+        return importFiles(sources, destination, options, onFile,
+                           &m_importCancel);
+      });
+}
+
+// Uploads the thumbnails of freshly imported files. They are a cache: the
+// texture budget may take them back.
+void App::collectImportedFiles() {
+  while (std::optional<ImportedFile> file = m_importedFiles.tryPop()) {
+    const std::string path = file->destination.string();
+    releaseThumbnail(path);
+    FilmstripThumbnail thumbnail;
+    thumbnail.image = uploadTexture(*file->thumbnail);
+    thumbnail.handle = m_textureBudget.track(
+        TextureRole::Thumbnail, TextureFormat::RGB8, thumbnail.image.width,
+        thumbnail.image.height, 1, [this, path]() { releaseThumbnail(path); });
+    browser.SetThumbnail(file->destination, thumbnail.image.textureId,
+                         thumbnail.image.width, thumbnail.image.height,
+                         thumbnail.handle);
+    m_thumbnails[path] = thumbnail;
+  }
+
+  if (m_import.valid() && m_import.wait_for(std::chrono::seconds(0)) ==
+                              std::future_status::ready) {
+    m_importSummary = m_import.get();
+    // Show what arrived; the listing only reads the directory
+    if (browser.Refresh(m_importDestination))
+      m_filmstripDir = m_importDestination;
+    m_lastDir = m_importDestination.string();
+    ImGui::MarkIniSettingsDirty();
+  }
+}
+
+void App::releaseThumbnail(const std::string &path) {
+  const auto it = m_thumbnails.find(path);
+  if (it == m_thumbnails.end())
+    return;
+  m_retiredThumbnails.push_back(it->second.image.textureId);
+  m_textureBudget.release(it->second.handle);
+  browser.RemoveThumbnail(path);
+  m_thumbnails.erase(it);
+}
+
+void App::destroyRetiredThumbnails() {
+  for (unsigned int textureId : m_retiredThumbnails) {
+    GLuint id = static_cast<GLuint>(textureId);
+    glDeleteTextures(1, &id);
+  }
+  m_retiredThumbnails.clear();
+}
+
+void App::drawImportWindow() {
+  collectImportedFiles();
+  if (!m_showImportWindow)
+    return;
+
+  ImGui::SetNextWindowSize(ImVec2(420.0f, 0.0f), ImGuiCond_FirstUseEver);
+  if (ImGui::Begin("Import", &m_showImportWindow)) {
+    ImGui::TextWrapped("%s -> %s", m_importSource.string().c_str(),
+                       m_importDestination.string().c_str());
+    if (m_import.valid()) {
+      const size_t total = m_importTotal;
+      const size_t done = m_importDone;
+      const double seconds = millisecondsSince(m_importStart) / 1000.0;
+      ImGui::ProgressBar(total > 0 ? static_cast<float>(done) / total : 0.0f,
+                         ImVec2(-1.0f, 0.0f));
+      ImGui::Text("%zu / %zu files, %.1f MB/s", done, total,
+                  seconds > 0.0 ? m_importBytes / 1.0e6 / seconds : 0.0);
+      if (ImGui::Button("Cancel"))
+        m_importCancel = true;
+    } else if (m_importSummary) {
+      ImGui::Text("%zu copied, %zu already there, %zu failed%s",
+                  m_importSummary->copied, m_importSummary->skipped,
+                  m_importSummary->failed,
+                  m_importSummary->cancelled ? " (cancelled)" : "");
+      ImGui::Text("%.1f MB in %.1f s, %.1f MB/s",
+                  m_importSummary->bytes / 1.0e6, m_importSummary->seconds,
+                  m_importSummary->megabytesPerSecond());
+      ImGui::TextDisabled("import_bench compares this to a plain read");
+    }
+  }
+  ImGui::End();
+}
+
+void App::startExport() {
+  m_exportCancel = false;
+  m_exportDone = 0;
+  m_exportFailed = 0;
+  m_exportSummary.reset();
+  m_exportStart = std::chrono::steady_clock::now();
+  m_showExportWindow = true;
+  std::vector<BatchJob> jobs =
+      makeExportJobs(browser.GetFiles(), m_exportDestination, m_develop);
+  m_exportTotal = jobs.size();
+  BatchOptions options;
+  options.workerCommand = {m_options.executable};
+  m_export = std::async(
+      std::launch::async, [this, jobs = std::move(jobs), options]() {
+        auto onResult = [this](const BatchJobResult &result) {
+          if (result.ok) {
+            m_metrics.histogram("export.render_ms").record(result.renderMs);
+          } else {
+            ++m_exportFailed;
+            fmt::print(stderr, "Export of {} failed after {} tries: {}\n",
+                       result.job.input, result.attempts, result.error);
+          }
+          ++m_exportDone;
+        };
+        return runBatchRender(jobs, options, onResult, &m_exportCancel);
+      });
+}
+
+void App::drawExportWindow() {
+  if (m_export.valid() && m_export.wait_for(std::chrono::seconds(0)) ==
+                              std::future_status::ready)
+    m_exportSummary = m_export.get();
+  if (!m_showExportWindow)
+    return;
+
+  ImGui::SetNextWindowSize(ImVec2(420.0f, 0.0f), ImGuiCond_FirstUseEver);
+  if (ImGui::Begin("Export", &m_showExportWindow)) {
+    ImGui::TextWrapped("%s -> %s", m_filmstripDir.string().c_str(),
+                       m_exportDestination.string().c_str());
+    if (m_export.valid()) {
+      const size_t total = m_exportTotal;
+      const size_t done = m_exportDone;
+      const double seconds = millisecondsSince(m_exportStart) / 1000.0;
+      ImGui::ProgressBar(total > 0 ? static_cast<float>(done) / total : 0.0f,
+                         ImVec2(-1.0f, 0.0f));
+      ImGui::Text("%zu / %zu files, %zu failed, %.2f files/s", done, total,
+                  static_cast<size_t>(m_exportFailed),
+                  seconds > 0.0 ? done / seconds : 0.0);
+      if (ImGui::Button("Cancel"))
+        m_exportCancel = true;
+    } else if (m_exportSummary) {
+      ImGui::Text("%zu rendered, %zu failed%s", m_exportSummary->rendered,
+                  m_exportSummary->failed,
+                  m_exportSummary->cancelled ? " (cancelled)" : "");
+      ImGui::Text("%zu retries, %zu worker crashes, %zu workers started",
+                  m_exportSummary->retries, m_exportSummary->workerCrashes,
+                  m_exportSummary->workersStarted);
+      ImGui::Text("%.1f s", m_exportSummary->seconds);
+    }
+  }
+  ImGui::End();
+}
+
+void App::openNewFile(const fs::path &path, OpenReason reason) {
   // Function to open File. Async. Push to queue
   const std::string filePathName = path.string();
   const fs::path directory = path.parent_path();
 
   if (directory != m_filmstripDir && browser.Refresh(directory)) {
     m_filmstripDir = directory;
+    // The watch follows the filmstrip
+    if (m_folderWatcher.watching())
+      m_folderWatcher.start(directory);
   }
 
   m_lastDir = directory.string();
+  m_lastFile = filePathName;
   ImGui::MarkIniSettingsDirty();
-  const uint64_t generation = ++m_loadGeneration;
-  m_loading = true;
   m_showingPreview = false;
+  m_autoAdjust.reset();
+
+  LoadOptions options;
+  options.demosaicMode = m_gpuDemosaicReady || m_demosaicMode != 3
+                             ? m_demosaicMode
+                             : 0;
+  // Culling steps through a folder; none of it is the image to restore
+  if (reason != OpenReason::CullDwell)
+    options.previewCacheFile = m_previewCacheFile;
+  // A newer capture or cull step makes this one's full decode pointless
+  options.skipFullWhenSuperseded = reason != OpenReason::Browse;
+  options.skipPreview = reason == OpenReason::CullDwell;
+  m_loader.open(filePathName, options);
+  if (reason != OpenReason::Capture)
+    m_captureGeneration = 0;
+}
 
-  m_loadFutures.push_back(
-      std::async(std::launch::async, [this, filePathName, generation]() {
-        if (auto preview = extractEmbeddedPreviewImage(filePathName)) {
-          m_loadResults.push(LoadResult{generation, std::move(*preview)});
-        }
-        if (auto full = decodeFullRawImage(filePathName)) {
-          m_loadResults.push(LoadResult{generation, std::move(*full)});
-        }
-        m_completedLoads.push(generation);
-      }));
+void App::pollWatchFolder() {
+  if (!m_folderWatcher.poll(m_captures)) {
+    if (m_folderWatcher.takeOverflow())
+      browser.Refresh(m_folderWatcher.folder());
+    return;
+  }
+
+  // A burst is listed whole but only its newest capture is opened
+  const CapturedFile *newest = nullptr;
+  for (const CapturedFile &capture : m_captures) {
+    if (browser.AddFile(capture.path))
+      newest = &capture;
+  }
+  if (!newest)
+    return;
+
+  m_capture = *newest;
+  openNewFile(m_capture.path, OpenReason::Capture);
+  m_captureGeneration = m_loader.generation();
+  m_captureLatency = {m_capture.writeToSeenMs, 0.0, 0.0};
+  m_metrics.histogram("tether.seen_ms").record(m_capture.writeToSeenMs);
+}
+
+void App::recordCaptureLatency(const LoadResult &result) {
+  const double ms = m_capture.writeToSeenMs + millisecondsSince(m_capture.seen);
+  if (result.mosaic || result.image.kind == ImageKind::Full) {
+    m_captureLatency.fullMs = ms;
+    m_metrics.histogram("tether.full_ms").record(ms);
+    m_captureGeneration = 0;
+  } else {
+    m_captureLatency.previewMs = ms;
+    m_metrics.histogram("tether.preview_ms").record(ms);
+  }
+}
+
+void App::startCulling() {
+  const std::vector<fs::path> &files = browser.GetFiles();
+  const auto current = std::find(files.begin(), files.end(), m_lastFile);
+  const size_t cursor =
+      current == files.end() ? 0 : static_cast<size_t>(current - files.begin());
+  const CullOptions options;
+  m_cull.start(files, cursor, options);
+  m_cullTextures.assign(2 * options.radius + 1, std::nullopt);
+  m_cullGeneration = 0;
+  m_cullFullShown = false;
+  m_cullSwitchRecorded = false;
+}
+
+void App::stopCulling() {
+  if (!m_cull.active())
+    return;
+  // The viewer carries on with the image under the cursor
+  const fs::path current = m_cull.currentFile();
+  m_cull.stop();
+  for (size_t slot = 0; slot < m_cullTextures.size(); ++slot)
+    releaseCullTexture(slot);
+  if (!m_cullFullShown && current != fs::path(m_lastFile))
+    openNewFile(current);
+  m_cullGeneration = 0;
+}
+
+void App::releaseCullTexture(size_t slot) {
+  if (!m_cullTextures[slot])
+    return;
+  GLuint textureId = static_cast<GLuint>(m_cullTextures[slot]->image.textureId);
+  glDeleteTextures(1, &textureId);
+  m_textureBudget.release(m_cullTextures[slot]->handle);
+  m_cullTextures[slot].reset();
+}
+
+void App::updateCulling() {
+  if (!m_cull.active())
+    return;
+
+  if (!ImGui::GetIO().WantTextInput) {
+    int step = 0;
+    if (ImGui::IsKeyPressed(ImGuiKey_RightArrow))
+      step = 1;
+    if (ImGui::IsKeyPressed(ImGuiKey_LeftArrow))
+      step = -1;
+    if (step != 0 && m_cull.move(step)) {
+      m_cullGeneration = 0;
+      m_cullFullShown = false;
+      m_cullSwitchRecorded = false;
+    }
+    for (int stars = 0; stars <= 5; ++stars) {
+      if (ImGui::IsKeyPressed(static_cast<ImGuiKey>(ImGuiKey_0 + stars)))
+        m_cull.setRating(stars);
+    }
+    if (ImGui::IsKeyPressed(ImGuiKey_X))
+      m_cull.toggleReject();
+    if (ImGui::IsKeyPressed(ImGuiKey_Escape)) {
+      stopCulling();
+      return;
+    }
+  }
+
+  m_cull.update();
+  // One upload per frame, so a burst of extractions never stretches a frame
+  if (auto preview = m_cull.takePreview()) {
+    const auto uploadStart = std::chrono::steady_clock::now();
+    releaseCullTexture(preview->slot);
+    CullTexture texture;
+    texture.image = uploadTexture(preview->image);
+    TextureFormat format = TextureFormat::RGB16;
+    if (!preview->image.is16Bit)
+      format = preview->image.channels == 4 ? TextureFormat::RGBA8
+                                            : TextureFormat::RGB8;
+    // No evict callback: the ring stays resident
+    texture.handle = m_textureBudget.track(TextureRole::Preview, format,
+                                           texture.image.width,
+                                           texture.image.height);
+    texture.autoAdjust = preview->autoAdjust;
+    // Arrived after the dwell open of the image under the cursor
+    if (preview->file == m_cull.cursor() && m_cullGeneration != 0)
+      m_autoAdjust = texture.autoAdjust;
+    m_cullTextures[preview->slot] = std::move(texture);
+    m_metrics.histogram("cull.upload_ms")
+        .record(millisecondsSince(uploadStart));
+  }
+
+  // Only the full image is decoded: the ring's preview stays on screen
+  // until it arrives and stands in for the loader's Auto estimate
+  if (m_cull.takeDwell(std::chrono::steady_clock::now())) {
+    openNewFile(m_cull.currentFile(), OpenReason::CullDwell);
+    m_cullGeneration = m_loader.generation();
+    const std::optional<size_t> slot = m_cull.residentSlot(m_cull.cursor());
+    if (slot && m_cullTextures[*slot])
+      m_autoAdjust = m_cullTextures[*slot]->autoAdjust;
+  }
+}
+
+bool App::drawCullView() {
+  if (!m_cull.active() || m_cullFullShown)
+    return false;
+
+  const size_t file = m_cull.cursor();
+  const CullMark &mark = m_cull.mark(file);
+  ImGui::Text("%zu / %zu  %s  %.*s", file + 1, m_cull.fileCount(),
+              m_cull.fileName(file).c_str(), mark.rating, "*****");
+  if (mark.rejected) {
+    ImGui::SameLine();
+    ImGui::TextColored(ImVec4(1.0f, 0.35f, 0.3f, 1.0f), "Rejected");
+  }
+
+  const std::optional<size_t> slot = m_cull.residentSlot(file);
+  if (!slot || !m_cullTextures[*slot]) {
+    ImGui::TextDisabled(m_cull.previewFailed(file)
+                            ? "No embedded preview, full image on dwell"
+                            : "Extracting preview...");
+    return true;
+  }
+
+  const RawImage &image = m_cullTextures[*slot]->image;
+  const ImVec2 canvas = ImGui::GetContentRegionAvail();
+  const float scale = std::min(canvas.x / static_cast<float>(image.width),
+                               canvas.y / static_cast<float>(image.height));
+  const float w = image.width * scale;
+  const float h = image.height * scale;
+  const ImVec2 cursor = ImGui::GetCursorPos();
+  ImGui::SetCursorPos(ImVec2(cursor.x + (canvas.x - w) * 0.5f,
+                             cursor.y + (canvas.y - h) * 0.5f));
+  ImGui::Image((ImTextureID)(uintptr_t)image.textureId, ImVec2(w, h));
+
+  // Key press to the first frame drawing the image: the ring hit or miss
+  if (!m_cullSwitchRecorded) {
+    m_metrics.histogram("cull.switch_ms")
+        .record(millisecondsSince(m_cull.movedAt()));
+    m_cullSwitchRecorded = true;
+  }
+  return true;
 }
 
 void App::drawAboutWindow() {}
 
+void App::drawPerformanceWindow() {
+  if (!m_showPerformanceWindow)
+    return;
+
+  if (ImGui::Begin("Performance", &m_showPerformanceWindow)) {
+    const Histogram &frames = m_metrics.histogram("frame.ms");
+    const HistogramSummary frame = frames.summary();
+    const double fps = frame.p50 > 0.0 ? 1000.0 / frame.p50 : 0.0;
+    ImGui::Text("Frame: %.1f ms p50, %.1f p95, %.1f p99 (%.0f fps)", frame.p50,
+                frame.p95, frame.p99, fps);
+    const std::vector<float> recent = frames.recent();
+    ImGui::PlotLines("##frames", recent.data(), static_cast<int>(recent.size()),
+                     0, nullptr, 0.0f, 50.0f, ImVec2(-1.0f, 60.0f));
+
+    const MetricsSnapshot snapshot = m_metrics.snapshot();
+    constexpr double kMiB = 1024.0 * 1024.0;
+    ImGui::SeparatorText("Gauges");
+    for (const auto &[name, value] : snapshot.gauges) {
+      if (name.rfind("memory.", 0) == 0)
+        ImGui::Text("%-28s %10.1f MB", name.c_str(), value / kMiB);
+      else
+        ImGui::Text("%-28s %10lld", name.c_str(),
+                    static_cast<long long>(value));
+    }
+
+    ImGui::SeparatorText("Counters");
+    for (const auto &[name, value] : snapshot.counters)
+      ImGui::Text("%-28s %10lld", name.c_str(), static_cast<long long>(value));
+
+    ImGui::SeparatorText("Latencies (ms)");
+    if (ImGui::BeginTable("##latencies", 5,
+                          ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+      ImGui::TableSetupColumn("Stage");
+      ImGui::TableSetupColumn("Count");
+      ImGui::TableSetupColumn("p50");
+      ImGui::TableSetupColumn("p95");
+      ImGui::TableSetupColumn("Max");
+      ImGui::TableHeadersRow();
+      for (const auto &[name, h] : snapshot.histograms) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(name.c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%lld", static_cast<long long>(h.count));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", h.p50);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", h.p95);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", h.max);
+      }
+      ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Copy as JSON"))
+      ImGui::SetClipboardText(toJson(snapshot).c_str());
+  }
+  ImGui::End();
+}
+
+// Needs a build with PHOTOCRISPY_TRACK_ALLOCATIONS. With nothing happening
+// on screen the UI thread should not allocate at all.
+void App::drawAllocationWindow() {
+  if (!m_showAllocationWindow)
+    return;
+
+  if (ImGui::Begin("Allocations", &m_showAllocationWindow)) {
+    const AllocationCount &total = m_frameAllocations.total;
+    ImGui::Text("Last frame: %llu allocations, %llu frees, %.1f KiB",
+                static_cast<unsigned long long>(total.allocations),
+                static_cast<unsigned long long>(total.frees),
+                total.bytes / 1024.0);
+    const AllocationCount process = processAllocations();
+    ImGui::TextDisabled("All threads since launch: %llu allocations, "
+                        "%.1f MiB",
+                        static_cast<unsigned long long>(process.allocations),
+                        process.bytes / (1024.0 * 1024.0));
+
+    if (ImGui::BeginTable("scopes", 4,
+                          ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders)) {
+      ImGui::TableSetupColumn("Scope");
+      ImGui::TableSetupColumn("Allocations");
+      ImGui::TableSetupColumn("Frees");
+      ImGui::TableSetupColumn("KiB");
+      ImGui::TableHeadersRow();
+      for (size_t i = 0; i < m_frameAllocations.scopeCount; ++i) {
+        const AllocationScopeCount &scope = m_frameAllocations.scopes[i];
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(scope.scope);
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu",
+                    static_cast<unsigned long long>(scope.count.allocations));
+        ImGui::TableNextColumn();
+        ImGui::Text("%llu", static_cast<unsigned long long>(scope.count.frees));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", scope.count.bytes / 1024.0);
+      }
+      ImGui::EndTable();
+    }
+  }
+  ImGui::End();
+}
+
+void App::drawGpuMemoryWindow() {
+  if (!m_showGpuMemoryWindow)
+    return;
+
+  if (ImGui::Begin("GPU Memory", &m_showGpuMemoryWindow)) {
+    constexpr double kMiB = 1024.0 * 1024.0;
+    const double used = m_textureBudget.usedBytes() / kMiB;
+    const double budget = m_textureBudget.budgetBytes() / kMiB;
+
+    ImGui::Text("Textures: %.1f / %.0f MB", used, budget);
+    ImGui::ProgressBar(budget > 0.0 ? static_cast<float>(used / budget) : 0.0f);
+    int budgetMb = static_cast<int>(budget);
+    if (ImGui::SliderInt("Budget (MB)", &budgetMb, 128, 8192))
+      m_textureBudget.setBudgetBytes(static_cast<size_t>(budgetMb) * 1024 *
+                                     1024);
+    ImGui::Text("Evictions: %zu", m_textureBudget.evictionCount());
+
+    ImGui::SeparatorText("By role");
+    for (TextureRole role :
+         {TextureRole::Source, TextureRole::Processed, TextureRole::Proxy,
+          TextureRole::Tile, TextureRole::Lut, TextureRole::Detail,
+          TextureRole::Thumbnail, TextureRole::Preview, TextureRole::Ui}) {
+      ImGui::Text("%-10s %8.1f MB", textureRoleName(role),
+                  m_textureBudget.bytesForRole(role) / kMiB);
+    }
+
+    ImGui::SeparatorText("Allocations");
+    if (ImGui::BeginTable("##textures", 4,
+                          ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+      ImGui::TableSetupColumn("Role");
+      ImGui::TableSetupColumn("Format");
+      ImGui::TableSetupColumn("Size");
+      ImGui::TableSetupColumn("MB");
+      ImGui::TableHeadersRow();
+      for (const TextureBudget::Entry &entry : m_textureBudget.entries()) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(textureRoleName(entry.role));
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(textureFormatName(entry.format));
+        ImGui::TableNextColumn();
+        if (entry.depth > 1)
+          ImGui::Text("%dx%dx%d", entry.width, entry.height, entry.depth);
+        else
+          ImGui::Text("%dx%d", entry.width, entry.height);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.2f", entry.bytes / kMiB);
+      }
+      ImGui::EndTable();
+    }
+  }
+  ImGui::End();
+}
+
 void App::renderMenuBar() {
   if (ImGui::BeginMainMenuBar()) {
     if (ImGui::BeginMenu("File")) {
@@ -281,9 +1442,54 @@ void App::renderMenuBar() {
         ImGuiFileDialog::Instance()->OpenDialog(
             "ChooseFileDlgKey", "Choose File", ".ARW,.DNG,.RAF", config);
       }
+      // Two folder dialogs: the card, then where the files go
+      if (ImGui::MenuItem("Import...", nullptr, false,
+                          !m_import.valid())) {
+        IGFD::FileDialogConfig config;
+        config.path = m_lastDir;
+        ImGuiFileDialog::Instance()->OpenDialog(
+            "ImportSourceDlgKey", "Import From", nullptr, config);
+      }
+      // Renders the filmstrip folder with the current develop settings.
+      // The batch workers are POSIX processes, so there is none on Windows.
+#ifdef _WIN32
+      const bool canExport = false;
+#else
+      const bool canExport = !m_export.valid() && !browser.GetFiles().empty();
+#endif
+      if (ImGui::MenuItem("Export Folder...", nullptr, false, canExport)) {
+        IGFD::FileDialogConfig config;
+        config.path = m_lastDir;
+        ImGuiFileDialog::Instance()->OpenDialog(
+            "ExportDestinationDlgKey", "Export To", nullptr, config);
+      }
+      // Tethered shooting into the filmstrip folder
+      if (ImGui::MenuItem("Watch Folder", nullptr,
+                          m_folderWatcher.watching(),
+                          !m_filmstripDir.empty())) {
+        if (m_folderWatcher.watching())
+          m_folderWatcher.stop();
+        else
+          m_folderWatcher.start(m_filmstripDir);
+      }
 
       ImGui::EndMenu();
     }
+    if (ImGui::BeginMenu("View")) {
+      ImGui::MenuItem("GPU Memory", nullptr, &m_showGpuMemoryWindow);
+      ImGui::MenuItem("Performance", nullptr, &m_showPerformanceWindow);
+      ImGui::MenuItem("Allocations", nullptr, &m_showAllocationWindow,
+                      allocationTrackingEnabled());
+      ImGui::Separator();
+      if (ImGui::MenuItem("Culling", nullptr, m_cull.active(),
+                          !browser.GetFiles().empty())) {
+        if (m_cull.active())
+          stopCulling();
+        else
+          startCulling();
+      }
+      ImGui::EndMenu();
+    }
     if (ImGui::BeginMenu("Help")) {
       if (ImGui::MenuItem("About")) {
         m_showAboutWindow = true;
@@ -310,6 +1516,12 @@ void App::renderMenuBar() {
       ImVec2 triangleSize = ImGui::GetContentRegionAvail();
       triangleSize.y -= ImGui::GetFrameHeightWithSpacing();
 
+      if (!m_triangleReady) {
+        newTriangle.createTriangle();
+        newTriangle.createFramebuffer();
+        m_triangleReady = true;
+      }
+
       if (triangleSize.x > 0.0f && triangleSize.y > 0.0f) {
         newTriangle.renderTriangle(static_cast<int>(triangleSize.x),
                                    static_cast<int>(triangleSize.y));
@@ -317,6 +1529,18 @@ void App::renderMenuBar() {
                      triangleSize, ImVec2(0.0f, 1.0f), ImVec2(1.0f, 0.0f));
       }
 
+      if (m_startup.firstImageMs > 0.0)
+        ImGui::TextDisabled(
+            "Startup: %.0f ms first frame, %.0f ms first image%s",
+            m_startup.firstFrameMs, m_startup.firstImageMs,
+            m_startup.restoredFromCache ? " (cached)" : "");
+      else
+        ImGui::TextDisabled("Startup: %.0f ms first frame",
+                            m_startup.firstFrameMs);
+      const ShaderCacheStats &shaders = m_shaderCache->stats();
+      ImGui::TextDisabled("Shaders: %d cached, %d compiled (%.0f ms)",
+                          shaders.hits, shaders.misses, shaders.compileMs);
+
       if (ImGui::Button("Close", ImVec2(100.0f, 0.0f))) {
         m_showAboutWindow = false;
       }
@@ -334,6 +1558,33 @@ void App::renderMenuBar() {
     // close
     ImGuiFileDialog::Instance()->Close();
   }
+
+  if (ImGuiFileDialog::Instance()->Display("ImportSourceDlgKey")) {
+    const bool ok = ImGuiFileDialog::Instance()->IsOk();
+    if (ok)
+      m_importSource = ImGuiFileDialog::Instance()->GetCurrentPath();
+    ImGuiFileDialog::Instance()->Close();
+    if (ok) {
+      IGFD::FileDialogConfig config;
+      config.path = m_lastDir;
+      ImGuiFileDialog::Instance()->OpenDialog(
+          "ImportDestinationDlgKey", "Import To", nullptr, config);
+    }
+  }
+  if (ImGuiFileDialog::Instance()->Display("ImportDestinationDlgKey")) {
+    if (ImGuiFileDialog::Instance()->IsOk()) {
+      m_importDestination = ImGuiFileDialog::Instance()->GetCurrentPath();
+      startImport();
+    }
+    ImGuiFileDialog::Instance()->Close();
+  }
+  if (ImGuiFileDialog::Instance()->Display("ExportDestinationDlgKey")) {
+    if (ImGuiFileDialog::Instance()->IsOk()) {
+      m_exportDestination = ImGuiFileDialog::Instance()->GetCurrentPath();
+      startExport();
+    }
+    ImGuiFileDialog::Instance()->Close();
+  }
 }
 
 void App::renderDevelopPanel() {
@@ -350,73 +1601,152 @@ void App::renderDevelopPanel() {
   }
   ImGui::End();
   ImGui::Begin("Develop Settings");
+  if (m_image.has_value()) {
+    std::array<float, kHistogramBins> histogram;
+    {
+      std::lock_guard<std::mutex> lock(m_histogramMutex);
+      histogram = m_histogram;
+    }
+    ImGui::PlotHistogram("##histogram", histogram.data(), kHistogramBins, 0,
+                         nullptr, 0.0f, 1.0f, ImVec2(-1.0f, 60.0f));
+  }
   ImGui::Text("Basic Adjustments");
   bool adjustmentsChanged = false;
+  // True while any adjustment widget is held (drives proxy rendering)
+  bool adjustmentActive = false;
   adjustmentsChanged |=
-      ImGui::SliderFloat("Exposure", &m_exposure, -5.0f, 5.0f);
-  adjustmentsChanged |=
-      ImGui::SliderFloat3("White Balance RGB", m_color, 0.0f, 2.0f);
+      ImGui::SliderFloat("Exposure", &m_develop.exposure, -5.0f, 5.0f);
+  adjustmentActive |= ImGui::IsItemActive();
+  adjustmentsChanged |= ImGui::SliderFloat3(
+      "White Balance RGB", m_develop.whiteBalance, 0.0f, 2.0f);
+  adjustmentActive |= ImGui::IsItemActive();
+
+  ImGui::BeginDisabled(!m_detailFiltersReady);
+  ImGui::Text("Detail");
+  adjustmentsChanged |= ImGui::SliderFloat(
+      "Sharpen Amount", &m_develop.sharpenAmount, 0.0f, 2.0f);
+  adjustmentActive |= ImGui::IsItemActive();
+  adjustmentsChanged |= ImGui::SliderFloat(
+      "Sharpen Radius", &m_develop.sharpenRadius, 0.5f, 3.0f);
+  adjustmentActive |= ImGui::IsItemActive();
+  adjustmentsChanged |= ImGui::SliderFloat(
+      "Sharpen Threshold", &m_develop.sharpenThreshold, 0.0f, 0.1f);
+  adjustmentActive |= ImGui::IsItemActive();
+  adjustmentsChanged |= ImGui::SliderFloat(
+      "Luminance Noise", &m_develop.lumaNoise, 0.0f, 1.0f);
+  adjustmentActive |= ImGui::IsItemActive();
+  adjustmentsChanged |= ImGui::SliderFloat(
+      "Color Noise", &m_develop.chromaNoise, 0.0f, 1.0f);
+  adjustmentActive |= ImGui::IsItemActive();
+  ImGui::EndDisabled();
 
   if (ImGui::Button("Reset Adjustments")) {
-    m_exposure = 0.0f;
-    m_color[0] = 1.0f;
-    m_color[1] = 1.0f;
-    m_color[2] = 1.0f;
+    m_develop = DevelopSettings{};
+    adjustmentsChanged = true;
+  }
+  ImGui::SameLine();
+  ImGui::BeginDisabled(!m_autoAdjust);
+  if (ImGui::Button("Auto")) {
+    applyAutoAdjustment(*m_autoAdjust, m_develop);
     adjustmentsChanged = true;
   }
+  ImGui::EndDisabled();
+  if (m_autoAdjust && ImGui::IsItemHovered())
+    ImGui::SetTooltip("Exposure %+.2f EV, white balance %.2f / %.2f / %.2f",
+                      m_autoAdjust->exposure, m_autoAdjust->whiteBalance[0],
+                      m_autoAdjust->whiteBalance[1],
+                      m_autoAdjust->whiteBalance[2]);
+
+  adjustmentsChanged |= ImGui::Checkbox("Use 3D LUT", &m_useDevelopLut);
+  ImGui::Checkbox("Proxy while dragging", &m_useProxyWhileDragging);
+  ImGui::Checkbox("Tiles when zoomed in", &m_useRoiProcessing);
+  const char *demosaicModes[] = {"LibRaw", "Bilinear", "Edge-directed",
+                                 "GPU"};
+  ImGui::Combo("Demosaic", &m_demosaicMode, demosaicModes,
+               m_gpuDemosaicReady ? 4 : 3);
+
+  // Drag released: refine the proxy to full resolution.
+  if (m_adjustmentActive && !adjustmentActive && m_showingProxy)
+    adjustmentsChanged = true;
+  m_adjustmentActive = adjustmentActive;
 
   if (adjustmentsChanged)
     m_processingDirty = true;
 
+  ImGui::TextDisabled("Last step: %.2f ms GPU, %.2f ms CPU", m_lastStep.gpuMs,
+                      m_lastStep.cpuMs);
+  ImGui::TextDisabled("%s %dx%d", m_lastStep.proxy ? "Proxy" : "Full",
+                      m_lastStep.width, m_lastStep.height);
+  if (m_roiActive)
+    ImGui::TextDisabled("Tiles rendered this frame: %d", m_tilesRendered);
+
   if (ImGui::Button("Export DNG")) {
-    fmt::print("Exporting at exposure: {}\n", m_exposure);
+    fmt::print("Exporting at exposure: {}\n", m_develop.exposure);
   }
 
   ImGui::End();
 }
 
 void App::photoViewer() {
-  while (auto result = m_loadResults.tryPop()) {
-    if (result->generation != m_loadGeneration) {
-      continue;
+  while (auto result = m_loader.takeResult()) {
+    if (result->autoAdjust)
+      m_autoAdjust = result->autoAdjust;
+    const auto uploadStart = std::chrono::steady_clock::now();
+    if (result->mosaic) {
+      // Keeps the preview on screen if the GPU path fails
+      std::optional<RawImage> developed = developMosaic(*result->mosaic);
+      if (!developed)
+        continue;
+      clearImage();
+      m_image = developed;
+      m_imageOnDemosaicTarget = true;
+    } else {
+      clearImage();
+      m_image = uploadTexture(result->image);
+      TextureFormat sourceFormat = TextureFormat::RGB16;
+      if (!result->image.is16Bit)
+        sourceFormat = result->image.channels == 4 ? TextureFormat::RGBA8
+                                                   : TextureFormat::RGB8;
+      m_imageTextureHandle = m_textureBudget.track(
+          TextureRole::Source, sourceFormat, m_image->width, m_image->height);
     }
-
-    clearImage();
-    m_image = uploadTexture(result->image);
+    m_metrics.histogram("upload.texture_ms")
+        .record(millisecondsSince(uploadStart));
+    if (result->generation == m_captureGeneration)
+      recordCaptureLatency(*result);
+    if (result->generation == m_cullGeneration &&
+        (result->mosaic || result->image.kind == ImageKind::Full))
+      m_cullFullShown = true;
+    ++m_imageRevision;
     // editing part
     resizeProcessedImage(m_image->width, m_image->height);
     m_processingDirty = true;
 
     m_showingPreview = result->image.kind == ImageKind::Preview;
-
-    if (result->image.kind == ImageKind::Full) {
-      m_loading = false;
-      m_showingPreview = false;
-    }
-  }
-
-  for (auto it = m_loadFutures.begin(); it != m_loadFutures.end();) {
-    if (it->valid() &&
-        it->wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-      it->get();
-      it = m_loadFutures.erase(it);
-    } else {
-      ++it;
-    }
   }
+  m_loader.collect();
 
-  while (auto completedGeneration = m_completedLoads.tryPop()) {
-    if (*completedGeneration == m_loadGeneration)
-      m_loading = false;
-  }
+  m_textureBytesGauge.set(static_cast<int64_t>(m_textureBudget.usedBytes()));
 
   ImGui::Begin("Viewer");
+  if (drawCullView()) {
+    ImGui::End();
+    return;
+  }
   processImage();
   // As imgui is constantly rendering, we ask if m_image has value.
   if (m_image.has_value()) {
+    if (m_startup.reopenedLastFile && m_startup.firstImageMs == 0.0) {
+      m_startup.firstImageMs = millisecondsSinceLaunch();
+      m_metrics
+          .histogram(m_startup.restoredFromCache
+                         ? "startup.first_image_cached_ms"
+                         : "startup.first_image_ms")
+          .record(m_startup.firstImageMs);
+    }
     ImVec2 canvasSize = ImGui::GetContentRegionAvail();
 
-    if (m_loading && m_showingPreview) {
+    if (m_loader.loading() && m_showingPreview) {
       ImGui::TextDisabled("Loading full RAW...");
       canvasSize = ImGui::GetContentRegionAvail();
     }
@@ -432,6 +1762,9 @@ void App::photoViewer() {
 
     float w = fitW * m_zoom;
     float h = fitH * m_zoom;
+    // On-screen image size, used to size the proxy target
+    m_viewerImageWidth = w;
+    m_viewerImageHeight = h;
     // Center image only when it's smaller than the canvas
     float offsetX = (w < canvasSize.x) ? (canvasSize.x - w) * 0.5f : 0.0f;
     float offsetY = (h < canvasSize.y) ? (canvasSize.y - h) * 0.5f : 0.0f;
@@ -474,14 +1807,42 @@ void App::photoViewer() {
 
     ImGui::SetCursorPos(ImVec2(offsetX, offsetY));
 
-    // ImGui::Image((ImTextureID)(uintptr_t)m_image->textureId, ImVec2(w, h));
-    ImGui::Image((ImTextureID)(uintptr_t)(m_processingReady
-                                              ? m_processedTexture
-                                              : m_image->textureId),
-                 ImVec2(w, h));
+    // Visible part of the image, in image pixels
+    const float scale = w / static_cast<float>(m_image->width);
+    ImageRect visible;
+    visible.x =
+        static_cast<int>(std::floor((ImGui::GetScrollX() - offsetX) / scale));
+    visible.y =
+        static_cast<int>(std::floor((ImGui::GetScrollY() - offsetY) / scale));
+    visible.width = static_cast<int>(std::ceil(canvasSize.x / scale)) + 1;
+    visible.height = static_cast<int>(std::ceil(canvasSize.y / scale)) + 1;
+
+    // Develop only the visible tiles when they cover at most half the image.
+    const int64_t visibleArea =
+        static_cast<int64_t>(std::min(visible.width, m_image->width)) *
+        std::min(visible.height, m_image->height);
+    // Tiles only run the develop pass, so not with the detail filters on.
+    m_roiActive = m_useRoiProcessing && m_processingReady &&
+                  !detailFiltersActive(m_develop) &&
+                  visibleArea * 2 <=
+                      static_cast<int64_t>(m_image->width) * m_image->height;
+
+    if (m_roiActive) {
+      const ImVec2 origin = ImGui::GetCursorScreenPos();
+      drawImageTiles(origin.x, origin.y, scale, visible);
+      // Reserve the image area so scrolling behaves as with ImGui::Image
+      ImGui::Dummy(ImVec2(w, h));
+    } else {
+      // ImGui::Image((ImTextureID)(uintptr_t)m_image->textureId, ImVec2(w, h));
+      GLuint displayTexture = m_image->textureId;
+      if (m_processingReady)
+        displayTexture = m_showingProxy ? m_proxyTarget.texture()
+                                        : m_processedTarget.texture();
+      ImGui::Image((ImTextureID)(uintptr_t)displayTexture, ImVec2(w, h));
+    }
 
     ImGui::EndChild();
-  } else if (m_loading) {
+  } else if (m_loader.loading()) {
     ImVec2 region = ImGui::GetContentRegionAvail();
     float barW = region.x * 0.5f;
     ImGui::SetCursorPos(ImVec2((region.x - barW) * 0.5f, region.y * 0.5f));
@@ -498,8 +1859,19 @@ void App::filmStrip() {
   ImGui::Begin("Filmstrip");
   const fs::path &files = browser.GetSelectedFile();
 
+  if (m_folderWatcher.watching()) {
+    ImGui::TextDisabled("Watching for captures");
+    if (m_captureLatency.seenMs > 0.0)
+      ImGui::Text("Last: seen %.0f ms, preview %.0f ms, full %.0f ms",
+                  m_captureLatency.seenMs, m_captureLatency.previewMs,
+                  m_captureLatency.fullMs);
+  }
+
   if (m_lastDir != ".") {
     bool sel = browser.Draw();
+    // Least recently drawn thumbnails are the ones the budget takes back
+    for (uint64_t handle : browser.GetDrawnThumbnails())
+      m_textureBudget.touch(handle);
 
     if (sel) {
       openNewFile(files);
@@ -513,11 +1885,44 @@ void App::clearImage() {
   if (!m_image.has_value())
     return;
 
-  GLuint textureId = static_cast<GLuint>(m_image->textureId);
-  glDeleteTextures(1, &textureId);
+  // m_demosaicTarget is reused by the next GPU load
+  if (!m_imageOnDemosaicTarget) {
+    GLuint textureId = static_cast<GLuint>(m_image->textureId);
+    glDeleteTextures(1, &textureId);
+  }
+  m_imageOnDemosaicTarget = false;
+  m_textureBudget.release(m_imageTextureHandle);
+  m_imageTextureHandle = 0;
   m_image.reset();
 }
 
+std::optional<RawImage> App::developMosaic(const RawMosaic &mosaic) {
+  if (!m_gpuDemosaicReady || !m_gpuDemosaic.upload(mosaic))
+    return std::nullopt;
+
+  const int width = m_gpuDemosaic.width();
+  const int height = m_gpuDemosaic.height();
+  // Into a new target: m_image may still be on m_demosaicTarget (no preview
+  // in between), and a failed develop must leave it on screen
+  RenderTarget target;
+  target.trackMemory(&m_textureBudget, TextureRole::Source);
+  const bool developed =
+      target.create() &&
+      target.resize(width, height, TextureFormat::RGBA16F) &&
+      m_gpuDemosaic.develop(target);
+  // The developed target is the source from here on
+  m_gpuDemosaic.releaseMosaic();
+  if (!developed) {
+    target.destroy();
+    return std::nullopt;
+  }
+
+  // The caller replaces m_image before anything draws the old one
+  m_demosaicTarget.destroy();
+  m_demosaicTarget = target;
+  return RawImage{m_demosaicTarget.texture(), width, height, ImageKind::Full};
+}
+
 void App::renderDockSpace() {
   ImGuiViewport *viewport = ImGui::GetMainViewport();
   ImGui::SetNextWindowPos(viewport->Pos);
@@ -0,0 +1,263 @@
+#include "AutoAdjust.h"
+#include "Demosaic.h"
+#include "ImageView.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PHOTOCRISPY_AUTO_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PHOTOCRISPY_AUTO_NEON 1
+#endif
+
+// AutoAdjust does the following
+// 1. Gathers every stride-th pixel of every stride-th row as 0..1 RGBX floats.
+// 2. White balance: grey world over the channels that are neither clipped
+//    nor black, accumulated four lanes at a time.
+// 3. Exposure: luminance histogram of the white-balanced samples; the gain
+//    moves the median to the target unless that would clip the highlights.
+//    A median in the bottom bin (black frame) gets no exposure suggestion.
+
+namespace
+{
+constexpr int kHistogramBins = 256;
+
+// Accumulates the masked sums of step 2: per lane, values inside
+// (black, clip) are added to sums and counted.
+class ChannelStatistics
+{
+public:
+    ChannelStatistics(float black, float clip)
+    {
+#if defined(PHOTOCRISPY_AUTO_SSE)
+        m_black = _mm_set1_ps(black);
+        m_clip = _mm_set1_ps(clip);
+        m_one = _mm_set1_ps(1.0f);
+        m_sums = _mm_setzero_ps();
+        m_counts = _mm_setzero_ps();
+#elif defined(PHOTOCRISPY_AUTO_NEON)
+        m_black = vdupq_n_f32(black);
+        m_clip = vdupq_n_f32(clip);
+        m_sums = vdupq_n_f32(0.0f);
+        m_counts = vdupq_n_f32(0.0f);
+#else
+        m_black = black;
+        m_clip = clip;
+#endif
+    }
+
+    void add(const float *rgbx, size_t pixelCount)
+    {
+        for (size_t i = 0; i < pixelCount; ++i, rgbx += 4)
+        {
+#if defined(PHOTOCRISPY_AUTO_SSE)
+            const __m128 value = _mm_loadu_ps(rgbx);
+            const __m128 mask = _mm_and_ps(_mm_cmpgt_ps(value, m_black), _mm_cmplt_ps(value, m_clip));
+            m_sums = _mm_add_ps(m_sums, _mm_and_ps(value, mask));
+            m_counts = _mm_add_ps(m_counts, _mm_and_ps(m_one, mask));
+#elif defined(PHOTOCRISPY_AUTO_NEON)
+            const float32x4_t value = vld1q_f32(rgbx);
+            const uint32x4_t mask = vandq_u32(vcgtq_f32(value, m_black), vcltq_f32(value, m_clip));
+            m_sums = vaddq_f32(m_sums, vbslq_f32(mask, value, vdupq_n_f32(0.0f)));
+            m_counts = vaddq_f32(m_counts, vbslq_f32(mask, vdupq_n_f32(1.0f), vdupq_n_f32(0.0f)));
+#else
+            for (int c = 0; c < 4; ++c)
+                if (rgbx[c] > m_black && rgbx[c] < m_clip)
+                {
+                    m_sums[c] += rgbx[c];
+                    m_counts[c] += 1.0f;
+                }
+#endif
+        }
+    }
+
+    // Mean of channel c over the values that counted, 0 if none did.
+    float mean(int c) const
+    {
+        float sums[4];
+        float counts[4];
+#if defined(PHOTOCRISPY_AUTO_SSE)
+        _mm_storeu_ps(sums, m_sums);
+        _mm_storeu_ps(counts, m_counts);
+#elif defined(PHOTOCRISPY_AUTO_NEON)
+        vst1q_f32(sums, m_sums);
+        vst1q_f32(counts, m_counts);
+#else
+        std::copy(m_sums, m_sums + 4, sums);
+        std::copy(m_counts, m_counts + 4, counts);
+#endif
+        return counts[c] > 0.0f ? sums[c] / counts[c] : 0.0f;
+    }
+
+private:
+#if defined(PHOTOCRISPY_AUTO_SSE)
+    __m128 m_black, m_clip, m_one, m_sums, m_counts;
+#elif defined(PHOTOCRISPY_AUTO_NEON)
+    float32x4_t m_black, m_clip, m_sums, m_counts;
+#else
+    float m_black, m_clip;
+    float m_sums[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float m_counts[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+#endif
+};
+
+int sampleStride(int width, int height, int targetSamples)
+{
+    const double pixels = static_cast<double>(width) * height;
+    return std::max(1, static_cast<int>(std::sqrt(pixels / std::max(targetSamples, 1))));
+}
+
+// Value below which a fraction of the histogram lies. Upper bin edge, so
+// anything in the top bin counts as clipped.
+float percentile(const std::array<int, kHistogramBins> &histogram, int total, float fraction)
+{
+    const int rank = static_cast<int>(std::ceil(fraction * total));
+    int seen = 0;
+    for (int bin = 0; bin < kHistogramBins; ++bin)
+    {
+        seen += histogram[bin];
+        if (seen >= rank)
+            return static_cast<float>(bin + 1) / kHistogramBins;
+    }
+    return 1.0f;
+}
+
+// Steps 2 and 3 on gathered RGBX samples. nullopt without any.
+std::optional<AutoAdjustment> estimateFromSamples(const std::vector<float> &rgbx, const AutoAdjustOptions &options)
+{
+    const size_t sampleCount = rgbx.size() / 4;
+    if (sampleCount == 0)
+        return std::nullopt;
+    AutoAdjustment adjustment;
+    adjustment.samples = static_cast<int>(sampleCount);
+
+    ChannelStatistics statistics(options.blackLevel, options.clipLevel);
+    statistics.add(rgbx.data(), sampleCount);
+    const float green = statistics.mean(1);
+    for (int c = 0; c < 3; ++c)
+    {
+        const float mean = statistics.mean(c);
+        // The Develop panel's white balance sliders go to 2.
+        if (green > 0.0f && mean > 0.0f)
+            adjustment.whiteBalance[c] = std::clamp(green / mean, 0.5f, 2.0f);
+    }
+
+    std::array<int, kHistogramBins> histogram{};
+    const float *wb = adjustment.whiteBalance;
+    for (size_t i = 0; i < sampleCount; ++i)
+    {
+        const float *pixel = rgbx.data() + i * 4;
+        const float luma = 0.2126f * pixel[0] * wb[0] + 0.7152f * pixel[1] * wb[1] + 0.0722f * pixel[2] * wb[2];
+        const int bin = std::clamp(static_cast<int>(luma * kHistogramBins), 0, kHistogramBins - 1);
+        ++histogram[bin];
+    }
+    const int total = static_cast<int>(sampleCount);
+    const float median = percentile(histogram, total, 0.5f);
+    const float highlight = percentile(histogram, total, options.highlightPercentile);
+    // Mostly black: the median says nothing about the scene, and the gain
+    // would only ever hit the +5 EV limit
+    if (median <= 1.0f / kHistogramBins)
+        return adjustment;
+
+    // Brighten no further than the highlights allow; darkening is always
+    // allowed.
+    float gain = options.targetMedian / median;
+    if (gain > 1.0f)
+        gain = std::max(1.0f, std::min(gain, 1.0f / highlight));
+    adjustment.exposure = std::clamp(std::log2(gain), -5.0f, 5.0f);
+    return adjustment;
+}
+
+template <typename T, int Channels>
+void gatherPixels(ConstImageView<T, Channels> image, int stride, std::vector<float> &rgbx)
+{
+    constexpr float scale = 1.0f / imageValueMax<T>();
+    for (int y = stride / 2; y < image.height; y += stride)
+    {
+        for (int x = stride / 2; x < image.width; x += stride)
+        {
+            const T *pixel = image.pixel(x, y);
+            rgbx.push_back(pixel[0] * scale);
+            rgbx.push_back(pixel[1] * scale);
+            rgbx.push_back(pixel[2] * scale);
+            rgbx.push_back(0.0f);
+        }
+    }
+}
+
+float bt709(float x)
+{
+    return x < 0.018f ? 4.5f * x : 1.099f * std::pow(x, 0.45f) - 0.099f;
+}
+} // namespace
+
+std::optional<AutoAdjustment> estimateAutoAdjustment(const ImageData &image, const AutoAdjustOptions &options)
+{
+    if (image.width <= 0 || image.height <= 0)
+        return std::nullopt;
+    const int stride = sampleStride(image.width, image.height, options.targetSamples);
+    std::vector<float> rgbx;
+    rgbx.reserve(static_cast<size_t>(image.width / stride + 1) * (image.height / stride + 1) * 4);
+    // Anything but 8 / 16-bit RGB(A) is refused
+    if (!dispatchImage(image, [&](auto view) { gatherPixels(view, stride, rgbx); }))
+        return std::nullopt;
+    return estimateFromSamples(rgbx, options);
+}
+
+std::optional<AutoAdjustment> estimateAutoAdjustment(const RawMosaic &mosaic, const AutoAdjustOptions &options)
+{
+    const int cellWidth = mosaic.patternWidth;
+    const int cellHeight = mosaic.patternHeight;
+    if (mosaic.width < cellWidth || mosaic.height < cellHeight || cellWidth <= 0 || cellHeight <= 0 ||
+        mosaic.pixels.size() < static_cast<size_t>(mosaic.width) * mosaic.height)
+        return std::nullopt;
+
+    // Stride in whole CFA cells so every sample starts on the same colour.
+    const int cellsX = mosaic.width / cellWidth;
+    const int cellsY = mosaic.height / cellHeight;
+    const int stride = sampleStride(cellsX, cellsY, options.targetSamples);
+    const float range[3] = {mosaic.white - mosaic.black[0], mosaic.white - mosaic.black[1],
+                            mosaic.white - mosaic.black[2]};
+    const float (*m)[3] = mosaic.cameraToRgb;
+
+    std::vector<float> rgbx;
+    rgbx.reserve(static_cast<size_t>(cellsX / stride + 1) * (cellsY / stride + 1) * 4);
+    for (int cy = stride / 2; cy < cellsY; cy += stride)
+        for (int cx = stride / 2; cx < cellsX; cx += stride)
+        {
+            float sums[3] = {0.0f, 0.0f, 0.0f};
+            int counts[3] = {0, 0, 0};
+            for (int dy = 0; dy < cellHeight; ++dy)
+                for (int dx = 0; dx < cellWidth; ++dx)
+                {
+                    const int row = cy * cellHeight + dy;
+                    const int col = cx * cellWidth + dx;
+                    const int color = mosaicColor(mosaic, row, col);
+                    sums[color] += mosaic.pixels[static_cast<size_t>(row) * mosaic.width + col];
+                    ++counts[color];
+                }
+
+            float camera[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                const float mean = counts[c] ? sums[c] / counts[c] : 0.0f;
+                camera[c] = std::clamp((mean - mosaic.black[c]) / std::max(range[c], 1.0f) * mosaic.whiteBalance[c],
+                                       0.0f, 1.0f);
+            }
+            for (int c = 0; c < 3; ++c)
+                rgbx.push_back(
+                    bt709(std::clamp(m[c][0] * camera[0] + m[c][1] * camera[1] + m[c][2] * camera[2], 0.0f, 1.0f)));
+            rgbx.push_back(0.0f);
+        }
+    return estimateFromSamples(rgbx, options);
+}
+
+void applyAutoAdjustment(const AutoAdjustment &adjustment, DevelopSettings &settings)
+{
+    settings.exposure = adjustment.exposure;
+    std::copy(adjustment.whiteBalance, adjustment.whiteBalance + 3, settings.whiteBalance);
+}
@@ -0,0 +1,669 @@
+#include "BatchRender.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// BatchRender does the following
+// 1. Formats and parses the line protocol between coordinator and workers.
+// 2. Worker loop: HELLO, then one JOB at a time until QUIT.
+// 3. Coordinator: starts worker processes on socket pairs, hands out jobs,
+//    polls for replies, and treats a closed socket as a crash of whatever
+//    the worker was running (retried on another worker).
+// 4. Folder export helpers: job list and the 16-bit PPM writer.
+
+namespace fs = std::filesystem;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// fd the worker finds its end of the socket on
+constexpr int kWorkerFd = 3;
+// A peer sending this much without a newline is not speaking the protocol
+constexpr size_t kMaxLineBytes = 1 << 20;
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::string escapeField(const std::string &text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text)
+    {
+        if (c == '\\')
+            escaped += "\\\\";
+        else if (c == '\t')
+            escaped += "\\t";
+        else if (c == '\n')
+            escaped += "\\n";
+        else if (c == '\r')
+            escaped += "\\r";
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+std::optional<std::string> unescapeField(const std::string &text)
+{
+    std::string plain;
+    plain.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (text[i] != '\\')
+        {
+            plain += text[i];
+            continue;
+        }
+        if (++i == text.size())
+            return std::nullopt;
+        switch (text[i])
+        {
+        case '\\':
+            plain += '\\';
+            break;
+        case 't':
+            plain += '\t';
+            break;
+        case 'n':
+            plain += '\n';
+            break;
+        case 'r':
+            plain += '\r';
+            break;
+        default:
+            return std::nullopt;
+        }
+    }
+    return plain;
+}
+
+// True when fields has nothing left but spaces.
+bool consumed(std::istringstream &fields)
+{
+    fields >> std::ws;
+    return fields.eof();
+}
+
+std::vector<std::string> splitTabs(const std::string &line)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    for (;;)
+    {
+        const size_t tab = line.find('\t', start);
+        parts.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+        if (tab == std::string::npos)
+            return parts;
+        start = tab + 1;
+    }
+}
+
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// Writes all of line; a dead peer gives false rather than SIGPIPE.
+bool sendLine(int fd, const std::string &line)
+{
+    size_t sent = 0;
+    while (sent < line.size())
+    {
+        const ssize_t size = ::send(fd, line.data() + sent, line.size() - sent, kSendFlags);
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size <= 0)
+            return false;
+        sent += static_cast<size_t>(size);
+    }
+    return true;
+}
+
+// Splits what arrives on a socket into lines.
+class LineReader
+{
+public:
+    // One read of whatever is there (blocks if nothing is). False at end of
+    // stream, on errors and on oversized lines.
+    bool fill(int fd)
+    {
+        char chunk[4096];
+        ssize_t size;
+        do
+            size = ::recv(fd, chunk, sizeof(chunk), 0);
+        while (size < 0 && errno == EINTR);
+        if (size <= 0)
+            return false;
+        m_buffer.append(chunk, static_cast<size_t>(size));
+        return m_buffer.size() - m_start <= kMaxLineBytes || m_buffer.find('\n', m_start) != std::string::npos;
+    }
+
+    std::optional<std::string> next()
+    {
+        const size_t end = m_buffer.find('\n', m_start);
+        if (end == std::string::npos)
+        {
+            m_buffer.erase(0, m_start);
+            m_start = 0;
+            return std::nullopt;
+        }
+        std::string line = m_buffer.substr(m_start, end - m_start);
+        m_start = end + 1;
+        return line;
+    }
+
+private:
+    std::string m_buffer;
+    size_t m_start = 0;
+};
+
+struct WorkerProcess
+{
+    pid_t pid = -1;
+    int fd = -1;
+    LineReader reader;
+    // HELLO with our version received
+    bool ready = false;
+    // Index into the job list
+    std::optional<size_t> job;
+    Clock::time_point jobStart;
+    bool dead = false;
+    bool timedOut = false;
+};
+
+std::optional<WorkerProcess> spawnWorker(const std::vector<std::string> &command)
+{
+    if (command.empty())
+        return std::nullopt;
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        return std::nullopt;
+    // Neither end leaks into workers started later
+    ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    ::fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    // Built before fork(): the child only calls exec-safe functions
+    std::vector<std::string> arguments = command;
+    arguments.push_back("--batch-worker");
+    arguments.push_back(std::to_string(kWorkerFd));
+    std::vector<char *> argv;
+    for (std::string &argument : arguments)
+        argv.push_back(argument.data());
+    argv.push_back(nullptr);
+
+    const pid_t pid = ::fork();
+    if (pid < 0)
+    {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return std::nullopt;
+    }
+    if (pid == 0)
+    {
+        // dup2() clears close-on-exec on the copy
+        if (fds[1] == kWorkerFd)
+            ::fcntl(kWorkerFd, F_SETFD, 0);
+        else if (::dup2(fds[1], kWorkerFd) < 0)
+            ::_exit(127);
+        ::execvp(argv[0], argv.data());
+        ::_exit(127);
+    }
+
+    ::close(fds[1]);
+    WorkerProcess worker;
+    worker.pid = pid;
+    worker.fd = fds[0];
+    return worker;
+}
+
+// Closes the socket and waits for the process; how it ended, for errors.
+std::string reapWorker(WorkerProcess &worker)
+{
+    ::close(worker.fd);
+    worker.fd = -1;
+    int status = 0;
+    pid_t reaped = 0;
+    // A worker that closed its socket is normally exiting; give it a moment
+    for (int i = 0; i < 50 && (reaped = ::waitpid(worker.pid, &status, WNOHANG)) == 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (reaped == 0)
+    {
+        ::kill(worker.pid, SIGKILL);
+        reaped = ::waitpid(worker.pid, &status, 0);
+    }
+    if (reaped != worker.pid)
+        return "worker lost";
+    if (WIFSIGNALED(status))
+        return "worker killed by signal " + std::to_string(WTERMSIG(status));
+    return "worker exited with status " + std::to_string(WEXITSTATUS(status));
+}
+#endif
+} // namespace
+
+std::string formatBatchMessage(const BatchMessage &message)
+{
+    std::ostringstream out;
+    out.precision(9);
+    switch (message.type)
+    {
+    case BatchMessageType::Hello:
+        out << "HELLO " << message.version;
+        break;
+    case BatchMessageType::Job:
+    {
+        const BatchJob &job = message.job;
+        const DevelopSettings &settings = job.settings;
+        out << "JOB " << job.id << ' ' << job.targetEdge << ' ' << settings.exposure << ' '
+            << settings.whiteBalance[0] << ' ' << settings.whiteBalance[1] << ' ' << settings.whiteBalance[2] << ' '
+            << settings.sharpenAmount << ' ' << settings.sharpenRadius << ' ' << settings.sharpenThreshold << ' '
+            << settings.lumaNoise << ' ' << settings.chromaNoise << '\t' << escapeField(job.input) << '\t'
+            << escapeField(job.output);
+        break;
+    }
+    case BatchMessageType::Done:
+        out << "DONE " << message.job.id << ' ' << message.renderMs;
+        break;
+    case BatchMessageType::Failed:
+        out << "FAIL " << message.job.id << '\t' << escapeField(message.error);
+        break;
+    case BatchMessageType::Quit:
+        out << "QUIT";
+        break;
+    }
+    out << '\n';
+    return out.str();
+}
+
+std::optional<BatchMessage> parseBatchMessage(const std::string &line)
+{
+    const std::vector<std::string> parts = splitTabs(line);
+    std::istringstream fields(parts[0]);
+    std::string type;
+    fields >> type;
+
+    BatchMessage message;
+    if (type == "HELLO" && parts.size() == 1)
+    {
+        message.type = BatchMessageType::Hello;
+        if (!(fields >> message.version))
+            return std::nullopt;
+    }
+    else if (type == "JOB" && parts.size() == 3)
+    {
+        message.type = BatchMessageType::Job;
+        BatchJob &job = message.job;
+        DevelopSettings &settings = job.settings;
+        if (!(fields >> job.id >> job.targetEdge >> settings.exposure >> settings.whiteBalance[0] >>
+              settings.whiteBalance[1] >> settings.whiteBalance[2] >> settings.sharpenAmount >>
+              settings.sharpenRadius >> settings.sharpenThreshold >> settings.lumaNoise >> settings.chromaNoise))
+            return std::nullopt;
+        std::optional<std::string> input = unescapeField(parts[1]);
+        std::optional<std::string> output = unescapeField(parts[2]);
+        if (!input || !output || input->empty() || output->empty())
+            return std::nullopt;
+        job.input = std::move(*input);
+        job.output = std::move(*output);
+    }
+    else if (type == "DONE" && parts.size() == 1)
+    {
+        message.type = BatchMessageType::Done;
+        if (!(fields >> message.job.id >> message.renderMs))
+            return std::nullopt;
+    }
+    else if (type == "FAIL" && parts.size() == 2)
+    {
+        message.type = BatchMessageType::Failed;
+        std::optional<std::string> error = unescapeField(parts[1]);
+        if (!(fields >> message.job.id) || !error)
+            return std::nullopt;
+        message.error = std::move(*error);
+    }
+    else if (type == "QUIT" && parts.size() == 1)
+    {
+        message.type = BatchMessageType::Quit;
+    }
+    else
+    {
+        return std::nullopt;
+    }
+
+    if (!consumed(fields))
+        return std::nullopt;
+    return message;
+}
+
+bool writeDevelopedPpm(const DevelopImage &image, const fs::path &path)
+{
+    const size_t rowValues = static_cast<size_t>(std::max(image.width, 0)) * 3;
+    if (image.width <= 0 || image.height <= 0 || image.pixels.size() < rowValues * image.height)
+        return false;
+
+    fs::path temporary = path;
+    temporary += ".part";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out << "P6\n" << image.width << ' ' << image.height << "\n65535\n";
+        // Big-endian, as the format wants
+        std::vector<uint8_t> row(rowValues * 2);
+        for (int y = 0; y < image.height; ++y)
+        {
+            const float *values = image.pixels.data() + y * rowValues;
+            for (size_t i = 0; i < rowValues; ++i)
+            {
+                const uint16_t value = static_cast<uint16_t>(std::clamp(values[i], 0.0f, 1.0f) * 65535.0f + 0.5f);
+                row[i * 2] = static_cast<uint8_t>(value >> 8);
+                row[i * 2 + 1] = static_cast<uint8_t>(value & 0xff);
+            }
+            out.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size()));
+        }
+        if (!out)
+        {
+            out.close();
+            std::error_code ignored;
+            fs::remove(temporary, ignored);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(temporary, path, error);
+    return !error;
+}
+
+std::vector<BatchJob> makeExportJobs(const std::vector<fs::path> &files, const fs::path &destination,
+                                     const DevelopSettings &settings, int targetEdge)
+{
+    std::vector<BatchJob> jobs;
+    std::set<std::string> names;
+    for (const fs::path &file : files)
+    {
+        const std::string stem = file.stem().string();
+        std::string name = stem + ".ppm";
+        for (int suffix = 2; !names.insert(name).second; ++suffix)
+            name = stem + "-" + std::to_string(suffix) + ".ppm";
+
+        BatchJob job;
+        job.id = jobs.size();
+        job.input = file.string();
+        job.output = (destination / name).string();
+        job.settings = settings;
+        job.targetEdge = targetEdge;
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+std::string batchWorkerExecutable(const char *argv0)
+{
+    std::error_code error;
+    const fs::path self = fs::read_symlink("/proc/self/exe", error);
+    if (!error && !self.empty())
+        return self.string();
+    return argv0 ? argv0 : "";
+}
+
+#ifndef _WIN32
+int runBatchWorker(int fd, const BatchRenderFunction &render)
+{
+    BatchMessage hello;
+    hello.type = BatchMessageType::Hello;
+    if (!sendLine(fd, formatBatchMessage(hello)))
+        return 1;
+
+    LineReader reader;
+    for (;;)
+    {
+        while (std::optional<std::string> line = reader.next())
+        {
+            const std::optional<BatchMessage> message = parseBatchMessage(*line);
+            if (!message)
+                continue;
+            if (message->type == BatchMessageType::Quit)
+            {
+                ::close(fd);
+                return 0;
+            }
+            if (message->type != BatchMessageType::Job)
+                continue;
+
+            const auto start = Clock::now();
+            BatchMessage reply;
+            reply.job.id = message->job.id;
+            if (render(message->job, reply.error))
+            {
+                reply.type = BatchMessageType::Done;
+                reply.renderMs = millisecondsSince(start);
+            }
+            else
+            {
+                reply.type = BatchMessageType::Failed;
+                if (reply.error.empty())
+                    reply.error = "render failed";
+            }
+            if (!sendLine(fd, formatBatchMessage(reply)))
+                return 1;
+        }
+        // The coordinator went away: nothing left to do
+        if (!reader.fill(fd))
+            break;
+    }
+    ::close(fd);
+    return 0;
+}
+
+BatchSummary runBatchRender(const std::vector<BatchJob> &jobs, const BatchOptions &options,
+                            const std::function<void(const BatchJobResult &)> &onResult,
+                            const std::atomic<bool> *cancel)
+{
+    const auto start = Clock::now();
+    BatchSummary summary;
+    std::deque<size_t> pending;
+    for (size_t i = 0; i < jobs.size(); ++i)
+        pending.push_back(i);
+    std::vector<int> attempts(jobs.size(), 0);
+    const int maxAttempts = std::max(options.maxAttempts, 1);
+
+    unsigned workerCount = options.workers;
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency() / 2);
+    // A worker that ends before its HELLO gives its slot up, so a broken
+    // command does not restart forever.
+    size_t slots = std::min<size_t>(workerCount, jobs.size());
+    std::vector<WorkerProcess> workers;
+
+    auto finish = [&](size_t index, bool ok, std::string error, double renderMs) {
+        if (ok)
+            ++summary.rendered;
+        else
+            ++summary.failed;
+        if (onResult)
+            onResult(BatchJobResult{jobs[index], ok, attempts[index], std::move(error), renderMs});
+    };
+    auto failTry = [&](size_t index, std::string error) {
+        if (attempts[index] < maxAttempts && !summary.cancelled)
+        {
+            ++summary.retries;
+            // To the back, so one bad file does not hold up the rest
+            pending.push_back(index);
+        }
+        else
+        {
+            finish(index, false, std::move(error), 0.0);
+        }
+    };
+
+    for (;;)
+    {
+        if (cancel && *cancel && !summary.cancelled)
+        {
+            summary.cancelled = true;
+            pending.clear();
+        }
+
+        while (workers.size() < slots && !pending.empty())
+        {
+            std::optional<WorkerProcess> worker = spawnWorker(options.workerCommand);
+            if (!worker)
+            {
+                --slots;
+                continue;
+            }
+            ++summary.workersStarted;
+            workers.push_back(std::move(*worker));
+        }
+        if (workers.empty())
+        {
+            while (!pending.empty())
+            {
+                const size_t index = pending.front();
+                pending.pop_front();
+                finish(index, false, "no batch worker could be started", 0.0);
+            }
+            break;
+        }
+
+        for (WorkerProcess &worker : workers)
+        {
+            if (!worker.ready || worker.job || pending.empty())
+                continue;
+            const size_t index = pending.front();
+            pending.pop_front();
+            ++attempts[index];
+            BatchMessage message;
+            message.type = BatchMessageType::Job;
+            message.job = jobs[index];
+            worker.job = index;
+            worker.jobStart = Clock::now();
+            // A failed send shows up as a closed socket below
+            sendLine(worker.fd, formatBatchMessage(message));
+        }
+
+        const bool busy = std::any_of(workers.begin(), workers.end(),
+                                      [](const WorkerProcess &worker) { return worker.job.has_value(); });
+        if (pending.empty() && !busy)
+            break;
+
+        // Short timeout: cancel and job timeouts are checked between waits
+        std::vector<pollfd> fds;
+        for (const WorkerProcess &worker : workers)
+            fds.push_back(pollfd{worker.fd, POLLIN, 0});
+        if (::poll(fds.data(), fds.size(), 100) < 0 && errno != EINTR)
+            break;
+
+        for (size_t i = 0; i < workers.size(); ++i)
+        {
+            WorkerProcess &worker = workers[i];
+            if (fds[i].revents == 0)
+                continue;
+            worker.dead = !worker.reader.fill(worker.fd);
+            while (std::optional<std::string> line = worker.reader.next())
+            {
+                const std::optional<BatchMessage> message = parseBatchMessage(*line);
+                if (!message)
+                    continue;
+                if (message->type == BatchMessageType::Hello)
+                {
+                    worker.ready = message->version == kBatchProtocolVersion;
+                    worker.dead = worker.dead || !worker.ready;
+                }
+                else if ((message->type == BatchMessageType::Done || message->type == BatchMessageType::Failed) &&
+                         worker.job && jobs[*worker.job].id == message->job.id)
+                {
+                    const size_t index = *worker.job;
+                    worker.job.reset();
+                    if (message->type == BatchMessageType::Done)
+                        finish(index, true, {}, message->renderMs);
+                    else
+                        failTry(index, message->error);
+                }
+            }
+        }
+
+        if (options.jobTimeoutSeconds > 0.0)
+        {
+            for (WorkerProcess &worker : workers)
+            {
+                if (worker.job && !worker.dead && millisecondsSince(worker.jobStart) > options.jobTimeoutSeconds * 1000.0)
+                {
+                    ::kill(worker.pid, SIGKILL);
+                    worker.dead = true;
+                    worker.timedOut = true;
+                }
+            }
+        }
+
+        for (auto it = workers.begin(); it != workers.end();)
+        {
+            if (!it->dead)
+            {
+                ++it;
+                continue;
+            }
+            const std::string ended = reapWorker(*it);
+            if (it->job)
+            {
+                ++summary.workerCrashes;
+                failTry(*it->job, it->timedOut ? "timed out" : ended);
+            }
+            else if (!it->ready)
+            {
+                --slots;
+            }
+            it = workers.erase(it);
+        }
+    }
+
+    BatchMessage quit;
+    quit.type = BatchMessageType::Quit;
+    for (WorkerProcess &worker : workers)
+    {
+        sendLine(worker.fd, formatBatchMessage(quit));
+        reapWorker(worker);
+    }
+    summary.seconds = millisecondsSince(start) / 1000.0;
+    return summary;
+}
+#else
+int runBatchWorker(int, const BatchRenderFunction &)
+{
+    return 1;
+}
+
+BatchSummary runBatchRender(const std::vector<BatchJob> &jobs, const BatchOptions &,
+                            const std::function<void(const BatchJobResult &)> &onResult, const std::atomic<bool> *)
+{
+    BatchSummary summary;
+    for (const BatchJob &job : jobs)
+    {
+        ++summary.failed;
+        if (onResult)
+            onResult(BatchJobResult{job, false, 0, "batch workers need a POSIX system", 0.0});
+    }
+    return summary;
+}
+#endif
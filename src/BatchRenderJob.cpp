@@ -0,0 +1,43 @@
+#include "BatchRender.h"
+#include "DetailFilters.h"
+#include "Resample.h"
+
+// BatchRenderJob does the following
+// 1. Decodes the raw file with decodeFullRawImage() (half size when the
+//    target edge allows it) and shrinks it to the target edge.
+// 2. Develops it with the same stages as the viewer, detail filters included.
+// 3. Writes the result as a 16-bit PPM.
+// Kept apart from BatchRender.cpp so the coordinator and its tests do not
+// need LibRaw.
+
+bool renderBatchJob(const BatchJob &job, std::string &error)
+{
+    std::optional<ImageData> decoded = decodeFullRawImage(job.input, job.targetEdge);
+    if (!decoded)
+    {
+        error = "could not decode " + job.input;
+        return false;
+    }
+
+    // The worker processes are the parallelism: one thread each here
+    ResampleOptions resample;
+    resample.threads = 1;
+    if (job.targetEdge > 0)
+    {
+        if (std::optional<ImageData> fitted = resampleToFit(*decoded, job.targetEdge, resample))
+            decoded = std::move(fitted);
+    }
+
+    DetailFilterOptions detail;
+    detail.threads = 1;
+    DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+    addDetailStages(pipeline, detail);
+    const DevelopImage &developed = pipeline.process(toDevelopImage(*decoded), 1, job.settings);
+
+    if (!writeDevelopedPpm(developed, job.output))
+    {
+        error = "could not write " + job.output;
+        return false;
+    }
+    return true;
+}
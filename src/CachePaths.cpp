@@ -0,0 +1,37 @@
+#include "CachePaths.h"
+#include <cstdlib>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+fs::path platformCacheDirectory()
+{
+#if defined(_WIN32)
+    if (const char *localAppData = std::getenv("LOCALAPPDATA"))
+        return fs::path(localAppData) / "PhotoCrispy" / "Cache";
+#elif defined(__APPLE__)
+    if (const char *home = std::getenv("HOME"))
+        return fs::path(home) / "Library" / "Caches" / "PhotoCrispy";
+#else
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return fs::path(xdg) / "photocrispy";
+    if (const char *home = std::getenv("HOME"))
+        return fs::path(home) / ".cache" / "photocrispy";
+#endif
+    return {};
+}
+} // namespace
+
+fs::path userCacheDirectory()
+{
+    std::error_code error;
+    fs::path directory = platformCacheDirectory();
+    if (!directory.empty() && (fs::create_directories(directory, error) || fs::is_directory(directory, error)))
+        return directory;
+
+    directory = fs::temp_directory_path(error) / "photocrispy";
+    fs::create_directories(directory, error);
+    return directory;
+}
@@ -0,0 +1,325 @@
+#include "Culling.h"
+#include "AutoAdjust.h"
+#include "Resample.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+// Culling does the following
+// 1. CullRing: maps the files around the cursor onto a fixed set of slots
+//    and hands out the missing ones nearest first.
+// 2. Reads and writes the ratings / rejects sidecar.
+// 3. CullSession: extracts embedded previews for the ring on a few worker
+//    threads, resampled for display, and tracks cursor moves and dwell.
+
+namespace fs = std::filesystem;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr const char *kSidecarHeader = "photocrispy-cull 1";
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+} // namespace
+
+CullRing::CullRing(size_t fileCount, size_t radius)
+    : m_slots(2 * radius + 1), m_fileCount(fileCount), m_radius(radius)
+{
+}
+
+void CullRing::setCursor(size_t file)
+{
+    m_cursor = std::min(file, m_fileCount > 0 ? m_fileCount - 1 : 0);
+}
+
+std::optional<size_t> CullRing::resident(size_t file) const
+{
+    const Slot &slot = slotOf(file);
+    if (slot.file == file && slot.state == State::Resident)
+        return file % m_slots.size();
+    return std::nullopt;
+}
+
+std::optional<size_t> CullRing::nextMissing()
+{
+    for (size_t distance = 0; distance <= m_radius; ++distance)
+    {
+        // Ahead first: culling mostly moves forward
+        const size_t candidates[2] = {m_cursor + distance, m_cursor - distance};
+        for (int side = 0; side < (distance == 0 ? 1 : 2); ++side)
+        {
+            const size_t file = candidates[side];
+            if (side == 1 && distance > m_cursor)
+                continue;
+            if (file >= m_fileCount)
+                continue;
+            Slot &slot = slotOf(file);
+            if (slot.file == file && slot.state != State::Empty)
+                continue;
+            slot.file = file;
+            slot.state = State::Requested;
+            return file;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<size_t> CullRing::place(size_t file)
+{
+    Slot &slot = slotOf(file);
+    if (slot.file != file || (slot.state != State::Requested && slot.state != State::Resident))
+        return std::nullopt;
+    slot.state = State::Resident;
+    return file % m_slots.size();
+}
+
+void CullRing::fail(size_t file)
+{
+    Slot &slot = slotOf(file);
+    if (slot.file == file)
+        slot.state = State::Failed;
+}
+
+bool CullRing::failed(size_t file) const
+{
+    const Slot &slot = slotOf(file);
+    return slot.file == file && slot.state == State::Failed;
+}
+
+fs::path cullSidecarPath(const fs::path &folder)
+{
+    return folder / "photocrispy-cull.txt";
+}
+
+CullMarks loadCullMarks(const fs::path &sidecar)
+{
+    CullMarks marks;
+    std::ifstream in(sidecar);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != kSidecarHeader)
+        return marks;
+
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        CullMark mark;
+        char flag = 0;
+        if (!(fields >> mark.rating >> flag) || mark.rating < 0 || mark.rating > 5 || (flag != 'x' && flag != '-'))
+            continue;
+        mark.rejected = flag == 'x';
+        // The rest of the line, spaces included
+        std::string name;
+        fields.get();
+        std::getline(fields, name);
+        if (!name.empty())
+            marks[name] = mark;
+    }
+    return marks;
+}
+
+bool saveCullMarks(const fs::path &sidecar, const CullMarks &marks)
+{
+    fs::path temporary = sidecar;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        if (!out)
+            return false;
+        out << kSidecarHeader << '\n';
+        for (const auto &[name, mark] : marks)
+        {
+            if (mark == CullMark{})
+                continue;
+            out << mark.rating << ' ' << (mark.rejected ? 'x' : '-') << ' ' << name << '\n';
+        }
+        if (!out)
+            return false;
+    }
+
+    std::error_code error;
+    fs::rename(temporary, sidecar, error);
+    return !error;
+}
+
+CullSession::CullSession(const DecoderRegistry &decoders, MetricsRegistry &metrics)
+    : m_decoders(decoders), m_metrics(metrics)
+{
+}
+
+CullSession::~CullSession()
+{
+    stop();
+}
+
+void CullSession::start(std::vector<fs::path> files, size_t cursor, const CullOptions &options)
+{
+    stop();
+    ++m_session;
+    m_options = options;
+    m_files = std::move(files);
+    m_ring.emplace(m_files.size(), m_options.radius);
+    m_ring->setCursor(cursor);
+    m_movedAt = Clock::now();
+    m_dwellTaken = false;
+
+    m_sidecar = m_files.empty() ? fs::path() : cullSidecarPath(m_files.front().parent_path());
+    m_sidecarMarks = m_sidecar.empty() ? CullMarks() : loadCullMarks(m_sidecar);
+    m_names.clear();
+    m_marks.assign(m_files.size(), CullMark{});
+    for (size_t i = 0; i < m_files.size(); ++i)
+    {
+        m_names.push_back(m_files[i].filename().string());
+        const auto found = m_sidecarMarks.find(m_names[i]);
+        if (found != m_sidecarMarks.end())
+            m_marks[i] = found->second;
+    }
+}
+
+void CullSession::stop()
+{
+    for (auto &worker : m_workers)
+    {
+        if (worker.valid())
+            worker.wait();
+    }
+    m_workers.clear();
+    while (m_results.tryPop())
+    {
+    }
+    m_ring.reset();
+}
+
+bool CullSession::move(int step)
+{
+    if (!m_ring || m_files.empty())
+        return false;
+    const size_t before = m_ring->cursor();
+    const long target = std::clamp<long>(static_cast<long>(before) + step, 0, static_cast<long>(m_files.size()) - 1);
+    if (static_cast<size_t>(target) == before)
+        return false;
+
+    m_ring->setCursor(static_cast<size_t>(target));
+    m_movedAt = Clock::now();
+    m_dwellTaken = false;
+    m_metrics.counter(m_ring->resident(m_ring->cursor()) ? "cull.ring_hits" : "cull.ring_misses").add();
+    return true;
+}
+
+void CullSession::update()
+{
+    for (auto it = m_workers.begin(); it != m_workers.end();)
+    {
+        if (it->wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            it->get();
+            it = m_workers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    if (!m_ring)
+        return;
+
+    while (m_workers.size() < m_options.workers)
+    {
+        const std::optional<size_t> file = m_ring->nextMissing();
+        if (!file)
+            break;
+        m_workers.push_back(std::async(std::launch::async, [this, index = *file, path = m_files[*file].string(),
+                                                            session = m_session]() { extract(index, path, session); }));
+    }
+}
+
+void CullSession::extract(size_t file, const std::string &path, uint64_t session)
+{
+    const auto start = Clock::now();
+    const int maxEdge = m_options.maxEdge;
+    Extracted extracted{session, file, m_decoders.decode({path, DecodeOutput::Preview, maxEdge, {}}), nullptr};
+    if (extracted.image)
+    {
+        // The extraction workers are the parallelism: one thread each here
+        ResampleOptions resample;
+        resample.threads = 1;
+        if (std::optional<ImageData> fitted = resampleToFit(*extracted.image, maxEdge, resample))
+            extracted.image = std::move(fitted);
+        if (std::optional<AutoAdjustment> autoAdjust = estimateAutoAdjustment(*extracted.image))
+            extracted.autoAdjust = std::make_shared<const AutoAdjustment>(*autoAdjust);
+    }
+    m_metrics.histogram("cull.extract_ms").record(millisecondsSince(start));
+    m_results.push(std::move(extracted));
+}
+
+std::optional<CullPreview> CullSession::takePreview()
+{
+    while (auto extracted = m_results.tryPop())
+    {
+        if (!m_ring || extracted->session != m_session)
+            continue;
+        if (!extracted->image)
+        {
+            m_ring->fail(extracted->file);
+            continue;
+        }
+        const std::optional<size_t> slot = m_ring->place(extracted->file);
+        if (!slot)
+        {
+            // The cursor moved on before it arrived
+            m_metrics.counter("cull.dropped").add();
+            continue;
+        }
+        return CullPreview{extracted->file, *slot, std::move(*extracted->image), std::move(extracted->autoAdjust)};
+    }
+    return std::nullopt;
+}
+
+std::optional<size_t> CullSession::residentSlot(size_t file) const
+{
+    return m_ring ? m_ring->resident(file) : std::nullopt;
+}
+
+bool CullSession::previewFailed(size_t file) const
+{
+    return m_ring && m_ring->failed(file);
+}
+
+bool CullSession::takeDwell(Clock::time_point now)
+{
+    if (!m_ring || m_files.empty() || m_dwellTaken)
+        return false;
+    if (std::chrono::duration<double, std::milli>(now - m_movedAt).count() < m_options.dwellMs)
+        return false;
+    m_dwellTaken = true;
+    return true;
+}
+
+bool CullSession::setRating(int rating)
+{
+    if (!m_ring || m_files.empty())
+        return false;
+    CullMark mark = m_marks[cursor()];
+    mark.rating = std::clamp(rating, 0, 5);
+    return setMark(mark);
+}
+
+bool CullSession::toggleReject()
+{
+    if (!m_ring || m_files.empty())
+        return false;
+    CullMark mark = m_marks[cursor()];
+    mark.rejected = !mark.rejected;
+    return setMark(mark);
+}
+
+bool CullSession::setMark(const CullMark &mark)
+{
+    m_marks[cursor()] = mark;
+    m_sidecarMarks[m_names[cursor()]] = mark;
+    return saveCullMarks(m_sidecar, m_sidecarMarks);
+}
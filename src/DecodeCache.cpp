@@ -0,0 +1,481 @@
+#include "DecodeCache.h"
+#include "EmbeddedJpeg.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// DecodeCache does the following
+// 1. Codes each band of rows with MED prediction and bit-packed residuals.
+// 2. Writes header, band table and bands atomically (temp file + rename).
+// 3. Loads by reading and decoding bands in parallel into pixels16.
+// 4. Trims the directory to the budget, oldest access first.
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr char kMagic[4] = {'P', 'C', 'D', 'C'};
+constexpr uint32_t kVersion = 1;
+constexpr int kBlock = 32;
+constexpr const char *kExtension = ".pcd";
+
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    uint64_t parametersHash;
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    int32_t bandRows;
+    uint32_t bandCount;
+    uint32_t reserved;
+};
+
+struct BandEntry
+{
+    uint64_t offset;
+    uint32_t size;
+    uint32_t checksum;
+};
+
+uint64_t fnv1a(const std::string &value, uint64_t hash = 1469598103934665603ull)
+{
+    for (unsigned char c : value)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Word-at-a-time, cheap enough to run over every band on load.
+uint32_t bandChecksum(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 1469598103934665603ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    for (; i < size; ++i)
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+bool sourceStamp(const std::string &sourcePath, uint64_t &size, int64_t &modified)
+{
+    std::error_code error;
+    size = fs::file_size(sourcePath, error);
+    if (error)
+        return false;
+    const auto time = fs::last_write_time(sourcePath, error);
+    modified = static_cast<int64_t>(time.time_since_epoch().count());
+    return !error;
+}
+
+// LOCO-I median edge detector: a = left, b = above, c = above left.
+// median(a, b, a + b - c), written as a clamp so it compiles without branches.
+inline int medPredict(int a, int b, int c)
+{
+    return std::clamp(a + b - c, std::min(a, b), std::max(a, b));
+}
+
+inline uint16_t zigzag(uint16_t value, int prediction)
+{
+    const int16_t residual = static_cast<int16_t>(static_cast<uint16_t>(value - prediction));
+    return static_cast<uint16_t>((static_cast<uint16_t>(residual) << 1) ^ (residual >> 15));
+}
+
+inline uint16_t unzigzag(uint16_t code, int prediction)
+{
+    const uint16_t residual = static_cast<uint16_t>((code >> 1) ^ -(code & 1));
+    return static_cast<uint16_t>(prediction + residual);
+}
+
+int bitWidth(uint16_t value)
+{
+    int bits = 0;
+    while (value >> bits)
+        ++bits;
+    return bits;
+}
+
+void packBlock(const uint16_t *codes, int count, std::vector<uint8_t> &out)
+{
+    uint16_t combined = 0;
+    for (int i = 0; i < count; ++i)
+        combined |= codes[i];
+    const int bits = bitWidth(combined);
+    out.push_back(static_cast<uint8_t>(bits));
+
+    if (bits == 0)
+        return;
+
+    // 32 codes of at most 16 bits: at most 64 bytes, written 4 at a time.
+    const size_t bytes = (static_cast<size_t>(count) * bits + 7) / 8;
+    const size_t base = out.size();
+    out.resize(base + bytes + 4);
+    uint8_t *packed = out.data() + base;
+    uint64_t accumulator = 0;
+    int filled = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        accumulator |= static_cast<uint64_t>(codes[i]) << filled;
+        filled += bits;
+        if (filled >= 32)
+        {
+            const uint32_t word = static_cast<uint32_t>(accumulator);
+            std::memcpy(packed, &word, 4);
+            packed += 4;
+            accumulator >>= 32;
+            filled -= 32;
+        }
+    }
+    const uint32_t word = static_cast<uint32_t>(accumulator);
+    std::memcpy(packed, &word, 4);
+    out.resize(base + bytes);
+}
+
+// Reads one block; position advances past it. False on truncated input.
+bool unpackBlock(const uint8_t *data, size_t size, size_t &position, int count, uint16_t *codes)
+{
+    if (position >= size)
+        return false;
+    const int bits = data[position++];
+    if (bits > 16)
+        return false;
+    const size_t bytes = (static_cast<size_t>(count) * bits + 7) / 8;
+    if (bytes > size - position)
+        return false;
+
+    const uint8_t *packed = data + position;
+    const bool slack = size - position >= bytes + 8;
+    position += bytes;
+    const uint32_t mask = (1u << bits) - 1;
+    if (slack)
+    {
+        // Enough input left for plain 8-byte loads: no carried state.
+        for (int i = 0; i < count; ++i)
+        {
+            const size_t bit = static_cast<size_t>(i) * bits;
+            uint64_t word;
+            std::memcpy(&word, packed + bit / 8, 8);
+            codes[i] = static_cast<uint16_t>((word >> (bit % 8)) & mask);
+        }
+        return true;
+    }
+
+    uint64_t accumulator = 0;
+    int available = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        while (available < bits)
+        {
+            accumulator |= static_cast<uint64_t>(*packed++) << available;
+            available += 8;
+        }
+        codes[i] = static_cast<uint16_t>(accumulator & mask);
+        accumulator >>= bits;
+        available -= bits;
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<uint8_t> encodeBand16(const uint16_t *pixels, int width, int rows, int channels)
+{
+    std::vector<uint8_t> out;
+    out.reserve(static_cast<size_t>(width) * rows * channels);
+    const size_t stride = static_cast<size_t>(width) * channels;
+    std::vector<uint16_t> codes(static_cast<size_t>(width) + kBlock);
+    for (int c = 0; c < channels; ++c)
+        for (int y = 0; y < rows; ++y)
+        {
+            const uint16_t *row = pixels + y * stride + c;
+            if (y == 0)
+            {
+                codes[0] = zigzag(row[0], 0);
+                for (int x = 1; x < width; ++x)
+                    codes[x] = zigzag(row[x * channels], row[(x - 1) * channels]);
+            }
+            else
+            {
+                const uint16_t *above = row - stride;
+                codes[0] = zigzag(row[0], above[0]);
+                for (int x = 1; x < width; ++x)
+                {
+                    const int i = x * channels;
+                    codes[x] = zigzag(row[i], medPredict(row[i - channels], above[i], above[i - channels]));
+                }
+            }
+            for (int x0 = 0; x0 < width; x0 += kBlock)
+                packBlock(codes.data() + x0, std::min(kBlock, width - x0), out);
+        }
+    return out;
+}
+
+bool decodeBand16(const uint8_t *data, size_t size, int width, int rows, int channels, uint16_t *out)
+{
+    size_t position = 0;
+    const size_t stride = static_cast<size_t>(width) * channels;
+    std::vector<uint16_t> codes(static_cast<size_t>(width) + kBlock);
+    for (int c = 0; c < channels; ++c)
+        for (int y = 0; y < rows; ++y)
+        {
+            for (int x0 = 0; x0 < width; x0 += kBlock)
+                if (!unpackBlock(data, size, position, std::min(kBlock, width - x0), codes.data() + x0))
+                    return false;
+
+            uint16_t *row = out + y * stride + c;
+            if (y == 0)
+            {
+                row[0] = unzigzag(codes[0], 0);
+                for (int x = 1; x < width; ++x)
+                    row[x * channels] = unzigzag(codes[x], row[(x - 1) * channels]);
+            }
+            else
+            {
+                const uint16_t *above = row - stride;
+                row[0] = unzigzag(codes[0], above[0]);
+                for (int x = 1; x < width; ++x)
+                {
+                    const int i = x * channels;
+                    row[i] = unzigzag(codes[x], medPredict(row[i - channels], above[i], above[i - channels]));
+                }
+            }
+        }
+    return position == size;
+}
+
+DecodeCache::DecodeCache(fs::path directory, uint64_t budgetBytes)
+    : m_directory(std::move(directory)), m_budgetBytes(budgetBytes)
+{
+    std::error_code error;
+    fs::create_directories(m_directory, error);
+}
+
+fs::path DecodeCache::entryPath(const std::string &sourcePath, const std::string &parameters) const
+{
+    std::error_code error;
+    fs::path canonical = fs::weakly_canonical(sourcePath, error);
+    if (error)
+        canonical = sourcePath;
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(fnv1a(parameters, fnv1a(canonical.string()))));
+    return m_directory / (std::string(name) + kExtension);
+}
+
+std::optional<ImageData> DecodeCache::load(const std::string &sourcePath, const std::string &parameters)
+{
+    const fs::path path = entryPath(sourcePath, parameters);
+    const FileRangeReader file(path.string());
+    if (!file.isOpen())
+        return std::nullopt;
+
+    const auto reject = [&path]() -> std::optional<ImageData> {
+        std::error_code error;
+        fs::remove(path, error);
+        return std::nullopt;
+    };
+
+    Header header{};
+    uint64_t sourceSize = 0;
+    int64_t sourceModified = 0;
+    if (!file.read(0, sizeof(header), reinterpret_cast<uint8_t *>(&header)) ||
+        std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion)
+        return reject();
+    if (!sourceStamp(sourcePath, sourceSize, sourceModified) || header.sourceSize != sourceSize ||
+        header.sourceModified != sourceModified || header.parametersHash != fnv1a(parameters))
+        return reject();
+    if (header.width <= 0 || header.height <= 0 || header.channels < 1 || header.channels > 4 ||
+        header.bandRows <= 0 ||
+        header.bandCount != static_cast<uint32_t>((header.height + header.bandRows - 1) / header.bandRows))
+        return reject();
+
+    // Everything allocated below is bounded by the file: a damaged entry
+    // must be rejected, not ask for gigabytes.
+    std::error_code sizeError;
+    const uint64_t fileSize = fs::file_size(path, sizeError);
+    const uint64_t tableEnd = sizeof(header) + static_cast<uint64_t>(header.bandCount) * sizeof(BandEntry);
+    if (sizeError || tableEnd > fileSize)
+        return reject();
+    std::vector<BandEntry> bands(header.bandCount);
+    if (!file.read(sizeof(header), bands.size() * sizeof(BandEntry), reinterpret_cast<uint8_t *>(bands.data())))
+        return reject();
+    // Every block of kBlock codes takes at least its bit width byte, so the
+    // bands' sizes bound the pixels they can hold.
+    const uint64_t blocksPerRow = (static_cast<uint64_t>(header.width) + kBlock - 1) / kBlock;
+    for (size_t band = 0; band < bands.size(); ++band)
+    {
+        const int rows = std::min(header.bandRows, header.height - static_cast<int>(band) * header.bandRows);
+        const BandEntry &entry = bands[band];
+        if (entry.offset < tableEnd || entry.offset > fileSize || entry.size > fileSize - entry.offset ||
+            entry.size < blocksPerRow * rows * header.channels)
+            return reject();
+    }
+
+    ImageData image;
+    image.width = header.width;
+    image.height = header.height;
+    image.channels = header.channels;
+    image.is16Bit = true;
+    image.kind = ImageKind::Full;
+    const size_t rowValues = static_cast<size_t>(header.width) * header.channels;
+    image.pixels16.resize(rowValues * header.height);
+
+    std::atomic<bool> ok{true};
+    parallelFor(0, static_cast<int>(bands.size()), 1, [&](int first, int last) {
+        std::vector<uint8_t> compressed;
+        for (int band = first; band < last && ok; ++band)
+        {
+            const BandEntry &entry = bands[band];
+            const int y0 = band * header.bandRows;
+            const int rows = std::min(header.bandRows, header.height - y0);
+            compressed.resize(entry.size);
+            if (!file.read(entry.offset, entry.size, compressed.data()) ||
+                bandChecksum(compressed.data(), compressed.size()) != entry.checksum ||
+                !decodeBand16(compressed.data(), compressed.size(), header.width, rows, header.channels,
+                              image.pixels16.data() + y0 * rowValues))
+                ok = false;
+        }
+    });
+    if (!ok)
+        return reject();
+
+    // Recency for trim()
+    std::error_code error;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+    return image;
+}
+
+bool DecodeCache::store(const std::string &sourcePath, const std::string &parameters, const ImageData &image)
+{
+    const size_t rowValues = static_cast<size_t>(image.width) * image.channels;
+    if (!image.is16Bit || image.width <= 0 || image.height <= 0 || image.channels < 1 || image.channels > 4 ||
+        image.pixels16.size() < rowValues * image.height)
+        return false;
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    if (!sourceStamp(sourcePath, header.sourceSize, header.sourceModified))
+        return false;
+    header.parametersHash = fnv1a(parameters);
+    header.width = image.width;
+    header.height = image.height;
+    header.channels = image.channels;
+    header.bandRows = kDecodeCacheBandRows;
+    header.bandCount = static_cast<uint32_t>((image.height + kDecodeCacheBandRows - 1) / kDecodeCacheBandRows);
+
+    std::vector<std::vector<uint8_t>> compressed(header.bandCount);
+    parallelFor(0, static_cast<int>(header.bandCount), 1, [&](int first, int last) {
+        for (int band = first; band < last; ++band)
+        {
+            const int y0 = band * kDecodeCacheBandRows;
+            const int rows = std::min(kDecodeCacheBandRows, image.height - y0);
+            compressed[band] = encodeBand16(image.pixels16.data() + y0 * rowValues, image.width, rows, image.channels);
+        }
+    });
+
+    std::vector<BandEntry> bands(header.bandCount);
+    uint64_t offset = sizeof(header) + bands.size() * sizeof(BandEntry);
+    for (size_t band = 0; band < bands.size(); ++band)
+    {
+        bands[band].offset = offset;
+        bands[band].size = static_cast<uint32_t>(compressed[band].size());
+        bands[band].checksum = bandChecksum(compressed[band].data(), compressed[band].size());
+        offset += compressed[band].size();
+    }
+
+    // Unique temp name: two loader threads may store the same file.
+    static std::atomic<unsigned> writes{0};
+    const fs::path path = entryPath(sourcePath, parameters);
+    fs::path temporary = path;
+    temporary += ".tmp" + std::to_string(writes++);
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(bands.data()),
+                  static_cast<std::streamsize>(bands.size() * sizeof(BandEntry)));
+        for (const std::vector<uint8_t> &band : compressed)
+            out.write(reinterpret_cast<const char *>(band.data()), static_cast<std::streamsize>(band.size()));
+        if (!out)
+        {
+            out.close();
+            std::error_code error;
+            fs::remove(temporary, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(temporary, path, error);
+    if (error)
+        return false;
+    trim();
+    return true;
+}
+
+void DecodeCache::setBudgetBytes(uint64_t bytes)
+{
+    m_budgetBytes = bytes;
+    trim();
+}
+
+uint64_t DecodeCache::sizeBytes() const
+{
+    uint64_t total = 0;
+    std::error_code error;
+    for (const auto &entry : fs::directory_iterator(m_directory, error))
+        if (entry.path().extension() == kExtension)
+            total += entry.file_size(error);
+    return total;
+}
+
+void DecodeCache::trim()
+{
+    std::lock_guard<std::mutex> lock(m_trimMutex);
+
+    struct Entry
+    {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type used;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code error;
+    for (const auto &item : fs::directory_iterator(m_directory, error))
+    {
+        if (item.path().extension() != kExtension)
+            continue;
+        std::error_code itemError;
+        const uint64_t size = item.file_size(itemError);
+        const fs::file_time_type used = item.last_write_time(itemError);
+        if (itemError)
+            continue;
+        entries.push_back(Entry{item.path(), size, used});
+        total += size;
+    }
+    if (total <= m_budgetBytes)
+        return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+    for (const Entry &entry : entries)
+    {
+        if (total <= m_budgetBytes)
+            break;
+        if (fs::remove(entry.path, error))
+            total -= entry.size;
+    }
+}
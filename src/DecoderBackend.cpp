@@ -0,0 +1,112 @@
+#include "DecoderBackend.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+// DecoderRegistry does the following
+// 1. Keeps the registered backends and routing preferences.
+// 2. Orders the backends supporting a request: requested backend, then
+//    preferences, then cost.
+// 3. Decodes with the first backend that succeeds.
+
+const char *decodeOutputName(DecodeOutput output)
+{
+    switch (output)
+    {
+    case DecodeOutput::Thumbnail:
+        return "thumbnail";
+    case DecodeOutput::Preview:
+        return "preview";
+    case DecodeOutput::Full:
+        return "full";
+    }
+    return "?";
+}
+
+std::string decodeExtension(const std::string &path)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+void DecoderRegistry::add(std::shared_ptr<const DecoderBackend> backend)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_backends.push_back(std::move(backend));
+}
+
+void DecoderRegistry::prefer(const std::string &extension, DecodeOutput output, const std::string &backendName)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Latest call wins for the same route.
+    m_preferences.erase(std::remove_if(m_preferences.begin(), m_preferences.end(),
+                                       [&](const Preference &p) {
+                                           return p.extension == extension && p.output == output;
+                                       }),
+                        m_preferences.end());
+    m_preferences.push_back(Preference{extension, output, backendName});
+}
+
+std::vector<std::shared_ptr<const DecoderBackend>> DecoderRegistry::route(const DecodeRequest &request) const
+{
+    const std::string extension = decodeExtension(request.path);
+
+    std::vector<std::pair<int, std::shared_ptr<const DecoderBackend>>> ranked;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto &backend : m_backends)
+        {
+            if (!backend->supports(extension, request.output))
+                continue;
+            // Requested backend, then an exact preference, then a "*" one.
+            int rank = 3;
+            if (!request.preferredBackend.empty() && request.preferredBackend == backend->name())
+                rank = 0;
+            for (const Preference &preference : m_preferences)
+                if (preference.output == request.output && preference.backend == backend->name())
+                {
+                    if (preference.extension == extension)
+                        rank = std::min(rank, 1);
+                    else if (preference.extension == "*")
+                        rank = std::min(rank, 2);
+                }
+            ranked.emplace_back(rank, backend);
+        }
+    }
+
+    std::stable_sort(ranked.begin(), ranked.end(), [&](const auto &a, const auto &b) {
+        if (a.first != b.first)
+            return a.first < b.first;
+        return a.second->cost(extension, request.output) < b.second->cost(extension, request.output);
+    });
+
+    std::vector<std::shared_ptr<const DecoderBackend>> ordered;
+    for (auto &entry : ranked)
+        ordered.push_back(std::move(entry.second));
+    return ordered;
+}
+
+std::optional<ImageData> DecoderRegistry::decode(const DecodeRequest &request) const
+{
+    for (const auto &backend : route(request))
+        if (auto image = backend->decode(request))
+            return image;
+    return std::nullopt;
+}
+
+std::vector<std::shared_ptr<const DecoderBackend>> DecoderRegistry::backends() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_backends;
+}
+
+std::shared_ptr<const DecoderBackend> DecoderRegistry::find(const std::string &name) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &backend : m_backends)
+        if (name == backend->name())
+            return backend;
+    return nullptr;
+}
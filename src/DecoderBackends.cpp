@@ -0,0 +1,152 @@
+#include "DecoderBackend.h"
+#include "Demosaic.h"
+#include "EmbeddedJpeg.h"
+#include "Resample.h"
+#include "StbImageDecoder.h"
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <unordered_set>
+
+// The built-in decoder backends, wrapping the ImageLoader free functions.
+// Costs are rough relative numbers; decoder_bench measures real ones.
+
+namespace
+{
+bool isRawExtension(const std::string &extension)
+{
+    static const std::unordered_set<std::string> extensions = {".arw", ".dng", ".cr2", ".cr3",
+                                                               ".nef", ".raf", ".rw2", ".orf"};
+    return extensions.count(extension) != 0;
+}
+
+bool isStbExtension(const std::string &extension)
+{
+    static const std::unordered_set<std::string> extensions = {".jpg", ".jpeg", ".png", ".bmp", ".tga"};
+    return extensions.count(extension) != 0;
+}
+
+// Embedded JPEGs are often full size; a thumbnail request gets them shrunk
+// here with a proper filter rather than by GL_LINEAR at draw time.
+std::optional<ImageData> fitThumbnail(std::optional<ImageData> image, const DecodeRequest &request)
+{
+    if (!image || request.output != DecodeOutput::Thumbnail || request.targetEdge <= 0)
+        return image;
+    return resampleToFit(*image, request.targetEdge);
+}
+
+// unpack() + dcraw_process(); half size when the target allows it.
+class LibRawBackend : public DecoderBackend
+{
+public:
+    const char *name() const override { return "libraw"; }
+    bool supports(const std::string &extension, DecodeOutput output) const override
+    {
+        return isRawExtension(extension) && output == DecodeOutput::Full;
+    }
+    int cost(const std::string &, DecodeOutput) const override { return 100; }
+    std::optional<ImageData> decode(const DecodeRequest &request) const override
+    {
+        return decodeFullRawImage(request.path, request.targetEdge);
+    }
+};
+
+// LibRaw unpack() + the tiled demosaic (Demosaic.h).
+class InHouseDemosaicBackend : public DecoderBackend
+{
+public:
+    explicit InHouseDemosaicBackend(DemosaicQuality quality) : m_quality(quality) {}
+
+    const char *name() const override
+    {
+        return m_quality == DemosaicQuality::Bilinear ? "demosaic-bilinear" : "demosaic-edge";
+    }
+    bool supports(const std::string &extension, DecodeOutput output) const override
+    {
+        return isRawExtension(extension) && output == DecodeOutput::Full;
+    }
+    int cost(const std::string &, DecodeOutput) const override
+    {
+        return m_quality == DemosaicQuality::Bilinear ? 40 : 60;
+    }
+    std::optional<ImageData> decode(const DecodeRequest &request) const override
+    {
+        DemosaicOptions options;
+        options.quality = m_quality;
+        return decodeRawWithDemosaic(request.path, options);
+    }
+
+private:
+    DemosaicQuality m_quality;
+};
+
+// Byte-range read of the embedded JPEG, no LibRaw involved.
+class EmbeddedJpegBackend : public DecoderBackend
+{
+public:
+    const char *name() const override { return "embedded-jpeg"; }
+    bool supports(const std::string &extension, DecodeOutput output) const override
+    {
+        return isRawExtension(extension) && output != DecodeOutput::Full;
+    }
+    int cost(const std::string &, DecodeOutput) const override { return 1; }
+    std::optional<ImageData> decode(const DecodeRequest &request) const override
+    {
+        // Baseline JPEGs run around 2-4 bits per pixel, so edge^2 / 4 bytes
+        // is a JPEG of roughly targetEdge or larger. Thumbnails without a
+        // target take the smallest JPEG.
+        uint64_t maxBytes = UINT64_MAX;
+        if (request.targetEdge > 0)
+            maxBytes = static_cast<uint64_t>(request.targetEdge) * request.targetEdge / 4;
+        else if (request.output == DecodeOutput::Thumbnail)
+            maxBytes = 0;
+
+        const std::vector<uint8_t> jpeg = readEmbeddedJpeg(request.path, maxBytes);
+        if (jpeg.empty())
+            return std::nullopt;
+        return fitThumbnail(decodeJpegMemoryToRgb(jpeg.data(), jpeg.size(), ImageKind::Preview), request);
+    }
+};
+
+// open_file() + unpack_thumb(): slower, but knows every format LibRaw does.
+class LibRawThumbnailBackend : public DecoderBackend
+{
+public:
+    const char *name() const override { return "libraw-thumb"; }
+    bool supports(const std::string &extension, DecodeOutput output) const override
+    {
+        return isRawExtension(extension) && output != DecodeOutput::Full;
+    }
+    int cost(const std::string &, DecodeOutput) const override { return 20; }
+    std::optional<ImageData> decode(const DecodeRequest &request) const override
+    {
+        // Falls back to LibRaw itself when the container isn't understood.
+        return fitThumbnail(extractEmbeddedPreviewImage(request.path), request);
+    }
+};
+
+class StbBackend : public DecoderBackend
+{
+public:
+    const char *name() const override { return "stb"; }
+    bool supports(const std::string &extension, DecodeOutput) const override { return isStbExtension(extension); }
+    int cost(const std::string &, DecodeOutput) const override { return 10; }
+    std::optional<ImageData> decode(const DecodeRequest &request) const override
+    {
+        std::ifstream file(request.path, std::ios::binary);
+        const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        const ImageKind kind = request.output == DecodeOutput::Full ? ImageKind::Full : ImageKind::Preview;
+        return fitThumbnail(decodeJpegMemoryToRgb(bytes.data(), bytes.size(), kind), request);
+    }
+};
+} // namespace
+
+void registerDefaultDecoders(DecoderRegistry &registry)
+{
+    registry.add(std::make_shared<LibRawBackend>());
+    registry.add(std::make_shared<InHouseDemosaicBackend>(DemosaicQuality::Bilinear));
+    registry.add(std::make_shared<InHouseDemosaicBackend>(DemosaicQuality::EdgeDirected));
+    registry.add(std::make_shared<EmbeddedJpegBackend>());
+    registry.add(std::make_shared<LibRawThumbnailBackend>());
+    registry.add(std::make_shared<StbBackend>());
+}
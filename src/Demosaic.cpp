@@ -0,0 +1,299 @@
+#include "Demosaic.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Demosaic does the following per tile
+// 1. Copies the tile plus a halo out of the mosaic, applying black/white
+//    levels and white balance (values 0..1, clipped like dcraw's scale_colors).
+// 2. Interpolates the two missing colours of every pixel.
+// 3. Converts camera RGB to sRGB, applies the output curve and writes 16-bit RGB.
+// Tiles only read the shared mosaic and write disjoint output rows, so they run
+// on the thread pool without locks.
+
+namespace
+{
+// Enough border for the 5x5 Hamilton-Adams window plus the 3x3
+// colour-difference step that reads interpolated greens.
+constexpr int kHalo = 4;
+
+// Reflects an out-of-range coordinate back into [0, size).
+inline int reflect(int i, int size)
+{
+    if (i < 0)
+        i = -i;
+    if (i >= size)
+        i = 2 * size - 2 - i;
+    return std::clamp(i, 0, size - 1);
+}
+
+struct TileBuffers
+{
+    int width = 0;
+    int height = 0;
+    std::vector<float> cfa;
+    std::vector<uint8_t> color;
+    std::vector<float> green;
+    std::vector<float> rgb;
+
+    void resize(int w, int h)
+    {
+        width = w;
+        height = h;
+        const size_t count = static_cast<size_t>(w) * h;
+        cfa.resize(count);
+        color.resize(count);
+        green.resize(count);
+        rgb.resize(count * 3);
+    }
+};
+
+// Step 1. Reflected coordinates keep value and CFA colour consistent at the
+// image border for any pattern.
+void loadTile(const RawMosaic &mosaic, int x0, int y0, TileBuffers &tile)
+{
+    float scale[3];
+    for (int c = 0; c < 3; ++c)
+        scale[c] = mosaic.whiteBalance[c] / std::max(mosaic.white - mosaic.black[c], 1.0f);
+
+    for (int y = 0; y < tile.height; ++y)
+    {
+        const int row = reflect(y0 - kHalo + y, mosaic.height);
+        const uint16_t *source = mosaic.pixels.data() + static_cast<size_t>(row) * mosaic.width;
+        float *cfa = tile.cfa.data() + static_cast<size_t>(y) * tile.width;
+        uint8_t *color = tile.color.data() + static_cast<size_t>(y) * tile.width;
+
+        for (int x = 0; x < tile.width; ++x)
+        {
+            const int col = reflect(x0 - kHalo + x, mosaic.width);
+            const int c = mosaicColor(mosaic, row, col);
+            color[x] = static_cast<uint8_t>(c);
+            cfa[x] = std::clamp((source[col] - mosaic.black[c]) * scale[c], 0.0f, 1.0f);
+        }
+    }
+}
+
+// Step 2, Bilinear: mean of the same-colour samples in the 3x3 neighbourhood,
+// widened to 5x5 when the 3x3 has none (possible with X-Trans).
+void interpolateBilinear(TileBuffers &tile)
+{
+    const int w = tile.width;
+    for (int y = 2; y < tile.height - 2; ++y)
+    {
+        for (int x = 2; x < w - 2; ++x)
+        {
+            const size_t index = static_cast<size_t>(y) * w + x;
+            const int own = tile.color[index];
+
+            for (int c = 0; c < 3; ++c)
+            {
+                float value = tile.cfa[index];
+                if (c != own)
+                {
+                    float sum = 0.0f;
+                    int count = 0;
+                    for (int radius = 1; radius <= 2 && count == 0; ++radius)
+                    {
+                        for (int dy = -radius; dy <= radius; ++dy)
+                            for (int dx = -radius; dx <= radius; ++dx)
+                            {
+                                const size_t n = index + static_cast<ptrdiff_t>(dy) * w + dx;
+                                if (tile.color[n] == c)
+                                {
+                                    sum += tile.cfa[n];
+                                    ++count;
+                                }
+                            }
+                    }
+                    value = count > 0 ? sum / static_cast<float>(count) : 0.0f;
+                }
+                tile.rgb[index * 3 + c] = value;
+            }
+        }
+    }
+}
+
+// Step 2, EdgeDirected (Bayer).
+void interpolateEdgeDirected(TileBuffers &tile)
+{
+    const int w = tile.width;
+    const ptrdiff_t up = -static_cast<ptrdiff_t>(w);
+    const ptrdiff_t down = w;
+
+    // Green everywhere: interpolate along the direction with the smaller
+    // gradient, corrected by the Laplacian of the site's own colour.
+    for (int y = 2; y < tile.height - 2; ++y)
+    {
+        for (int x = 2; x < w - 2; ++x)
+        {
+            const size_t i = static_cast<size_t>(y) * w + x;
+            const float *v = tile.cfa.data();
+            if (tile.color[i] == 1)
+            {
+                tile.green[i] = v[i];
+                continue;
+            }
+
+            const float laplaceH = 2.0f * v[i] - v[i - 2] - v[i + 2];
+            const float laplaceV = 2.0f * v[i] - v[i + 2 * up] - v[i + 2 * down];
+            const float gradientH = std::fabs(v[i - 1] - v[i + 1]) + std::fabs(laplaceH);
+            const float gradientV = std::fabs(v[i + up] - v[i + down]) + std::fabs(laplaceV);
+            const float estimateH = 0.5f * (v[i - 1] + v[i + 1]) + 0.25f * laplaceH;
+            const float estimateV = 0.5f * (v[i + up] + v[i + down]) + 0.25f * laplaceV;
+
+            float g;
+            if (gradientH < gradientV)
+                g = estimateH;
+            else if (gradientV < gradientH)
+                g = estimateV;
+            else
+                g = 0.5f * (estimateH + estimateV);
+            tile.green[i] = std::clamp(g, 0.0f, 1.0f);
+        }
+    }
+
+    // Red and blue: bilinear on the colour difference (c - G), which is
+    // smooth across edges where c alone is not.
+    for (int y = 3; y < tile.height - 3; ++y)
+    {
+        for (int x = 3; x < w - 3; ++x)
+        {
+            const size_t i = static_cast<size_t>(y) * w + x;
+            const int own = tile.color[i];
+            const float g = tile.green[i];
+            tile.rgb[i * 3 + 1] = g;
+
+            for (int c = 0; c < 3; c += 2)
+            {
+                if (c == own)
+                {
+                    tile.rgb[i * 3 + c] = tile.cfa[i];
+                    continue;
+                }
+
+                float sum = 0.0f;
+                int count = 0;
+                for (int dy = -1; dy <= 1; ++dy)
+                    for (int dx = -1; dx <= 1; ++dx)
+                    {
+                        const size_t n = i + static_cast<ptrdiff_t>(dy) * w + dx;
+                        if (tile.color[n] == c)
+                        {
+                            sum += tile.cfa[n] - tile.green[n];
+                            ++count;
+                        }
+                    }
+                const float value = count > 0 ? g + sum / static_cast<float>(count) : g;
+                tile.rgb[i * 3 + c] = std::clamp(value, 0.0f, 1.0f);
+            }
+        }
+    }
+}
+
+// BT.709 transfer curve (LibRaw's default gamm[0] = 0.45, gamm[1] = 4.5).
+std::vector<uint16_t> makeOutputCurve(bool applyGamma)
+{
+    std::vector<uint16_t> curve(65536);
+    for (int i = 0; i < 65536; ++i)
+    {
+        const double x = i / 65535.0;
+        double y = x;
+        if (applyGamma)
+            y = x < 0.018 ? 4.5 * x : 1.099 * std::pow(x, 0.45) - 0.099;
+        curve[i] = static_cast<uint16_t>(std::lround(std::clamp(y, 0.0, 1.0) * 65535.0));
+    }
+    return curve;
+}
+
+// Step 3, for the interior rows of a tile.
+void writeTile(const RawMosaic &mosaic, const TileBuffers &tile, int x0, int y0, int x1, int y1,
+               const std::vector<uint16_t> &curve, ImageData &output)
+{
+    const float (*m)[3] = mosaic.cameraToRgb;
+    for (int y = y0; y < y1; ++y)
+    {
+        const float *rgb = tile.rgb.data() + (static_cast<size_t>(y - y0 + kHalo) * tile.width + kHalo) * 3;
+        uint16_t *out = output.pixels16.data() + (static_cast<size_t>(y) * output.width + x0) * 3;
+
+        for (int x = 0; x < x1 - x0; ++x)
+        {
+            const float r = rgb[x * 3 + 0];
+            const float g = rgb[x * 3 + 1];
+            const float b = rgb[x * 3 + 2];
+            for (int c = 0; c < 3; ++c)
+            {
+                const float value = std::clamp(m[c][0] * r + m[c][1] * g + m[c][2] * b, 0.0f, 1.0f);
+                out[x * 3 + c] = curve[static_cast<int>(value * 65535.0f + 0.5f)];
+            }
+        }
+    }
+}
+} // namespace
+
+ImageData demosaicMosaic(const RawMosaic &mosaic, const DemosaicOptions &options)
+{
+    ImageData output;
+    output.width = mosaic.width;
+    output.height = mosaic.height;
+    output.channels = 3;
+    output.is16Bit = true;
+    output.kind = ImageKind::Full;
+    if (mosaic.width <= 0 || mosaic.height <= 0 ||
+        mosaic.pixels.size() < static_cast<size_t>(mosaic.width) * mosaic.height)
+        return output;
+
+    output.pixels16.resize(static_cast<size_t>(mosaic.width) * mosaic.height * 3);
+
+    const bool bayer = mosaic.patternWidth == 2 && mosaic.patternHeight == 2;
+    const bool edgeDirected = options.quality == DemosaicQuality::EdgeDirected && bayer;
+    const int tileSize = std::max(options.tileSize, 16);
+    const int tilesX = (mosaic.width + tileSize - 1) / tileSize;
+    const int tilesY = (mosaic.height + tileSize - 1) / tileSize;
+    const std::vector<uint16_t> curve = makeOutputCurve(options.applyGamma);
+
+    parallelFor(
+        0, tilesX * tilesY, 1,
+        [&](int first, int last) {
+            TileBuffers tile;
+            for (int t = first; t < last; ++t)
+            {
+                const int x0 = (t % tilesX) * tileSize;
+                const int y0 = (t / tilesX) * tileSize;
+                const int x1 = std::min(x0 + tileSize, mosaic.width);
+                const int y1 = std::min(y0 + tileSize, mosaic.height);
+
+                tile.resize(x1 - x0 + 2 * kHalo, y1 - y0 + 2 * kHalo);
+                loadTile(mosaic, x0, y0, tile);
+                if (edgeDirected)
+                    interpolateEdgeDirected(tile);
+                else
+                    interpolateBilinear(tile);
+                writeTile(mosaic, tile, x0, y0, x1, y1, curve, output);
+            }
+        },
+        options.threads);
+
+    return output;
+}
+
+double imagePsnr(const ImageData &a, const ImageData &b)
+{
+    if (a.width != b.width || a.height != b.height || a.channels != b.channels || a.is16Bit != b.is16Bit)
+        return 0.0;
+
+    const size_t count = a.is16Bit ? a.pixels16.size() : a.pixels8.size();
+    const double peak = a.is16Bit ? 65535.0 : 255.0;
+    double squaredError = 0.0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const double difference = a.is16Bit ? static_cast<double>(a.pixels16[i]) - b.pixels16[i]
+                                             : static_cast<double>(a.pixels8[i]) - b.pixels8[i];
+        squaredError += difference * difference;
+    }
+    if (count == 0 || squaredError == 0.0)
+        return std::numeric_limits<double>::infinity();
+
+    const double mse = squaredError / static_cast<double>(count);
+    return 10.0 * std::log10(peak * peak / mse);
+}
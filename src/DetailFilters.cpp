@@ -0,0 +1,444 @@
+#include "DetailFilters.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// DetailFilters does the following per tile
+// 1. Converts the tile plus its halo to Y / Cb / Cr planes, clamping at the
+//    image border.
+// 2. Horizontal pass over every plane row (halo rows included), then the
+//    vertical pass over the tile rows. Inner loops run along x so they stay
+//    contiguous.
+// 3. Converts back to RGB into the destination.
+
+namespace
+{
+struct Tile
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Planes of one tile, reused across the tiles of a parallelFor chunk.
+// Source planes are (width + 2 halo) x (height + 2 halo), horizontal pass
+// planes width x (height + 2 halo), accumulators one row.
+struct TileScratch
+{
+    std::vector<float> luma, cb, cr;
+    std::vector<float> lumaH, cbH, crH;
+    std::vector<float> sum, weights, chromaWeights, sumCb, sumCr;
+};
+
+template <typename Fn>
+void forEachTile(int width, int height, const DetailFilterOptions &options, Fn &&fn)
+{
+    const int tileSize = std::max(options.tileSize, 16);
+    const int tilesX = (width + tileSize - 1) / tileSize;
+    const int tilesY = (height + tileSize - 1) / tileSize;
+    parallelFor(
+        0, tilesX * tilesY, 1,
+        [&](int begin, int end) {
+            TileScratch scratch;
+            for (int t = begin; t < end; ++t)
+            {
+                Tile tile;
+                tile.x = (t % tilesX) * tileSize;
+                tile.y = (t / tilesX) * tileSize;
+                tile.width = std::min(tileSize, width - tile.x);
+                tile.height = std::min(tileSize, height - tile.y);
+                fn(tile, scratch);
+            }
+        },
+        options.threads);
+}
+
+// Normalized Gaussian, weights[radius + k] for k in [-radius, radius].
+std::vector<float> gaussianWeights(float sigma, int radius)
+{
+    std::vector<float> weights(2 * radius + 1);
+    float total = 0.0f;
+    for (int k = -radius; k <= radius; ++k)
+    {
+        weights[radius + k] = std::exp(-static_cast<float>(k * k) / (2.0f * sigma * sigma));
+        total += weights[radius + k];
+    }
+    for (float &weight : weights)
+        weight /= total;
+    return weights;
+}
+
+inline float toLuma(const float *rgb)
+{
+    return (rgb[0] + 2.0f * rgb[1] + rgb[2]) * 0.25f;
+}
+
+// Step 1. Cb and Cr are skipped when null.
+void loadPlanes(const DevelopImage &image, const Tile &tile, int halo, float *luma, float *cb, float *cr)
+{
+    const int stride = tile.width + 2 * halo;
+    for (int ty = 0; ty < tile.height + 2 * halo; ++ty)
+    {
+        const int y = std::clamp(tile.y - halo + ty, 0, image.height - 1);
+        const float *row = image.pixels.data() + static_cast<size_t>(y) * image.width * 3;
+        for (int tx = 0; tx < stride; ++tx)
+        {
+            const int x = std::clamp(tile.x - halo + tx, 0, image.width - 1);
+            const float *rgb = row + static_cast<size_t>(x) * 3;
+            const float value = toLuma(rgb);
+            const size_t i = static_cast<size_t>(ty) * stride + tx;
+            luma[i] = value;
+            if (cb)
+            {
+                cb[i] = rgb[2] - value;
+                cr[i] = rgb[0] - value;
+            }
+        }
+    }
+}
+
+// 1 at equal luma, 1/2 at a difference of range.
+inline float rangeWeight(float difference, float inverseRange2)
+{
+    return 1.0f / (1.0f + difference * difference * inverseRange2);
+}
+
+// The bilateral weight of every tap uses the centre of its own pass, so a
+// pass is
+//   out[x] = sum_k s[k] r(v[x+k] - v[x]) v[x+k] / sum_k s[k] r(v[x+k] - v[x])
+// with chroma taking its range weights from the unfiltered luma.
+void reduceNoiseTile(const NoiseReductionKernel &kernel, const DevelopImage &source, DevelopImage &destination,
+                     const Tile &tile, TileScratch &scratch)
+{
+    const int lumaRadius = kernel.luma ? kernel.lumaRadius : 0;
+    const int chromaRadius = kernel.chroma ? kernel.chromaRadius : 0;
+    const int halo = std::max(lumaRadius, chromaRadius);
+    const int stride = tile.width + 2 * halo;
+    const int rows = tile.height + 2 * halo;
+    const size_t planeSize = static_cast<size_t>(stride) * rows;
+    const size_t passSize = static_cast<size_t>(tile.width) * rows;
+    const int width = tile.width;
+
+    scratch.luma.resize(planeSize);
+    scratch.cb.resize(planeSize);
+    scratch.cr.resize(planeSize);
+    scratch.lumaH.resize(passSize);
+    scratch.cbH.resize(passSize);
+    scratch.crH.resize(passSize);
+    for (auto *row : {&scratch.sum, &scratch.weights, &scratch.chromaWeights, &scratch.sumCb, &scratch.sumCr})
+        row->resize(width);
+    loadPlanes(source, tile, halo, scratch.luma.data(), scratch.cb.data(), scratch.cr.data());
+
+    const std::vector<float> lumaSpatial = gaussianWeights(kernel.lumaSigma, lumaRadius);
+    const std::vector<float> chromaSpatial = gaussianWeights(kernel.chromaSigma, chromaRadius);
+    const float lumaInverse = 1.0f / (kernel.lumaRange * kernel.lumaRange);
+    const float chromaInverse = 1.0f / (kernel.chromaRange * kernel.chromaRange);
+    float *sum = scratch.sum.data();
+    float *weights = scratch.weights.data();
+    float *chromaWeights = scratch.chromaWeights.data();
+    float *sumCb = scratch.sumCb.data();
+    float *sumCr = scratch.sumCr.data();
+
+    // Horizontal pass
+    for (int ty = 0; ty < rows; ++ty)
+    {
+        const float *luma = scratch.luma.data() + static_cast<size_t>(ty) * stride + halo;
+        const float *cb = scratch.cb.data() + static_cast<size_t>(ty) * stride + halo;
+        const float *cr = scratch.cr.data() + static_cast<size_t>(ty) * stride + halo;
+        float *lumaH = scratch.lumaH.data() + static_cast<size_t>(ty) * width;
+        float *cbH = scratch.cbH.data() + static_cast<size_t>(ty) * width;
+        float *crH = scratch.crH.data() + static_cast<size_t>(ty) * width;
+
+        if (kernel.luma)
+        {
+            std::fill(sum, sum + width, 0.0f);
+            std::fill(weights, weights + width, 0.0f);
+            for (int k = -lumaRadius; k <= lumaRadius; ++k)
+            {
+                const float spatial = lumaSpatial[lumaRadius + k];
+                for (int x = 0; x < width; ++x)
+                {
+                    const float value = luma[x + k];
+                    const float weight = spatial * rangeWeight(value - luma[x], lumaInverse);
+                    sum[x] += weight * value;
+                    weights[x] += weight;
+                }
+            }
+            for (int x = 0; x < width; ++x)
+                lumaH[x] = sum[x] / weights[x];
+        }
+        else
+        {
+            std::copy(luma, luma + width, lumaH);
+        }
+
+        if (kernel.chroma)
+        {
+            std::fill(sumCb, sumCb + width, 0.0f);
+            std::fill(sumCr, sumCr + width, 0.0f);
+            std::fill(chromaWeights, chromaWeights + width, 0.0f);
+            for (int k = -chromaRadius; k <= chromaRadius; ++k)
+            {
+                const float spatial = chromaSpatial[chromaRadius + k];
+                for (int x = 0; x < width; ++x)
+                {
+                    const float weight = spatial * rangeWeight(luma[x + k] - luma[x], chromaInverse);
+                    sumCb[x] += weight * cb[x + k];
+                    sumCr[x] += weight * cr[x + k];
+                    chromaWeights[x] += weight;
+                }
+            }
+            for (int x = 0; x < width; ++x)
+            {
+                cbH[x] = sumCb[x] / chromaWeights[x];
+                crH[x] = sumCr[x] / chromaWeights[x];
+            }
+        }
+        else
+        {
+            std::copy(cb, cb + width, cbH);
+            std::copy(cr, cr + width, crH);
+        }
+    }
+
+    // Vertical pass, written straight to the destination
+    for (int y = 0; y < tile.height; ++y)
+    {
+        const size_t centre = static_cast<size_t>(y + halo) * width;
+        float *out = destination.pixels.data() + (static_cast<size_t>(tile.y + y) * destination.width + tile.x) * 3;
+
+        if (kernel.luma)
+        {
+            std::fill(sum, sum + width, 0.0f);
+            std::fill(weights, weights + width, 0.0f);
+            for (int k = -lumaRadius; k <= lumaRadius; ++k)
+            {
+                const float spatial = lumaSpatial[lumaRadius + k];
+                const float *row = scratch.lumaH.data() + static_cast<size_t>(y + halo + k) * width;
+                const float *centreRow = scratch.lumaH.data() + centre;
+                for (int x = 0; x < width; ++x)
+                {
+                    const float weight = spatial * rangeWeight(row[x] - centreRow[x], lumaInverse);
+                    sum[x] += weight * row[x];
+                    weights[x] += weight;
+                }
+            }
+            for (int x = 0; x < width; ++x)
+                sum[x] /= weights[x];
+        }
+        else
+        {
+            std::copy(scratch.lumaH.begin() + centre, scratch.lumaH.begin() + centre + width, sum);
+        }
+
+        if (kernel.chroma)
+        {
+            std::fill(sumCb, sumCb + width, 0.0f);
+            std::fill(sumCr, sumCr + width, 0.0f);
+            std::fill(chromaWeights, chromaWeights + width, 0.0f);
+            const float *guideCentre = scratch.luma.data() + static_cast<size_t>(y + halo) * stride + halo;
+            for (int k = -chromaRadius; k <= chromaRadius; ++k)
+            {
+                const float spatial = chromaSpatial[chromaRadius + k];
+                const size_t row = static_cast<size_t>(y + halo + k);
+                const float *guide = scratch.luma.data() + row * stride + halo;
+                const float *cb = scratch.cbH.data() + row * width;
+                const float *cr = scratch.crH.data() + row * width;
+                for (int x = 0; x < width; ++x)
+                {
+                    const float weight = spatial * rangeWeight(guide[x] - guideCentre[x], chromaInverse);
+                    sumCb[x] += weight * cb[x];
+                    sumCr[x] += weight * cr[x];
+                    chromaWeights[x] += weight;
+                }
+            }
+            for (int x = 0; x < width; ++x)
+            {
+                sumCb[x] /= chromaWeights[x];
+                sumCr[x] /= chromaWeights[x];
+            }
+        }
+        else
+        {
+            std::copy(scratch.cbH.begin() + centre, scratch.cbH.begin() + centre + width, sumCb);
+            std::copy(scratch.crH.begin() + centre, scratch.crH.begin() + centre + width, sumCr);
+        }
+
+        // Step 3
+        for (int x = 0; x < width; ++x)
+        {
+            const float r = sum[x] + sumCr[x];
+            const float b = sum[x] + sumCb[x];
+            out[x * 3 + 0] = r;
+            out[x * 3 + 1] = (4.0f * sum[x] - r - b) * 0.5f;
+            out[x * 3 + 2] = b;
+        }
+    }
+}
+
+// Unsharp mask on luma: detail = Y - gaussian(Y). Detail below threshold
+// is taken for noise and ramps in up to twice the threshold. The luma change
+// is added to all three channels, so colours don't shift.
+void sharpenTile(const SharpenKernel &kernel, const DevelopImage &source, DevelopImage &destination,
+                 const Tile &tile, TileScratch &scratch)
+{
+    const int radius = kernel.radius;
+    const int stride = tile.width + 2 * radius;
+    const int rows = tile.height + 2 * radius;
+    const int width = tile.width;
+
+    scratch.luma.resize(static_cast<size_t>(stride) * rows);
+    scratch.lumaH.resize(static_cast<size_t>(width) * rows);
+    scratch.sum.resize(width);
+    loadPlanes(source, tile, radius, scratch.luma.data(), nullptr, nullptr);
+
+    const std::vector<float> spatial = gaussianWeights(kernel.sigma, radius);
+    for (int ty = 0; ty < rows; ++ty)
+    {
+        const float *luma = scratch.luma.data() + static_cast<size_t>(ty) * stride + radius;
+        float *lumaH = scratch.lumaH.data() + static_cast<size_t>(ty) * width;
+        std::fill(lumaH, lumaH + width, 0.0f);
+        for (int k = -radius; k <= radius; ++k)
+        {
+            const float weight = spatial[radius + k];
+            for (int x = 0; x < width; ++x)
+                lumaH[x] += weight * luma[x + k];
+        }
+    }
+
+    const float inverseThreshold = 1.0f / std::max(kernel.threshold, 1e-6f);
+    float *blur = scratch.sum.data();
+    for (int y = 0; y < tile.height; ++y)
+    {
+        std::fill(blur, blur + width, 0.0f);
+        for (int k = -radius; k <= radius; ++k)
+        {
+            const float weight = spatial[radius + k];
+            const float *row = scratch.lumaH.data() + static_cast<size_t>(y + radius + k) * width;
+            for (int x = 0; x < width; ++x)
+                blur[x] += weight * row[x];
+        }
+
+        const float *luma = scratch.luma.data() + static_cast<size_t>(y + radius) * stride + radius;
+        const size_t offset = (static_cast<size_t>(tile.y + y) * source.width + tile.x) * 3;
+        const float *in = source.pixels.data() + offset;
+        float *out = destination.pixels.data() + offset;
+        for (int x = 0; x < width; ++x)
+        {
+            const float detail = luma[x] - blur[x];
+            const float mask = std::clamp((std::abs(detail) - kernel.threshold) * inverseThreshold, 0.0f, 1.0f);
+            const float delta = kernel.amount * detail * mask;
+            out[x * 3 + 0] = in[x * 3 + 0] + delta;
+            out[x * 3 + 1] = in[x * 3 + 1] + delta;
+            out[x * 3 + 2] = in[x * 3 + 2] + delta;
+        }
+    }
+}
+
+bool sameSize(const DevelopImage &source, const DevelopImage &destination)
+{
+    return source.width > 0 && source.height > 0 && destination.width == source.width &&
+           destination.height == source.height &&
+           source.pixels.size() >= static_cast<size_t>(source.width) * source.height * 3 &&
+           destination.pixels.size() == source.pixels.size();
+}
+} // namespace
+
+NoiseReductionKernel noiseReductionKernel(const DevelopSettings &settings, float scale)
+{
+    NoiseReductionKernel kernel;
+    const float luma = std::clamp(settings.lumaNoise, 0.0f, 1.0f);
+    const float chroma = std::clamp(settings.chromaNoise, 0.0f, 1.0f);
+    kernel.luma = luma > 0.0f;
+    kernel.lumaSigma = std::max((0.5f + 2.0f * luma) * scale, 0.05f);
+    kernel.lumaRange = 0.005f + 0.045f * luma;
+    kernel.lumaRadius = static_cast<int>(std::ceil(2.0f * kernel.lumaSigma));
+    kernel.chroma = chroma > 0.0f;
+    kernel.chromaSigma = std::max((1.0f + 3.0f * chroma) * scale, 0.05f);
+    kernel.chromaRange = 0.02f + 0.1f * chroma;
+    kernel.chromaRadius = static_cast<int>(std::ceil(2.0f * kernel.chromaSigma));
+    return kernel;
+}
+
+SharpenKernel sharpenKernel(const DevelopSettings &settings, float scale)
+{
+    SharpenKernel kernel;
+    kernel.amount = std::max(settings.sharpenAmount, 0.0f);
+    kernel.active = kernel.amount > 0.0f;
+    kernel.sigma = std::max(settings.sharpenRadius * scale, 0.05f);
+    kernel.radius = static_cast<int>(std::ceil(3.0f * kernel.sigma));
+    kernel.threshold = std::max(settings.sharpenThreshold, 0.0f);
+    return kernel;
+}
+
+bool detailFiltersActive(const DevelopSettings &settings)
+{
+    const NoiseReductionKernel noise = noiseReductionKernel(settings);
+    return noise.luma || noise.chroma || sharpenKernel(settings).active;
+}
+
+void reduceNoise(const DevelopSettings &settings, const DevelopImage &source, DevelopImage &destination,
+                 const DetailFilterOptions &options)
+{
+    if (!sameSize(source, destination))
+        return;
+    const NoiseReductionKernel kernel = noiseReductionKernel(settings);
+    if (!kernel.luma && !kernel.chroma)
+    {
+        destination.pixels = source.pixels;
+        return;
+    }
+    forEachTile(source.width, source.height, options, [&](const Tile &tile, TileScratch &scratch) {
+        reduceNoiseTile(kernel, source, destination, tile, scratch);
+    });
+}
+
+void sharpen(const DevelopSettings &settings, const DevelopImage &source, DevelopImage &destination,
+             const DetailFilterOptions &options)
+{
+    if (!sameSize(source, destination))
+        return;
+    const SharpenKernel kernel = sharpenKernel(settings);
+    if (!kernel.active)
+    {
+        destination.pixels = source.pixels;
+        return;
+    }
+    forEachTile(source.width, source.height, options, [&](const Tile &tile, TileScratch &scratch) {
+        sharpenTile(kernel, source, destination, tile, scratch);
+    });
+}
+
+void addDetailStages(DevelopPipeline &pipeline, const DetailFilterOptions &options)
+{
+    DevelopStage noise;
+    noise.name = "Noise Reduction";
+    noise.kind = DevelopStageKind::Neighborhood;
+    noise.parameterHash = [](const DevelopSettings &settings) {
+        const float values[2] = {settings.lumaNoise, settings.chromaNoise};
+        return hashDevelopValues(values, 2);
+    };
+    noise.applyImage = [options](const DevelopSettings &settings, const DevelopImage &source,
+                                 DevelopImage &destination) { reduceNoise(settings, source, destination, options); };
+    pipeline.addStage(std::move(noise));
+
+    DevelopStage sharpening;
+    sharpening.name = "Sharpening";
+    sharpening.kind = DevelopStageKind::Neighborhood;
+    sharpening.parameterHash = [](const DevelopSettings &settings) {
+        const float values[3] = {settings.sharpenAmount, settings.sharpenRadius, settings.sharpenThreshold};
+        return hashDevelopValues(values, 3);
+    };
+    sharpening.applyImage = [options](const DevelopSettings &settings, const DevelopImage &source,
+                                      DevelopImage &destination) { sharpen(settings, source, destination, options); };
+    pipeline.addStage(std::move(sharpening));
+}
+
+DevelopPipeline makeDetailDevelopPipeline()
+{
+    DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+    addDetailStages(pipeline);
+    return pipeline;
+}
@@ -0,0 +1,195 @@
+#include "DevelopLut.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PHOTOCRISPY_LUT_SSE 1
+#endif
+
+// DevelopLut does the following
+// 1. Bakes a PerPixel develop pass into a size^3 RGBA float table.
+// 2. Applies the table to RGB float pixels with trilinear interpolation.
+// 3. Bakes asynchronously and caches tables by pass parameters (DevelopLutBaker).
+
+DevelopLut bakeDevelopLut(const DevelopPipeline &pipeline, const DevelopSettings &settings,
+                          int size, size_t passIndex)
+{
+    DevelopLut lut;
+    lut.size = size;
+    lut.key = pipeline.passKey(settings, passIndex) ^ static_cast<uint64_t>(size);
+
+    // Grid colours go through the same fused CPU kernel as a real image.
+    const size_t entryCount = static_cast<size_t>(size) * size * size;
+    std::vector<float> rgb(entryCount * 3);
+    const float step = 1.0f / static_cast<float>(size - 1);
+    size_t index = 0;
+    for (int b = 0; b < size; ++b)
+        for (int g = 0; g < size; ++g)
+            for (int r = 0; r < size; ++r)
+            {
+                rgb[index++] = r * step;
+                rgb[index++] = g * step;
+                rgb[index++] = b * step;
+            }
+
+    pipeline.applyPerPixelPass(passIndex, settings, rgb.data(), entryCount);
+
+    lut.rgba.resize(entryCount * 4);
+    for (size_t i = 0; i < entryCount; ++i)
+    {
+        lut.rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        lut.rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        lut.rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        lut.rgba[i * 4 + 3] = 1.0f;
+    }
+    return lut;
+}
+
+namespace
+{
+// Lattice cell and fractional position of one channel value.
+inline void locate(float value, int size, int &cell, float &fraction)
+{
+    const float scaled = std::clamp(value, 0.0f, 1.0f) * static_cast<float>(size - 1);
+    cell = std::min(static_cast<int>(scaled), size - 2);
+    fraction = scaled - static_cast<float>(cell);
+}
+} // namespace
+
+void applyDevelopLut(const DevelopLut &lut, const float *in, float *out, size_t pixelCount)
+{
+    if (lut.size < 2)
+        return;
+
+    const int size = lut.size;
+    const size_t strideG = static_cast<size_t>(size) * 4;
+    const size_t strideB = static_cast<size_t>(size) * size * 4;
+    const float *table = lut.rgba.data();
+
+    for (size_t i = 0; i < pixelCount; ++i)
+    {
+        int r0, g0, b0;
+        float tr, tg, tb;
+        locate(in[i * 3 + 0], size, r0, tr);
+        locate(in[i * 3 + 1], size, g0, tg);
+        locate(in[i * 3 + 2], size, b0, tb);
+
+        const float *c000 = table + b0 * strideB + g0 * strideG + r0 * 4;
+        const float *c010 = c000 + strideG;
+        const float *c001 = c000 + strideB;
+        const float *c011 = c001 + strideG;
+
+#ifdef PHOTOCRISPY_LUT_SSE
+        // All three channels of a lattice point are interpolated in one register.
+        const __m128 wr = _mm_set1_ps(tr);
+        const __m128 wg = _mm_set1_ps(tg);
+        const __m128 wb = _mm_set1_ps(tb);
+        auto lerp = [](__m128 a, __m128 b, __m128 t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t)); };
+
+        const __m128 x00 = lerp(_mm_loadu_ps(c000), _mm_loadu_ps(c000 + 4), wr);
+        const __m128 x10 = lerp(_mm_loadu_ps(c010), _mm_loadu_ps(c010 + 4), wr);
+        const __m128 x01 = lerp(_mm_loadu_ps(c001), _mm_loadu_ps(c001 + 4), wr);
+        const __m128 x11 = lerp(_mm_loadu_ps(c011), _mm_loadu_ps(c011 + 4), wr);
+        const __m128 result = lerp(lerp(x00, x10, wg), lerp(x01, x11, wg), wb);
+
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, result);
+        out[i * 3 + 0] = lanes[0];
+        out[i * 3 + 1] = lanes[1];
+        out[i * 3 + 2] = lanes[2];
+#else
+        for (int c = 0; c < 3; ++c)
+        {
+            const float x00 = c000[c] + (c000[c + 4] - c000[c]) * tr;
+            const float x10 = c010[c] + (c010[c + 4] - c010[c]) * tr;
+            const float x01 = c001[c] + (c001[c + 4] - c001[c]) * tr;
+            const float x11 = c011[c] + (c011[c + 4] - c011[c]) * tr;
+            const float y0 = x00 + (x10 - x00) * tg;
+            const float y1 = x01 + (x11 - x01) * tg;
+            out[i * 3 + c] = y0 + (y1 - y0) * tb;
+        }
+#endif
+    }
+}
+
+DevelopLutBaker::DevelopLutBaker(DevelopPipeline pipeline, int size, size_t cacheCapacity)
+    : m_pipeline(std::move(pipeline)), m_size(std::max(size, 2)), m_cacheCapacity(std::max<size_t>(cacheCapacity, 1))
+{
+}
+
+DevelopLutBaker::~DevelopLutBaker()
+{
+    if (m_bake.valid())
+        m_bake.wait();
+}
+
+std::shared_ptr<const DevelopLut> DevelopLutBaker::request(const DevelopSettings &settings)
+{
+    const uint64_t key = m_pipeline.passKey(settings, 0) ^ static_cast<uint64_t>(m_size);
+
+    for (auto it = m_cache.begin(); it != m_cache.end(); ++it)
+    {
+        if ((*it)->key == key)
+        {
+            m_cache.splice(m_cache.begin(), m_cache, it);
+            return m_cache.front();
+        }
+    }
+
+    if (!m_bake.valid())
+        startBake(settings, key);
+    else if (m_bakingKey != key)
+        m_pending = std::make_pair(settings, key);
+    else
+        m_pending.reset();
+
+    return nullptr;
+}
+
+void DevelopLutBaker::collect()
+{
+    // The worker pushes before its future turns ready, so checking the future
+    // first guarantees a finished bake is already in m_baked.
+    bool finished = false;
+    if (m_bake.valid() && m_bake.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        m_bake.get();
+        finished = true;
+    }
+
+    while (auto baked = m_baked.tryPop())
+    {
+        m_cache.push_front(std::move(*baked));
+        if (m_cache.size() > m_cacheCapacity)
+            m_cache.pop_back();
+    }
+
+    if (finished && m_pending)
+    {
+        const auto pending = *m_pending;
+        m_pending.reset();
+        const bool cached = std::any_of(m_cache.begin(), m_cache.end(),
+                                        [&](const auto &lut) { return lut->key == pending.second; });
+        if (!cached)
+            startBake(pending.first, pending.second);
+    }
+}
+
+void DevelopLutBaker::wait()
+{
+    while (m_bake.valid())
+    {
+        m_bake.wait();
+        collect();
+    }
+}
+
+void DevelopLutBaker::startBake(const DevelopSettings &settings, uint64_t key)
+{
+    m_bakingKey = key;
+    m_bake = std::async(std::launch::async, [this, settings]() {
+        m_baked.push(std::make_shared<const DevelopLut>(bakeDevelopLut(m_pipeline, settings, m_size)));
+    });
+}
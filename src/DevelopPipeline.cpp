@@ -0,0 +1,260 @@
+#include "DevelopPipeline.h"
+#include "ImageView.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+// DevelopPipeline does the following
+// 1. Groups stages into passes (fused PerPixel runs, single Neighborhood stages).
+// 2. Generates the fused fragment shader for a PerPixel pass.
+// 3. Runs the same passes on the CPU, caching every pass output.
+
+namespace
+{
+constexpr const char *kDeclarationsMarker = "// @DEVELOP_DECLARATIONS@";
+constexpr const char *kBodyMarker = "// @DEVELOP_BODY@";
+
+// Pixels pushed through all fused stages at once. Small enough for the
+// chunk to stay in L1 between stages.
+constexpr size_t kFusedChunkPixels = 1024;
+
+void replaceMarker(std::string &source, const char *marker, const std::string &replacement)
+{
+    const size_t position = source.find(marker);
+    if (position != std::string::npos)
+        source.replace(position, std::strlen(marker), replacement);
+}
+
+// One instantiation per pixel format: the scale and the pixel step are
+// constants, the alpha channel is skipped.
+template <typename T, int Channels>
+void normalizeToDevelop(ConstImageView<T, Channels> view, float *out)
+{
+    constexpr float scale = 1.0f / imageValueMax<T>();
+    for (int y = 0; y < view.height; ++y)
+    {
+        const T *pixel = view.row(y);
+        for (int x = 0; x < view.width; ++x, pixel += Channels, out += 3)
+        {
+            out[0] = pixel[0] * scale;
+            out[1] = pixel[1] * scale;
+            out[2] = pixel[2] * scale;
+        }
+    }
+}
+} // namespace
+
+uint64_t hashDevelopValues(const float *values, size_t count, uint64_t seed)
+{
+    uint64_t hash = seed;
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(values);
+    for (size_t i = 0; i < count * sizeof(float); ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void DevelopPipeline::addStage(DevelopStage stage)
+{
+    const bool fuses = stage.kind == DevelopStageKind::PerPixel && !m_passes.empty() &&
+                       m_passes.back().kind == DevelopStageKind::PerPixel;
+    if (fuses)
+    {
+        ++m_passes.back().stageCount;
+    }
+    else
+    {
+        m_passes.push_back(DevelopPass{m_stages.size(), 1, stage.kind});
+    }
+
+    m_stages.push_back(std::move(stage));
+    invalidate();
+}
+
+std::string DevelopPipeline::fragmentShaderSource(const std::string &shaderTemplate,
+                                                  size_t passIndex) const
+{
+    std::string declarations;
+    std::string body;
+    if (passIndex < m_passes.size() && m_passes[passIndex].kind == DevelopStageKind::PerPixel)
+    {
+        const DevelopPass &pass = m_passes[passIndex];
+        for (size_t i = pass.firstStage; i < pass.firstStage + pass.stageCount; ++i)
+        {
+            const DevelopStage &stage = m_stages[i];
+            declarations += "// " + stage.name + "\n" + stage.glslDeclarations + "\n";
+            body += "    // " + stage.name + "\n    " + stage.glslBody + "\n";
+        }
+    }
+
+    std::string source = shaderTemplate;
+    replaceMarker(source, kDeclarationsMarker, declarations);
+    replaceMarker(source, kBodyMarker, body);
+    return source;
+}
+
+std::vector<DevelopUniform> DevelopPipeline::uniforms(const DevelopSettings &settings,
+                                                      size_t passIndex) const
+{
+    std::vector<DevelopUniform> result;
+    if (passIndex >= m_passes.size())
+        return result;
+
+    const DevelopPass &pass = m_passes[passIndex];
+    for (size_t i = pass.firstStage; i < pass.firstStage + pass.stageCount; ++i)
+    {
+        if (m_stages[i].uniforms)
+            m_stages[i].uniforms(settings, result);
+    }
+    return result;
+}
+
+uint64_t DevelopPipeline::passKey(const DevelopSettings &settings, size_t passIndex) const
+{
+    uint64_t key = 1469598103934665603ull;
+    for (size_t p = 0; p <= passIndex && p < m_passes.size(); ++p)
+    {
+        const DevelopPass &pass = m_passes[p];
+        for (size_t i = pass.firstStage; i < pass.firstStage + pass.stageCount; ++i)
+        {
+            const uint64_t stageHash = m_stages[i].parameterHash ? m_stages[i].parameterHash(settings) : 0;
+            key = (key ^ stageHash) * 1099511628211ull;
+        }
+    }
+    return key;
+}
+
+void DevelopPipeline::applyPerPixelPass(size_t passIndex, const DevelopSettings &settings,
+                                        float *rgb, size_t pixelCount) const
+{
+    if (passIndex >= m_passes.size() || m_passes[passIndex].kind != DevelopStageKind::PerPixel)
+        return;
+
+    // Fused kernel: each chunk goes through every stage before moving on,
+    // so the image is streamed from memory once instead of once per stage.
+    const DevelopPass &pass = m_passes[passIndex];
+    for (size_t begin = 0; begin < pixelCount; begin += kFusedChunkPixels)
+    {
+        const size_t count = std::min(kFusedChunkPixels, pixelCount - begin);
+        float *chunk = rgb + begin * 3;
+        for (size_t i = pass.firstStage; i < pass.firstStage + pass.stageCount; ++i)
+        {
+            if (m_stages[i].applyPixels)
+                m_stages[i].applyPixels(settings, chunk, count);
+        }
+    }
+}
+
+const DevelopImage &DevelopPipeline::process(const DevelopImage &source, uint64_t sourceRevision,
+                                             const DevelopSettings &settings)
+{
+    m_lastExecutedPasses = 0;
+    if (m_passes.empty())
+        return source;
+
+    m_cache.resize(m_passes.size());
+
+    bool upstreamChanged = false;
+    const DevelopImage *input = &source;
+    for (size_t p = 0; p < m_passes.size(); ++p)
+    {
+        const uint64_t key = passKey(settings, p) ^ (sourceRevision * 0x9e3779b97f4a7c15ull);
+        PassCache &cache = m_cache[p];
+
+        if (upstreamChanged || !cache.valid || cache.key != key)
+        {
+            const DevelopPass &pass = m_passes[p];
+            if (pass.kind == DevelopStageKind::PerPixel)
+            {
+                cache.output = *input;
+                applyPerPixelPass(p, settings, cache.output.pixels.data(),
+                                  cache.output.pixels.size() / 3);
+            }
+            else
+            {
+                cache.output.width = input->width;
+                cache.output.height = input->height;
+                cache.output.pixels.resize(input->pixels.size());
+                m_stages[pass.firstStage].applyImage(settings, *input, cache.output);
+            }
+
+            cache.valid = true;
+            cache.key = key;
+            upstreamChanged = true;
+            ++m_lastExecutedPasses;
+        }
+
+        input = &cache.output;
+    }
+
+    return *input;
+}
+
+void DevelopPipeline::invalidate()
+{
+    for (PassCache &cache : m_cache)
+        cache.valid = false;
+    m_cache.resize(m_passes.size());
+}
+
+DevelopPipeline makeDefaultDevelopPipeline()
+{
+    DevelopPipeline pipeline;
+
+    DevelopStage exposure;
+    exposure.name = "Exposure";
+    exposure.glslDeclarations = "uniform float exposure;";
+    exposure.glslBody = "color *= exp2(exposure);";
+    exposure.uniforms = [](const DevelopSettings &settings, std::vector<DevelopUniform> &out) {
+        out.push_back(DevelopUniform{"exposure", 1, {settings.exposure}});
+    };
+    exposure.parameterHash = [](const DevelopSettings &settings) {
+        return hashDevelopValues(&settings.exposure, 1);
+    };
+    exposure.applyPixels = [](const DevelopSettings &settings, float *rgb, size_t pixelCount) {
+        const float gain = std::exp2(settings.exposure);
+        for (size_t i = 0; i < pixelCount * 3; ++i)
+            rgb[i] *= gain;
+    };
+    pipeline.addStage(std::move(exposure));
+
+    DevelopStage whiteBalance;
+    whiteBalance.name = "White Balance";
+    whiteBalance.glslDeclarations = "uniform vec3 whiteBalance;";
+    whiteBalance.glslBody = "color *= whiteBalance;";
+    whiteBalance.uniforms = [](const DevelopSettings &settings, std::vector<DevelopUniform> &out) {
+        out.push_back(DevelopUniform{"whiteBalance", 3,
+                                     {settings.whiteBalance[0], settings.whiteBalance[1],
+                                      settings.whiteBalance[2]}});
+    };
+    whiteBalance.parameterHash = [](const DevelopSettings &settings) {
+        return hashDevelopValues(settings.whiteBalance, 3);
+    };
+    whiteBalance.applyPixels = [](const DevelopSettings &settings, float *rgb, size_t pixelCount) {
+        const float r = settings.whiteBalance[0];
+        const float g = settings.whiteBalance[1];
+        const float b = settings.whiteBalance[2];
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            rgb[i * 3 + 0] *= r;
+            rgb[i * 3 + 1] *= g;
+            rgb[i * 3 + 2] *= b;
+        }
+    };
+    pipeline.addStage(std::move(whiteBalance));
+
+    return pipeline;
+}
+
+DevelopImage toDevelopImage(const ImageData &image)
+{
+    DevelopImage result;
+    result.width = image.width;
+    result.height = image.height;
+    result.pixels.resize(static_cast<size_t>(std::max(image.width, 0)) * std::max(image.height, 0) * 3);
+    dispatchImage(image, [&](auto view) { normalizeToDevelop(view, result.pixels.data()); });
+    return result;
+}
@@ -0,0 +1,314 @@
+#include "EmbeddedJpeg.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// EmbeddedJpeg does the following
+// 1. Reads byte ranges of a file with pread (FileRangeReader).
+// 2. Walks the RAF header or the TIFF IFD chain, SubIFDs included, and
+//    collects every JPEG the file points at.
+// 3. Keeps the JPEGs a viewer can decode (SOF0-2), largest first.
+
+#ifdef _WIN32
+FileRangeReader::FileRangeReader(const std::string &path) : m_path(path)
+{
+    m_open = std::ifstream(path, std::ios::binary).is_open();
+}
+
+FileRangeReader::~FileRangeReader() = default;
+
+bool FileRangeReader::isOpen() const
+{
+    return m_open;
+}
+
+bool FileRangeReader::read(uint64_t offset, size_t size, uint8_t *out) const
+{
+    // One stream per call keeps concurrent reads independent.
+    std::ifstream file(m_path, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset));
+    file.read(reinterpret_cast<char *>(out), static_cast<std::streamsize>(size));
+    return file.gcount() == static_cast<std::streamsize>(size);
+}
+#else
+FileRangeReader::FileRangeReader(const std::string &path)
+{
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+FileRangeReader::~FileRangeReader()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+bool FileRangeReader::isOpen() const
+{
+    return m_fd >= 0;
+}
+
+bool FileRangeReader::read(uint64_t offset, size_t size, uint8_t *out) const
+{
+    if (m_fd < 0)
+        return false;
+
+    size_t done = 0;
+    while (done < size)
+    {
+        const ssize_t count = ::pread(m_fd, out + done, size - done, static_cast<off_t>(offset + done));
+        if (count <= 0)
+            return false;
+        done += static_cast<size_t>(count);
+    }
+    return true;
+}
+#endif
+
+ByteReader FileRangeReader::reader() const
+{
+    return [this](uint64_t offset, size_t size, uint8_t *out) { return read(offset, size, out); };
+}
+
+namespace
+{
+// Malformed or hostile files can loop their IFD chain.
+constexpr int kMaxIfds = 32;
+constexpr uint16_t kMaxIfdEntries = 1024;
+// Larger "previews" are corrupt offsets, not worth allocating for.
+constexpr uint64_t kMaxJpegBytes = 256ull << 20;
+
+// TIFF tags
+constexpr uint16_t kTagCompression = 0x0103;
+constexpr uint16_t kTagPhotometric = 0x0106;
+constexpr uint16_t kTagStripOffsets = 0x0111;
+constexpr uint16_t kTagStripByteCounts = 0x0117;
+constexpr uint16_t kTagSubIfds = 0x014A;
+constexpr uint16_t kTagJpegOffset = 0x0201;
+constexpr uint16_t kTagJpegLength = 0x0202;
+// Panasonic RW2 stores its preview as an UNDEFINED blob.
+constexpr uint16_t kTagPanasonicJpeg = 0x002E;
+
+constexpr uint16_t kTypeShort = 3;
+constexpr uint16_t kPhotometricCfa = 32803;
+constexpr uint16_t kPhotometricLinearRaw = 34892;
+
+struct TiffParser
+{
+    const ByteReader &read;
+    bool bigEndian = false;
+
+    uint16_t u16(const uint8_t *p) const
+    {
+        return bigEndian ? static_cast<uint16_t>(p[0] << 8 | p[1]) : static_cast<uint16_t>(p[1] << 8 | p[0]);
+    }
+
+    uint32_t u32(const uint8_t *p) const
+    {
+        return bigEndian ? (uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3])
+                         : (uint32_t(p[3]) << 24 | uint32_t(p[2]) << 16 | uint32_t(p[1]) << 8 | p[0]);
+    }
+
+    // First value of an entry whose value fits in the entry itself.
+    uint32_t value(const uint8_t *entry) const
+    {
+        return u16(entry + 2) == kTypeShort ? u16(entry + 8) : u32(entry + 8);
+    }
+};
+
+// Reads the SubIFD offsets of an entry (inline when there is only one).
+void readSubIfds(const TiffParser &tiff, const uint8_t *entry, std::vector<uint32_t> &pending)
+{
+    const uint32_t count = std::min<uint32_t>(tiff.u32(entry + 4), kMaxIfds);
+    if (count == 1)
+    {
+        pending.push_back(tiff.u32(entry + 8));
+        return;
+    }
+
+    std::vector<uint8_t> offsets(static_cast<size_t>(count) * 4);
+    if (!tiff.read(tiff.u32(entry + 8), offsets.size(), offsets.data()))
+        return;
+    for (uint32_t i = 0; i < count; ++i)
+        pending.push_back(tiff.u32(offsets.data() + i * 4));
+}
+
+void collectTiffJpegs(const TiffParser &tiff, uint32_t firstIfd, std::vector<ByteRange> &candidates)
+{
+    std::vector<uint32_t> pending{firstIfd};
+    std::vector<uint32_t> visited;
+
+    while (!pending.empty() && static_cast<int>(visited.size()) < kMaxIfds)
+    {
+        const uint32_t ifd = pending.back();
+        pending.pop_back();
+        if (ifd == 0 || std::find(visited.begin(), visited.end(), ifd) != visited.end())
+            continue;
+        visited.push_back(ifd);
+
+        uint8_t countBytes[2];
+        if (!tiff.read(ifd, 2, countBytes))
+            continue;
+        const uint16_t entryCount = std::min(tiff.u16(countBytes), kMaxIfdEntries);
+
+        // Entries plus the offset of the next IFD in one read.
+        std::vector<uint8_t> entries(static_cast<size_t>(entryCount) * 12 + 4);
+        if (!tiff.read(ifd + 2, entries.size(), entries.data()))
+            continue;
+
+        uint32_t jpegOffset = 0, jpegLength = 0;
+        uint32_t stripOffset = 0, stripLength = 0;
+        uint32_t compression = 0, photometric = 0;
+        bool singleStrip = false;
+
+        for (uint16_t i = 0; i < entryCount; ++i)
+        {
+            const uint8_t *entry = entries.data() + i * 12;
+            switch (tiff.u16(entry))
+            {
+            case kTagCompression:
+                compression = tiff.value(entry);
+                break;
+            case kTagPhotometric:
+                photometric = tiff.value(entry);
+                break;
+            case kTagStripOffsets:
+                singleStrip = tiff.u32(entry + 4) == 1;
+                stripOffset = tiff.value(entry);
+                break;
+            case kTagStripByteCounts:
+                stripLength = tiff.value(entry);
+                break;
+            case kTagJpegOffset:
+                jpegOffset = tiff.value(entry);
+                break;
+            case kTagJpegLength:
+                jpegLength = tiff.value(entry);
+                break;
+            case kTagPanasonicJpeg:
+                candidates.push_back(ByteRange{tiff.u32(entry + 8), tiff.u32(entry + 4)});
+                break;
+            case kTagSubIfds:
+                readSubIfds(tiff, entry, pending);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (jpegOffset != 0 && jpegLength != 0)
+            candidates.push_back(ByteRange{jpegOffset, jpegLength});
+
+        // Old-style JPEG (6) or JPEG (7) strips, unless they hold sensor data.
+        const bool jpegStrip = compression == 6 || compression == 7;
+        const bool sensorData = photometric == kPhotometricCfa || photometric == kPhotometricLinearRaw;
+        if (jpegStrip && !sensorData && singleStrip && stripOffset != 0 && stripLength != 0)
+            candidates.push_back(ByteRange{stripOffset, stripLength});
+
+        pending.push_back(tiff.u32(entries.data() + entryCount * 12));
+    }
+}
+
+// Walks the JPEG markers up to the frame header. SOF0-2 decode with stb,
+// SOF3 is the lossless JPEG used for raw data.
+bool isViewerJpeg(const ByteReader &read, const ByteRange &range)
+{
+    uint8_t header[4];
+    if (range.length < 4 || range.length > kMaxJpegBytes)
+        return false;
+    if (!read(range.offset, 2, header) || header[0] != 0xFF || header[1] != 0xD8)
+        return false;
+
+    uint64_t position = range.offset + 2;
+    for (int segment = 0; segment < 32 && position + 4 <= range.offset + range.length; ++segment)
+    {
+        if (!read(position, 4, header) || header[0] != 0xFF)
+            return false;
+        const uint8_t marker = header[1];
+        if (marker >= 0xC0 && marker <= 0xC2)
+            return true;
+        if (marker >= 0xC3 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+            return false;
+        position += 2 + (uint32_t(header[2]) << 8 | header[3]);
+    }
+    return false;
+}
+} // namespace
+
+std::vector<ByteRange> findEmbeddedJpegs(const ByteReader &read)
+{
+    std::vector<ByteRange> candidates;
+    uint8_t header[92];
+    if (!read(0, 16, header))
+        return candidates;
+
+    if (std::memcmp(header, "FUJIFILMCCD-RAW ", 16) == 0)
+    {
+        // RAF: big-endian offset and length of the JPEG at byte 84
+        if (read(0, sizeof(header), header))
+        {
+            const TiffParser raf{read, true};
+            candidates.push_back(ByteRange{raf.u32(header + 84), raf.u32(header + 88)});
+        }
+    }
+    else if ((header[0] == 'I' && header[1] == 'I') || (header[0] == 'M' && header[1] == 'M'))
+    {
+        // 42 for TIFF, 0x55 for RW2, "RO"/"RS" for ORF
+        const TiffParser tiff{read, header[0] == 'M'};
+        const uint16_t magic = tiff.u16(header + 2);
+        if (magic == 42 || magic == 0x55 || magic == 0x4F52 || magic == 0x5352)
+            collectTiffJpegs(tiff, tiff.u32(header + 4), candidates);
+    }
+
+    std::vector<ByteRange> jpegs;
+    for (const ByteRange &candidate : candidates)
+    {
+        const bool duplicate = std::any_of(jpegs.begin(), jpegs.end(), [&](const ByteRange &range) {
+            return range.offset == candidate.offset;
+        });
+        if (!duplicate && isViewerJpeg(read, candidate))
+            jpegs.push_back(candidate);
+    }
+    std::sort(jpegs.begin(), jpegs.end(),
+              [](const ByteRange &a, const ByteRange &b) { return a.length > b.length; });
+    return jpegs;
+}
+
+std::vector<ByteRange> findEmbeddedJpegs(const uint8_t *data, size_t size)
+{
+    const ByteReader read = [data, size](uint64_t offset, size_t count, uint8_t *out) {
+        if (offset > size || count > size - offset)
+            return false;
+        std::memcpy(out, data + offset, count);
+        return true;
+    };
+    return findEmbeddedJpegs(read);
+}
+
+std::vector<uint8_t> readEmbeddedJpeg(const std::string &path, uint64_t maxBytes)
+{
+    const FileRangeReader file(path);
+    if (!file.isOpen())
+        return {};
+
+    const ByteReader read = file.reader();
+    const std::vector<ByteRange> jpegs = findEmbeddedJpegs(read);
+    if (jpegs.empty())
+        return {};
+
+    auto chosen = std::find_if(jpegs.begin(), jpegs.end(),
+                               [maxBytes](const ByteRange &range) { return range.length <= maxBytes; });
+    if (chosen == jpegs.end())
+        chosen = std::prev(jpegs.end());
+
+    std::vector<uint8_t> bytes(chosen->length);
+    if (!read(chosen->offset, bytes.size(), bytes.data()))
+        return {};
+    return bytes;
+}
@@ -29,17 +29,47 @@ bool FileBrowser::Refresh(const fs::path &folder) {
     return false;
 
   files = std::move(refreshedFiles);
+  names.clear();
+  names.reserve(files.size());
+  for (const auto &file : files)
+    names.push_back(file.filename().string());
+  return true;
+}
+bool FileBrowser::AddFile(const fs::path &file) {
+  if (!IsSupportedImage(file))
+    return false;
+  if (std::find(files.begin(), files.end(), file) == files.end()) {
+    files.push_back(file);
+    names.push_back(file.filename().string());
+  }
   return true;
 }
 const fs::path &FileBrowser::GetSelectedFile() const { return selectedFile; }
+const std::vector<fs::path> &FileBrowser::GetFiles() const { return files; }
+
+const std::vector<uint64_t> &FileBrowser::GetDrawnThumbnails() const {
+  return drawnThumbnails;
+}
 
 bool FileBrowser::Draw() {
   bool selectionChanged = false;
+  drawnThumbnails.clear();
 
-  for (const auto &file : files) {
-    const bool isSelected = (file == selectedFile);
-    const std::string filename = file.filename().string();
-    if (ImGui::Selectable(filename.c_str(), isSelected)) {
+  for (size_t i = 0; i < files.size(); ++i) {
+    const fs::path &file = files[i];
+    const bool isSelected = file.native() == selectedFile.native();
+    const auto thumbnail = thumbnails.find(file.native());
+    if (thumbnail != thumbnails.end()) {
+      const float height = ImGui::GetTextLineHeightWithSpacing() * 3.0f;
+      const float width = height * thumbnail->second.width /
+                          std::max(thumbnail->second.height, 1);
+      ImGui::Image(static_cast<ImTextureID>(thumbnail->second.textureId),
+                   ImVec2(width, height));
+      if (ImGui::IsItemVisible())
+        drawnThumbnails.push_back(thumbnail->second.tag);
+      ImGui::SameLine();
+    }
+    if (ImGui::Selectable(names[i].c_str(), isSelected)) {
       selectedFile = file;
       selectionChanged = true;
     }
@@ -48,3 +78,12 @@ bool FileBrowser::Draw() {
 
   return selectionChanged;
 }
+
+void FileBrowser::SetThumbnail(const fs::path &file, unsigned int textureId,
+                               int width, int height, uint64_t tag) {
+  thumbnails[file.native()] = Thumbnail{textureId, width, height, tag};
+}
+
+void FileBrowser::RemoveThumbnail(const fs::path &file) {
+  thumbnails.erase(file.native());
+}
@@ -0,0 +1,133 @@
+#include "FolderWatcher.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// FolderWatcher does the following
+// 1. start(): a non-blocking inotify descriptor watching the folder for
+//    closed-after-writing and moved-in files.
+// 2. poll(): drains every pending event, skips directories, and keeps one
+//    entry per file, at the position of its last event.
+// 3. Measures how long after its last write each file was seen.
+
+namespace fs = std::filesystem;
+
+FolderWatcher::~FolderWatcher()
+{
+    stop();
+}
+
+#ifdef __linux__
+namespace
+{
+constexpr uint32_t kFinishedMask = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+double millisecondsSinceModified(const fs::path &path)
+{
+    struct stat status;
+    if (::stat(path.c_str(), &status) != 0)
+        return 0.0;
+    const auto modified = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(status.st_mtim.tv_sec) + std::chrono::nanoseconds(status.st_mtim.tv_nsec)));
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now() - modified).count();
+    return std::max(ms, 0.0);
+}
+} // namespace
+
+bool FolderWatcher::start(const fs::path &folder)
+{
+    stop();
+    m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0)
+        return false;
+    if (::inotify_add_watch(m_fd, folder.c_str(), kFinishedMask | IN_ONLYDIR) < 0)
+    {
+        stop();
+        return false;
+    }
+    m_folder = folder;
+    m_overflowed = false;
+    // Room for a few hundred events per read
+    m_events.resize(64 * 1024);
+    return true;
+}
+
+void FolderWatcher::stop()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+    m_fd = -1;
+    m_folder.clear();
+}
+
+bool FolderWatcher::poll(std::vector<CapturedFile> &captured)
+{
+    captured.clear();
+    if (m_fd < 0)
+        return false;
+
+    for (;;)
+    {
+        const ssize_t size = ::read(m_fd, m_events.data(), m_events.size());
+        if (size <= 0)
+            break; // EAGAIN: drained
+
+        const auto now = std::chrono::steady_clock::now();
+        for (ssize_t offset = 0; offset < size;)
+        {
+            inotify_event event;
+            std::memcpy(&event, m_events.data() + offset, sizeof(event));
+            const char *name = m_events.data() + offset + sizeof(event);
+            offset += static_cast<ssize_t>(sizeof(event) + event.len);
+
+            if (event.mask & IN_Q_OVERFLOW)
+                m_overflowed = true;
+            if (!(event.mask & kFinishedMask) || (event.mask & IN_ISDIR) || event.len == 0)
+                continue;
+
+            CapturedFile file;
+            file.path = m_folder / name;
+            file.seen = now;
+            // A file written again within one burst is reported once, last.
+            captured.erase(std::remove_if(captured.begin(), captured.end(),
+                                          [&](const CapturedFile &other) { return other.path == file.path; }),
+                           captured.end());
+            captured.push_back(std::move(file));
+        }
+    }
+
+    for (CapturedFile &file : captured)
+        file.writeToSeenMs = millisecondsSinceModified(file.path);
+    return !captured.empty();
+}
+#else
+bool FolderWatcher::start(const fs::path &)
+{
+    return false;
+}
+
+void FolderWatcher::stop()
+{
+    m_fd = -1;
+    m_folder.clear();
+}
+
+bool FolderWatcher::poll(std::vector<CapturedFile> &captured)
+{
+    captured.clear();
+    return false;
+}
+#endif
+
+bool FolderWatcher::takeOverflow()
+{
+    return std::exchange(m_overflowed, false);
+}
@@ -0,0 +1,258 @@
+#include "ImageLoadPipeline.h"
+#include "AutoAdjust.h"
+#include "Demosaic.h"
+#include "PreviewCache.h"
+#include <chrono>
+#include <memory>
+#include <utility>
+
+// ImageLoadPipeline does the following per open()
+// 1. Decodes the preview through the decoder registry, estimates auto
+//    exposure / white balance from it, pushes it, then saves it for the next
+//    launch unless a newer open() superseded it. Skipped when the caller
+//    shows its own preview.
+// 2. Optionally stops there if a newer open() superseded it.
+// 3. GPU mode: unpacks the mosaic and stops there (developed on the GL thread).
+// 4. Otherwise loads the full image from the decode cache, or decodes it,
+//    pushes it and then stores it while it is still the current file.
+// 5. Tells the owner the generation is done, and how long it worked for
+//    nothing if a newer open() superseded it meanwhile.
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// CPU memory a load result holds until the viewer uploads it.
+int64_t decodedBytes(const LoadResult &result)
+{
+    size_t bytes = result.image.pixels8.size() + result.image.pixels16.size() * sizeof(uint16_t);
+    if (result.mosaic)
+        bytes += result.mosaic->pixels.size() * sizeof(uint16_t);
+    return static_cast<int64_t>(bytes);
+}
+} // namespace
+
+ImageLoadPipeline::ImageLoadPipeline(const DecoderRegistry &decoders, MetricsRegistry &metrics)
+    : m_decoders(decoders), m_metrics(metrics), m_inFlightGauge(metrics.gauge("loader.in_flight")),
+      m_queueDepthGauge(metrics.gauge("loader.queue_depth"))
+{
+}
+
+ImageLoadPipeline::~ImageLoadPipeline()
+{
+    wait();
+}
+
+void ImageLoadPipeline::setDecodeCache(DecodeCache *cache)
+{
+    m_decodeCache = cache;
+}
+
+uint64_t ImageLoadPipeline::open(const std::string &path, const LoadOptions &options)
+{
+    m_metrics.counter("loader.started").add();
+    if (m_loading)
+        m_metrics.counter("loader.superseded").add();
+    const uint64_t generation = ++m_generation;
+    m_loading = true;
+
+    m_workers.push_back(
+        std::async(std::launch::async, [this, path, generation, options]() { load(path, generation, options); }));
+    return generation;
+}
+
+void ImageLoadPipeline::load(const std::string &path, uint64_t generation, const LoadOptions &options)
+{
+    const auto workStart = Clock::now();
+    // Work done after a newer open() is wasted; the viewer drops it.
+    auto finish = [&]() {
+        if (generation != m_generation)
+            m_metrics.histogram("loader.stale_work_ms").record(millisecondsSince(workStart));
+        m_completed.push(generation);
+    };
+
+    bool estimated = false;
+    std::optional<ImageData> preview;
+    if (!options.skipPreview)
+        preview = decode({path, DecodeOutput::Preview, 0, {}});
+    if (preview)
+    {
+        // Saved after the push, off the time to preview
+        std::optional<ImageData> cacheCopy;
+        if (!options.previewCacheFile.empty())
+            cacheCopy = *preview;
+        const auto stageStart = Clock::now();
+        std::optional<AutoAdjustment> autoAdjust = estimateAutoAdjustment(*preview);
+        m_metrics.histogram("auto_adjust.estimate_ms").record(millisecondsSince(stageStart));
+
+        LoadResult result;
+        result.generation = generation;
+        result.image = std::move(*preview);
+        if (autoAdjust)
+            result.autoAdjust = std::make_shared<const AutoAdjustment>(*autoAdjust);
+        estimated = autoAdjust.has_value();
+        push(std::move(result));
+
+        // A newer open() owns the cache file now
+        if (cacheCopy && generation == m_generation)
+        {
+            const auto saveStart = Clock::now();
+            savePreviewCache(options.previewCacheFile, path, *cacheCopy);
+            m_metrics.histogram("preview_cache.save_ms").record(millisecondsSince(saveStart));
+        }
+    }
+
+    if (options.skipFullWhenSuperseded && generation != m_generation)
+    {
+        m_metrics.counter("loader.skipped_full").add();
+        finish();
+        return;
+    }
+
+    if (options.demosaicMode == 3)
+    {
+        const auto stageStart = Clock::now();
+        if (auto mosaic = extractRawMosaic(path))
+        {
+            m_metrics.histogram("decode.unpack_ms").record(millisecondsSince(stageStart));
+            LoadResult result;
+            result.generation = generation;
+            const bool transposed = (mosaic->flip & 4) != 0;
+            result.image.width = transposed ? mosaic->height : mosaic->width;
+            result.image.height = transposed ? mosaic->width : mosaic->height;
+            // No preview to estimate from: the sensor data will do.
+            if (!estimated)
+                if (auto autoAdjust = estimateAutoAdjustment(*mosaic))
+                    result.autoAdjust = std::make_shared<const AutoAdjustment>(*autoAdjust);
+            result.mosaic = std::make_shared<const RawMosaic>(std::move(*mosaic));
+            push(std::move(result));
+            finish();
+            return;
+        }
+    }
+
+    // The Develop panel's choice goes first. Non-CFA sensors and in-house
+    // failures fall through to the other full decoders.
+    const DecodeRequest request{path, DecodeOutput::Full, 0,
+                                options.demosaicMode == 1   ? "demosaic-bilinear"
+                                : options.demosaicMode == 2 ? "demosaic-edge"
+                                                            : "libraw"};
+    // Keyed by the decoder that was asked for; the fallbacks give the same
+    // result every time.
+    auto stageStart = Clock::now();
+    std::optional<ImageData> full;
+    if (m_decodeCache)
+        full = m_decodeCache->load(path, request.preferredBackend);
+    if (full)
+    {
+        m_metrics.counter("decode_cache.hits").add();
+        m_metrics.histogram("decode.cache_load_ms").record(millisecondsSince(stageStart));
+        push(LoadResult{generation, std::move(*full)});
+        finish();
+        return;
+    }
+    if (m_decodeCache)
+        m_metrics.counter("decode_cache.misses").add();
+
+    full = decode(request);
+    if (full)
+    {
+        // Stored after the push, so the band encode and the write are not
+        // part of the time to full image. Superseded decodes are not stored.
+        std::optional<ImageData> cacheCopy;
+        if (m_decodeCache && generation == m_generation)
+            cacheCopy = *full;
+        push(LoadResult{generation, std::move(*full)});
+        if (cacheCopy && generation == m_generation)
+        {
+            stageStart = Clock::now();
+            m_decodeCache->store(path, request.preferredBackend, *cacheCopy);
+            m_metrics.histogram("decode.cache_store_ms").record(millisecondsSince(stageStart));
+        }
+    }
+    else
+    {
+        m_metrics.counter("loader.failed").add();
+    }
+    finish();
+}
+
+// Like DecoderRegistry::decode(), timing each backend that succeeds.
+std::optional<ImageData> ImageLoadPipeline::decode(const DecodeRequest &request)
+{
+    for (const auto &backend : m_decoders.route(request))
+    {
+        const auto start = Clock::now();
+        if (auto image = backend->decode(request))
+        {
+            m_metrics.histogram(std::string("decode.") + backend->name() + "_ms").record(millisecondsSince(start));
+            return image;
+        }
+        m_metrics.counter(std::string("decode.") + backend->name() + "_failed").add();
+    }
+    return std::nullopt;
+}
+
+void ImageLoadPipeline::push(LoadResult result)
+{
+    m_metrics.gauge("memory.decoded_bytes").add(decodedBytes(result));
+    m_results.push(std::move(result));
+}
+
+std::optional<LoadResult> ImageLoadPipeline::takeResult()
+{
+    while (auto result = m_results.tryPop())
+    {
+        const int64_t bytes = decodedBytes(*result);
+        m_metrics.gauge("memory.decoded_bytes").add(-bytes);
+        if (result->generation != m_generation)
+        {
+            m_metrics.counter("loader.stale_results").add();
+            m_metrics.counter("loader.stale_bytes").add(bytes);
+            continue;
+        }
+        if (result->image.kind == ImageKind::Full)
+            m_loading = false;
+        return result;
+    }
+    return std::nullopt;
+}
+
+void ImageLoadPipeline::collect()
+{
+    for (auto it = m_workers.begin(); it != m_workers.end();)
+    {
+        if (it->valid() && it->wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            it->get();
+            it = m_workers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    while (auto completed = m_completed.tryPop())
+    {
+        if (*completed == m_generation)
+            m_loading = false;
+    }
+
+    m_inFlightGauge.set(static_cast<int64_t>(m_workers.size()));
+    m_queueDepthGauge.set(static_cast<int64_t>(m_results.size()));
+}
+
+void ImageLoadPipeline::wait()
+{
+    for (auto &worker : m_workers)
+    {
+        if (worker.valid())
+            worker.wait();
+    }
+}
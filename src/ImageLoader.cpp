@@ -1,18 +1,25 @@
 #include "ImageLoader.h"
+#include "Demosaic.h"
+#include "EmbeddedJpeg.h"
+#include "ImageView.h"
+#include "Parallel.h"
 #include "StbImageDecoder.h"
 #include <GLFW/glfw3.h>
 #include <libraw/libraw.h>
+#include <algorithm>
 
 // ImageLoader does the following
 // 1. Fully decode a RAW file into 16-bit image data.
-// 2. Extract a fast embedded preview from a RAW file.
+// 2. Extract a fast embedded preview from a RAW file, reading only the JPEG
+//    bytes when the container layout is known.
 // 3. Upload either the image data to an OpenGL texture (either one).
+// 4. Hand the unpacked sensor data to the in-house demosaic (Demosaic.h).
 
 // Loading the raw file
 // A LibRaw object is created with output_bps = 16
 // opens, unpacks, and processes the RAW file.
 // std::nullopt is returned upon failure
-std::optional<ImageData> decodeFullRawImage(const std::string &path)
+std::optional<ImageData> decodeFullRawImage(const std::string &path, int targetEdge)
 {
     // TODO
     // Apply a simple GLSL shader that does gamma (pow(color, 1.0/2.2)) at minimum
@@ -23,6 +30,9 @@ std::optional<ImageData> decodeFullRawImage(const std::string &path)
 
     if (raw.open_file(path.c_str()) != LIBRAW_SUCCESS)
         return std::nullopt;
+    const int longEdge = std::max<int>(raw.imgdata.sizes.width, raw.imgdata.sizes.height);
+    if (targetEdge > 0 && longEdge / 2 >= targetEdge)
+        raw.imgdata.params.half_size = 1;
     if (raw.unpack() != LIBRAW_SUCCESS)
         return std::nullopt;
     if (raw.dcraw_process() != LIBRAW_SUCCESS)
@@ -52,11 +62,18 @@ std::optional<ImageData> decodeFullRawImage(const std::string &path)
 }
 
 // Extracting embedded preview
-// JPEG or Bitmap
-// Using a LibRaw Object
+// JPEG located by EmbeddedJpeg when possible,
+// JPEG or Bitmap using a LibRaw Object otherwise
 // std::nullopt is returned upon failure
-std::optional<ImageData> extractEmbeddedPreviewImage(const std::string &path)
+std::optional<ImageData> extractEmbeddedPreviewImage(const std::string &path, uint64_t maxBytes)
 {
+    const std::vector<uint8_t> jpeg = readEmbeddedJpeg(path, maxBytes);
+    if (!jpeg.empty())
+    {
+        if (auto image = decodeJpegMemoryToRgb(jpeg.data(), jpeg.size(), ImageKind::Preview))
+            return image;
+    }
+
     LibRaw raw;
 
     if (raw.open_file(path.c_str()) != LIBRAW_SUCCESS)
@@ -106,19 +123,157 @@ std::optional<ImageData> extractEmbeddedPreviewImage(const std::string &path)
     LibRaw::dcraw_clear_mem(thumb);
     return result;
 }
-// Creates and binds a texture, sets linear filtering, then chooses
-// the upload format based on data.is16Bit.
-// For full RAW data, it uploads as a 16-bit RGB texture:
-//
-// GL_RGB16
-// GL_UNSIGNED_SHORT
-// data.pixels16.data()
-//
-// For preview data, it uploads as an 8-bit RGB/RGBA texture:
+// Batch preview extraction
+// Each worker reads and decodes one file at a time, so maxInFlight bounds
+// both the I/O depth and the decode memory.
+void extractEmbeddedPreviewImages(const std::vector<std::string> &paths, unsigned maxInFlight,
+                                  const std::function<void(size_t, std::optional<ImageData>)> &onResult,
+                                  uint64_t maxBytes)
+{
+    parallelFor(
+        0, static_cast<int>(paths.size()), 1,
+        [&](int begin, int end) {
+            for (int i = begin; i < end; ++i)
+                onResult(static_cast<size_t>(i), extractEmbeddedPreviewImage(paths[i], maxBytes));
+        },
+        std::max(maxInFlight, 1u));
+}
+
+// Copying the sensor data
+// Only the visible area (inside top/left margins) is kept.
+// COLOR() reports the second green of a Bayer quad as 3, it is folded into 1.
+// std::nullopt is returned upon failure or for non-CFA sensors
+std::optional<RawMosaic> extractRawMosaic(const std::string &path)
+{
+    LibRaw raw;
+
+    if (raw.open_file(path.c_str()) != LIBRAW_SUCCESS)
+        return std::nullopt;
+    if (raw.unpack() != LIBRAW_SUCCESS)
+        return std::nullopt;
+
+    const libraw_data_t &data = raw.imgdata;
+    if (!data.rawdata.raw_image || data.idata.filters == 0)
+        return std::nullopt;
+
+    RawMosaic mosaic;
+    mosaic.width = data.sizes.width;
+    mosaic.height = data.sizes.height;
+    mosaic.flip = data.sizes.flip;
+
+    // filters == 9 marks the 6x6 X-Trans layout
+    const bool xtrans = data.idata.filters == 9;
+    mosaic.patternWidth = xtrans ? 6 : 2;
+    mosaic.patternHeight = xtrans ? 6 : 2;
+    for (int row = 0; row < mosaic.patternHeight; ++row)
+    {
+        for (int col = 0; col < mosaic.patternWidth; ++col)
+        {
+            const int color = raw.COLOR(row, col);
+            mosaic.pattern[row * mosaic.patternWidth + col] = static_cast<uint8_t>(color == 3 ? 1 : color);
+        }
+    }
+
+    const size_t pitch = data.sizes.raw_pitch / sizeof(uint16_t);
+    mosaic.pixels.resize(static_cast<size_t>(mosaic.width) * mosaic.height);
+    for (int row = 0; row < mosaic.height; ++row)
+    {
+        const uint16_t *source =
+            data.rawdata.raw_image + (row + data.sizes.top_margin) * pitch + data.sizes.left_margin;
+        std::copy(source, source + mosaic.width, mosaic.pixels.begin() + static_cast<size_t>(row) * mosaic.width);
+    }
+
+    // Levels
+    for (int c = 0; c < 3; ++c)
+        mosaic.black[c] = static_cast<float>(data.color.black + data.color.cblack[c]);
+    mosaic.white = static_cast<float>(data.color.maximum);
+
+    // As shot white balance, daylight when the file has none
+    const float *multipliers = data.color.cam_mul[0] > 0.0f ? data.color.cam_mul : data.color.pre_mul;
+    const float smallest = std::max(std::min({multipliers[0], multipliers[1], multipliers[2]}), 1e-6f);
+    for (int c = 0; c < 3; ++c)
+        mosaic.whiteBalance[c] = multipliers[c] / smallest;
+
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            mosaic.cameraToRgb[i][j] = data.color.rgb_cam[i][j];
+
+    return mosaic;
+}
+
+namespace
+{
+// Same mapping as LibRaw's flip_index(): bit 4 transposes, bit 2 mirrors rows,
+// bit 1 mirrors columns.
+ImageData applyFlip(ImageData image, int flip)
+{
+    if ((flip & 7) == 0)
+        return image;
+
+    ImageData result = image;
+    if (flip & 4)
+        std::swap(result.width, result.height);
+
+    for (int row = 0; row < result.height; ++row)
+    {
+        for (int col = 0; col < result.width; ++col)
+        {
+            int sourceRow = row;
+            int sourceCol = col;
+            if (flip & 4)
+                std::swap(sourceRow, sourceCol);
+            if (flip & 2)
+                sourceRow = image.height - 1 - sourceRow;
+            if (flip & 1)
+                sourceCol = image.width - 1 - sourceCol;
+
+            const size_t source = (static_cast<size_t>(sourceRow) * image.width + sourceCol) * 3;
+            const size_t target = (static_cast<size_t>(row) * result.width + col) * 3;
+            for (int c = 0; c < 3; ++c)
+                result.pixels16[target + c] = image.pixels16[source + c];
+        }
+    }
+    return result;
+}
+} // namespace
+
+// Decoding with the in-house demosaic
+// LibRaw only unpacks, everything after that runs tiled on all cores.
+// std::nullopt is returned upon failure
+std::optional<ImageData> decodeRawWithDemosaic(const std::string &path, const DemosaicOptions &options)
+{
+    std::optional<RawMosaic> mosaic = extractRawMosaic(path);
+    if (!mosaic)
+        return std::nullopt;
+
+    ImageData image = demosaicMosaic(*mosaic, options);
+    if (image.pixels16.empty())
+        return std::nullopt;
+    return applyFlip(std::move(image), mosaic->flip);
+}
+
+namespace
+{
+// One instantiation per pixel format: the GL formats are constants.
+template <typename T, int Channels>
+void uploadPixels(ConstImageView<T, Channels> view)
+{
+    constexpr bool wide = sizeof(T) == 2;
+    constexpr GLenum format = Channels == 4 ? GL_RGBA : GL_RGB;
+    constexpr GLint internalFormat = Channels == 4 ? (wide ? GL_RGBA16 : GL_RGBA8) : (wide ? GL_RGB16 : GL_RGB8);
+    constexpr GLenum type = wide ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+    // Rows are packed: an RGB row need not be a multiple of 4 bytes long
+    glPixelStorei(GL_UNPACK_ALIGNMENT, sizeof(T));
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, view.width, view.height, 0, format, type, view.data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+} // namespace
+
+// Creates and binds a texture, sets linear filtering, then uploads with the
+// format matching the data:
 //
-// GL_RGB8 or GL_RGBA8
-// GL_UNSIGNED_BYTE
-// data.pixels8.data()
+// 16-bit full RAW data: GL_RGB16 / GL_RGBA16, GL_UNSIGNED_SHORT
+// 8-bit previews:       GL_RGB8 / GL_RGBA8, GL_UNSIGNED_BYTE
 //
 // returns a RawImage containing the OpenGL texture ID, dimensions,
 // and whether the texture represents a preview or the full image.
@@ -129,18 +284,7 @@ RawImage uploadTexture(const ImageData &data)
     glBindTexture(GL_TEXTURE_2D, texId);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    if (data.is16Bit)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16, data.width, data.height,
-                     0, GL_RGB, GL_UNSIGNED_SHORT, data.pixels16.data());
-    }
-    else
-    {
-        GLenum format = data.channels == 4 ? GL_RGBA : GL_RGB;
-        GLint internalFormat = data.channels == 4 ? GL_RGBA8 : GL_RGB8;
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, data.width, data.height,
-                     0, format, GL_UNSIGNED_BYTE, data.pixels8.data());
-    }
+    dispatchImage(data, [](auto view) { uploadPixels(view); });
 
     return RawImage{(unsigned int)texId, data.width, data.height, data.kind};
 }
@@ -0,0 +1,456 @@
+#include "ImportPipeline.h"
+#include "Parallel.h"
+#include "Resample.h"
+#include "StbImageDecoder.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// ImportPipeline does the following
+// 1. Finds the raw files under the source folder and picks a destination
+//    name for each one up front, so workers never race for a name.
+// 2. Per file, on a worker: reads it into one aligned buffer chunk by chunk,
+//    hashing and writing each chunk as it arrives, flushes the copy.
+// 3. Finds the embedded previews in the buffer and decodes the thumbnail.
+// 4. Verifies the flushed copy against the hash and renames it into place.
+
+namespace fs = std::filesystem;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kAlignment = 4096;
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+
+double millisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+uint64_t mixWord(uint64_t state, uint64_t word)
+{
+    state ^= word * kPrime2;
+    state = (state << 31) | (state >> 33);
+    return state * kPrime1;
+}
+
+uint64_t loadWord(const uint8_t *bytes)
+{
+    uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+bool isRawFile(const fs::path &path)
+{
+    static const std::unordered_set<std::string> extensions = {".arw", ".dng", ".cr2", ".cr3",
+                                                               ".nef", ".raf", ".rw2", ".orf"};
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extensions.count(extension) != 0;
+}
+
+// Page aligned, so the kernel can move whole pages.
+struct AlignedDeleter
+{
+    void operator()(uint8_t *bytes) const { ::operator delete(bytes, std::align_val_t(kAlignment)); }
+};
+using AlignedBuffer = std::unique_ptr<uint8_t[], AlignedDeleter>;
+
+AlignedBuffer allocateAligned(size_t size)
+{
+    const size_t rounded = (std::max<size_t>(size, 1) + kAlignment - 1) / kAlignment * kAlignment;
+    return AlignedBuffer(static_cast<uint8_t *>(::operator new(rounded, std::align_val_t(kAlignment))));
+}
+
+// Whole-buffer reads and writes on one file.
+class ImportFile
+{
+public:
+    ImportFile(const fs::path &path, bool write)
+    {
+#ifdef _WIN32
+        const auto mode = write ? std::ios::out | std::ios::trunc : std::ios::in;
+        m_stream.open(path, mode | std::ios::binary);
+#else
+        m_fd = write ? ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                     : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (m_fd >= 0 && !write)
+            ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    }
+
+    ~ImportFile() { close(); }
+    ImportFile(const ImportFile &) = delete;
+    ImportFile &operator=(const ImportFile &) = delete;
+
+    bool isOpen() const
+    {
+#ifdef _WIN32
+        return m_stream.is_open();
+#else
+        return m_fd >= 0;
+#endif
+    }
+
+    bool read(uint8_t *out, size_t size)
+    {
+#ifdef _WIN32
+        m_stream.read(reinterpret_cast<char *>(out), static_cast<std::streamsize>(size));
+        return m_stream.gcount() == static_cast<std::streamsize>(size);
+#else
+        size_t done = 0;
+        while (done < size)
+        {
+            const ssize_t count = ::read(m_fd, out + done, size - done);
+            if (count <= 0)
+                return false;
+            done += static_cast<size_t>(count);
+        }
+        return true;
+#endif
+    }
+
+    bool write(const uint8_t *data, size_t size)
+    {
+#ifdef _WIN32
+        m_stream.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        return static_cast<bool>(m_stream);
+#else
+        size_t done = 0;
+        while (done < size)
+        {
+            const ssize_t count = ::write(m_fd, data + done, size - done);
+            if (count <= 0)
+                return false;
+            done += static_cast<size_t>(count);
+        }
+        return true;
+#endif
+    }
+
+    // Waits until the written data is on the disk.
+    bool sync()
+    {
+#ifdef _WIN32
+        m_stream.flush();
+        return static_cast<bool>(m_stream);
+#else
+        return ::fdatasync(m_fd) == 0;
+#endif
+    }
+
+    // Makes the next read of this (flushed) file come from the disk.
+    void dropCache()
+    {
+#ifndef _WIN32
+        ::posix_fadvise(m_fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    }
+
+    bool close()
+    {
+#ifdef _WIN32
+        if (!m_stream.is_open())
+            return true;
+        m_stream.close();
+        return !m_stream.fail();
+#else
+        if (m_fd < 0)
+            return true;
+        const bool closed = ::close(m_fd) == 0;
+        m_fd = -1;
+        return closed;
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    std::fstream m_stream;
+#else
+    int m_fd = -1;
+#endif
+};
+
+struct ImportJob
+{
+    fs::path source;
+    fs::path destination;
+    // Same name and size already there
+    bool alreadyImported = false;
+};
+
+std::vector<ImportJob> planImport(const std::vector<fs::path> &sources, const fs::path &destination)
+{
+    std::vector<ImportJob> jobs;
+    std::unordered_set<std::string> taken;
+    for (const fs::path &source : sources)
+    {
+        ImportJob job;
+        job.source = source;
+        std::error_code error;
+        const uintmax_t sourceSize = fs::file_size(source, error);
+        for (int copy = 1;; ++copy)
+        {
+            fs::path name = source.filename();
+            if (copy > 1)
+                name = source.stem().string() + "-" + std::to_string(copy) + source.extension().string();
+            job.destination = destination / name;
+            if (taken.count(job.destination.string()) != 0)
+                continue;
+            if (fs::exists(job.destination, error))
+            {
+                if (fs::file_size(job.destination, error) != sourceSize || error)
+                    continue;
+                job.alreadyImported = true;
+            }
+            break;
+        }
+        taken.insert(job.destination.string());
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+// Same choice as the embedded-jpeg decoder backend: the largest JPEG of at
+// most edge^2 / 4 bytes, else the smallest.
+std::optional<ImageData> decodeThumbnail(const uint8_t *data, const std::vector<ByteRange> &previews, int edge)
+{
+    if (previews.empty() || edge <= 0)
+        return std::nullopt;
+    const uint64_t maxBytes = static_cast<uint64_t>(edge) * edge / 4;
+    auto chosen = std::find_if(previews.begin(), previews.end(),
+                               [maxBytes](const ByteRange &range) { return range.length <= maxBytes; });
+    if (chosen == previews.end())
+        chosen = std::prev(previews.end());
+
+    const std::optional<ImageData> preview =
+        decodeJpegMemoryToRgb(data + chosen->offset, static_cast<size_t>(chosen->length), ImageKind::Preview);
+    if (!preview)
+        return std::nullopt;
+    // The other files in flight keep the remaining cores busy.
+    ResampleOptions resample;
+    resample.threads = 1;
+    return resampleToFit(*preview, edge, resample);
+}
+
+ImportedFile importFile(const ImportJob &job, const ImportOptions &options)
+{
+    ImportedFile result;
+    result.source = job.source;
+    result.destination = job.destination;
+    std::error_code error;
+    const uintmax_t size = fs::file_size(job.source, error);
+    if (error)
+    {
+        result.error = "can't stat the source";
+        return result;
+    }
+    result.bytes = size;
+    if (job.alreadyImported)
+    {
+        result.status = ImportStatus::Skipped;
+        return result;
+    }
+
+    const fs::path partial = job.destination.string() + ".part";
+    auto fail = [&](const char *message) {
+        result.error = message;
+        fs::remove(partial, error);
+        return result;
+    };
+
+    ImportFile in(job.source, false);
+    if (!in.isOpen())
+        return fail("can't open the source");
+    ImportFile out(partial, true);
+    if (!out.isOpen())
+        return fail("can't create the copy");
+
+    const size_t chunkBytes = std::max(options.chunkBytes / kAlignment, size_t{1}) * kAlignment;
+    AlignedBuffer buffer = allocateAligned(size);
+    ContentHash hash;
+    for (uint64_t offset = 0; offset < size;)
+    {
+        const size_t count = static_cast<size_t>(std::min<uint64_t>(chunkBytes, size - offset));
+        uint8_t *chunk = buffer.get() + offset;
+        auto start = Clock::now();
+        if (!in.read(chunk, count))
+            return fail("short read from the source");
+        result.readMs += millisecondsSince(start);
+
+        hash.update(chunk, count);
+        start = Clock::now();
+        if (!out.write(chunk, count))
+            return fail("write failed");
+        result.writeMs += millisecondsSince(start);
+        offset += count;
+    }
+    result.hash = hash.value();
+
+    const auto syncStart = Clock::now();
+    if (!out.sync())
+        return fail("flushing the copy failed");
+    out.dropCache();
+    if (!out.close())
+        return fail("closing the copy failed");
+    result.writeMs += millisecondsSince(syncStart);
+
+    result.previews = findEmbeddedJpegs(buffer.get(), static_cast<size_t>(size));
+    result.thumbnail = decodeThumbnail(buffer.get(), result.previews, options.thumbnailEdge);
+
+    if (options.verify)
+    {
+        // The buffer is reused; the source bytes are no longer needed.
+        const auto start = Clock::now();
+        ImportFile copy(partial, false);
+        ContentHash written;
+        for (uint64_t offset = 0; offset < size;)
+        {
+            const size_t count = static_cast<size_t>(std::min<uint64_t>(chunkBytes, size - offset));
+            if (!copy.read(buffer.get(), count))
+                return fail("can't read the copy back");
+            written.update(buffer.get(), count);
+            offset += count;
+        }
+        result.verifyMs = millisecondsSince(start);
+        if (written.value() != result.hash)
+            return fail("the copy differs from the source");
+    }
+
+    fs::rename(partial, job.destination, error);
+    if (error)
+        return fail("can't rename the copy");
+    fs::last_write_time(job.destination, fs::last_write_time(job.source, error), error);
+    result.status = ImportStatus::Copied;
+    return result;
+}
+} // namespace
+
+void ContentHash::update(const uint8_t *data, size_t size)
+{
+    m_length += size;
+    if (m_tailSize > 0)
+    {
+        const size_t take = std::min(size, sizeof(m_tail) - m_tailSize);
+        std::memcpy(m_tail + m_tailSize, data, take);
+        m_tailSize += take;
+        data += take;
+        size -= take;
+        if (m_tailSize < sizeof(m_tail))
+            return;
+        m_state = mixWord(m_state, loadWord(m_tail));
+        m_tailSize = 0;
+    }
+
+    uint64_t state = m_state;
+    for (; size >= 8; data += 8, size -= 8)
+        state = mixWord(state, loadWord(data));
+    m_state = state;
+
+    std::memcpy(m_tail, data, size);
+    m_tailSize = size;
+}
+
+uint64_t ContentHash::value() const
+{
+    uint64_t state = m_state;
+    if (m_tailSize > 0)
+    {
+        uint8_t last[8] = {};
+        std::memcpy(last, m_tail, m_tailSize);
+        state = mixWord(state, loadWord(last));
+    }
+    state = mixWord(state, m_length);
+    // Final avalanche (MurmurHash3 fmix64)
+    state ^= state >> 33;
+    state *= 0xFF51AFD7ED558CCDull;
+    state ^= state >> 33;
+    state *= 0xC4CEB9FE1A85EC53ull;
+    state ^= state >> 33;
+    return state;
+}
+
+uint64_t hashBytes(const uint8_t *data, size_t size)
+{
+    ContentHash hash;
+    hash.update(data, size);
+    return hash.value();
+}
+
+std::vector<fs::path> findImportSources(const fs::path &folder)
+{
+    std::vector<fs::path> sources;
+    std::error_code error;
+    for (fs::recursive_directory_iterator it(folder, fs::directory_options::skip_permission_denied, error), end;
+         !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file(error) && isRawFile(it->path()))
+            sources.push_back(it->path());
+    }
+    std::sort(sources.begin(), sources.end());
+    return sources;
+}
+
+ImportSummary importFiles(const std::vector<fs::path> &sources, const fs::path &destination,
+                          const ImportOptions &options, const std::function<void(const ImportedFile &)> &onFile,
+                          const std::atomic<bool> *cancel)
+{
+    const auto start = Clock::now();
+    std::error_code error;
+    fs::create_directories(destination, error);
+    const std::vector<ImportJob> jobs = planImport(sources, destination);
+
+    ImportSummary summary;
+    std::mutex summaryMutex;
+    parallelFor(
+        0, static_cast<int>(jobs.size()), 1,
+        [&](int begin, int end) {
+            for (int i = begin; i < end; ++i)
+            {
+                if (cancel && cancel->load())
+                {
+                    std::lock_guard<std::mutex> lock(summaryMutex);
+                    summary.cancelled = true;
+                    continue;
+                }
+                const ImportedFile file = importFile(jobs[i], options);
+                {
+                    std::lock_guard<std::mutex> lock(summaryMutex);
+                    if (file.status == ImportStatus::Copied)
+                    {
+                        ++summary.copied;
+                        summary.bytes += file.bytes;
+                    }
+                    else if (file.status == ImportStatus::Skipped)
+                    {
+                        ++summary.skipped;
+                    }
+                    else
+                    {
+                        ++summary.failed;
+                    }
+                }
+                if (onFile)
+                    onFile(file);
+            }
+        },
+        std::max(options.filesInFlight, 1u));
+    summary.seconds = millisecondsSince(start) / 1000.0;
+    return summary;
+}
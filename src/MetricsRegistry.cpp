@@ -0,0 +1,182 @@
+#include "MetricsRegistry.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// MetricsRegistry does the following
+// 1. Hands out counters, gauges and histograms by name (created on first use).
+// 2. Histograms keep a ring of recent samples and sort a copy for percentiles.
+// 3. snapshot() and toJson() for the Performance window and headless tools.
+
+void Histogram::record(double value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // One allocation for the whole window rather than growing into it
+    if (m_samples.empty())
+        m_samples.reserve(kWindow);
+    if (m_samples.size() < kWindow)
+        m_samples.push_back(value);
+    else
+        m_samples[m_next] = value;
+    m_next = (m_next + 1) % kWindow;
+    ++m_count;
+    m_sum += value;
+}
+
+namespace
+{
+// Nearest-rank percentile of sorted values.
+double percentile(const std::vector<double> &sorted, double fraction)
+{
+    const size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+template <typename Metric>
+Metric &findOrCreate(std::map<std::string, std::unique_ptr<Metric>> &metrics, const std::string &name)
+{
+    std::unique_ptr<Metric> &metric = metrics[name];
+    if (!metric)
+        metric = std::make_unique<Metric>();
+    return *metric;
+}
+
+void appendJsonString(std::string &out, const std::string &value)
+{
+    out += '"';
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+void appendNumber(std::string &out, double value)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.6g", std::isfinite(value) ? value : 0.0);
+    out += buffer;
+}
+
+void appendIntegers(std::string &out, const std::vector<std::pair<std::string, int64_t>> &values)
+{
+    out += '{';
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (i > 0)
+            out += ", ";
+        appendJsonString(out, values[i].first);
+        out += ": " + std::to_string(values[i].second);
+    }
+    out += '}';
+}
+} // namespace
+
+HistogramSummary Histogram::summary() const
+{
+    std::vector<double> sorted;
+    HistogramSummary summary;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        sorted = m_samples;
+        summary.count = m_count;
+        summary.mean = m_count > 0 ? m_sum / m_count : 0.0;
+    }
+    if (sorted.empty())
+        return summary;
+
+    std::sort(sorted.begin(), sorted.end());
+    summary.min = sorted.front();
+    summary.max = sorted.back();
+    summary.p50 = percentile(sorted, 0.50);
+    summary.p95 = percentile(sorted, 0.95);
+    summary.p99 = percentile(sorted, 0.99);
+    return summary;
+}
+
+std::vector<float> Histogram::recent() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<float> values;
+    values.reserve(m_samples.size());
+    // Until the ring is full m_next is its size and the start is 0.
+    const size_t start = m_samples.size() < kWindow ? 0 : m_next;
+    for (size_t i = 0; i < m_samples.size(); ++i)
+        values.push_back(static_cast<float>(m_samples[(start + i) % m_samples.size()]));
+    return values;
+}
+
+Counter &MetricsRegistry::counter(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return findOrCreate(m_counters, name);
+}
+
+Gauge &MetricsRegistry::gauge(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return findOrCreate(m_gauges, name);
+}
+
+Histogram &MetricsRegistry::histogram(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return findOrCreate(m_histograms, name);
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() const
+{
+    MetricsSnapshot snapshot;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &[name, counter] : m_counters)
+        snapshot.counters.emplace_back(name, counter->value());
+    for (const auto &[name, gauge] : m_gauges)
+        snapshot.gauges.emplace_back(name, gauge->value());
+    for (const auto &[name, histogram] : m_histograms)
+        snapshot.histograms.emplace_back(name, histogram->summary());
+    return snapshot;
+}
+
+std::string toJson(const MetricsSnapshot &snapshot)
+{
+    std::string out = "{\"counters\": ";
+    appendIntegers(out, snapshot.counters);
+    out += ", \"gauges\": ";
+    appendIntegers(out, snapshot.gauges);
+    out += ", \"histograms\": {";
+    for (size_t i = 0; i < snapshot.histograms.size(); ++i)
+    {
+        const HistogramSummary &h = snapshot.histograms[i].second;
+        if (i > 0)
+            out += ", ";
+        appendJsonString(out, snapshot.histograms[i].first);
+        out += ": {\"count\": " + std::to_string(h.count);
+        const std::pair<const char *, double> fields[] = {
+            {"mean", h.mean}, {"min", h.min}, {"max", h.max}, {"p50", h.p50}, {"p95", h.p95}, {"p99", h.p99},
+        };
+        for (const auto &[field, value] : fields)
+        {
+            out += ", \"";
+            out += field;
+            out += "\": ";
+            appendNumber(out, value);
+        }
+        out += '}';
+    }
+    out += "}}";
+    return out;
+}
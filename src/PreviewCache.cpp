@@ -0,0 +1,188 @@
+#include "PreviewCache.h"
+#include "ImageView.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+// PreviewCache does the following
+// 1. Shrinks a preview to at most kPreviewCacheMaxEdge, 8-bit RGB.
+// 2. Stores it with a header identifying the source file version.
+// 3. Loads it back only if the source file is unchanged.
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr char kMagic[4] = {'P', 'C', 'P', 'V'};
+constexpr uint32_t kVersion = 1;
+
+struct SourceStamp
+{
+    uint64_t size = 0;
+    int64_t modified = 0;
+};
+
+std::optional<SourceStamp> stampOf(const std::string &sourcePath)
+{
+    std::error_code error;
+    SourceStamp stamp;
+    stamp.size = fs::file_size(sourcePath, error);
+    if (error)
+        return std::nullopt;
+    const auto modified = fs::last_write_time(sourcePath, error);
+    if (error)
+        return std::nullopt;
+    stamp.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+    return stamp;
+}
+
+template <typename T>
+void writeValue(std::ofstream &out, const T &value)
+{
+    out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+bool readValue(std::ifstream &in, T &value)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+// Averages blocks of about factor x factor source pixels; 16-bit values are
+// reduced to their top 8 bits first.
+template <typename T, int Channels>
+void boxDownscale(ConstImageView<T, Channels> source, double factor, ImageView<uint8_t, 3> target)
+{
+    constexpr int shift = sizeof(T) == 2 ? 8 : 0;
+    for (int y = 0; y < target.height; ++y)
+    {
+        const int y0 = static_cast<int>(y * factor);
+        const int y1 = std::max(y0 + 1, std::min(source.height, static_cast<int>((y + 1) * factor)));
+        uint8_t *out = target.row(y);
+        for (int x = 0; x < target.width; ++x, out += 3)
+        {
+            const int x0 = static_cast<int>(x * factor);
+            const int x1 = std::max(x0 + 1, std::min(source.width, static_cast<int>((x + 1) * factor)));
+
+            uint32_t sum[3] = {0, 0, 0};
+            for (int sy = y0; sy < y1; ++sy)
+            {
+                const T *pixel = source.pixel(x0, sy);
+                for (int sx = x0; sx < x1; ++sx, pixel += Channels)
+                {
+                    sum[0] += pixel[0] >> shift;
+                    sum[1] += pixel[1] >> shift;
+                    sum[2] += pixel[2] >> shift;
+                }
+            }
+
+            const uint32_t count = static_cast<uint32_t>((y1 - y0) * (x1 - x0));
+            for (int c = 0; c < 3; ++c)
+                out[c] = static_cast<uint8_t>(sum[c] / count);
+        }
+    }
+}
+} // namespace
+
+ImageData downscaleToRgb8(const ImageData &image, int maxEdge)
+{
+    ImageData result;
+    result.kind = ImageKind::Preview;
+    result.channels = 3;
+    if (image.width <= 0 || image.height <= 0 || maxEdge <= 0)
+        return result;
+
+    const double factor = std::max(1.0, static_cast<double>(std::max(image.width, image.height)) / maxEdge);
+    result.width = std::max(1, static_cast<int>(image.width / factor));
+    result.height = std::max(1, static_cast<int>(image.height / factor));
+    result.pixels8.resize(static_cast<size_t>(result.width) * result.height * 3);
+
+    dispatchImage(image, [&](auto source) { boxDownscale(source, factor, *imageView<uint8_t, 3>(result)); });
+    return result;
+}
+
+bool savePreviewCache(const fs::path &cacheFile, const std::string &sourcePath, const ImageData &preview)
+{
+    const std::optional<SourceStamp> stamp = stampOf(sourcePath);
+    if (!stamp)
+        return false;
+
+    const ImageData small = downscaleToRgb8(preview, kPreviewCacheMaxEdge);
+    if (small.pixels8.empty())
+        return false;
+
+    // Unique temp name: loads of several generations may save at once.
+    static std::atomic<unsigned> writes{0};
+    fs::path temporary = cacheFile;
+    temporary += ".tmp" + std::to_string(writes++);
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        out.write(kMagic, sizeof(kMagic));
+        writeValue(out, kVersion);
+        writeValue(out, stamp->size);
+        writeValue(out, stamp->modified);
+        writeValue(out, static_cast<uint32_t>(sourcePath.size()));
+        out.write(sourcePath.data(), static_cast<std::streamsize>(sourcePath.size()));
+        writeValue(out, static_cast<int32_t>(small.width));
+        writeValue(out, static_cast<int32_t>(small.height));
+        out.write(reinterpret_cast<const char *>(small.pixels8.data()),
+                  static_cast<std::streamsize>(small.pixels8.size()));
+        if (!out)
+        {
+            out.close();
+            std::error_code ignored;
+            fs::remove(temporary, ignored);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    fs::rename(temporary, cacheFile, error);
+    if (!error)
+        return true;
+    std::error_code ignored;
+    fs::remove(temporary, ignored);
+    return false;
+}
+
+std::optional<ImageData> loadPreviewCache(const fs::path &cacheFile, const std::string &sourcePath)
+{
+    const std::optional<SourceStamp> stamp = stampOf(sourcePath);
+    if (!stamp)
+        return std::nullopt;
+
+    std::ifstream in(cacheFile, std::ios::binary);
+    char magic[4];
+    uint32_t version = 0;
+    SourceStamp cached;
+    uint32_t pathLength = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(magic)) != 0 ||
+        !readValue(in, version) || version != kVersion || !readValue(in, cached.size) ||
+        !readValue(in, cached.modified) || !readValue(in, pathLength) || pathLength > 4096)
+        return std::nullopt;
+
+    std::string path(pathLength, '\0');
+    if (!in.read(path.data(), pathLength) || path != sourcePath || cached.size != stamp->size ||
+        cached.modified != stamp->modified)
+        return std::nullopt;
+
+    int32_t width = 0;
+    int32_t height = 0;
+    if (!readValue(in, width) || !readValue(in, height) || width <= 0 || height <= 0 ||
+        width > kPreviewCacheMaxEdge || height > kPreviewCacheMaxEdge)
+        return std::nullopt;
+
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.channels = 3;
+    image.kind = ImageKind::Preview;
+    image.pixels8.resize(static_cast<size_t>(width) * height * 3);
+    if (!in.read(reinterpret_cast<char *>(image.pixels8.data()), static_cast<std::streamsize>(image.pixels8.size())))
+        return std::nullopt;
+    return image;
+}
@@ -0,0 +1,99 @@
+#include "ProgramBinaryFile.h"
+#include <cstring>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr char kMagic[4] = {'P', 'C', 'S', 'B'};
+constexpr uint32_t kVersion = 1;
+// Real binaries are a few hundred KB at most.
+constexpr uint64_t kMaxBinaryBytes = 64ull << 20;
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 1469598103934665603ull)
+{
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Length first so ("ab", "c") and ("a", "bc") hash differently.
+uint64_t hashString(const std::string &value, uint64_t hash)
+{
+    const uint64_t length = value.size();
+    hash = fnv1a(&length, sizeof(length), hash);
+    return fnv1a(value.data(), value.size(), hash);
+}
+
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t checksum;
+};
+} // namespace
+
+uint64_t programCacheKey(const std::string &vertexSource, const std::string &fragmentSource,
+                         const std::string &vendor, const std::string &renderer, const std::string &version)
+{
+    uint64_t hash = 1469598103934665603ull;
+    for (const std::string *part : {&vertexSource, &fragmentSource, &vendor, &renderer, &version})
+        hash = hashString(*part, hash);
+    return hash;
+}
+
+bool writeProgramBinaryFile(const fs::path &path, uint64_t key, const ProgramBinary &binary)
+{
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.key = key;
+    header.format = binary.format;
+    header.size = binary.data.size();
+    header.checksum = fnv1a(binary.data.data(), binary.data.size());
+
+    // Temp file + rename: a crash mid-write never leaves a half file behind.
+    fs::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(binary.data.data()),
+                  static_cast<std::streamsize>(binary.data.size()));
+        if (!out)
+            return false;
+    }
+
+    std::error_code error;
+    fs::rename(temporary, path, error);
+    return !error;
+}
+
+std::optional<ProgramBinary> readProgramBinaryFile(const fs::path &path, uint64_t key)
+{
+    std::ifstream in(path, std::ios::binary);
+    Header header{};
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        return std::nullopt;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.key != key || header.size == 0 || header.size > kMaxBinaryBytes)
+        return std::nullopt;
+
+    ProgramBinary binary;
+    binary.format = header.format;
+    binary.data.resize(header.size);
+    if (!in.read(reinterpret_cast<char *>(binary.data.data()), static_cast<std::streamsize>(header.size)))
+        return std::nullopt;
+    if (fnv1a(binary.data.data(), binary.data.size()) != header.checksum)
+        return std::nullopt;
+    return binary;
+}
@@ -0,0 +1,276 @@
+#include "Resample.h"
+#include "ImageView.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PHOTOCRISPY_RESAMPLE_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PHOTOCRISPY_RESAMPLE_NEON 1
+#endif
+
+// Resample does the following per band of output rows
+// 1. Widens the source rows the band needs to float RGBX (alpha, or padding
+//    for RGB), so every pixel is one 4-float vector whatever the layout.
+// 2. Filters those rows horizontally with the precomputed taps.
+// 3. Filters the band vertically, one whole row of vectors per tap, and
+//    rounds back to 8 or 16 bits.
+// Bands recompute the few source rows they share with their neighbours
+// instead of synchronising, so they run on the thread pool without locks.
+
+namespace
+{
+constexpr double kPi = 3.14159265358979323846;
+
+double filterRadius(ResampleFilter filter)
+{
+    switch (filter)
+    {
+    case ResampleFilter::Box:
+        return 0.5;
+    case ResampleFilter::Triangle:
+        return 1.0;
+    case ResampleFilter::Lanczos3:
+        return 3.0;
+    }
+    return 1.0;
+}
+
+double sinc(double x)
+{
+    if (x == 0.0)
+        return 1.0;
+    x *= kPi;
+    return std::sin(x) / x;
+}
+
+double filterWeight(ResampleFilter filter, double x)
+{
+    switch (filter)
+    {
+    case ResampleFilter::Box:
+        return x >= -0.5 && x < 0.5 ? 1.0 : 0.0;
+    case ResampleFilter::Triangle:
+        return std::max(0.0, 1.0 - std::abs(x));
+    case ResampleFilter::Lanczos3:
+        return std::abs(x) < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+    }
+    return 0.0;
+}
+
+// Four floats: one RGBX pixel in the horizontal pass, four values of a row
+// in the vertical one.
+#if defined(PHOTOCRISPY_RESAMPLE_SSE)
+using Float4 = __m128;
+inline Float4 load4(const float *p) { return _mm_loadu_ps(p); }
+inline void store4(float *p, Float4 v) { _mm_storeu_ps(p, v); }
+inline Float4 splat4(float value) { return _mm_set1_ps(value); }
+inline Float4 zero4() { return _mm_setzero_ps(); }
+inline Float4 multiplyAdd4(Float4 acc, Float4 a, Float4 b) { return _mm_add_ps(acc, _mm_mul_ps(a, b)); }
+#elif defined(PHOTOCRISPY_RESAMPLE_NEON)
+using Float4 = float32x4_t;
+inline Float4 load4(const float *p) { return vld1q_f32(p); }
+inline void store4(float *p, Float4 v) { vst1q_f32(p, v); }
+inline Float4 splat4(float value) { return vdupq_n_f32(value); }
+inline Float4 zero4() { return vdupq_n_f32(0.0f); }
+inline Float4 multiplyAdd4(Float4 acc, Float4 a, Float4 b) { return vmlaq_f32(acc, a, b); }
+#else
+struct Float4
+{
+    float v[4];
+};
+inline Float4 load4(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store4(float *p, Float4 v) { std::copy(v.v, v.v + 4, p); }
+inline Float4 splat4(float value) { return {{value, value, value, value}}; }
+inline Float4 zero4() { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+inline Float4 multiplyAdd4(Float4 acc, Float4 a, Float4 b)
+{
+    for (int i = 0; i < 4; ++i)
+        acc.v[i] += a.v[i] * b.v[i];
+    return acc;
+}
+#endif
+
+template <typename T, int Channels>
+void widenRow(const T *source, int width, float *rgbx)
+{
+    for (int x = 0; x < width; ++x, source += Channels, rgbx += 4)
+    {
+        rgbx[0] = source[0];
+        rgbx[1] = source[1];
+        rgbx[2] = source[2];
+        rgbx[3] = Channels == 4 ? source[3] : 0.0f;
+    }
+}
+
+void filterRow(const float *rgbx, const ResampleTaps &taps, int width, float *out)
+{
+    const float *weights = taps.weights.data();
+    for (int x = 0; x < width; ++x, weights += taps.taps, out += 4)
+    {
+        const float *pixel = rgbx + static_cast<size_t>(taps.first[x]) * 4;
+        Float4 acc = zero4();
+        for (int t = 0; t < taps.taps; ++t, pixel += 4)
+            acc = multiplyAdd4(acc, load4(pixel), splat4(weights[t]));
+        store4(out, acc);
+    }
+}
+
+template <typename T, int Channels>
+void narrowRow(const float *rgbx, int width, T *out)
+{
+    constexpr float maxValue = imageValueMax<T>();
+    for (int x = 0; x < width; ++x, rgbx += 4, out += Channels)
+        for (int c = 0; c < Channels; ++c)
+            out[c] = static_cast<T>(std::clamp(rgbx[c], 0.0f, maxValue) + 0.5f);
+}
+
+template <typename T, int Channels>
+void resampleBand(ConstImageView<T, Channels> input, const ResampleTaps &tapsX, const ResampleTaps &tapsY,
+                  ImageView<T, Channels> output, int rowBegin, int rowEnd)
+{
+    const int width = output.width;
+    const int sourceBegin = tapsY.first[rowBegin];
+    const int sourceEnd = tapsY.first[rowEnd - 1] + tapsY.taps;
+    const size_t rowFloats = static_cast<size_t>(width) * 4;
+
+    // 1. + 2. Source rows of the band, widened and filtered horizontally.
+    std::vector<float> widened(static_cast<size_t>(input.width) * 4);
+    std::vector<float> filtered(rowFloats * (sourceEnd - sourceBegin));
+    for (int row = sourceBegin; row < sourceEnd; ++row)
+    {
+        widenRow<T, Channels>(input.row(row), input.width, widened.data());
+        filterRow(widened.data(), tapsX, width, filtered.data() + rowFloats * (row - sourceBegin));
+    }
+
+    // 3. Vertical pass, tap by tap over whole rows so the loads stream.
+    std::vector<float> accumulated(rowFloats);
+    for (int y = rowBegin; y < rowEnd; ++y)
+    {
+        std::fill(accumulated.begin(), accumulated.end(), 0.0f);
+        const float *weights = tapsY.weights.data() + static_cast<size_t>(y) * tapsY.taps;
+        for (int t = 0; t < tapsY.taps; ++t)
+        {
+            if (weights[t] == 0.0f)
+                continue;
+            const float *row = filtered.data() + rowFloats * (tapsY.first[y] + t - sourceBegin);
+            const Float4 weight = splat4(weights[t]);
+            for (size_t i = 0; i < rowFloats; i += 4)
+                store4(accumulated.data() + i, multiplyAdd4(load4(accumulated.data() + i), load4(row + i), weight));
+        }
+        narrowRow<T, Channels>(accumulated.data(), width, output.row(y));
+    }
+}
+} // namespace
+
+const char *resampleFilterName(ResampleFilter filter)
+{
+    switch (filter)
+    {
+    case ResampleFilter::Box:
+        return "box";
+    case ResampleFilter::Triangle:
+        return "triangle";
+    case ResampleFilter::Lanczos3:
+        return "lanczos3";
+    }
+    return "unknown";
+}
+
+ResampleTaps computeResampleTaps(int sourceSize, int outputSize, ResampleFilter filter)
+{
+    ResampleTaps result;
+    if (sourceSize <= 0 || outputSize <= 0)
+        return result;
+
+    // Shrinking stretches the filter over scale source pixels so it
+    // averages everything that lands in one output pixel.
+    const double scale = static_cast<double>(sourceSize) / outputSize;
+    const double filterScale = std::max(scale, 1.0);
+    const double support = filterRadius(filter) * filterScale;
+    result.taps = std::min(static_cast<int>(std::ceil(support)) * 2 + 1, sourceSize);
+    result.first.resize(outputSize);
+    result.weights.assign(static_cast<size_t>(outputSize) * result.taps, 0.0f);
+
+    std::vector<double> weights(result.taps);
+    for (int i = 0; i < outputSize; ++i)
+    {
+        const double center = (i + 0.5) * scale;
+        const int begin = std::max(0, static_cast<int>(center - support + 0.5));
+        const int end = std::min(sourceSize, std::max(begin + 1, static_cast<int>(center + support + 0.5)));
+        const int count = std::min(end - begin, result.taps);
+
+        double sum = 0.0;
+        for (int k = 0; k < count; ++k)
+        {
+            weights[k] = filterWeight(filter, (begin + k + 0.5 - center) / filterScale);
+            sum += weights[k];
+        }
+        // Near the border the window is clipped; shift it back inside so
+        // all taps are readable and put the weights at the matching offset.
+        const int first = std::min(begin, sourceSize - result.taps);
+        float *out = result.weights.data() + static_cast<size_t>(i) * result.taps + (begin - first);
+        result.first[i] = first;
+        if (sum == 0.0)
+        {
+            out[0] = 1.0f;
+            continue;
+        }
+        for (int k = 0; k < count; ++k)
+            out[k] = static_cast<float>(weights[k] / sum);
+    }
+    return result;
+}
+
+std::optional<ImageData> resampleImage(const ImageData &source, int width, int height, const ResampleOptions &options)
+{
+    if (source.width <= 0 || source.height <= 0 || width <= 0 || height <= 0 ||
+        (source.channels != 3 && source.channels != 4))
+        return std::nullopt;
+    const size_t sourceValues = static_cast<size_t>(source.width) * source.height * source.channels;
+    if ((source.is16Bit ? source.pixels16.size() : source.pixels8.size()) < sourceValues)
+        return std::nullopt;
+    if (width == source.width && height == source.height)
+        return source;
+
+    const ResampleTaps tapsX = computeResampleTaps(source.width, width, options.filter);
+    const ResampleTaps tapsY = computeResampleTaps(source.height, height, options.filter);
+
+    ImageData output;
+    output.width = width;
+    output.height = height;
+    output.channels = source.channels;
+    output.is16Bit = source.is16Bit;
+    output.kind = source.kind;
+    const size_t outputValues = static_cast<size_t>(width) * height * source.channels;
+
+    if (source.is16Bit)
+        output.pixels16.resize(outputValues);
+    else
+        output.pixels8.resize(outputValues);
+    dispatchImage(source, [&](auto input) {
+        using View = decltype(input);
+        using T = std::remove_const_t<typename View::Value>;
+        const ImageView<T, View::channels> target = *imageView<T, View::channels>(output);
+        parallelFor(
+            0, height, options.bandRows,
+            [&](int rowBegin, int rowEnd) { resampleBand(input, tapsX, tapsY, target, rowBegin, rowEnd); },
+            options.threads);
+    });
+    return output;
+}
+
+std::optional<ImageData> resampleToFit(const ImageData &source, int maxEdge, const ResampleOptions &options)
+{
+    const int longEdge = std::max(source.width, source.height);
+    if (maxEdge <= 0 || longEdge <= maxEdge)
+        return resampleImage(source, source.width, source.height, options);
+
+    const double scale = static_cast<double>(maxEdge) / longEdge;
+    const int width = std::max(1, static_cast<int>(std::lround(source.width * scale)));
+    const int height = std::max(1, static_cast<int>(std::lround(source.height * scale)));
+    return resampleImage(source, width, height, options);
+}
@@ -0,0 +1,220 @@
+#include "SessionRecording.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+// SessionRecording does the following
+// 1. Writes the header and settings once, then one block of lines per frame.
+// 2. Reads a recording back, rejecting anything it doesn't understand.
+// 3. Summarizes and exports the frame times of a session.
+
+namespace
+{
+constexpr const char *kMagic = "photocrispy-session";
+constexpr int kVersion = 1;
+
+const char *eventName(SessionEventType type)
+{
+    switch (type)
+    {
+    case SessionEventType::MousePos:
+        return "mouse_pos";
+    case SessionEventType::MouseButton:
+        return "mouse_button";
+    case SessionEventType::MouseWheel:
+        return "wheel";
+    case SessionEventType::Key:
+        return "key";
+    case SessionEventType::Char:
+        return "char";
+    case SessionEventType::Focus:
+        return "focus";
+    }
+    return "?";
+}
+
+std::optional<SessionEventType> eventType(const std::string &name)
+{
+    for (SessionEventType type : {SessionEventType::MousePos, SessionEventType::MouseButton,
+                                  SessionEventType::MouseWheel, SessionEventType::Key, SessionEventType::Char,
+                                  SessionEventType::Focus})
+    {
+        if (name == eventName(type))
+            return type;
+    }
+    return std::nullopt;
+}
+
+// Nearest-rank, like the metrics histograms.
+HistogramSummary summarize(std::vector<double> values)
+{
+    HistogramSummary summary;
+    if (values.empty())
+        return summary;
+    std::sort(values.begin(), values.end());
+    auto rank = [&](double fraction) {
+        const size_t index = static_cast<size_t>(std::ceil(fraction * values.size()));
+        return values[std::clamp<size_t>(index, 1, values.size()) - 1];
+    };
+    summary.count = static_cast<int64_t>(values.size());
+    double sum = 0.0;
+    for (double value : values)
+        sum += value;
+    summary.mean = sum / values.size();
+    summary.min = values.front();
+    summary.max = values.back();
+    summary.p50 = rank(0.50);
+    summary.p95 = rank(0.95);
+    summary.p99 = rank(0.99);
+    return summary;
+}
+} // namespace
+
+bool SessionWriter::open(const std::filesystem::path &path, int windowWidth, int windowHeight,
+                         const std::string &settings)
+{
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file)
+        return false;
+    // Shortest text that reads back to the same float
+    m_file << std::setprecision(std::numeric_limits<float>::max_digits10);
+    m_file << kMagic << ' ' << kVersion << '\n';
+    m_file << "window " << windowWidth << ' ' << windowHeight << '\n';
+    m_file << "settings " << settings.size() << '\n' << settings << '\n';
+    return static_cast<bool>(m_file);
+}
+
+void SessionWriter::writeFrame(const SessionFrame &frame)
+{
+    if (!m_file.is_open())
+        return;
+    m_file << "frame " << frame.deltaTime << ' ' << frame.displayWidth << ' ' << frame.displayHeight << '\n';
+    for (const SessionEvent &event : frame.events)
+    {
+        m_file << eventName(event.type);
+        switch (event.type)
+        {
+        case SessionEventType::MousePos:
+        case SessionEventType::MouseWheel:
+            m_file << ' ' << event.x << ' ' << event.y;
+            break;
+        case SessionEventType::MouseButton:
+        case SessionEventType::Key:
+            m_file << ' ' << event.code << ' ' << event.down;
+            break;
+        case SessionEventType::Char:
+            m_file << ' ' << event.code;
+            break;
+        case SessionEventType::Focus:
+            m_file << ' ' << event.down;
+            break;
+        }
+        m_file << '\n';
+    }
+}
+
+bool SessionWriter::close()
+{
+    if (!m_file.is_open())
+        return false;
+    m_file.flush();
+    const bool ok = static_cast<bool>(m_file);
+    m_file.close();
+    return ok;
+}
+
+std::optional<SessionRecording> loadSessionRecording(const std::filesystem::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int version = 0;
+    if (!(file >> magic >> version) || magic != kMagic || version != kVersion)
+        return std::nullopt;
+
+    SessionRecording recording;
+    std::string keyword;
+    size_t settingsBytes = 0;
+    if (!(file >> keyword >> recording.windowWidth >> recording.windowHeight) || keyword != "window")
+        return std::nullopt;
+    if (!(file >> keyword >> settingsBytes) || keyword != "settings" || file.get() != '\n')
+        return std::nullopt;
+    recording.settings.resize(settingsBytes);
+    if (!file.read(recording.settings.data(), static_cast<std::streamsize>(settingsBytes)))
+        return std::nullopt;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty())
+            continue;
+        std::istringstream fields(line);
+        fields >> keyword;
+        if (keyword == "frame")
+        {
+            SessionFrame frame;
+            if (!(fields >> frame.deltaTime >> frame.displayWidth >> frame.displayHeight))
+                return std::nullopt;
+            recording.frames.push_back(std::move(frame));
+            continue;
+        }
+
+        const std::optional<SessionEventType> type = eventType(keyword);
+        if (!type || recording.frames.empty())
+            return std::nullopt;
+        SessionEvent event;
+        event.type = *type;
+        bool ok = true;
+        switch (event.type)
+        {
+        case SessionEventType::MousePos:
+        case SessionEventType::MouseWheel:
+            ok = static_cast<bool>(fields >> event.x >> event.y);
+            break;
+        case SessionEventType::MouseButton:
+        case SessionEventType::Key:
+            ok = static_cast<bool>(fields >> event.code >> event.down);
+            break;
+        case SessionEventType::Char:
+            ok = static_cast<bool>(fields >> event.code);
+            break;
+        case SessionEventType::Focus:
+            ok = static_cast<bool>(fields >> event.down);
+            break;
+        }
+        if (!ok)
+            return std::nullopt;
+        recording.frames.back().events.push_back(event);
+    }
+    return recording;
+}
+
+FrameTimeSummary summarizeFrameTimes(const std::vector<FrameTiming> &frames, double hitchMs)
+{
+    std::vector<double> cpu;
+    std::vector<double> gpu;
+    FrameTimeSummary summary;
+    for (const FrameTiming &frame : frames)
+    {
+        cpu.push_back(frame.cpuMs);
+        if (frame.gpuMs >= 0.0)
+            gpu.push_back(frame.gpuMs);
+        if (frame.cpuMs > hitchMs)
+            ++summary.hitches;
+    }
+    summary.cpu = summarize(std::move(cpu));
+    summary.gpu = summarize(std::move(gpu));
+    return summary;
+}
+
+bool writeFrameTimes(const std::filesystem::path &path, const std::vector<FrameTiming> &frames)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+        return false;
+    file << "frame,cpu_ms,gpu_ms\n" << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < frames.size(); ++i)
+        file << i << ',' << frames[i].cpuMs << ',' << frames[i].gpuMs << '\n';
+    return static_cast<bool>(file);
+}
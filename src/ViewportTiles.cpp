@@ -0,0 +1,110 @@
+#include "ViewportTiles.h"
+#include <algorithm>
+#include <cmath>
+
+int tileLevelForScale(float displayScale)
+{
+    if (displayScale >= 1.0f || displayScale <= 0.0f)
+        return 0;
+    // Each level halves the tile resolution.
+    return static_cast<int>(std::floor(std::log2(1.0f / displayScale)));
+}
+
+ImageRect tileRect(const TileKey &key, int tileSize, int imageWidth, int imageHeight)
+{
+    const int span = tileSize << key.level;
+    ImageRect rect;
+    rect.x = key.column * span;
+    rect.y = key.row * span;
+    rect.width = std::max(0, std::min(span, imageWidth - rect.x));
+    rect.height = std::max(0, std::min(span, imageHeight - rect.y));
+    return rect;
+}
+
+std::vector<TileKey> tilesForView(const ImageRect &visible, int margin, int tileSize, int level,
+                                  int imageWidth, int imageHeight)
+{
+    std::vector<TileKey> tiles;
+    if (tileSize <= 0 || imageWidth <= 0 || imageHeight <= 0)
+        return tiles;
+
+    const int left = std::max(0, visible.x - margin);
+    const int top = std::max(0, visible.y - margin);
+    const int right = std::min(imageWidth, visible.x + visible.width + margin);
+    const int bottom = std::min(imageHeight, visible.y + visible.height + margin);
+    if (right <= left || bottom <= top)
+        return tiles;
+
+    const int span = tileSize << level;
+    for (int row = top / span; row <= (bottom - 1) / span; ++row)
+        for (int column = left / span; column <= (right - 1) / span; ++column)
+            tiles.push_back(TileKey{level, column, row});
+    return tiles;
+}
+
+size_t tileSlotsForView(int viewWidth, int viewHeight, int tileSize)
+{
+    const int half = std::max(1, tileSize / 2);
+    // Partial tiles at both ends of the view, plus the margin on each side
+    const size_t columns = static_cast<size_t>(std::max(0, viewWidth) / half + 3);
+    const size_t rows = static_cast<size_t>(std::max(0, viewHeight) / half + 3);
+    return columns * rows;
+}
+
+TileCache::TileCache(size_t capacity) : m_slots(capacity) {}
+
+void TileCache::beginFrame() { ++m_frame; }
+
+std::optional<size_t> TileCache::find(const TileKey &key, uint64_t revision)
+{
+    for (size_t i = 0; i < m_slots.size(); ++i)
+    {
+        Slot &slot = m_slots[i];
+        if (slot.used && slot.revision == revision && slot.key == key)
+        {
+            slot.lastFrame = m_frame;
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<size_t> TileCache::acquire(const TileKey &key, uint64_t revision)
+{
+    size_t best = m_slots.size();
+    for (size_t i = 0; i < m_slots.size(); ++i)
+    {
+        const Slot &slot = m_slots[i];
+        if (!slot.used)
+        {
+            best = i;
+            break;
+        }
+        if (slot.lastFrame != m_frame && (best == m_slots.size() || slot.lastFrame < m_slots[best].lastFrame))
+            best = i;
+    }
+
+    if (best == m_slots.size())
+        return std::nullopt;
+
+    m_slots[best] = Slot{true, key, revision, m_frame};
+    return best;
+}
+
+void TileCache::release(size_t slot)
+{
+    if (slot < m_slots.size())
+        m_slots[slot] = Slot{};
+}
+
+void TileCache::clear()
+{
+    for (Slot &slot : m_slots)
+        slot = Slot{};
+}
+
+void TileCache::grow(size_t capacity)
+{
+    if (capacity > m_slots.size())
+        m_slots.resize(capacity);
+}
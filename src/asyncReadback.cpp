@@ -0,0 +1,165 @@
+#include "../include/graphics/asyncReadback.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+bool AsyncReadback::create() {
+  return m_scratch[0].create() && m_scratch[1].create();
+}
+
+GLuint AsyncReadback::acquireBuffer() {
+  if (!m_freeBuffers.empty()) {
+    const GLuint buffer = m_freeBuffers.back();
+    m_freeBuffers.pop_back();
+    return buffer;
+  }
+  GLuint buffer = 0;
+  glGenBuffers(1, &buffer);
+  return buffer;
+}
+
+bool AsyncReadback::request(const RenderTarget &source,
+                            ReadbackRegion region, int downsample,
+                            ReadbackFormat format, Callback callback) {
+  if (source.framebuffer() == 0 || !callback)
+    return false;
+
+  region.x = std::clamp(region.x, 0, source.width());
+  region.y = std::clamp(region.y, 0, source.height());
+  if (region.width <= 0)
+    region.width = source.width() - region.x;
+  if (region.height <= 0)
+    region.height = source.height() - region.y;
+  region.width = std::min(region.width, source.width() - region.x);
+  region.height = std::min(region.height, source.height() - region.y);
+  if (region.width <= 0 || region.height <= 0)
+    return false;
+
+  downsample = std::max(downsample, 1);
+  const int outWidth = (region.width + downsample - 1) / downsample;
+  const int outHeight = (region.height + downsample - 1) / downsample;
+  const TextureFormat scratchFormat = format == ReadbackFormat::RGBA8
+                                          ? TextureFormat::RGBA8
+                                          : TextureFormat::RGBA16F;
+
+  // Downsample on the GPU: linear blits of at most 2x, so every step
+  // averages 2x2 texels and nothing is skipped.
+  GLuint readFramebuffer = source.framebuffer();
+  int x = region.x, y = region.y, w = region.width, h = region.height;
+  int scratch = 0;
+  while (w != outWidth || h != outHeight) {
+    const int nextWidth = std::max(outWidth, (w + 1) / 2);
+    const int nextHeight = std::max(outHeight, (h + 1) / 2);
+    RenderTarget &step = m_scratch[scratch];
+    if (!step.resize(nextWidth, nextHeight, scratchFormat))
+      return false;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, step.framebuffer());
+    glBlitFramebuffer(x, y, x + w, y + h, 0, 0, nextWidth, nextHeight,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    readFramebuffer = step.framebuffer();
+    x = y = 0;
+    w = nextWidth;
+    h = nextHeight;
+    scratch ^= 1;
+  }
+
+  Pending pending;
+  pending.image.width = outWidth;
+  pending.image.height = outHeight;
+  pending.image.format = format;
+  pending.bytes = static_cast<size_t>(outWidth) * outHeight *
+                  (format == ReadbackFormat::RGBA8 ? 4 : 4 * sizeof(float));
+  pending.callback = std::move(callback);
+  pending.buffer = acquireBuffer();
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pending.buffer);
+  glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(pending.bytes),
+               nullptr, GL_STREAM_READ);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  // With a pack buffer bound the last argument is an offset: returns at once.
+  glReadPixels(x, y, w, h, GL_RGBA,
+               format == ReadbackFormat::RGBA8 ? GL_UNSIGNED_BYTE : GL_FLOAT,
+               nullptr);
+  pending.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  // Makes sure the fence reaches the GPU even if nothing else is submitted.
+  glFlush();
+
+  m_pending.push_back(std::move(pending));
+  return true;
+}
+
+void AsyncReadback::deliver(Pending &pending) {
+  glDeleteSync(pending.fence);
+  pending.fence = nullptr;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pending.buffer);
+  const void *mapped =
+      glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                       static_cast<GLsizeiptr>(pending.bytes), GL_MAP_READ_BIT);
+  if (mapped) {
+    pending.image.bytes.resize(pending.bytes);
+    std::memcpy(pending.image.bytes.data(), mapped, pending.bytes);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  m_freeBuffers.push_back(pending.buffer);
+  pending.buffer = 0;
+
+  if (pending.image.bytes.empty())
+    return;
+  m_callbacks.push_back(std::async(
+      std::launch::async,
+      [callback = std::move(pending.callback),
+       image = std::move(pending.image)]() mutable {
+        callback(std::move(image));
+      }));
+}
+
+void AsyncReadback::reapCallbacks(bool wait) {
+  for (auto it = m_callbacks.begin(); it != m_callbacks.end();) {
+    if (wait || it->wait_for(std::chrono::seconds(0)) ==
+                    std::future_status::ready) {
+      it->get();
+      it = m_callbacks.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void AsyncReadback::poll() {
+  // Fences signal in submission order, so stop at the first busy one.
+  size_t done = 0;
+  for (; done < m_pending.size(); ++done) {
+    const GLenum status = glClientWaitSync(m_pending[done].fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+      break;
+    deliver(m_pending[done]);
+  }
+  m_pending.erase(m_pending.begin(), m_pending.begin() + done);
+  reapCallbacks(false);
+}
+
+void AsyncReadback::flush() {
+  for (Pending &pending : m_pending) {
+    glClientWaitSync(pending.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                     GL_TIMEOUT_IGNORED);
+    deliver(pending);
+  }
+  m_pending.clear();
+  reapCallbacks(true);
+}
+
+void AsyncReadback::destroy() {
+  flush();
+  if (!m_freeBuffers.empty())
+    glDeleteBuffers(static_cast<GLsizei>(m_freeBuffers.size()),
+                    m_freeBuffers.data());
+  m_freeBuffers.clear();
+  m_scratch[0].destroy();
+  m_scratch[1].destroy();
+}
@@ -0,0 +1,66 @@
+#include "../include/graphics/frameTimer.h"
+
+bool FrameTimer::create() {
+  for (Slot &slot : m_slots) {
+    glGenQueries(1, &slot.begin);
+    glGenQueries(1, &slot.end);
+  }
+  m_created = m_slots.back().end != 0;
+  return m_created;
+}
+
+void FrameTimer::begin(uint64_t frame) {
+  Slot &slot = m_slots[m_next];
+  m_measuring = m_created && !slot.pending;
+  if (!m_measuring)
+    return;
+  glQueryCounter(slot.begin, GL_TIMESTAMP);
+  slot.frame = frame;
+}
+
+void FrameTimer::end() {
+  if (!m_measuring)
+    return;
+  Slot &slot = m_slots[m_next];
+  glQueryCounter(slot.end, GL_TIMESTAMP);
+  slot.pending = true;
+  m_next = (m_next + 1) % kSlots;
+  m_measuring = false;
+}
+
+bool FrameTimer::read(Slot &slot, bool wait,
+                      const std::function<void(uint64_t, double)> &done) {
+  if (!wait) {
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(slot.end, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available != GL_TRUE)
+      return false;
+  }
+  // The end timestamp being in means the begin one is too.
+  GLuint64 beginNs = 0;
+  GLuint64 endNs = 0;
+  glGetQueryObjectui64v(slot.begin, GL_QUERY_RESULT, &beginNs);
+  glGetQueryObjectui64v(slot.end, GL_QUERY_RESULT, &endNs);
+  slot.pending = false;
+  done(slot.frame, static_cast<double>(endNs - beginNs) / 1.0e6);
+  return true;
+}
+
+void FrameTimer::collect(const std::function<void(uint64_t, double)> &done,
+                         bool wait) {
+  while (m_slots[m_oldest].pending && read(m_slots[m_oldest], wait, done))
+    m_oldest = (m_oldest + 1) % kSlots;
+}
+
+void FrameTimer::destroy() {
+  for (Slot &slot : m_slots) {
+    if (slot.begin != 0)
+      glDeleteQueries(1, &slot.begin);
+    if (slot.end != 0)
+      glDeleteQueries(1, &slot.end);
+    slot = Slot{};
+  }
+  m_next = 0;
+  m_oldest = 0;
+  m_created = false;
+}
@@ -0,0 +1,138 @@
+#include "../include/graphics/gpuDemosaic.h"
+#include <algorithm>
+#include <iterator>
+
+bool GpuDemosaic::create() {
+  m_shader.create_shader(PHOTOCRISPY_SHADER_DIR "/imageProcessing.vert",
+                         PHOTOCRISPY_SHADER_DIR "/demosaic.frag");
+
+  GLint linked = false;
+  glGetProgramiv(m_shader.ID, GL_LINK_STATUS, &linked);
+  if (linked != GL_TRUE) {
+    glDeleteProgram(m_shader.ID);
+    m_shader.ID = 0;
+    return false;
+  }
+
+  m_shader.use();
+  glUniform1i(glGetUniformLocation(m_shader.ID, "mosaic"), 0);
+  glUseProgram(0);
+
+  glGenVertexArrays(1, &m_vao);
+  return true;
+}
+
+void GpuDemosaic::trackMemory(TextureBudget *budget) { m_budget = budget; }
+
+bool GpuDemosaic::upload(const RawMosaic &mosaic) {
+  if (m_shader.ID == 0 || mosaic.width <= 0 || mosaic.height <= 0 ||
+      mosaic.pixels.size() <
+          static_cast<size_t>(mosaic.width) * mosaic.height)
+    return false;
+
+  releaseMosaic();
+
+  // Everything but the pixels, which only live on the GPU from here on.
+  m_parameters.width = mosaic.width;
+  m_parameters.height = mosaic.height;
+  m_parameters.patternWidth = mosaic.patternWidth;
+  m_parameters.patternHeight = mosaic.patternHeight;
+  std::copy(std::begin(mosaic.pattern), std::end(mosaic.pattern),
+            m_parameters.pattern);
+  std::copy(std::begin(mosaic.black), std::end(mosaic.black),
+            m_parameters.black);
+  m_parameters.white = mosaic.white;
+  std::copy(std::begin(mosaic.whiteBalance), std::end(mosaic.whiteBalance),
+            m_parameters.whiteBalance);
+  for (int i = 0; i < 3; ++i)
+    std::copy(std::begin(mosaic.cameraToRgb[i]),
+              std::end(mosaic.cameraToRgb[i]), m_parameters.cameraToRgb[i]);
+  m_parameters.flip = mosaic.flip;
+
+  if (m_budget)
+    m_budgetHandle = m_budget->track(TextureRole::Source, TextureFormat::R16,
+                                     mosaic.width, mosaic.height);
+
+  // texelFetch only, so no filtering and no mipmaps.
+  glGenTextures(1, &m_mosaicTexture);
+  glBindTexture(GL_TEXTURE_2D, m_mosaicTexture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, mosaic.width, mosaic.height, 0,
+               GL_RED, GL_UNSIGNED_SHORT, mosaic.pixels.data());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  return m_mosaicTexture != 0;
+}
+
+bool GpuDemosaic::develop(RenderTarget &target, const float *sourceRegion) {
+  static const float kWholeImage[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+  if (m_mosaicTexture == 0)
+    return false;
+  if (!sourceRegion)
+    sourceRegion = kWholeImage;
+
+  const RawMosaic &p = m_parameters;
+  const GLuint program = m_shader.ID;
+  m_shader.use();
+  glUniform4fv(glGetUniformLocation(program, "sourceRegion"), 1,
+               sourceRegion);
+  glUniform2i(glGetUniformLocation(program, "mosaicSize"), p.width,
+              p.height);
+  glUniform2i(glGetUniformLocation(program, "patternSize"), p.patternWidth,
+              p.patternHeight);
+  GLint pattern[36];
+  std::copy(std::begin(p.pattern), std::end(p.pattern), pattern);
+  glUniform1iv(glGetUniformLocation(program, "pattern"), 36, pattern);
+  glUniform3fv(glGetUniformLocation(program, "black"), 1, p.black);
+  glUniform1f(glGetUniformLocation(program, "white"), p.white);
+  glUniform3fv(glGetUniformLocation(program, "whiteBalance"), 1,
+               p.whiteBalance);
+  // cameraToRgb is row-major, GLSL matrices are column-major.
+  glUniformMatrix3fv(glGetUniformLocation(program, "cameraToRgb"), 1, GL_TRUE,
+                     &p.cameraToRgb[0][0]);
+  glUniform1i(glGetUniformLocation(program, "flip"), p.flip);
+  glUniform1i(glGetUniformLocation(program, "applyGamma"), 1);
+
+  target.bind();
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, m_mosaicTexture);
+  glBindVertexArray(m_vao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+
+  glBindVertexArray(0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glUseProgram(0);
+  target.touch();
+  return true;
+}
+
+void GpuDemosaic::releaseMosaic() {
+  if (m_mosaicTexture != 0)
+    glDeleteTextures(1, &m_mosaicTexture);
+  m_mosaicTexture = 0;
+  if (m_budget)
+    m_budget->release(m_budgetHandle);
+  m_budgetHandle = 0;
+}
+
+void GpuDemosaic::destroy() {
+  releaseMosaic();
+  if (m_shader.ID != 0)
+    glDeleteProgram(m_shader.ID);
+  if (m_vao != 0)
+    glDeleteVertexArrays(1, &m_vao);
+  m_shader.ID = 0;
+  m_vao = 0;
+}
+
+int GpuDemosaic::width() const {
+  return (m_parameters.flip & 4) ? m_parameters.height : m_parameters.width;
+}
+
+int GpuDemosaic::height() const {
+  return (m_parameters.flip & 4) ? m_parameters.width : m_parameters.height;
+}
@@ -0,0 +1,129 @@
+#include "../include/graphics/gpuDetailFilters.h"
+
+bool GpuDetailFilters::create() {
+  m_shader.create_shader(PHOTOCRISPY_SHADER_DIR "/imageProcessing.vert",
+                         PHOTOCRISPY_SHADER_DIR "/detailFilters.frag");
+
+  GLint linked = false;
+  glGetProgramiv(m_shader.ID, GL_LINK_STATUS, &linked);
+  if (linked != GL_TRUE) {
+    glDeleteProgram(m_shader.ID);
+    m_shader.ID = 0;
+    return false;
+  }
+
+  m_shader.use();
+  glUniform1i(glGetUniformLocation(m_shader.ID, "source"), 0);
+  glUniform1i(glGetUniformLocation(m_shader.ID, "guide"), 1);
+  glUseProgram(0);
+
+  glGenVertexArrays(1, &m_vao);
+  return true;
+}
+
+void GpuDetailFilters::trackMemory(TextureBudget *budget) {
+  m_budget = budget;
+}
+
+bool GpuDetailFilters::prepare(RenderTarget &target, int width, int height) {
+  if (target.texture() == 0) {
+    if (!target.create())
+      return false;
+    target.trackMemory(m_budget, TextureRole::Detail);
+  }
+  return target.resize(width, height, TextureFormat::RGBA16F);
+}
+
+void GpuDetailFilters::apply(const RenderTarget &input, uint64_t inputKey,
+                             RenderTarget &output,
+                             const DevelopSettings &settings, float scale) {
+  if (m_shader.ID == 0)
+    return;
+  const int width = input.width();
+  const int height = input.height();
+  const NoiseReductionKernel noise = noiseReductionKernel(settings, scale);
+  const SharpenKernel sharpen = sharpenKernel(settings, scale);
+  const bool denoise = noise.luma || noise.chroma;
+  if (!prepare(m_horizontal, width, height))
+    return;
+
+  const GLuint program = m_shader.ID;
+  m_shader.use();
+  glUniform1i(glGetUniformLocation(program, "filterLuma"), noise.luma);
+  glUniform1f(glGetUniformLocation(program, "lumaSigma"), noise.lumaSigma);
+  glUniform1f(glGetUniformLocation(program, "lumaRange"), noise.lumaRange);
+  glUniform1i(glGetUniformLocation(program, "lumaRadius"), noise.lumaRadius);
+  glUniform1i(glGetUniformLocation(program, "filterChroma"), noise.chroma);
+  glUniform1f(glGetUniformLocation(program, "chromaSigma"),
+              noise.chromaSigma);
+  glUniform1f(glGetUniformLocation(program, "chromaRange"),
+              noise.chromaRange);
+  glUniform1i(glGetUniformLocation(program, "chromaRadius"),
+              noise.chromaRadius);
+  glUniform1f(glGetUniformLocation(program, "sharpenSigma"), sharpen.sigma);
+  glUniform1i(glGetUniformLocation(program, "sharpenRadius"),
+              sharpen.radius);
+  glUniform1f(glGetUniformLocation(program, "sharpenAmount"),
+              sharpen.amount);
+  glUniform1f(glGetUniformLocation(program, "sharpenThreshold"),
+              sharpen.threshold);
+
+  if (denoise && !sharpen.active) {
+    // Nothing follows, so straight into output.
+    runPass(0, input.texture(), input.texture(), m_horizontal);
+    runPass(1, m_horizontal.texture(), input.texture(), output);
+  } else {
+    GLuint sharpenInput = input.texture();
+    if (denoise && prepare(m_denoised, width, height)) {
+      // Everything the denoised image depends on
+      const float values[4] = {settings.lumaNoise, settings.chromaNoise, scale,
+                               static_cast<float>(width * height)};
+      const uint64_t key = hashDevelopValues(values, 4, inputKey);
+      if (key != m_denoisedKey) {
+        runPass(0, input.texture(), input.texture(), m_horizontal);
+        runPass(1, m_horizontal.texture(), input.texture(), m_denoised);
+        m_denoisedKey = key;
+      }
+      sharpenInput = m_denoised.texture();
+    }
+    runPass(2, sharpenInput, 0, m_horizontal);
+    runPass(3, m_horizontal.texture(), sharpenInput, output);
+  }
+  glUseProgram(0);
+}
+
+void GpuDetailFilters::runPass(int mode, GLuint source, GLuint guide,
+                               RenderTarget &target) {
+  glUniform1i(glGetUniformLocation(m_shader.ID, "mode"), mode);
+  target.bind();
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, guide);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, source);
+  glBindVertexArray(m_vao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+
+  glBindVertexArray(0);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  target.touch();
+}
+
+void GpuDetailFilters::release() {
+  m_horizontal.destroy();
+  m_denoised.destroy();
+  m_denoisedKey = 0;
+}
+
+void GpuDetailFilters::destroy() {
+  release();
+  if (m_shader.ID != 0)
+    glDeleteProgram(m_shader.ID);
+  if (m_vao != 0)
+    glDeleteVertexArrays(1, &m_vao);
+  m_shader.ID = 0;
+  m_vao = 0;
+}
@@ -1,8 +1,73 @@
 #include "App.h"
+#include "BatchRender.h"
+#include "ImportPipeline.h"
+#include "fmt/core.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
 
-int main() {
+// Headless folder export: every raw file under source, developed with the
+// default settings, to destination.
+static int runBatch(const char *argv0, const fs::path &source, const fs::path &destination, unsigned workers) {
+    std::error_code error;
+    fs::create_directories(destination, error);
+    const std::vector<BatchJob> jobs = makeExportJobs(findImportSources(source), destination, DevelopSettings{});
+    BatchOptions options;
+    options.workerCommand = {batchWorkerExecutable(argv0)};
+    options.workers = workers;
+    size_t finished = 0;
+    const BatchSummary summary = runBatchRender(jobs, options, [&](const BatchJobResult &result) {
+        ++finished;
+        if (result.ok)
+            fmt::print("[{}/{}] {} ({:.0f} ms)\n", finished, jobs.size(), result.job.output, result.renderMs);
+        else
+            fmt::print(stderr, "[{}/{}] {} failed after {} tries: {}\n", finished, jobs.size(), result.job.input,
+                       result.attempts, result.error);
+    });
+    fmt::print("{} rendered, {} failed, {} retries, {} worker crashes, {:.1f} s\n", summary.rendered,
+               summary.failed, summary.retries, summary.workerCrashes, summary.seconds);
+    return summary.failed == 0 ? 0 : 1;
+}
+
+// photocrispy [--record <session>] [--replay <session>] [--frame-times <csv>]
+// photocrispy --batch <source> <destination> [--workers <n>]
+// photocrispy --batch-worker <fd>   (started by the batch coordinator)
+int main(int argc, char **argv) {
+    if (argc == 3 && std::string(argv[1]) == "--batch-worker")
+        return runBatchWorker(std::atoi(argv[2]));
+
+    AppOptions options;
+    fs::path batchSource;
+    fs::path batchDestination;
+    unsigned batchWorkers = 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--record" && hasValue)
+            options.recordSession = argv[++i];
+        else if (arg == "--replay" && hasValue)
+            options.replaySession = argv[++i];
+        else if (arg == "--frame-times" && hasValue)
+            options.frameTimes = argv[++i];
+        else if (arg == "--batch" && i + 2 < argc) {
+            batchSource = argv[++i];
+            batchDestination = argv[++i];
+        } else if (arg == "--workers" && hasValue)
+            batchWorkers = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        else {
+            fmt::print(stderr, "usage: photocrispy [--record <session>] [--replay <session>] "
+                               "[--frame-times <csv>]\n"
+                               "       photocrispy --batch <source> <destination> [--workers <n>]\n");
+            return 2;
+        }
+    }
+    if (!batchSource.empty())
+        return runBatch(argv[0], batchSource, batchDestination, batchWorkers);
+
+    options.executable = batchWorkerExecutable(argv[0]);
     App app;
-    if (!app.init()) return -1;
+    if (!app.init(options)) return -1;
     app.run();
     app.shutdown();
     return 0;
@@ -0,0 +1,120 @@
+#include "../include/graphics/renderTarget.h"
+#include "fmt/core.h"
+#include <cstdio>
+
+GLenum textureInternalFormat(TextureFormat format) {
+  switch (format) {
+  case TextureFormat::RGB8:
+    return GL_RGB8;
+  case TextureFormat::RGBA8:
+    return GL_RGBA8;
+  case TextureFormat::RGB16:
+    return GL_RGB16;
+  case TextureFormat::RGB10A2:
+    return GL_RGB10_A2;
+  case TextureFormat::RGBA16F:
+    return GL_RGBA16F;
+  case TextureFormat::RGBA32F:
+    return GL_RGBA32F;
+  case TextureFormat::R16:
+    return GL_R16;
+  }
+  return GL_RGBA8;
+}
+
+bool RenderTarget::create() {
+  glGenFramebuffers(1, &m_framebuffer);
+  glGenTextures(1, &m_texture);
+
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         m_texture, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  return m_framebuffer != 0 && m_texture != 0;
+}
+
+void RenderTarget::trackMemory(TextureBudget *budget, TextureRole role,
+                               std::function<void()> evict) {
+  m_budget = budget;
+  m_role = role;
+  m_evict = std::move(evict);
+}
+
+bool RenderTarget::resize(int width, int height, TextureFormat format) {
+  if (m_texture == 0 || width <= 0 || height <= 0)
+    return false;
+
+  if (m_allocated && width == m_width && height == m_height &&
+      format == m_format)
+    return true;
+
+  // Account first: the budget may evict other textures to make room.
+  if (m_budget) {
+    if (m_budgetHandle == 0)
+      m_budgetHandle =
+          m_budget->track(m_role, format, width, height, 1, m_evict);
+    else
+      m_budget->update(m_budgetHandle, format, width, height);
+  }
+
+  // Float formats take float data, everything else is uploaded as bytes.
+  const bool isFloat = format == TextureFormat::RGBA16F ||
+                       format == TextureFormat::RGBA32F;
+  const GLenum type = isFloat ? GL_FLOAT : GL_UNSIGNED_BYTE;
+
+  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, textureInternalFormat(format), width, height,
+               0, GL_RGBA, type, nullptr);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  m_width = width;
+  m_height = height;
+  m_format = format;
+  m_allocated = true;
+
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    fmt::print(stderr, "Render target framebuffer incomplete: {:#x}\n",
+               status);
+    m_allocated = false;
+    return false;
+  }
+  return true;
+}
+
+void RenderTarget::touch() {
+  if (m_budget && m_budgetHandle != 0)
+    m_budget->touch(m_budgetHandle);
+}
+
+void RenderTarget::bind() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  glViewport(0, 0, m_width, m_height);
+}
+
+void RenderTarget::destroy() {
+  if (m_texture != 0)
+    glDeleteTextures(1, &m_texture);
+  if (m_framebuffer != 0)
+    glDeleteFramebuffers(1, &m_framebuffer);
+
+  if (m_budget && m_budgetHandle != 0)
+    m_budget->release(m_budgetHandle);
+
+  m_texture = 0;
+  m_framebuffer = 0;
+  m_width = 0;
+  m_height = 0;
+  m_allocated = false;
+  m_budgetHandle = 0;
+}
@@ -0,0 +1,109 @@
+#include "../include/graphics/shaderBinaryCache.h"
+#include <chrono>
+#include <cstdio>
+#include <system_error>
+
+namespace {
+std::string glString(GLenum name) {
+  const GLubyte *value = glGetString(name);
+  return value ? reinterpret_cast<const char *>(value) : "";
+}
+} // namespace
+
+ShaderBinaryCache::ShaderBinaryCache(std::filesystem::path directory)
+    : m_directory(std::move(directory)) {}
+
+void ShaderBinaryCache::queryDriver() {
+  if (m_driverQueried)
+    return;
+  m_driverQueried = true;
+  m_vendor = glString(GL_VENDOR);
+  m_renderer = glString(GL_RENDERER);
+  m_version = glString(GL_VERSION);
+
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+  m_supported = formats > 0 && !error;
+}
+
+bool ShaderBinaryCache::supported() {
+  queryDriver();
+  return m_supported;
+}
+
+uint64_t ShaderBinaryCache::key(const std::string &vertexSource,
+                                const std::string &fragmentSource) {
+  queryDriver();
+  return programCacheKey(vertexSource, fragmentSource, m_vendor, m_renderer,
+                         m_version);
+}
+
+std::filesystem::path ShaderBinaryCache::fileFor(uint64_t key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin",
+                static_cast<unsigned long long>(key));
+  return m_directory / name;
+}
+
+GLuint ShaderBinaryCache::load(uint64_t key) {
+  if (!supported()) {
+    ++m_stats.misses;
+    return 0;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const std::optional<ProgramBinary> binary =
+      readProgramBinaryFile(fileFor(key), key);
+  if (!binary) {
+    ++m_stats.misses;
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, binary->format, binary->data.data(),
+                  static_cast<GLsizei>(binary->data.size()));
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (linked != GL_TRUE) {
+    // Driver changed its mind (update without a version string change...)
+    glDeleteProgram(program);
+    std::error_code error;
+    std::filesystem::remove(fileFor(key), error);
+    ++m_stats.rejected;
+    ++m_stats.misses;
+    return 0;
+  }
+
+  ++m_stats.hits;
+  m_stats.loadMs += std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  return program;
+}
+
+void ShaderBinaryCache::store(GLuint program, uint64_t key) {
+  if (!supported() || program == 0)
+    return;
+
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  ProgramBinary binary;
+  binary.data.resize(static_cast<size_t>(length));
+  GLenum format = 0;
+  GLsizei written = 0;
+  glGetProgramBinary(program, length, &written, &format, binary.data.data());
+  if (written <= 0)
+    return;
+  binary.data.resize(static_cast<size_t>(written));
+  binary.format = format;
+  writeProgramBinaryFile(fileFor(key), key, binary);
+}
+
+void ShaderBinaryCache::recordCompile(double milliseconds) {
+  m_stats.compileMs += milliseconds;
+}
@@ -1,4 +1,6 @@
 #include "../include/graphics/shaderProgram.h"
+#include "../include/graphics/shaderBinaryCache.h"
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <glad/glad.h>
@@ -6,34 +8,49 @@
 #include <sstream>
 #include <string>
 
-void ShaderProgram::create_shader(std::string vertexSource,
-                                  std::string fragmentSource) {
-  // 1. retrieve the vertex/fragment source code from filePath
-  std::string vertexCode;
-  std::string fragmentCode;
-  std::ifstream vShaderFile;
-  std::ifstream fShaderFile;
+std::string ShaderProgram::read_source(const std::string &path) {
+  std::ifstream shaderFile;
   // ensure ifstream objects can throw exceptions:
-  vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+  shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
   try {
-    // open files
-    vShaderFile.open(vertexSource);
-    fShaderFile.open(fragmentSource);
-    std::stringstream vShaderStream, fShaderStream;
-    // read file's buffer contents into streams
-    vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
-    // close file handlers
-    vShaderFile.close();
-    fShaderFile.close();
-    // convert stream into string
-    vertexCode = vShaderStream.str();
-    fragmentCode = fShaderStream.str();
+    shaderFile.open(path);
+    std::stringstream shaderStream;
+    // read file's buffer contents into stream
+    shaderStream << shaderFile.rdbuf();
+    shaderFile.close();
+    return shaderStream.str();
   } catch (std::ifstream::failure &e) {
     std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what()
               << std::endl;
   }
+  return {};
+}
+
+ShaderBinaryCache *ShaderProgram::s_binaryCache = nullptr;
+
+void ShaderProgram::useBinaryCache(ShaderBinaryCache *cache) {
+  s_binaryCache = cache;
+}
+
+void ShaderProgram::create_shader(std::string vertexSource,
+                                  std::string fragmentSource) {
+  // 1. retrieve the vertex/fragment source code from filePath
+  create_shader_from_source(read_source(vertexSource),
+                            read_source(fragmentSource));
+}
+
+void ShaderProgram::create_shader_from_source(const std::string &vertexCode,
+                                              const std::string &fragmentCode) {
+  // 1b. a binary linked by an earlier run skips compiling altogether
+  uint64_t cacheKey = 0;
+  if (s_binaryCache) {
+    cacheKey = s_binaryCache->key(vertexCode, fragmentCode);
+    ID = s_binaryCache->load(cacheKey);
+    if (ID != 0)
+      return;
+  }
+  const auto compileStart = std::chrono::steady_clock::now();
+
   const char *vShaderCode = vertexCode.c_str();
   const char *fShaderCode = fragmentCode.c_str();
   // 2. compile shaders
@@ -52,12 +69,25 @@ void ShaderProgram::create_shader(std::string vertexSource,
   ID = glCreateProgram();
   glAttachShader(ID, vertex);
   glAttachShader(ID, fragment);
+  if (s_binaryCache)
+    glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
   glLinkProgram(ID);
   checkCompileErrors(ID, "PROGRAM");
   // delete the shaders as they're linked into our program now and no longer
   // necessary
   glDeleteShader(vertex);
   glDeleteShader(fragment);
+
+  if (s_binaryCache) {
+    s_binaryCache->recordCompile(
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - compileStart)
+            .count());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+    if (linked == GL_TRUE)
+      s_binaryCache->store(ID, cacheKey);
+  }
 }
 void ShaderProgram::use() { glUseProgram(ID); }
 
@@ -0,0 +1,230 @@
+#include "../include/graphics/textureBudget.h"
+#include <algorithm>
+
+size_t textureFormatBytesPerPixel(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::RGB8:
+    case TextureFormat::RGBA8:
+    case TextureFormat::RGB10A2:
+        return 4;
+    case TextureFormat::RGB16:
+    case TextureFormat::RGBA16F:
+        return 8;
+    case TextureFormat::RGBA32F:
+        return 16;
+    case TextureFormat::R16:
+        return 2;
+    }
+    return 4;
+}
+
+const char *textureFormatName(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::RGB8:
+        return "RGB8";
+    case TextureFormat::RGBA8:
+        return "RGBA8";
+    case TextureFormat::RGB16:
+        return "RGB16";
+    case TextureFormat::RGB10A2:
+        return "RGB10_A2";
+    case TextureFormat::RGBA16F:
+        return "RGBA16F";
+    case TextureFormat::RGBA32F:
+        return "RGBA32F";
+    case TextureFormat::R16:
+        return "R16";
+    }
+    return "?";
+}
+
+const char *textureRoleName(TextureRole role)
+{
+    switch (role)
+    {
+    case TextureRole::Source:
+        return "Source";
+    case TextureRole::Processed:
+        return "Processed";
+    case TextureRole::Proxy:
+        return "Proxy";
+    case TextureRole::Tile:
+        return "Tile";
+    case TextureRole::Lut:
+        return "LUT";
+    case TextureRole::Detail:
+        return "Detail";
+    case TextureRole::Thumbnail:
+        return "Thumbnail";
+    case TextureRole::Preview:
+        return "Preview";
+    case TextureRole::Ui:
+        return "UI";
+    }
+    return "?";
+}
+
+namespace
+{
+size_t textureBytes(TextureFormat format, int width, int height, int depth)
+{
+    return textureFormatBytesPerPixel(format) * static_cast<size_t>(std::max(width, 0)) *
+           static_cast<size_t>(std::max(height, 0)) * static_cast<size_t>(std::max(depth, 1));
+}
+} // namespace
+
+TextureBudget::TextureBudget(size_t budgetBytes) : m_budgetBytes(budgetBytes) {}
+
+TextureBudget::Handle TextureBudget::track(TextureRole role, TextureFormat format, int width, int height,
+                                           int depth, std::function<void()> evict)
+{
+    const size_t bytes = textureBytes(format, width, height, depth);
+    reserve(bytes);
+
+    Entry entry;
+    entry.handle = m_nextHandle++;
+    entry.role = role;
+    entry.format = format;
+    entry.width = width;
+    entry.height = height;
+    entry.depth = depth;
+    entry.bytes = bytes;
+    entry.lastUse = ++m_clock;
+    entry.evict = std::move(evict);
+
+    m_usedBytes += bytes;
+    m_entries.push_back(std::move(entry));
+    return m_entries.back().handle;
+}
+
+void TextureBudget::update(Handle handle, TextureFormat format, int width, int height, int depth)
+{
+    Entry *entry = find(handle);
+    if (!entry)
+        return;
+
+    const size_t bytes = textureBytes(format, width, height, depth);
+    if (bytes > entry->bytes)
+    {
+        // Eviction may reorder m_entries, so look the entry up again afterwards.
+        reserveExcept(bytes - entry->bytes, handle);
+        entry = find(handle);
+        if (!entry)
+            return;
+    }
+
+    m_usedBytes = m_usedBytes - entry->bytes + bytes;
+    entry->format = format;
+    entry->width = width;
+    entry->height = height;
+    entry->depth = depth;
+    entry->bytes = bytes;
+    entry->lastUse = ++m_clock;
+}
+
+void TextureBudget::release(Handle handle)
+{
+    auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                           [handle](const Entry &entry) { return entry.handle == handle; });
+    if (it == m_entries.end())
+        return;
+
+    m_usedBytes -= it->bytes;
+    m_entries.erase(it);
+}
+
+void TextureBudget::touch(Handle handle)
+{
+    if (Entry *entry = find(handle))
+        entry->lastUse = ++m_clock;
+}
+
+size_t TextureBudget::reserve(size_t bytes) { return reserveExcept(bytes, 0); }
+
+size_t TextureBudget::reserveExcept(size_t bytes, Handle keep)
+{
+    size_t freed = 0;
+    while (m_usedBytes + bytes > m_budgetBytes)
+    {
+        auto victim = m_entries.end();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if (it->evict && it->handle != keep && (victim == m_entries.end() || it->lastUse < victim->lastUse))
+                victim = it;
+        }
+        if (victim == m_entries.end())
+            break;
+
+        // The callback normally releases the handle itself; make sure it is
+        // gone either way so the loop always makes progress.
+        const Handle handle = victim->handle;
+        const size_t victimBytes = victim->bytes;
+        const std::function<void()> evict = victim->evict;
+        evict();
+        release(handle);
+
+        freed += victimBytes;
+        ++m_evictions;
+    }
+    return freed;
+}
+
+TextureFormat TextureBudget::chooseFormat(TextureRole role, int width, int height) const
+{
+    switch (role)
+    {
+    case TextureRole::Source:
+        return TextureFormat::RGB16;
+    case TextureRole::Lut:
+    case TextureRole::Detail:
+        return TextureFormat::RGBA16F;
+    case TextureRole::Thumbnail:
+    case TextureRole::Preview:
+    case TextureRole::Ui:
+        return TextureFormat::RGBA8;
+    case TextureRole::Processed:
+    case TextureRole::Proxy:
+    case TextureRole::Tile:
+        break;
+    }
+
+    // Results feed histograms and export, so keep half floats while they use
+    // at most a quarter of what is left, then 10-bit, then 8-bit.
+    const size_t available = m_budgetBytes > m_usedBytes ? m_budgetBytes - m_usedBytes : 0;
+    if (textureBytes(TextureFormat::RGBA16F, width, height, 1) * 4 <= available)
+        return TextureFormat::RGBA16F;
+    if (textureBytes(TextureFormat::RGB10A2, width, height, 1) * 2 <= available)
+        return TextureFormat::RGB10A2;
+    return TextureFormat::RGBA8;
+}
+
+void TextureBudget::setBudgetBytes(size_t bytes)
+{
+    m_budgetBytes = bytes;
+    reserve(0);
+}
+
+size_t TextureBudget::bytesForRole(TextureRole role) const
+{
+    size_t total = 0;
+    for (const Entry &entry : m_entries)
+    {
+        if (entry.role == role)
+            total += entry.bytes;
+    }
+    return total;
+}
+
+TextureBudget::Entry *TextureBudget::find(Handle handle)
+{
+    for (Entry &entry : m_entries)
+    {
+        if (entry.handle == handle)
+            return &entry;
+    }
+    return nullptr;
+}
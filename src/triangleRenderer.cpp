@@ -74,6 +74,12 @@ void TriangleRenderer::renderTriangle(int newWidth, int newHeight) {
     glBindTexture(GL_TEXTURE_2D, texture_id);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
                  GL_UNSIGNED_BYTE, nullptr);
+
+    if (textureBudget && budgetHandle == 0)
+      budgetHandle = textureBudget->track(TextureRole::Ui, TextureFormat::RGBA8,
+                                          width, height);
+    else if (textureBudget)
+      textureBudget->update(budgetHandle, TextureFormat::RGBA8, width, height);
   }
   glBindTexture(GL_TEXTURE_2D, 0);
 
@@ -97,6 +103,9 @@ void TriangleRenderer::renderTriangle(int newWidth, int newHeight) {
 }
 
 void TriangleRenderer::destroy() {
+  if (textureBudget && budgetHandle != 0)
+    textureBudget->release(budgetHandle);
+  budgetHandle = 0;
   glDeleteProgram(appShaders.ID);
   glDeleteTextures(1, &texture_id);
   glDeleteFramebuffers(1, &FBO);
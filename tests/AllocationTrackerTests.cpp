@@ -0,0 +1,142 @@
+#include "AllocationTracker.h"
+#include "DecoderBackend.h"
+#include "FileBrowser.h"
+#include "FolderWatcher.h"
+#include "ImageLoadPipeline.h"
+#include "MetricsRegistry.h"
+#include "imgui.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <vector>
+
+// Built with PHOTOCRISPY_TRACK_ALLOCATIONS.
+
+// Keeps the compiler from eliding allocations it can see through.
+static void *volatile g_sink = nullptr;
+
+static AllocationCount countFor(const AllocationFrame &frame, const char *scope)
+{
+    for (size_t i = 0; i < frame.scopeCount; ++i)
+        if (std::strcmp(frame.scopes[i].scope, scope) == 0)
+            return frame.scopes[i].count;
+    return AllocationCount{};
+}
+
+static void countsByInnermostScope()
+{
+    assert(allocationTrackingEnabled());
+    const uint64_t processBefore = processAllocations().allocations;
+
+    beginAllocationFrame();
+    {
+        AllocationScope outer("outer");
+        void *first = ::operator new(400);
+        g_sink = first;
+        {
+            AllocationScope inner("inner");
+            void *second = ::operator new(8);
+            g_sink = second;
+            ::operator delete(second);
+        }
+        ::operator delete(first);
+    }
+    void *third = ::operator new(10);
+    g_sink = third;
+    const AllocationFrame frame = endAllocationFrame();
+    ::operator delete(third);
+
+    assert(frame.total.allocations == 3 && frame.total.frees == 2 && frame.total.bytes == 418);
+    const AllocationCount outer = countFor(frame, "outer");
+    assert(outer.allocations == 1 && outer.frees == 1 && outer.bytes == 400);
+    const AllocationCount inner = countFor(frame, "inner");
+    assert(inner.allocations == 1 && inner.frees == 1 && inner.bytes == 8);
+    const AllocationCount unscoped = countFor(frame, "(unscoped)");
+    assert(unscoped.allocations == 1 && unscoped.frees == 0);
+    assert(processAllocations().allocations >= processBefore + 3);
+
+    // A new frame starts from zero.
+    beginAllocationFrame();
+    assert(endAllocationFrame().total.allocations == 0);
+}
+
+static void countsAlignedAllocations()
+{
+    beginAllocationFrame();
+    void *memory = ::operator new(100, std::align_val_t(256));
+    g_sink = memory;
+    assert(reinterpret_cast<uintptr_t>(memory) % 256 == 0);
+    ::operator delete(memory, std::align_val_t(256));
+    const AllocationFrame frame = endAllocationFrame();
+    assert(frame.total.allocations == 1 && frame.total.frees == 1);
+}
+
+// Filmstrip, watch folder and loader polling with nothing to do, the way the UI loop runs
+// them every frame: once warm, a frame must not allocate.
+static void idleFrameAllocatesNothing()
+{
+    const std::filesystem::path folder = std::filesystem::temp_directory_path() / "photocrispy_idle_frame_test";
+    std::filesystem::create_directories(folder);
+    for (const char *name : {"a_long_file_name_0001.arw", "b.arw", "c.nef"})
+        std::ofstream(folder / name) << "raw";
+
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(1280.0f, 720.0f);
+    io.DeltaTime = 1.0f / 60.0f;
+    io.Fonts->Build();
+
+    FileBrowser browser;
+    assert(browser.Refresh(folder));
+    browser.SetThumbnail(folder / "b.arw", 1, 160, 107, 7);
+    DecoderRegistry decoders;
+    MetricsRegistry metrics;
+    ImageLoadPipeline loader(decoders, metrics);
+    Histogram &frameTimes = metrics.histogram("frame.ms");
+    FolderWatcher watcher;
+#ifdef __linux__
+    assert(watcher.start(folder));
+#else
+    // No watcher on this platform; polling the stopped one is checked instead
+    assert(!watcher.start(folder));
+#endif
+    std::vector<CapturedFile> captured;
+
+    auto frame = [&]() {
+        assert(!watcher.poll(captured));
+        while (loader.takeResult())
+        {
+        }
+        loader.collect();
+        frameTimes.record(16.7);
+        ImGui::NewFrame();
+        ImGui::Begin("Filmstrip");
+        browser.Draw();
+        ImGui::End();
+        ImGui::Render();
+    };
+    for (int i = 0; i < 10; ++i)
+        frame();
+    assert(browser.GetDrawnThumbnails() == std::vector<uint64_t>{7});
+
+    beginAllocationFrame();
+    frame();
+    const AllocationFrame idle = endAllocationFrame();
+    assert(idle.total.allocations == 0);
+
+    ImGui::DestroyContext();
+    std::filesystem::remove_all(folder);
+}
+
+int main()
+{
+    countsByInnermostScope();
+    countsAlignedAllocations();
+    idleFrameAllocatesNothing();
+    return 0;
+}
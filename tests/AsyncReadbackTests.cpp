@@ -0,0 +1,157 @@
+#include "graphics/asyncReadback.h"
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// Reads back a target with four solid quadrants.
+// Needs an OpenGL 4.3 context; skipped when none can be created.
+
+static const float kQuadrants[4][4] = {
+    {1.0f, 0.0f, 0.0f, 1.0f}, // bottom left
+    {0.0f, 1.0f, 0.0f, 1.0f}, // bottom right
+    {0.0f, 0.0f, 1.0f, 1.0f}, // top left
+    {1.0f, 1.0f, 1.0f, 1.0f}, // top right
+};
+
+static void fillQuadrants(RenderTarget &target)
+{
+    const int halfWidth = target.width() / 2;
+    const int halfHeight = target.height() / 2;
+    target.bind();
+    glEnable(GL_SCISSOR_TEST);
+    for (int q = 0; q < 4; ++q)
+    {
+        glScissor((q % 2) * halfWidth, (q / 2) * halfHeight, halfWidth, halfHeight);
+        glClearColor(kQuadrants[q][0], kQuadrants[q][1], kQuadrants[q][2], kQuadrants[q][3]);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+struct Received
+{
+    std::mutex mutex;
+    std::vector<ReadbackImage> images;
+    std::atomic<int> onGlThread{0};
+};
+
+static AsyncReadback::Callback collect(Received &received, std::thread::id glThread)
+{
+    return [&received, glThread](ReadbackImage image) {
+        if (std::this_thread::get_id() == glThread)
+            ++received.onGlThread;
+        std::lock_guard<std::mutex> lock(received.mutex);
+        received.images.push_back(std::move(image));
+    };
+}
+
+static void readsWholeRegionAndDownsampled(AsyncReadback &readback, RenderTarget &target)
+{
+    Received received;
+    const std::thread::id glThread = std::this_thread::get_id();
+
+    // Whole target, a rectangle inside the top right quadrant, then 4x smaller
+    assert(readback.request(target, {}, 1, ReadbackFormat::RGBA8, collect(received, glThread)));
+    assert(readback.request(target, {70, 40, 20, 10}, 1, ReadbackFormat::RGBA8, collect(received, glThread)));
+    assert(readback.request(target, {}, 4, ReadbackFormat::RGBA32F, collect(received, glThread)));
+    assert(readback.pending() == 3);
+
+    // Drawing over the target right away must not change what is read.
+    target.bind();
+    glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (int frame = 0; frame < 1000 && readback.pending() > 0; ++frame)
+    {
+        readback.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    readback.flush();
+    assert(received.onGlThread == 0);
+    assert(received.images.size() == 3);
+
+    for (const ReadbackImage &image : received.images)
+    {
+        if (image.format == ReadbackFormat::RGBA32F)
+        {
+            assert(image.width == 32 && image.height == 16);
+            // Pixel (2, 2) is bottom left red, (29, 13) top right white.
+            const float *bottomLeft = image.floats() + (2 * 32 + 2) * 4;
+            const float *topRight = image.floats() + (13 * 32 + 29) * 4;
+            assert(std::fabs(bottomLeft[0] - 1.0f) < 0.01f && std::fabs(bottomLeft[1]) < 0.01f);
+            assert(std::fabs(topRight[2] - 1.0f) < 0.01f && std::fabs(topRight[1] - 1.0f) < 0.01f);
+            // 2x2 averaging steps: no bleeding across the aligned boundary.
+            const float *left = image.floats() + (2 * 32 + 15) * 4;
+            const float *right = image.floats() + (2 * 32 + 16) * 4;
+            assert(std::fabs(left[0] - 1.0f) < 0.01f && std::fabs(left[1]) < 0.01f);
+            assert(std::fabs(right[0]) < 0.01f && std::fabs(right[1] - 1.0f) < 0.01f);
+        }
+        else if (image.width == 128)
+        {
+            assert(image.height == 64 && image.bytes.size() == 128 * 64 * 4);
+            assert(image.bytes[0] == 255 && image.bytes[1] == 0);
+            const uint8_t *topLeft = &image.bytes[(63 * 128 + 0) * 4];
+            assert(topLeft[0] == 0 && topLeft[2] == 255);
+        }
+        else
+        {
+            assert(image.width == 20 && image.height == 10);
+            for (uint8_t value : image.bytes)
+                assert(value == 255);
+        }
+    }
+}
+
+static void rejectsEmptyRegions(AsyncReadback &readback, RenderTarget &target)
+{
+    const auto ignore = [](ReadbackImage) {};
+    assert(!readback.request(target, {128, 0, 0, 0}, 1, ReadbackFormat::RGBA8, ignore));
+    assert(!readback.request(target, {}, 1, ReadbackFormat::RGBA8, nullptr));
+    assert(readback.pending() == 0);
+}
+
+int main()
+{
+    if (!glfwInit())
+    {
+        std::printf("async_readback_tests skipped: no GLFW\n");
+        return 0;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "async_readback_tests", nullptr, nullptr);
+    if (!window)
+    {
+        std::printf("async_readback_tests skipped: no OpenGL 4.3 context\n");
+        glfwTerminate();
+        return 0;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+        return 1;
+
+    RenderTarget target;
+    AsyncReadback readback;
+    const bool created = target.create() && target.resize(128, 64, TextureFormat::RGBA16F) && readback.create();
+    assert(created);
+    (void)created;
+
+    fillQuadrants(target);
+    readsWholeRegionAndDownsampled(readback, target);
+    rejectsEmptyRegions(readback, target);
+
+    readback.destroy();
+    target.destroy();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
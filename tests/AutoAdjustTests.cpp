@@ -0,0 +1,169 @@
+#include "AutoAdjust.h"
+#include "Demosaic.h"
+
+#include <cassert>
+#include <cmath>
+#include <random>
+
+// Textured grey scene around level with each channel multiplied by cast.
+static ImageData makeScene(int width, int height, float level, const float cast[3], bool is16Bit = false)
+{
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> texture(0.6f, 1.4f);
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.channels = 3;
+    image.is16Bit = is16Bit;
+    const size_t values = static_cast<size_t>(width) * height * 3;
+    const float maxValue = is16Bit ? 65535.0f : 255.0f;
+    if (is16Bit)
+        image.pixels16.resize(values);
+    else
+        image.pixels8.resize(values);
+    for (size_t i = 0; i < values; i += 3)
+    {
+        const float grey = level * texture(random);
+        for (int c = 0; c < 3; ++c)
+        {
+            const float value = std::clamp(grey * cast[c], 0.0f, 1.0f) * maxValue + 0.5f;
+            if (is16Bit)
+                image.pixels16[i + c] = static_cast<uint16_t>(value);
+            else
+                image.pixels8[i + c] = static_cast<uint8_t>(value);
+        }
+    }
+    return image;
+}
+
+static const float kNeutral[3] = {1.0f, 1.0f, 1.0f};
+
+static void removesColourCast()
+{
+    const float cast[3] = {0.8f, 1.0f, 1.25f};
+    for (bool is16Bit : {false, true})
+    {
+        const auto adjustment = estimateAutoAdjustment(makeScene(600, 400, 0.4f, cast, is16Bit));
+        assert(adjustment);
+        assert(std::abs(adjustment->whiteBalance[0] - 1.25f) < 0.03f);
+        assert(adjustment->whiteBalance[1] == 1.0f);
+        assert(std::abs(adjustment->whiteBalance[2] - 0.8f) < 0.03f);
+    }
+}
+
+static void brightensDarkImages()
+{
+    const auto adjustment = estimateAutoAdjustment(makeScene(600, 400, 0.1f, kNeutral));
+    assert(adjustment);
+    // Median 0.1 to 0.42 would be two stops, but the brightest samples
+    // (0.14) only allow log2(1 / 0.14).
+    assert(adjustment->exposure > 1.5f && adjustment->exposure < 2.9f);
+    assert(std::abs(adjustment->whiteBalance[0] - 1.0f) < 0.02f);
+}
+
+static void darkensBrightImages()
+{
+    const auto adjustment = estimateAutoAdjustment(makeScene(600, 400, 0.6f, kNeutral));
+    assert(adjustment);
+    assert(std::abs(adjustment->exposure - std::log2(0.42f / 0.6f)) < 0.1f);
+}
+
+static void leavesClippedHighlightsAlone()
+{
+    // Median well below the target, but a tenth of the frame is blown out.
+    ImageData image = makeScene(600, 400, 0.3f, kNeutral);
+    for (size_t i = 0; i < image.pixels8.size() / 10; ++i)
+        image.pixels8[i] = 255;
+    const auto adjustment = estimateAutoAdjustment(image);
+    assert(adjustment && adjustment->exposure == 0.0f);
+}
+
+static void looksAtASubsample()
+{
+    AutoAdjustOptions options;
+    options.targetSamples = 10000;
+    const auto adjustment = estimateAutoAdjustment(makeScene(2000, 1500, 0.4f, kNeutral), options);
+    assert(adjustment && adjustment->samples >= 5000 && adjustment->samples <= 20000);
+}
+
+// The mosaic estimate should agree with the estimate on the demosaiced image.
+static void mosaicMatchesDemosaicedImage()
+{
+    const float cast[3] = {0.7f, 1.0f, 1.1f};
+    RawMosaic mosaic;
+    mosaic.width = 800;
+    mosaic.height = 600;
+    mosaic.black[0] = mosaic.black[1] = mosaic.black[2] = 512.0f;
+    mosaic.white = 16383.0f;
+    mosaic.pixels.resize(static_cast<size_t>(mosaic.width) * mosaic.height);
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> texture(0.8f, 1.2f);
+    for (int y = 0; y < mosaic.height; y += 2)
+        for (int x = 0; x < mosaic.width; x += 2)
+        {
+            const float grey = 0.05f * texture(random);
+            for (int dy = 0; dy < 2; ++dy)
+                for (int dx = 0; dx < 2; ++dx)
+                {
+                    const int color = mosaicColor(mosaic, y + dy, x + dx);
+                    const float value = 512.0f + grey * cast[color] * (16383.0f - 512.0f);
+                    mosaic.pixels[static_cast<size_t>(y + dy) * mosaic.width + x + dx] =
+                        static_cast<uint16_t>(value);
+                }
+        }
+
+    const auto fromMosaic = estimateAutoAdjustment(mosaic);
+    DemosaicOptions demosaic;
+    demosaic.quality = DemosaicQuality::Bilinear;
+    const auto fromImage = estimateAutoAdjustment(demosaicMosaic(mosaic, demosaic));
+    assert(fromMosaic && fromImage);
+    assert(fromMosaic->exposure > 0.5f);
+    assert(std::abs(fromMosaic->exposure - fromImage->exposure) < 0.15f);
+    for (int c = 0; c < 3; ++c)
+        assert(std::abs(fromMosaic->whiteBalance[c] - fromImage->whiteBalance[c]) < 0.05f);
+    assert(fromMosaic->whiteBalance[0] > fromMosaic->whiteBalance[2]);
+}
+
+static void appliesToSettings()
+{
+    AutoAdjustment adjustment;
+    adjustment.exposure = 0.75f;
+    adjustment.whiteBalance[0] = 1.2f;
+    adjustment.whiteBalance[2] = 0.9f;
+    DevelopSettings settings;
+    applyAutoAdjustment(adjustment, settings);
+    assert(settings.exposure == 0.75f && settings.whiteBalance[0] == 1.2f && settings.whiteBalance[2] == 0.9f);
+}
+
+static void leavesBlackFramesAlone()
+{
+    const auto adjustment = estimateAutoAdjustment(makeScene(600, 400, 0.0f, kNeutral));
+    assert(adjustment && adjustment->samples > 0);
+    assert(adjustment->exposure == 0.0f);
+    assert(adjustment->whiteBalance[0] == 1.0f && adjustment->whiteBalance[2] == 1.0f);
+}
+
+static void rejectsBadInput()
+{
+    assert(!estimateAutoAdjustment(ImageData{}));
+    ImageData grey = makeScene(10, 10, 0.5f, kNeutral);
+    grey.channels = 1;
+    assert(!estimateAutoAdjustment(grey));
+    assert(!estimateAutoAdjustment(RawMosaic{}));
+    // One column and a stride of 4: no sample lands on it
+    assert(!estimateAutoAdjustment(makeScene(1, 1 << 20, 0.5f, kNeutral)));
+}
+
+int main()
+{
+    removesColourCast();
+    brightensDarkImages();
+    darkensBrightImages();
+    leavesClippedHighlightsAlone();
+    looksAtASubsample();
+    mosaicMatchesDemosaicedImage();
+    appliesToSettings();
+    leavesBlackFramesAlone();
+    rejectsBadInput();
+    return 0;
+}
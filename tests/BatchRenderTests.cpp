@@ -0,0 +1,292 @@
+#include "BatchRender.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// The test binary is its own worker (main() below). Inputs are not read:
+// the name says what to do.
+//   "crash"  aborts the worker
+//   "bad"    reports a failure
+//   "flaky"  fails the first try, then works
+//   "hang"   never finishes
+// Anything else writes the exposure to the output file.
+static bool stubRender(const BatchJob &job, std::string &error)
+{
+    const std::string name = fs::path(job.input).filename().string();
+    if (name.find("crash") != std::string::npos)
+        std::abort();
+    if (name.find("bad") != std::string::npos)
+    {
+        error = "unreadable\tfile";
+        return false;
+    }
+    if (name.find("flaky") != std::string::npos)
+    {
+        const fs::path marker = job.output + ".tried";
+        if (!fs::exists(marker))
+        {
+            std::ofstream(marker) << "1";
+            error = "first try";
+            return false;
+        }
+    }
+    if (name.find("hang") != std::string::npos)
+        std::this_thread::sleep_for(std::chrono::seconds(30));
+    std::ofstream(job.output) << job.settings.exposure;
+    return true;
+}
+
+static std::string g_self;
+
+static fs::path freshFolder(const char *name)
+{
+    const fs::path folder = fs::temp_directory_path() / name;
+    fs::remove_all(folder);
+    fs::create_directories(folder);
+    return folder;
+}
+
+static std::vector<BatchJob> jobsFor(const fs::path &folder, const std::vector<std::string> &names)
+{
+    std::vector<fs::path> files;
+    for (const std::string &name : names)
+        files.push_back(folder / name);
+    DevelopSettings settings;
+    settings.exposure = 0.75f;
+    return makeExportJobs(files, folder / "out", settings);
+}
+
+static void messagesRoundTrip()
+{
+    BatchMessage job;
+    job.type = BatchMessageType::Job;
+    job.job.id = 42;
+    job.job.input = "/photos/with space/a\tb\\c.ARW";
+    job.job.output = "/out/a.ppm";
+    job.job.targetEdge = 2048;
+    job.job.settings.exposure = -1.2345678f;
+    job.job.settings.whiteBalance[2] = 1.0f / 3.0f;
+    job.job.settings.chromaNoise = 0.25f;
+
+    const std::string line = formatBatchMessage(job);
+    assert(line.back() == '\n' && line.find('\n') == line.size() - 1);
+    const std::optional<BatchMessage> parsed = parseBatchMessage(line.substr(0, line.size() - 1));
+    assert(parsed && parsed->type == BatchMessageType::Job);
+    assert(parsed->job.id == 42 && parsed->job.targetEdge == 2048);
+    assert(parsed->job.input == job.job.input && parsed->job.output == job.job.output);
+    assert(parsed->job.settings.exposure == job.job.settings.exposure);
+    assert(parsed->job.settings.whiteBalance[2] == job.job.settings.whiteBalance[2]);
+    assert(parsed->job.settings.chromaNoise == 0.25f);
+
+    BatchMessage failed;
+    failed.type = BatchMessageType::Failed;
+    failed.job.id = 7;
+    failed.error = "two\nlines";
+    const std::string failLine = formatBatchMessage(failed);
+    const std::optional<BatchMessage> parsedFail = parseBatchMessage(failLine.substr(0, failLine.size() - 1));
+    assert(parsedFail && parsedFail->job.id == 7 && parsedFail->error == "two\nlines");
+
+    assert(parseBatchMessage("HELLO 1")->version == 1);
+    assert(parseBatchMessage("DONE 3 12.5")->renderMs == 12.5);
+    assert(parseBatchMessage("QUIT")->type == BatchMessageType::Quit);
+    assert(!parseBatchMessage(""));
+    assert(!parseBatchMessage("HELLO"));
+    assert(!parseBatchMessage("DONE 3 12.5 extra"));
+    assert(!parseBatchMessage("JOB 1 0 0 1 1 1 0 1 0 0 0\t/in"));
+    assert(!parseBatchMessage("FAIL 1\tbad \\q escape"));
+    assert(!parseBatchMessage("RENDER 1"));
+}
+
+static void exportJobsGetDistinctOutputs()
+{
+    const std::vector<BatchJob> jobs =
+        makeExportJobs({"/card/a.ARW", "/card/a.DNG", "/card/b.NEF", "/card/sub/a.ARW"}, "/out", DevelopSettings{});
+    assert(jobs.size() == 4);
+    assert(jobs[0].output == (fs::path("/out") / "a.ppm").string());
+    assert(jobs[1].output == (fs::path("/out") / "a-2.ppm").string());
+    assert(jobs[2].output == (fs::path("/out") / "b.ppm").string());
+    assert(jobs[3].output == (fs::path("/out") / "a-3.ppm").string());
+    assert(jobs[3].id == 3);
+}
+
+static void ppmIsWrittenBigEndianAndClamped()
+{
+    const fs::path folder = freshFolder("photocrispy_batch_ppm_test");
+    DevelopImage image;
+    image.width = 2;
+    image.height = 1;
+    image.pixels = {0.0f, 0.5f, 1.0f, -1.0f, 2.0f, 1.0f / 65535.0f};
+    const fs::path path = folder / "out.ppm";
+    assert(writeDevelopedPpm(image, path));
+    assert(!fs::exists(folder / "out.ppm.part"));
+
+    std::ifstream in(path, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const std::string header = "P6\n2 1\n65535\n";
+    assert(bytes.size() == header.size() + 12 && bytes.compare(0, header.size(), header) == 0);
+    auto value = [&](size_t i) {
+        return (static_cast<uint8_t>(bytes[header.size() + i * 2]) << 8) |
+               static_cast<uint8_t>(bytes[header.size() + i * 2 + 1]);
+    };
+    assert(value(0) == 0 && value(1) == 32768 && value(2) == 65535);
+    assert(value(3) == 0 && value(4) == 65535 && value(5) == 1);
+
+    assert(!writeDevelopedPpm(DevelopImage{}, folder / "empty.ppm"));
+    fs::remove_all(folder);
+}
+
+// The worker processes are POSIX only; elsewhere runBatchRender() fails
+// every job, which missingWorkerFailsEverything() still covers.
+#ifndef _WIN32
+static void workersRenderEveryJob()
+{
+    const fs::path folder = freshFolder("photocrispy_batch_render_test");
+    fs::create_directories(folder / "out");
+    std::vector<std::string> names;
+    for (int i = 0; i < 12; ++i)
+        names.push_back("img" + std::to_string(i) + ".ARW");
+    const std::vector<BatchJob> jobs = jobsFor(folder, names);
+
+    BatchOptions options;
+    options.workerCommand = {g_self};
+    options.workers = 3;
+    size_t results = 0;
+    const BatchSummary summary = runBatchRender(jobs, options, [&](const BatchJobResult &result) {
+        assert(result.ok && result.attempts == 1);
+        ++results;
+    });
+    assert(results == 12 && summary.rendered == 12 && summary.failed == 0);
+    assert(summary.workersStarted == 3 && summary.workerCrashes == 0 && summary.retries == 0);
+    for (const BatchJob &job : jobs)
+    {
+        std::ifstream in(job.output);
+        float exposure = 0.0f;
+        assert(in >> exposure && exposure == 0.75f);
+    }
+    fs::remove_all(folder);
+}
+
+static void failuresAreRetriedElsewhere()
+{
+    const fs::path folder = freshFolder("photocrispy_batch_retry_test");
+    fs::create_directories(folder / "out");
+    const std::vector<BatchJob> jobs =
+        jobsFor(folder, {"a.ARW", "crash.ARW", "b.ARW", "bad.ARW", "flaky.ARW", "c.ARW", "d.ARW"});
+
+    BatchOptions options;
+    options.workerCommand = {g_self};
+    options.workers = 2;
+    options.maxAttempts = 2;
+    std::map<std::string, BatchJobResult> results;
+    const BatchSummary summary = runBatchRender(jobs, options, [&](const BatchJobResult &result) {
+        results[fs::path(result.job.input).filename().string()] = result;
+    });
+
+    assert(results.size() == jobs.size());
+    assert(summary.rendered == 5 && summary.failed == 2);
+    // The crash took down a worker on both tries; the rest went on
+    assert(summary.workerCrashes == 2 && summary.workersStarted >= 3);
+    assert(!results["crash.ARW"].ok && results["crash.ARW"].attempts == 2);
+    assert(results["crash.ARW"].error.find("signal") != std::string::npos);
+    assert(!results["bad.ARW"].ok && results["bad.ARW"].error == "unreadable\tfile");
+    assert(results["flaky.ARW"].ok && results["flaky.ARW"].attempts == 2);
+    assert(results["d.ARW"].ok && results["d.ARW"].attempts == 1);
+    // crash twice, bad once, flaky once
+    assert(summary.retries == 3);
+    fs::remove_all(folder);
+}
+
+static void hungJobsTimeOut()
+{
+    const fs::path folder = freshFolder("photocrispy_batch_timeout_test");
+    fs::create_directories(folder / "out");
+    const std::vector<BatchJob> jobs = jobsFor(folder, {"hang.ARW", "a.ARW"});
+
+    BatchOptions options;
+    options.workerCommand = {g_self};
+    options.workers = 2;
+    options.maxAttempts = 1;
+    options.jobTimeoutSeconds = 0.3;
+    const auto start = std::chrono::steady_clock::now();
+    std::string error;
+    const BatchSummary summary = runBatchRender(jobs, options, [&](const BatchJobResult &result) {
+        if (!result.ok)
+            error = result.error;
+    });
+    assert(summary.rendered == 1 && summary.failed == 1 && error == "timed out");
+    assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+    fs::remove_all(folder);
+}
+
+#endif
+
+static void missingWorkerFailsEverything()
+{
+    const fs::path folder = freshFolder("photocrispy_batch_missing_test");
+    const std::vector<BatchJob> jobs = jobsFor(folder, {"a.ARW", "b.ARW", "c.ARW"});
+
+    BatchOptions options;
+    options.workerCommand = {(folder / "no-such-worker").string()};
+    options.workers = 2;
+    size_t failed = 0;
+    const BatchSummary summary = runBatchRender(jobs, options, [&](const BatchJobResult &result) {
+        assert(!result.ok);
+        ++failed;
+    });
+    assert(failed == 3 && summary.failed == 3 && summary.rendered == 0);
+    fs::remove_all(folder);
+}
+
+#ifndef _WIN32
+static void cancelLeavesTheRestOut()
+{
+    const fs::path folder = freshFolder("photocrispy_batch_cancel_test");
+    fs::create_directories(folder / "out");
+    const std::vector<BatchJob> jobs = jobsFor(folder, {"a.ARW", "b.ARW", "c.ARW", "d.ARW"});
+
+    BatchOptions options;
+    options.workerCommand = {g_self};
+    options.workers = 1;
+    std::atomic<bool> cancel{false};
+    size_t results = 0;
+    const BatchSummary summary = runBatchRender(
+        jobs, options,
+        [&](const BatchJobResult &) {
+            ++results;
+            cancel = true;
+        },
+        &cancel);
+    assert(summary.cancelled && results == 1 && summary.rendered == 1);
+    fs::remove_all(folder);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    if (argc == 3 && std::strcmp(argv[1], "--batch-worker") == 0)
+        return runBatchWorker(std::atoi(argv[2]), stubRender);
+
+    g_self = batchWorkerExecutable(argv[0]);
+    messagesRoundTrip();
+    exportJobsGetDistinctOutputs();
+    ppmIsWrittenBigEndianAndClamped();
+#ifndef _WIN32
+    workersRenderEveryJob();
+    failuresAreRetriedElsewhere();
+    hungJobsTimeOut();
+#endif
+    missingWorkerFailsEverything();
+#ifndef _WIN32
+    cancelLeavesTheRestOut();
+#endif
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "Culling.h"
+
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// A 400 x 300 embedded preview for every ".stub" file; "*fail*" has none.
+class StubPreviewBackend : public DecoderBackend
+{
+public:
+    const char *name() const override { return "stub-preview"; }
+    bool supports(const std::string &extension, DecodeOutput output) const override
+    {
+        return extension == ".stub" && output == DecodeOutput::Preview;
+    }
+    int cost(const std::string &, DecodeOutput) const override { return 1; }
+    std::optional<ImageData> decode(const DecodeRequest &request) const override
+    {
+        if (request.path.find("fail") != std::string::npos)
+            return std::nullopt;
+        ImageData image;
+        image.width = 400;
+        image.height = 300;
+        image.pixels8.assign(static_cast<size_t>(image.width) * image.height * 3, 128);
+        image.kind = ImageKind::Preview;
+        return image;
+    }
+};
+
+static void ringHandsOutNearestFirst()
+{
+    CullRing ring(10, 2);
+    assert(ring.capacity() == 5);
+    assert(ring.nextMissing() == 0u);
+    assert(ring.nextMissing() == 1u);
+    assert(ring.nextMissing() == 2u);
+    assert(!ring.nextMissing());
+
+    assert(!ring.resident(1));
+    assert(ring.place(1) == 1u);
+    assert(ring.resident(1) == 1u);
+
+    // Window 3..7; 5 and 6 take the slots of 0 and 1.
+    ring.setCursor(5);
+    assert(ring.nextMissing() == 5u);
+    assert(ring.nextMissing() == 6u);
+    assert(ring.nextMissing() == 4u);
+    assert(ring.nextMissing() == 7u);
+    assert(ring.nextMissing() == 3u);
+    assert(!ring.nextMissing());
+    assert(!ring.resident(1));
+    // 0 arrives late: its slot belongs to 5 now
+    assert(!ring.place(0));
+
+    ring.fail(6);
+    assert(ring.failed(6) && !ring.resident(6));
+    ring.setCursor(6);
+    assert(ring.nextMissing() == 8u);
+    assert(!ring.nextMissing());
+
+    ring.setCursor(100);
+    assert(ring.cursor() == 9);
+}
+
+static void marksRoundTrip()
+{
+    const fs::path folder = fs::temp_directory_path() / "photocrispy_culling_marks_test";
+    fs::remove_all(folder);
+    fs::create_directories(folder);
+    const fs::path sidecar = cullSidecarPath(folder);
+
+    assert(loadCullMarks(sidecar).empty());
+    CullMarks marks;
+    marks["DSC0001.ARW"] = CullMark{3, false};
+    marks["with space.nef"] = CullMark{0, true};
+    marks["unmarked.nef"] = CullMark{};
+    assert(saveCullMarks(sidecar, marks));
+
+    const CullMarks loaded = loadCullMarks(sidecar);
+    assert(loaded.size() == 2);
+    assert(loaded.at("DSC0001.ARW") == (CullMark{3, false}));
+    assert(loaded.at("with space.nef") == (CullMark{0, true}));
+
+    std::ofstream(sidecar) << "something else\n3 - DSC0001.ARW\n";
+    assert(loadCullMarks(sidecar).empty());
+    fs::remove_all(folder);
+}
+
+static void sessionFillsTheRingAndKeepsMarks()
+{
+    const fs::path folder = fs::temp_directory_path() / "photocrispy_culling_session_test";
+    fs::remove_all(folder);
+    fs::create_directories(folder);
+    std::vector<fs::path> files;
+    for (const char *name : {"a.stub", "b-fail.stub", "c.stub", "d.stub", "e.stub", "f.stub"})
+        files.push_back(folder / name);
+
+    DecoderRegistry decoders;
+    decoders.add(std::make_shared<StubPreviewBackend>());
+    MetricsRegistry metrics;
+    CullOptions options;
+    options.radius = 1;
+    options.maxEdge = 200;
+    options.dwellMs = 0.0;
+
+    {
+        CullSession session(decoders, metrics);
+        session.start(files, 0, options);
+        assert(session.active() && session.fileCount() == 6 && session.cursor() == 0);
+
+        auto pump = [&](size_t file) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (!session.residentSlot(file) && !session.previewFailed(file) &&
+                   std::chrono::steady_clock::now() < deadline)
+            {
+                session.update();
+                while (auto preview = session.takePreview())
+                {
+                    // Resampled to maxEdge, depth kept
+                    assert(preview->image.width == 200 && preview->image.height == 150);
+                    assert(!preview->image.is16Bit && preview->image.pixels8.size() == 200u * 150u * 3u);
+                    assert(preview->autoAdjust);
+                    assert(session.residentSlot(preview->file) == preview->slot);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        };
+        pump(0);
+        pump(1);
+        assert(session.residentSlot(0) && session.previewFailed(1));
+
+        // Dwell fires once per position
+        assert(session.takeDwell(std::chrono::steady_clock::now()));
+        assert(!session.takeDwell(std::chrono::steady_clock::now()));
+
+        // No preview for 1: a miss. 2 enters the window and is extracted.
+        assert(session.move(1));
+        assert(metrics.counter("cull.ring_misses").value() == 1);
+        pump(2);
+        assert(session.move(1) && session.currentFile() == files[2]);
+        assert(session.fileName(2) == "c.stub");
+        assert(metrics.counter("cull.ring_hits").value() == 1);
+        assert(session.takeDwell(std::chrono::steady_clock::now()));
+        assert(session.move(-10) && session.cursor() == 0);
+        assert(!session.move(-1));
+
+        assert(session.setRating(4));
+        assert(session.toggleReject());
+        assert(session.toggleReject());
+        assert(session.move(3));
+        assert(session.setRating(9));
+        session.stop();
+        assert(!session.active());
+
+        session.start(files, 0, options);
+        assert(session.mark(0) == (CullMark{4, false}));
+        assert(session.mark(3) == (CullMark{5, false}));
+        assert(session.mark(1) == CullMark{});
+    }
+    fs::remove_all(folder);
+}
+
+int main()
+{
+    ringHandsOutNearestFirst();
+    marksRoundTrip();
+    sessionFillsTheRingAndKeepsMarks();
+    return 0;
+}
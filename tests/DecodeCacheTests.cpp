@@ -0,0 +1,224 @@
+#include "DecodeCache.h"
+
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+static ImageData makeImage(int width, int height, int channels, unsigned seed, int noise)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> jitter(-noise, noise);
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.is16Bit = true;
+    image.pixels16.resize(static_cast<size_t>(width) * height * channels);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            for (int c = 0; c < channels; ++c)
+            {
+                const double smooth = 32768.0 + 30000.0 * std::sin(x * 0.01 * (c + 1)) * std::cos(y * 0.013);
+                const int value = static_cast<int>(smooth) + jitter(random);
+                image.pixels16[(static_cast<size_t>(y) * width + x) * channels + c] =
+                    static_cast<uint16_t>(std::clamp(value, 0, 65535));
+            }
+    return image;
+}
+
+static void codecRoundTripsAnyContent()
+{
+    const int sizes[][3] = {{1, 1, 3}, {31, 5, 3}, {33, 64, 3}, {200, 7, 4}, {64, 3, 1}};
+    for (const auto &size : sizes)
+    {
+        for (int noise : {0, 200, 40000})
+        {
+            const ImageData image = makeImage(size[0], size[1], size[2], 7, noise);
+            const std::vector<uint8_t> coded = encodeBand16(image.pixels16.data(), size[0], size[1], size[2]);
+            std::vector<uint16_t> decoded(image.pixels16.size());
+            assert(decodeBand16(coded.data(), coded.size(), size[0], size[1], size[2], decoded.data()));
+            assert(decoded == image.pixels16);
+        }
+    }
+
+    // Extremes: 0 next to 65535 in both directions.
+    std::vector<uint16_t> extremes = {0, 65535, 0, 65535, 65535, 0, 1, 65534};
+    const std::vector<uint8_t> coded = encodeBand16(extremes.data(), 4, 2, 1);
+    std::vector<uint16_t> decoded(extremes.size());
+    assert(decodeBand16(coded.data(), coded.size(), 4, 2, 1, decoded.data()));
+    assert(decoded == extremes);
+}
+
+static void codecCompressesSmoothImages()
+{
+    const ImageData image = makeImage(512, 64, 3, 1, 0);
+    const std::vector<uint8_t> coded = encodeBand16(image.pixels16.data(), 512, 64, 3);
+    assert(coded.size() * 2 < image.pixels16.size() * sizeof(uint16_t));
+}
+
+static void codecRejectsDamagedInput()
+{
+    const ImageData image = makeImage(100, 10, 3, 3, 100);
+    std::vector<uint8_t> coded = encodeBand16(image.pixels16.data(), 100, 10, 3);
+    std::vector<uint16_t> decoded(image.pixels16.size());
+    assert(!decodeBand16(coded.data(), coded.size() - 1, 100, 10, 3, decoded.data()));
+    coded.push_back(0);
+    assert(!decodeBand16(coded.data(), coded.size(), 100, 10, 3, decoded.data()));
+    coded.pop_back();
+    coded[0] = 17; // bit width out of range
+    assert(!decodeBand16(coded.data(), coded.size(), 100, 10, 3, decoded.data()));
+}
+
+static fs::path makeDirectory(const char *name)
+{
+    const fs::path directory = fs::temp_directory_path() / name;
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    return directory;
+}
+
+static std::string writeSource(const fs::path &directory, const char *name, const char *contents)
+{
+    const fs::path path = directory / name;
+    std::ofstream(path, std::ios::binary) << contents;
+    return path.string();
+}
+
+static void cacheRoundTripAndStaleness()
+{
+    const fs::path directory = makeDirectory("photocrispy_decode_cache");
+    const std::string source = writeSource(directory, "a.ARW", "raw bytes");
+    DecodeCache cache(directory / "cache", 1ull << 30);
+
+    // Several bands, last one partial.
+    const ImageData image = makeImage(300, 2 * kDecodeCacheBandRows + 5, 3, 5, 50);
+    assert(!cache.load(source, "libraw"));
+    assert(cache.store(source, "libraw", image));
+    assert(cache.sizeBytes() > 0);
+
+    const auto loaded = cache.load(source, "libraw");
+    assert(loaded && loaded->width == image.width && loaded->height == image.height);
+    assert(loaded->is16Bit && loaded->kind == ImageKind::Full && loaded->pixels16 == image.pixels16);
+
+    // Other decode parameters are a different entry.
+    assert(!cache.load(source, "bilinear"));
+
+    // 8-bit images are not cached.
+    ImageData eightBit;
+    eightBit.width = eightBit.height = 1;
+    eightBit.pixels8 = {1, 2, 3};
+    assert(!cache.store(source, "jpeg", eightBit));
+
+    // The source changed: stale entry is dropped.
+    std::ofstream(source, std::ios::binary | std::ios::app) << "edited";
+    assert(!cache.load(source, "libraw"));
+    assert(cache.sizeBytes() == 0);
+    fs::remove_all(directory);
+}
+
+static void damagedEntriesAreDeleted()
+{
+    const fs::path directory = makeDirectory("photocrispy_decode_cache_damaged");
+    const std::string source = writeSource(directory, "b.NEF", "raw bytes");
+    DecodeCache cache(directory / "cache", 1ull << 30);
+    assert(cache.store(source, "libraw", makeImage(64, 70, 3, 9, 10)));
+
+    for (const auto &entry : fs::directory_iterator(directory / "cache"))
+    {
+        std::fstream file(entry.path(), std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-5, std::ios::end);
+        file.put('\x7F');
+    }
+    assert(!cache.load(source, "libraw"));
+    assert(cache.sizeBytes() == 0);
+    fs::remove_all(directory);
+}
+
+// Header fields that disagree with the file are rejected before anything is
+// sized from them.
+static void oversizedHeadersAreRejected()
+{
+    const fs::path directory = makeDirectory("photocrispy_decode_cache_oversized");
+    const std::string source = writeSource(directory, "c.NEF", "raw bytes");
+    DecodeCache cache(directory / "cache", 1ull << 30);
+    const ImageData image = makeImage(64, 70, 3, 9, 10);
+
+    // Header: magic, version, source size, modified, parameters hash, then
+    // width, height, channels, band rows, band count.
+    auto patch = [&](int32_t width, int32_t height, uint32_t bandCount) {
+        assert(cache.store(source, "libraw", image));
+        for (const auto &entry : fs::directory_iterator(directory / "cache"))
+        {
+            std::fstream file(entry.path(), std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(32);
+            file.write(reinterpret_cast<const char *>(&width), 4);
+            file.write(reinterpret_cast<const char *>(&height), 4);
+            file.seekp(48);
+            file.write(reinterpret_cast<const char *>(&bandCount), 4);
+        }
+    };
+
+    // 100000 x 100000: the band table alone is bigger than the file
+    const int32_t huge = 100000;
+    patch(huge, huge, static_cast<uint32_t>((huge + kDecodeCacheBandRows - 1) / kDecodeCacheBandRows));
+    assert(!cache.load(source, "libraw"));
+    assert(cache.sizeBytes() == 0);
+
+    // Band table intact, rows far wider than the bands could hold (would
+    // be terabytes of pixels)
+    patch(1 << 30, image.height, static_cast<uint32_t>((image.height + kDecodeCacheBandRows - 1) / kDecodeCacheBandRows));
+    assert(!cache.load(source, "libraw"));
+    assert(cache.sizeBytes() == 0);
+
+    // Truncated: the last band ends past the end of the file
+    assert(cache.store(source, "libraw", image));
+    for (const auto &entry : fs::directory_iterator(directory / "cache"))
+        fs::resize_file(entry.path(), fs::file_size(entry.path()) - 10);
+    assert(!cache.load(source, "libraw"));
+    assert(cache.sizeBytes() == 0);
+    fs::remove_all(directory);
+}
+
+static void trimEvictsLeastRecentlyUsed()
+{
+    const fs::path directory = makeDirectory("photocrispy_decode_cache_lru");
+    DecodeCache cache(directory / "cache", 1ull << 30);
+    const ImageData image = makeImage(256, 64, 3, 11, 2000);
+
+    const std::string first = writeSource(directory, "1.CR2", "one");
+    const std::string second = writeSource(directory, "2.CR2", "two");
+    const std::string third = writeSource(directory, "3.CR2", "three");
+    assert(cache.store(first, "libraw", image));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert(cache.store(second, "libraw", image));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    // Reading the first makes the second the least recently used.
+    assert(cache.load(first, "libraw"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    const uint64_t entrySize = cache.sizeBytes() / 2;
+    cache.setBudgetBytes(entrySize * 2 + entrySize / 2);
+    assert(cache.store(third, "libraw", image));
+    assert(cache.load(first, "libraw"));
+    assert(!cache.load(second, "libraw"));
+    assert(cache.load(third, "libraw"));
+    fs::remove_all(directory);
+}
+
+int main()
+{
+    codecRoundTripsAnyContent();
+    codecCompressesSmoothImages();
+    codecRejectsDamagedInput();
+    cacheRoundTripAndStaleness();
+    damagedEntriesAreDeleted();
+    oversizedHeadersAreRejected();
+    trimEvictsLeastRecentlyUsed();
+    return 0;
+}
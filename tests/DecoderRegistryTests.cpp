@@ -0,0 +1,136 @@
+#include "DecoderBackend.h"
+#include "Parallel.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <thread>
+
+// Deterministic backend: fixed cost, optional failure, counts calls and the
+// most calls it saw running at once.
+class StubBackend : public DecoderBackend
+{
+public:
+    StubBackend(std::string name, std::string extension, DecodeOutput output, int cost, bool fails = false)
+        : m_name(std::move(name)), m_extension(std::move(extension)), m_output(output), m_cost(cost), m_fails(fails)
+    {
+    }
+
+    const char *name() const override { return m_name.c_str(); }
+    bool supports(const std::string &extension, DecodeOutput output) const override
+    {
+        return extension == m_extension && output == m_output;
+    }
+    int cost(const std::string &, DecodeOutput) const override { return m_cost; }
+    std::optional<ImageData> decode(const DecodeRequest &request) const override
+    {
+        ++calls;
+        const int running = ++m_running;
+        for (int seen = maxRunning; running > seen && !maxRunning.compare_exchange_weak(seen, running);)
+        {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        --m_running;
+        if (m_fails)
+            return std::nullopt;
+
+        // Width encodes the request so results can be matched to inputs.
+        ImageData image;
+        image.width = static_cast<int>(request.path.size());
+        image.height = m_cost;
+        return image;
+    }
+
+    mutable std::atomic<int> calls{0};
+    mutable std::atomic<int> maxRunning{0};
+
+private:
+    std::string m_name;
+    std::string m_extension;
+    DecodeOutput m_output;
+    int m_cost;
+    bool m_fails;
+    mutable std::atomic<int> m_running{0};
+};
+
+static std::vector<std::string> names(const std::vector<std::shared_ptr<const DecoderBackend>> &backends)
+{
+    std::vector<std::string> result;
+    for (const auto &backend : backends)
+        result.push_back(backend->name());
+    return result;
+}
+
+static void routesByExtensionOutputAndCost()
+{
+    DecoderRegistry registry;
+    registry.add(std::make_shared<StubBackend>("slow", ".arw", DecodeOutput::Full, 100));
+    registry.add(std::make_shared<StubBackend>("fast", ".arw", DecodeOutput::Full, 10));
+    registry.add(std::make_shared<StubBackend>("preview", ".arw", DecodeOutput::Preview, 1));
+    registry.add(std::make_shared<StubBackend>("nef", ".nef", DecodeOutput::Full, 1));
+
+    assert(decodeExtension("/photos/DSC001.ARW") == ".arw");
+    assert((names(registry.route({"a/DSC001.ARW", DecodeOutput::Full, 0, {}})) ==
+            std::vector<std::string>{"fast", "slow"}));
+    assert((names(registry.route({"a.arw", DecodeOutput::Preview, 0, {}})) == std::vector<std::string>{"preview"}));
+    assert(registry.route({"a.cr3", DecodeOutput::Full, 0, {}}).empty());
+    assert(!registry.decode({"a.cr3", DecodeOutput::Full, 0, {}}));
+
+    // The request's choice, then preferences, then cost.
+    assert((names(registry.route({"a.arw", DecodeOutput::Full, 0, "slow"})) ==
+            std::vector<std::string>{"slow", "fast"}));
+    registry.prefer("*", DecodeOutput::Full, "slow");
+    assert(names(registry.route({"a.arw", DecodeOutput::Full, 0, {}})).front() == "slow");
+    registry.prefer(".arw", DecodeOutput::Full, "fast");
+    registry.prefer("*", DecodeOutput::Full, "slow");
+    assert(names(registry.route({"a.arw", DecodeOutput::Full, 0, {}})).front() == "fast");
+    assert(registry.find("nef") && !registry.find("missing"));
+}
+
+static void fallsBackWhenABackendFails()
+{
+    DecoderRegistry registry;
+    auto broken = std::make_shared<StubBackend>("broken", ".raf", DecodeOutput::Full, 1, true);
+    auto working = std::make_shared<StubBackend>("working", ".raf", DecodeOutput::Full, 50);
+    registry.add(broken);
+    registry.add(working);
+
+    const auto image = registry.decode({"x.raf", DecodeOutput::Full, 0, {}});
+    assert(image && image->height == 50);
+    assert(broken->calls == 1 && working->calls == 1);
+}
+
+static void decodesConcurrently()
+{
+    DecoderRegistry registry;
+    auto backend = std::make_shared<StubBackend>("stub", ".dng", DecodeOutput::Preview, 7);
+    registry.add(backend);
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < 64; ++i)
+        paths.push_back(std::string(static_cast<size_t>(i + 1), 'p') + ".dng");
+
+    std::vector<int> widths(paths.size(), -1);
+    parallelFor(
+        0, static_cast<int>(paths.size()), 1,
+        [&](int begin, int end) {
+            for (int i = begin; i < end; ++i)
+                if (auto image = registry.decode({paths[i], DecodeOutput::Preview, 0, {}}))
+                    widths[i] = image->width;
+        },
+        8);
+
+    for (size_t i = 0; i < paths.size(); ++i)
+        assert(widths[i] == static_cast<int>(paths[i].size()));
+    assert(backend->calls == 64);
+    assert(backend->maxRunning > 1);
+}
+
+int main()
+{
+    routesByExtensionOutputAndCost();
+    fallsBackWhenABackendFails();
+    decodesConcurrently();
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include "Demosaic.h"
+#include "Parallel.h"
+
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+// Smooth test scene with some colour: every channel is a different low
+// frequency wave, so a correct demosaic recovers it almost exactly.
+static ImageData makeScene(int width, int height)
+{
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.channels = 3;
+    image.is16Bit = true;
+    image.pixels16.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            const double values[3] = {
+                0.5 + 0.4 * std::sin(x * 0.05) * std::cos(y * 0.03),
+                0.5 + 0.4 * std::cos((x + y) * 0.02),
+                0.5 + 0.4 * std::sin(y * 0.04 + 1.0),
+            };
+            for (int c = 0; c < 3; ++c)
+                image.pixels16[(static_cast<size_t>(y) * width + x) * 3 + c] =
+                    static_cast<uint16_t>(std::lround(values[c] * 65535.0));
+        }
+    return image;
+}
+
+// Keeps one channel per pixel, as a sensor behind the given CFA would.
+static RawMosaic mosaicScene(const ImageData &scene, int patternSize, const uint8_t *pattern)
+{
+    RawMosaic mosaic;
+    mosaic.width = scene.width;
+    mosaic.height = scene.height;
+    mosaic.patternWidth = patternSize;
+    mosaic.patternHeight = patternSize;
+    for (int i = 0; i < patternSize * patternSize; ++i)
+        mosaic.pattern[i] = pattern[i];
+
+    mosaic.pixels.resize(static_cast<size_t>(scene.width) * scene.height);
+    for (int y = 0; y < scene.height; ++y)
+        for (int x = 0; x < scene.width; ++x)
+        {
+            const size_t index = static_cast<size_t>(y) * scene.width + x;
+            mosaic.pixels[index] = scene.pixels16[index * 3 + mosaicColor(mosaic, y, x)];
+        }
+    return mosaic;
+}
+
+static const uint8_t kRggb[4] = {0, 1, 1, 2};
+
+static const uint8_t kXTrans[36] = {
+    1, 1, 0, 1, 1, 2, //
+    1, 1, 2, 1, 1, 0, //
+    2, 0, 1, 0, 2, 1, //
+    1, 1, 2, 1, 1, 0, //
+    1, 1, 0, 1, 1, 2, //
+    0, 2, 1, 2, 0, 1, //
+};
+
+static void parallelForVisitsEveryIndexOnce()
+{
+    std::vector<std::atomic<int>> visits(1000);
+    parallelFor(0, 1000, 7, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            ++visits[i];
+    });
+    for (const auto &count : visits)
+        assert(count == 1);
+
+    bool called = false;
+    parallelFor(5, 5, 1, [&](int, int) { called = true; });
+    assert(!called);
+}
+
+static void bayerReconstructsSmoothScene()
+{
+    const ImageData scene = makeScene(300, 200);
+    const RawMosaic mosaic = mosaicScene(scene, 2, kRggb);
+
+    DemosaicOptions options;
+    options.applyGamma = false;
+
+    options.quality = DemosaicQuality::Bilinear;
+    const ImageData bilinear = demosaicMosaic(mosaic, options);
+    assert(bilinear.width == 300 && bilinear.height == 200 && bilinear.is16Bit);
+    assert(imagePsnr(bilinear, scene) > 50.0);
+
+    options.quality = DemosaicQuality::EdgeDirected;
+    const ImageData edgeDirected = demosaicMosaic(mosaic, options);
+    assert(imagePsnr(edgeDirected, scene) > 50.0);
+}
+
+static void xtransFallsBackToBilinear()
+{
+    const ImageData scene = makeScene(240, 180);
+    const RawMosaic mosaic = mosaicScene(scene, 6, kXTrans);
+
+    DemosaicOptions options;
+    options.applyGamma = false;
+    const ImageData result = demosaicMosaic(mosaic, options);
+    assert(imagePsnr(result, scene) > 45.0);
+}
+
+static void tilingDoesNotChangeTheResult()
+{
+    const ImageData scene = makeScene(197, 133);
+    const RawMosaic mosaic = mosaicScene(scene, 2, kRggb);
+
+    DemosaicOptions single;
+    single.tileSize = 1024;
+    single.threads = 1;
+    DemosaicOptions tiled;
+    tiled.tileSize = 32;
+    tiled.threads = 4;
+
+    const ImageData a = demosaicMosaic(mosaic, single);
+    const ImageData b = demosaicMosaic(mosaic, tiled);
+    assert(a.pixels16 == b.pixels16);
+}
+
+static void levelsAndWhiteBalanceAreApplied()
+{
+    // Flat grey behind black 1000 / white 5000, blue channel at half level.
+    RawMosaic mosaic;
+    mosaic.width = 16;
+    mosaic.height = 16;
+    mosaic.black[0] = mosaic.black[1] = mosaic.black[2] = 1000.0f;
+    mosaic.white = 5000.0f;
+    mosaic.whiteBalance[2] = 2.0f;
+    mosaic.pixels.resize(16 * 16);
+    for (int y = 0; y < 16; ++y)
+        for (int x = 0; x < 16; ++x)
+            mosaic.pixels[y * 16 + x] = mosaicColor(mosaic, y, x) == 2 ? 2000 : 3000;
+
+    DemosaicOptions options;
+    options.applyGamma = false;
+    const ImageData result = demosaicMosaic(mosaic, options);
+    for (size_t i = 0; i < result.pixels16.size(); ++i)
+        assert(std::abs(result.pixels16[i] - 32768) < 2);
+}
+
+static void psnrOfIdenticalImagesIsInfinite()
+{
+    const ImageData scene = makeScene(8, 8);
+    assert(std::isinf(imagePsnr(scene, scene)));
+
+    ImageData other = scene;
+    other.width = 4;
+    assert(imagePsnr(scene, other) == 0.0);
+}
+
+int main()
+{
+    parallelForVisitsEveryIndexOnce();
+    bayerReconstructsSmoothScene();
+    xtransFallsBackToBilinear();
+    tilingDoesNotChangeTheResult();
+    levelsAndWhiteBalanceAreApplied();
+    psnrOfIdenticalImagesIsInfinite();
+    return 0;
+}
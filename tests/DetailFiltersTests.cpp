@@ -0,0 +1,234 @@
+#include "DetailFilters.h"
+
+#include <cassert>
+#include <cmath>
+#include <random>
+
+static DevelopImage makeImage(int width, int height, float r, float g, float b)
+{
+    DevelopImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 3);
+    for (size_t i = 0; i < image.pixels.size(); i += 3)
+    {
+        image.pixels[i + 0] = r;
+        image.pixels[i + 1] = g;
+        image.pixels[i + 2] = b;
+    }
+    return image;
+}
+
+// Left half dark, right half bright, with gaussian noise on every channel
+// (colour noise) and on top of that, optionally, the same on all three (luma).
+static DevelopImage makeNoisyEdge(int width, int height, float colourNoise, float lumaNoise)
+{
+    std::mt19937 random(11);
+    std::normal_distribution<float> colour(0.0f, colourNoise);
+    std::normal_distribution<float> luma(0.0f, lumaNoise);
+    DevelopImage image = makeImage(width, height, 0.0f, 0.0f, 0.0f);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            float *rgb = &image.pixels[(static_cast<size_t>(y) * width + x) * 3];
+            const float level = x < width / 2 ? 0.2f : 0.8f;
+            const float shared = lumaNoise > 0.0f ? luma(random) : 0.0f;
+            for (int c = 0; c < 3; ++c)
+                rgb[c] = level + shared + (colourNoise > 0.0f ? colour(random) : 0.0f);
+        }
+    return image;
+}
+
+static DevelopImage run(void (*filter)(const DevelopSettings &, const DevelopImage &, DevelopImage &,
+                                      const DetailFilterOptions &),
+                        const DevelopSettings &settings, const DevelopImage &source,
+                        const DetailFilterOptions &options = {})
+{
+    DevelopImage result = makeImage(source.width, source.height, -1.0f, -1.0f, -1.0f);
+    filter(settings, source, result, options);
+    return result;
+}
+
+// Mean absolute difference of the channels from their mean
+// (colour noise) over columns [x0, x1).
+static float chromaSpread(const DevelopImage &image, int x0, int x1)
+{
+    double total = 0.0;
+    int count = 0;
+    for (int y = 0; y < image.height; ++y)
+        for (int x = x0; x < x1; ++x)
+        {
+            const float *rgb = &image.pixels[(static_cast<size_t>(y) * image.width + x) * 3];
+            const float mean = (rgb[0] + rgb[1] + rgb[2]) / 3.0f;
+            for (int c = 0; c < 3; ++c)
+                total += std::abs(rgb[c] - mean);
+            count += 3;
+        }
+    return static_cast<float>(total / count);
+}
+
+static float lumaSpread(const DevelopImage &image, int x0, int x1, float level)
+{
+    double total = 0.0;
+    int count = 0;
+    for (int y = 0; y < image.height; ++y)
+        for (int x = x0; x < x1; ++x)
+        {
+            const float *rgb = &image.pixels[(static_cast<size_t>(y) * image.width + x) * 3];
+            total += std::abs((rgb[0] + 2.0f * rgb[1] + rgb[2]) * 0.25f - level);
+            ++count;
+        }
+    return static_cast<float>(total / count);
+}
+
+static float maxDifference(const DevelopImage &a, const DevelopImage &b)
+{
+    float result = 0.0f;
+    for (size_t i = 0; i < a.pixels.size(); ++i)
+        result = std::max(result, std::abs(a.pixels[i] - b.pixels[i]));
+    return result;
+}
+
+static void offCopiesAndFlatStaysFlat()
+{
+    const DevelopImage flat = makeImage(70, 50, 0.3f, 0.5f, 0.7f);
+    DevelopSettings settings;
+    assert(!detailFiltersActive(settings));
+    assert(maxDifference(run(reduceNoise, settings, flat), flat) == 0.0f);
+    assert(maxDifference(run(sharpen, settings, flat), flat) == 0.0f);
+
+    settings.lumaNoise = 1.0f;
+    settings.chromaNoise = 1.0f;
+    settings.sharpenAmount = 2.0f;
+    assert(detailFiltersActive(settings));
+    assert(maxDifference(run(reduceNoise, settings, flat), flat) < 1e-5f);
+    assert(maxDifference(run(sharpen, settings, flat), flat) < 1e-5f);
+}
+
+static void removesColourNoiseKeepsEdge()
+{
+    const DevelopImage noisy = makeNoisyEdge(160, 120, 0.03f, 0.0f);
+    DevelopSettings settings;
+    settings.chromaNoise = 1.0f;
+    const DevelopImage result = run(reduceNoise, settings, noisy);
+    assert(chromaSpread(result, 0, 80) < chromaSpread(noisy, 0, 80) * 0.4f);
+    // The edge stays where it was: no bright pixels left of it, no dark ones
+    // right of it.
+    for (int y = 0; y < result.height; ++y)
+    {
+        const float *left = &result.pixels[(static_cast<size_t>(y) * result.width + 79) * 3];
+        const float *right = &result.pixels[(static_cast<size_t>(y) * result.width + 80) * 3];
+        assert((left[0] + 2.0f * left[1] + left[2]) * 0.25f < 0.35f);
+        assert((right[0] + 2.0f * right[1] + right[2]) * 0.25f > 0.65f);
+    }
+}
+
+static void removesLumaNoise()
+{
+    const DevelopImage noisy = makeNoisyEdge(160, 120, 0.0f, 0.02f);
+    DevelopSettings settings;
+    settings.lumaNoise = 1.0f;
+    const DevelopImage result = run(reduceNoise, settings, noisy);
+    assert(lumaSpread(result, 0, 70, 0.2f) < lumaSpread(noisy, 0, 70, 0.2f) * 0.6f);
+    assert(lumaSpread(result, 90, 160, 0.8f) < lumaSpread(noisy, 90, 160, 0.8f) * 0.6f);
+    // Luma only: the channels move together.
+    assert(chromaSpread(result, 0, 160) < 1e-5f);
+}
+
+static void sharpensEdgesNotNoise()
+{
+    const DevelopImage edge = makeNoisyEdge(64, 16, 0.0f, 0.0f);
+    DevelopSettings settings;
+    settings.sharpenAmount = 1.0f;
+    settings.sharpenRadius = 1.5f;
+    settings.sharpenThreshold = 0.01f;
+    const DevelopImage result = run(sharpen, settings, edge);
+    const float *dark = &result.pixels[(8 * 64 + 31) * 3];
+    const float *bright = &result.pixels[(8 * 64 + 32) * 3];
+    // Overshoot on both sides of the edge
+    assert(dark[1] < 0.15f && bright[1] > 0.85f);
+    // Flat areas away from the edge are untouched
+    assert(std::abs(result.pixels[(8 * 64 + 2) * 3 + 1] - 0.2f) < 1e-5f);
+
+    // Fine noise below the threshold is left alone, the edge is not.
+    const DevelopImage noisy = makeNoisyEdge(64, 16, 0.0f, 0.002f);
+    settings.sharpenThreshold = 0.05f;
+    const DevelopImage quiet = run(sharpen, settings, noisy);
+    for (int y = 0; y < 16; ++y)
+        for (int x = 0; x < 64; ++x)
+        {
+            const size_t i = (static_cast<size_t>(y) * 64 + x) * 3;
+            const float change = std::abs(quiet.pixels[i] - noisy.pixels[i]);
+            assert(std::abs(x - 32) < 4 || change < 1e-6f);
+        }
+    assert(quiet.pixels[(8 * 64 + 32) * 3] > noisy.pixels[(8 * 64 + 32) * 3] + 0.05f);
+}
+
+// Tile borders and thread count must not show in the result.
+static void tilingDoesNotChangeTheResult()
+{
+    const DevelopImage noisy = makeNoisyEdge(203, 97, 0.03f, 0.02f);
+    DevelopSettings settings;
+    settings.lumaNoise = 0.7f;
+    settings.chromaNoise = 0.5f;
+    settings.sharpenAmount = 0.8f;
+
+    DetailFilterOptions untiled;
+    untiled.tileSize = 4096;
+    untiled.threads = 1;
+    DetailFilterOptions tiled;
+    tiled.tileSize = 32;
+    tiled.threads = 4;
+    assert(maxDifference(run(reduceNoise, settings, noisy, untiled), run(reduceNoise, settings, noisy, tiled)) <
+           1e-6f);
+    assert(maxDifference(run(sharpen, settings, noisy, untiled), run(sharpen, settings, noisy, tiled)) < 1e-6f);
+}
+
+// Each detail stage is a cached pass: moving a sharpening slider only runs
+// the sharpening pass again.
+static void pipelineRerunsOnlyChangedStage()
+{
+    DevelopPipeline pipeline = makeDetailDevelopPipeline();
+    assert(pipeline.stages().size() == 4);
+    assert(pipeline.passes().size() == 3);
+
+    const DevelopImage noisy = makeNoisyEdge(64, 48, 0.02f, 0.01f);
+    DevelopSettings settings;
+    settings.chromaNoise = 0.5f;
+    pipeline.process(noisy, 1, settings);
+    assert(pipeline.lastExecutedPasses() == 3);
+
+    settings.sharpenAmount = 0.5f;
+    const DevelopImage sharpened = pipeline.process(noisy, 1, settings);
+    assert(pipeline.lastExecutedPasses() == 1);
+
+    settings.lumaNoise = 0.5f;
+    pipeline.process(noisy, 1, settings);
+    assert(pipeline.lastExecutedPasses() == 2);
+
+    settings.lumaNoise = 0.0f;
+    assert(maxDifference(pipeline.process(noisy, 1, settings), sharpened) == 0.0f);
+}
+
+static void proxyScaleShrinksKernels()
+{
+    DevelopSettings settings;
+    settings.lumaNoise = 1.0f;
+    settings.sharpenAmount = 1.0f;
+    settings.sharpenRadius = 2.0f;
+    assert(noiseReductionKernel(settings, 0.25f).lumaRadius < noiseReductionKernel(settings).lumaRadius);
+    assert(sharpenKernel(settings).radius == 6);
+    assert(sharpenKernel(settings, 0.5f).radius == 3);
+}
+
+int main()
+{
+    offCopiesAndFlatStaysFlat();
+    removesColourNoiseKeepsEdge();
+    removesLumaNoise();
+    sharpensEdgesNotNoise();
+    tilingDoesNotChangeTheResult();
+    pipelineRerunsOnlyChangedStage();
+    proxyScaleShrinksKernels();
+    return 0;
+}
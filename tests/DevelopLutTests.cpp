@@ -0,0 +1,76 @@
+#include "DevelopLut.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+static std::vector<float> makeColours(size_t count)
+{
+    std::vector<float> colours(count * 3);
+    std::srand(7);
+    for (float &value : colours)
+        value = static_cast<float>(std::rand()) / static_cast<float>(RAND_MAX);
+    return colours;
+}
+
+static void identityLutReturnsInput()
+{
+    const DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+    const DevelopLut lut = bakeDevelopLut(pipeline, DevelopSettings{}, 17);
+    assert(lut.size == 17);
+    assert(lut.rgba.size() == 17u * 17u * 17u * 4u);
+
+    const std::vector<float> colours = makeColours(256);
+    std::vector<float> result(colours.size());
+    applyDevelopLut(lut, colours.data(), result.data(), 256);
+    for (size_t i = 0; i < colours.size(); ++i)
+        assert(std::fabs(result[i] - colours[i]) < 1e-5f);
+}
+
+static void lutMatchesDirectEvaluation()
+{
+    const DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+    DevelopSettings settings;
+    settings.exposure = 0.7f;
+    settings.whiteBalance[0] = 1.3f;
+    settings.whiteBalance[2] = 0.6f;
+
+    const DevelopLut lut = bakeDevelopLut(pipeline, settings, 33);
+    std::vector<float> direct = makeColours(1024);
+    std::vector<float> viaLut(direct.size());
+    applyDevelopLut(lut, direct.data(), viaLut.data(), 1024);
+    pipeline.applyPerPixelPass(0, settings, direct.data(), 1024);
+
+    for (size_t i = 0; i < direct.size(); ++i)
+        assert(std::fabs(direct[i] - viaLut[i]) < 1e-4f);
+}
+
+static void bakerCachesByParameters()
+{
+    DevelopLutBaker baker(makeDefaultDevelopPipeline(), 9);
+    DevelopSettings settings;
+
+    assert(baker.request(settings) == nullptr);
+    baker.wait();
+    auto first = baker.request(settings);
+    assert(first != nullptr);
+    assert(baker.request(settings) == first);
+
+    settings.exposure = 1.0f;
+    assert(baker.request(settings) == nullptr);
+    baker.wait();
+    auto second = baker.request(settings);
+    assert(second != nullptr && second != first);
+
+    settings.exposure = 0.0f;
+    assert(baker.request(settings) == first);
+}
+
+int main()
+{
+    identityLutReturnsInput();
+    lutMatchesDirectEvaluation();
+    bakerCachesByParameters();
+    return 0;
+}
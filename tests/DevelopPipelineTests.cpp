@@ -0,0 +1,131 @@
+#include "DevelopPipeline.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <string>
+
+static DevelopImage makeImage(float value)
+{
+    DevelopImage image;
+    image.width = 4;
+    image.height = 2;
+    image.pixels.assign(4 * 2 * 3, value);
+    return image;
+}
+
+// Neighborhood stage that averages each pixel with its right neighbour.
+static DevelopStage makeBlurStage(int *runCount)
+{
+    DevelopStage blur;
+    blur.name = "Blur";
+    blur.kind = DevelopStageKind::Neighborhood;
+    blur.parameterHash = [](const DevelopSettings &) { return uint64_t{0}; };
+    blur.applyImage = [runCount](const DevelopSettings &, const DevelopImage &source, DevelopImage &destination) {
+        ++*runCount;
+        for (int y = 0; y < source.height; ++y)
+            for (int x = 0; x < source.width; ++x)
+                for (int c = 0; c < 3; ++c)
+                {
+                    const int right = std::min(x + 1, source.width - 1);
+                    const size_t here = (static_cast<size_t>(y) * source.width + x) * 3 + c;
+                    const size_t next = (static_cast<size_t>(y) * source.width + right) * 3 + c;
+                    destination.pixels[here] = 0.5f * (source.pixels[here] + source.pixels[next]);
+                }
+    };
+    return blur;
+}
+
+static void adjacentPerPixelStagesAreFused()
+{
+    DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+    assert(pipeline.stages().size() == 2);
+    assert(pipeline.passes().size() == 1);
+    assert(pipeline.passes()[0].stageCount == 2);
+
+    int blurRuns = 0;
+    pipeline.addStage(makeBlurStage(&blurRuns));
+    assert(pipeline.passes().size() == 2);
+    assert(pipeline.passes()[1].kind == DevelopStageKind::Neighborhood);
+}
+
+static void generatedShaderContainsEveryFusedStage()
+{
+    const DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+    const std::string source = pipeline.fragmentShaderSource(
+        "// @DEVELOP_DECLARATIONS@\nvoid main(){\n// @DEVELOP_BODY@\n}", 0);
+
+    assert(source.find("uniform float exposure;") != std::string::npos);
+    assert(source.find("uniform vec3 whiteBalance;") != std::string::npos);
+    assert(source.find("color *= exp2(exposure);") < source.find("color *= whiteBalance;"));
+    assert(source.find("@DEVELOP_") == std::string::npos);
+}
+
+static void uniformsFollowSettings()
+{
+    const DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+    DevelopSettings settings;
+    settings.exposure = 1.5f;
+    settings.whiteBalance[2] = 0.25f;
+
+    const std::vector<DevelopUniform> uniforms = pipeline.uniforms(settings, 0);
+    assert(uniforms.size() == 2);
+    assert(uniforms[0].name == "exposure" && uniforms[0].values[0] == 1.5f);
+    assert(uniforms[1].name == "whiteBalance" && uniforms[1].components == 3);
+    assert(uniforms[1].values[2] == 0.25f);
+}
+
+static void cpuPathMatchesShaderMath()
+{
+    DevelopPipeline pipeline = makeDefaultDevelopPipeline();
+    DevelopSettings settings;
+    settings.exposure = 1.0f;
+    settings.whiteBalance[0] = 0.5f;
+
+    const DevelopImage &result = pipeline.process(makeImage(0.25f), 1, settings);
+    assert(std::fabs(result.pixels[0] - 0.25f) < 1e-6f);
+    assert(std::fabs(result.pixels[1] - 0.5f) < 1e-6f);
+    assert(pipeline.lastExecutedPasses() == 1);
+}
+
+static void onlyPassesAfterTheChangeAreRecomputed()
+{
+    int blurRuns = 0;
+    DevelopPipeline pipeline;
+    pipeline.addStage(makeBlurStage(&blurRuns));
+    const DevelopPipeline defaults = makeDefaultDevelopPipeline();
+    for (const DevelopStage &stage : defaults.stages())
+        pipeline.addStage(stage);
+
+    const DevelopImage source = makeImage(0.5f);
+    DevelopSettings settings;
+
+    pipeline.process(source, 1, settings);
+    assert(blurRuns == 1);
+    assert(pipeline.lastExecutedPasses() == 2);
+
+    // Same inputs: nothing runs.
+    pipeline.process(source, 1, settings);
+    assert(pipeline.lastExecutedPasses() == 0);
+
+    // Exposure sits after the blur, so the cached blur output is reused.
+    settings.exposure = 2.0f;
+    pipeline.process(source, 1, settings);
+    assert(blurRuns == 1);
+    assert(pipeline.lastExecutedPasses() == 1);
+
+    // A new source revision re-runs everything.
+    pipeline.process(source, 2, settings);
+    assert(blurRuns == 2);
+    assert(pipeline.lastExecutedPasses() == 2);
+}
+
+int main()
+{
+    adjacentPerPixelStagesAreFused();
+    generatedShaderContainsEveryFusedStage();
+    uniformsFollowSettings();
+    cpuPathMatchesShaderMath();
+    onlyPassesAfterTheChangeAreRecomputed();
+    return 0;
+}
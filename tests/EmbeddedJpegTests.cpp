@@ -0,0 +1,210 @@
+#include "EmbeddedJpeg.h"
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// Little helper that lays out TIFF/RAF structures byte by byte.
+struct FileBuilder
+{
+    std::vector<uint8_t> bytes;
+    bool bigEndian = false;
+
+    size_t size() const { return bytes.size(); }
+
+    void u8(uint8_t value) { bytes.push_back(value); }
+
+    void u16(uint16_t value)
+    {
+        if (bigEndian)
+        {
+            u8(value >> 8);
+            u8(value & 0xFF);
+        }
+        else
+        {
+            u8(value & 0xFF);
+            u8(value >> 8);
+        }
+    }
+
+    void u32(uint32_t value)
+    {
+        if (bigEndian)
+        {
+            u16(value >> 16);
+            u16(value & 0xFFFF);
+        }
+        else
+        {
+            u16(value & 0xFFFF);
+            u16(value >> 16);
+        }
+    }
+
+    void entry(uint16_t tag, uint16_t type, uint32_t count, uint32_t value)
+    {
+        u16(tag);
+        u16(type);
+        u32(count);
+        if (type == 3 && count == 1)
+        {
+            u16(static_cast<uint16_t>(value));
+            u16(0);
+        }
+        else
+        {
+            u32(value);
+        }
+    }
+
+    // SOI, an APP segment, the frame header and padding up to length.
+    void jpeg(uint8_t frameMarker, size_t length)
+    {
+        const size_t start = size();
+        const uint8_t header[] = {0xFF, 0xD8, 0xFF, 0xE1, 0x00, 0x04, 0x00, 0x00, 0xFF, frameMarker, 0x00, 0x02};
+        bytes.insert(bytes.end(), std::begin(header), std::end(header));
+        while (size() - start < length)
+            u8(0);
+    }
+};
+
+// IFD0: JPEGInterchangeFormat preview, SubIFD: lossless raw strip and
+// a larger baseline JPEG strip.
+static std::vector<uint8_t> makeTiff(bool bigEndian)
+{
+    FileBuilder file;
+    file.bigEndian = bigEndian;
+    file.u8(bigEndian ? 'M' : 'I');
+    file.u8(bigEndian ? 'M' : 'I');
+    file.u16(42);
+    file.u32(8);
+
+    // IFD0 at 8: 3 entries
+    const uint32_t subIfds = 8 + 2 + 3 * 12 + 4; // 50, two offsets
+    const uint32_t rawIfd = subIfds + 8;          // 58
+    const uint32_t previewIfd = rawIfd + 2 + 4 * 12 + 4;
+    const uint32_t smallJpeg = previewIfd + 2 + 4 * 12 + 4;
+    const uint32_t rawStrip = smallJpeg + 100;
+    const uint32_t largeJpeg = rawStrip + 400;
+
+    file.u16(3);
+    file.entry(0x014A, 4, 2, subIfds);
+    file.entry(0x0201, 4, 1, smallJpeg);
+    file.entry(0x0202, 4, 1, 100);
+    file.u32(0);
+
+    file.u32(rawIfd);
+    file.u32(previewIfd);
+
+    // Raw data: lossless JPEG (SOF3), must be skipped.
+    file.u16(4);
+    file.entry(0x0103, 3, 1, 7);
+    file.entry(0x0106, 3, 1, 32803);
+    file.entry(0x0111, 4, 1, rawStrip);
+    file.entry(0x0117, 4, 1, 400);
+    file.u32(0);
+
+    // Large preview stored as a JPEG strip.
+    file.u16(4);
+    file.entry(0x0103, 3, 1, 7);
+    file.entry(0x0106, 3, 1, 6);
+    file.entry(0x0111, 4, 1, largeJpeg);
+    file.entry(0x0117, 4, 1, 300);
+    file.u32(0);
+
+    assert(file.size() == smallJpeg);
+    file.jpeg(0xC0, 100);
+    file.jpeg(0xC3, 400);
+    file.jpeg(0xC2, 300);
+    return file.bytes;
+}
+
+static void tiffPreviewsAreFoundLargestFirst()
+{
+    for (bool bigEndian : {false, true})
+    {
+        const std::vector<uint8_t> file = makeTiff(bigEndian);
+        const std::vector<ByteRange> jpegs = findEmbeddedJpegs(file.data(), file.size());
+        assert(jpegs.size() == 2);
+        assert(jpegs[0].length == 300);
+        assert(jpegs[1].length == 100);
+        assert(file[jpegs[0].offset] == 0xFF && file[jpegs[0].offset + 1] == 0xD8);
+    }
+}
+
+static void rafHeaderPointsAtTheJpeg()
+{
+    FileBuilder file;
+    file.bigEndian = true;
+    const char magic[] = "FUJIFILMCCD-RAW 0201FF383501";
+    file.bytes.assign(magic, magic + sizeof(magic) - 1);
+    while (file.size() < 84)
+        file.u8(0);
+    file.u32(160);
+    file.u32(64);
+    while (file.size() < 160)
+        file.u8(0);
+    file.jpeg(0xC0, 64);
+
+    const std::vector<ByteRange> jpegs = findEmbeddedJpegs(file.bytes.data(), file.size());
+    assert(jpegs.size() == 1);
+    assert(jpegs[0].offset == 160 && jpegs[0].length == 64);
+}
+
+static void unknownAndBrokenFilesGiveNothing()
+{
+    const uint8_t unknown[32] = {'f', 't', 'y', 'p'};
+    assert(findEmbeddedJpegs(unknown, sizeof(unknown)).empty());
+
+    // Truncated TIFF.
+    std::vector<uint8_t> file = makeTiff(false);
+    file.resize(40);
+    assert(findEmbeddedJpegs(file.data(), file.size()).empty());
+
+    // IFD that points back at itself.
+    FileBuilder loop;
+    loop.u8('I');
+    loop.u8('I');
+    loop.u16(42);
+    loop.u32(8);
+    loop.u16(1);
+    loop.entry(0x0100, 4, 1, 1);
+    loop.u32(8);
+    assert(findEmbeddedJpegs(loop.bytes.data(), loop.size()).empty());
+}
+
+static void fileReaderReadsOnlyTheJpegRange()
+{
+    const std::vector<uint8_t> file = makeTiff(false);
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "photocrispy_embedded_jpeg.tif";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(file.data()), static_cast<std::streamsize>(file.size()));
+    }
+
+    const std::vector<uint8_t> largest = readEmbeddedJpeg(path.string());
+    assert(largest.size() == 300);
+    assert(largest[0] == 0xFF && largest[1] == 0xD8 && largest[9] == 0xC2);
+
+    const std::vector<uint8_t> small = readEmbeddedJpeg(path.string(), 200);
+    assert(small.size() == 100);
+
+    uint8_t beyondEnd[4];
+    const FileRangeReader reader(path.string());
+    assert(reader.isOpen());
+    assert(!reader.read(file.size() - 2, sizeof(beyondEnd), beyondEnd));
+
+    std::filesystem::remove(path);
+    assert(readEmbeddedJpeg(path.string()).empty());
+}
+
+int main()
+{
+    tiffPreviewsAreFoundLargestFirst();
+    rafHeaderPointsAtTheJpeg();
+    unknownAndBrokenFilesGiveNothing();
+    fileReaderReadsOnlyTheJpegRange();
+    return 0;
+}
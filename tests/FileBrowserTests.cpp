@@ -6,5 +6,8 @@ int main()
 {
     FileBrowser browser;
     assert(!browser.Refresh("this-directory-must-not-exist"));
+    assert(!browser.AddFile("captures/notes.txt"));
+    assert(browser.AddFile("captures/DSC0001.ARW"));
+    assert(browser.AddFile("captures/DSC0001.ARW"));
     return 0;
 }
@@ -0,0 +1,108 @@
+#include "FolderWatcher.h"
+
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static fs::path testFolder()
+{
+    const fs::path folder = fs::temp_directory_path() / "photocrispy_folder_watcher_test";
+    fs::remove_all(folder);
+    fs::create_directories(folder);
+    return folder;
+}
+
+static void write(const fs::path &path, const char *contents)
+{
+    std::ofstream(path, std::ios::binary) << contents;
+}
+
+static void reportsFinishedFilesOnce()
+{
+    const fs::path folder = testFolder();
+    FolderWatcher watcher;
+    assert(watcher.start(folder) && watcher.watching() && watcher.folder() == folder);
+
+    std::vector<CapturedFile> captured;
+    assert(!watcher.poll(captured) && captured.empty());
+
+    write(folder / "DSC0001.ARW", "raw");
+    assert(watcher.poll(captured));
+    assert(captured.size() == 1 && captured[0].path == folder / "DSC0001.ARW");
+    assert(captured[0].writeToSeenMs >= 0.0);
+    assert(!watcher.poll(captured) && captured.empty());
+
+    watcher.stop();
+    assert(!watcher.watching());
+    fs::remove_all(folder);
+}
+
+// The camera software is still writing: nothing until it closes the file.
+static void waitsForTheWriterToClose()
+{
+    const fs::path folder = testFolder();
+    FolderWatcher watcher;
+    assert(watcher.start(folder));
+
+    std::vector<CapturedFile> captured;
+    std::FILE *file = std::fopen((folder / "DSC0002.ARW").c_str(), "wb");
+    assert(file);
+    std::fputs("first half", file);
+    std::fflush(file);
+    assert(!watcher.poll(captured));
+
+    std::fputs("second half", file);
+    std::fclose(file);
+    assert(watcher.poll(captured) && captured.size() == 1);
+    fs::remove_all(folder);
+}
+
+// Several captures between two frames, one of them written twice, and one
+// renamed into place from a temp file.
+static void coalescesBursts()
+{
+    const fs::path folder = testFolder();
+    FolderWatcher watcher;
+    assert(watcher.start(folder));
+
+    write(folder / "a.nef", "1");
+    write(folder / "b.nef", "2");
+    write(folder / "a.nef", "3");
+    write(folder / "c.nef.part", "4");
+    fs::rename(folder / "c.nef.part", folder / "c.nef");
+    fs::create_directories(folder / "subfolder");
+
+    std::vector<CapturedFile> captured;
+    assert(watcher.poll(captured));
+    // Oldest first; the temp file's own close is reported too, the caller
+    // filters by extension.
+    assert(captured.size() == 4);
+    assert(captured[0].path == folder / "b.nef");
+    assert(captured[1].path == folder / "a.nef");
+    assert(captured[2].path == folder / "c.nef.part");
+    assert(captured[3].path == folder / "c.nef");
+    fs::remove_all(folder);
+}
+
+static void missingFolderCannotBeWatched()
+{
+    FolderWatcher watcher;
+    assert(!watcher.start("this-directory-must-not-exist"));
+    assert(!watcher.watching());
+    std::vector<CapturedFile> captured;
+    assert(!watcher.poll(captured));
+    assert(!watcher.takeOverflow());
+}
+
+int main()
+{
+    reportsFinishedFilesOnce();
+    waitsForTheWriterToClose();
+    coalescesBursts();
+    missingFolderCannotBeWatched();
+    return 0;
+}
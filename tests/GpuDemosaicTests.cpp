@@ -0,0 +1,186 @@
+#include "Demosaic.h"
+#include "graphics/gpuDemosaic.h"
+#include "graphics/renderTarget.h"
+#include <GLFW/glfw3.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Compares shaders/demosaic.frag with the CPU bilinear demosaic.
+// Needs an OpenGL 4.3 context; Mesa llvmpipe is enough
+// (LIBGL_ALWAYS_SOFTWARE=1, under xvfb-run without a display).
+// Skipped when no context can be created.
+
+static ImageData makeScene(int width, int height)
+{
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.is16Bit = true;
+    image.pixels16.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            const double values[3] = {
+                0.5 + 0.4 * std::sin(x * 0.05) * std::cos(y * 0.03),
+                0.5 + 0.4 * std::cos((x + y) * 0.02),
+                0.5 + 0.4 * std::sin(y * 0.04 + 1.0),
+            };
+            for (int c = 0; c < 3; ++c)
+                image.pixels16[(static_cast<size_t>(y) * width + x) * 3 + c] =
+                    static_cast<uint16_t>(std::lround(values[c] * 65535.0));
+        }
+    return image;
+}
+
+// A camera-like mosaic: levels, white balance and a non-identity matrix.
+static RawMosaic makeMosaic(int width, int height, int patternSize, const uint8_t *pattern)
+{
+    const ImageData scene = makeScene(width, height);
+    RawMosaic mosaic;
+    mosaic.width = width;
+    mosaic.height = height;
+    mosaic.patternWidth = patternSize;
+    mosaic.patternHeight = patternSize;
+    for (int i = 0; i < patternSize * patternSize; ++i)
+        mosaic.pattern[i] = pattern[i];
+    mosaic.black[0] = mosaic.black[1] = mosaic.black[2] = 512.0f;
+    mosaic.white = 16383.0f;
+    mosaic.whiteBalance[0] = 2.0f;
+    mosaic.whiteBalance[2] = 1.5f;
+    const float matrix[3][3] = {{1.6f, -0.5f, -0.1f}, {-0.2f, 1.4f, -0.2f}, {0.0f, -0.4f, 1.4f}};
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            mosaic.cameraToRgb[i][j] = matrix[i][j];
+
+    mosaic.pixels.resize(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            const size_t index = static_cast<size_t>(y) * width + x;
+            const int c = mosaicColor(mosaic, y, x);
+            const float value = scene.pixels16[index * 3 + c] / 65535.0f / mosaic.whiteBalance[c];
+            mosaic.pixels[index] = static_cast<uint16_t>(512.0f + value * (16383.0f - 512.0f));
+        }
+    return mosaic;
+}
+
+static ImageData developOnGpu(GpuDemosaic &gpu, const RawMosaic &mosaic)
+{
+    ImageData result;
+    RenderTarget target;
+    if (!target.create() || !gpu.upload(mosaic) ||
+        !target.resize(gpu.width(), gpu.height(), TextureFormat::RGBA16F) || !gpu.develop(target))
+        return result;
+
+    result.width = gpu.width();
+    result.height = gpu.height();
+    result.is16Bit = true;
+    result.pixels16.resize(static_cast<size_t>(result.width) * result.height * 3);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer());
+    glPixelStorei(GL_PACK_ALIGNMENT, 2);
+    glReadPixels(0, 0, result.width, result.height, GL_RGB, GL_UNSIGNED_SHORT, result.pixels16.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    gpu.releaseMosaic();
+    target.destroy();
+    return result;
+}
+
+// LibRaw flip 6: 90 degrees clockwise.
+static ImageData rotateClockwise(const ImageData &image)
+{
+    ImageData result = image;
+    result.width = image.height;
+    result.height = image.width;
+    for (int y = 0; y < result.height; ++y)
+        for (int x = 0; x < result.width; ++x)
+            for (int c = 0; c < 3; ++c)
+                result.pixels16[(static_cast<size_t>(y) * result.width + x) * 3 + c] =
+                    image.pixels16[(static_cast<size_t>(image.height - 1 - x) * image.width + y) * 3 + c];
+    return result;
+}
+
+static const uint8_t kRggb[4] = {0, 1, 1, 2};
+
+static const uint8_t kXTrans[36] = {
+    1, 1, 0, 1, 1, 2, //
+    1, 1, 2, 1, 1, 0, //
+    2, 0, 1, 0, 2, 1, //
+    1, 1, 2, 1, 1, 0, //
+    1, 1, 0, 1, 1, 2, //
+    0, 2, 1, 2, 0, 1, //
+};
+
+static void bayerMatchesCpu(GpuDemosaic &gpu)
+{
+    const RawMosaic mosaic = makeMosaic(257, 171, 2, kRggb);
+    DemosaicOptions options;
+    options.quality = DemosaicQuality::Bilinear;
+
+    const ImageData cpu = demosaicMosaic(mosaic, options);
+    const ImageData gpuResult = developOnGpu(gpu, mosaic);
+    assert(gpuResult.width == cpu.width && gpuResult.height == cpu.height);
+    assert(imagePsnr(gpuResult, cpu) > 55.0);
+}
+
+static void xtransMatchesCpu(GpuDemosaic &gpu)
+{
+    const RawMosaic mosaic = makeMosaic(180, 120, 6, kXTrans);
+    DemosaicOptions options;
+    options.quality = DemosaicQuality::Bilinear;
+
+    assert(imagePsnr(developOnGpu(gpu, mosaic), demosaicMosaic(mosaic, options)) > 55.0);
+}
+
+static void orientationIsApplied(GpuDemosaic &gpu)
+{
+    RawMosaic mosaic = makeMosaic(96, 64, 2, kRggb);
+    DemosaicOptions options;
+    options.quality = DemosaicQuality::Bilinear;
+    const ImageData cpu = rotateClockwise(demosaicMosaic(mosaic, options));
+
+    mosaic.flip = 6;
+    const ImageData gpuResult = developOnGpu(gpu, mosaic);
+    assert(gpuResult.width == 64 && gpuResult.height == 96);
+    assert(imagePsnr(gpuResult, cpu) > 55.0);
+}
+
+int main()
+{
+    if (!glfwInit())
+    {
+        std::printf("gpu_demosaic_tests skipped: no GLFW\n");
+        return 0;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "gpu_demosaic_tests", nullptr, nullptr);
+    if (!window)
+    {
+        std::printf("gpu_demosaic_tests skipped: no OpenGL 4.3 context\n");
+        glfwTerminate();
+        return 0;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+        return 1;
+
+    GpuDemosaic gpu;
+    const bool created = gpu.create();
+    assert(created);
+    (void)created;
+
+    bayerMatchesCpu(gpu);
+    xtransMatchesCpu(gpu);
+    orientationIsApplied(gpu);
+
+    gpu.destroy();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "DetailFilters.h"
+#include "graphics/gpuDetailFilters.h"
+#include "graphics/renderTarget.h"
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Compares shaders/detailFilters.frag with the CPU detail filters.
+// Needs an OpenGL 4.3 context; Mesa llvmpipe is enough
+// (LIBGL_ALWAYS_SOFTWARE=1, under xvfb-run without a display).
+// Skipped when no context can be created.
+
+// Smooth colours, a hard edge and some colour and luma noise, kept inside
+// 0..1 so the GPU's clamp does not matter.
+static DevelopImage makeScene(int width, int height)
+{
+    std::mt19937 random(5);
+    std::normal_distribution<float> noise(0.0f, 0.02f);
+    DevelopImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            const float edge = x < width / 3 ? 0.3f : 0.6f;
+            const float shared = noise(random);
+            for (int c = 0; c < 3; ++c)
+            {
+                const float value = edge + 0.1f * std::sin(x * 0.05f + c) * std::cos(y * 0.04f) + shared +
+                                    noise(random);
+                image.pixels[(static_cast<size_t>(y) * width + x) * 3 + c] = std::clamp(value, 0.1f, 0.9f);
+            }
+        }
+    return image;
+}
+
+static void upload(RenderTarget &target, const DevelopImage &image)
+{
+    glBindTexture(GL_TEXTURE_2D, target.texture());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, GL_RGB, GL_FLOAT, image.pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static DevelopImage download(const RenderTarget &target)
+{
+    DevelopImage image;
+    image.width = target.width();
+    image.height = target.height();
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height * 3);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, image.width, image.height, GL_RGB, GL_FLOAT, image.pixels.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return image;
+}
+
+static DevelopImage filterOnCpu(const DevelopSettings &settings, const DevelopImage &source)
+{
+    DevelopImage denoised = source;
+    reduceNoise(settings, source, denoised);
+    DevelopImage result = denoised;
+    sharpen(settings, denoised, result);
+    for (float &value : result.pixels)
+        value = std::clamp(value, 0.0f, 1.0f);
+    return result;
+}
+
+static float maxDifference(const DevelopImage &a, const DevelopImage &b)
+{
+    float result = 0.0f;
+    for (size_t i = 0; i < a.pixels.size(); ++i)
+        result = std::max(result, std::abs(a.pixels[i] - b.pixels[i]));
+    return result;
+}
+
+// Half-float intermediates: a few 1e-3 apart at most.
+static void matchesCpu(GpuDetailFilters &gpu)
+{
+    const DevelopImage scene = makeScene(181, 97);
+    RenderTarget input;
+    RenderTarget output;
+    const bool ready = input.create() && output.create() &&
+                       input.resize(scene.width, scene.height, TextureFormat::RGBA16F) &&
+                       output.resize(scene.width, scene.height, TextureFormat::RGBA16F);
+    assert(ready);
+    (void)ready;
+    upload(input, scene);
+
+    const DevelopSettings configurations[] = {
+        [] {
+            DevelopSettings s;
+            s.lumaNoise = 0.6f;
+            return s;
+        }(),
+        [] {
+            DevelopSettings s;
+            s.chromaNoise = 0.8f;
+            return s;
+        }(),
+        [] {
+            DevelopSettings s;
+            s.sharpenAmount = 1.2f;
+            s.sharpenRadius = 1.3f;
+            return s;
+        }(),
+        [] {
+            DevelopSettings s;
+            s.lumaNoise = 0.4f;
+            s.chromaNoise = 0.5f;
+            s.sharpenAmount = 0.7f;
+            return s;
+        }(),
+        // Same noise reduction: the kept denoised image is reused.
+        [] {
+            DevelopSettings s;
+            s.lumaNoise = 0.4f;
+            s.chromaNoise = 0.5f;
+            s.sharpenAmount = 1.5f;
+            s.sharpenThreshold = 0.03f;
+            return s;
+        }(),
+    };
+    for (const DevelopSettings &configuration : configurations)
+    {
+        gpu.apply(input, 1, output, configuration, 1.0f);
+        const float difference = maxDifference(download(output), filterOnCpu(configuration, scene));
+        assert(difference < 4e-3f);
+        (void)difference;
+    }
+
+    input.destroy();
+    output.destroy();
+}
+
+int main()
+{
+    if (!glfwInit())
+    {
+        std::printf("gpu_detail_filters_tests skipped: no GLFW\n");
+        return 0;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "gpu_detail_filters_tests", nullptr, nullptr);
+    if (!window)
+    {
+        std::printf("gpu_detail_filters_tests skipped: no OpenGL 4.3 context\n");
+        glfwTerminate();
+        return 0;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+        return 1;
+
+    GpuDetailFilters gpu;
+    const bool created = gpu.create();
+    assert(created);
+    (void)created;
+
+    matchesCpu(gpu);
+
+    gpu.destroy();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,279 @@
+#include "AutoAdjust.h"
+#include "ImageLoadPipeline.h"
+#include "PreviewCache.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// Sleeps for a while and returns a small image whose width tells which file
+// it came from. Files named "*fail*" fail.
+class SleepyBackend : public DecoderBackend
+{
+public:
+    SleepyBackend(DecodeOutput output, int sleepMs) : m_output(output), m_sleepMs(sleepMs) {}
+
+    const char *name() const override { return m_output == DecodeOutput::Full ? "sleepy-full" : "sleepy-preview"; }
+    bool supports(const std::string &extension, DecodeOutput output) const override
+    {
+        return extension == ".stub" && output == m_output;
+    }
+    int cost(const std::string &, DecodeOutput) const override { return 1; }
+    std::optional<ImageData> decode(const DecodeRequest &request) const override
+    {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_sleepMs));
+        if (request.path.find("fail") != std::string::npos)
+            return std::nullopt;
+
+        ImageData image;
+        image.width = static_cast<int>(request.path.size());
+        image.height = 2;
+        image.is16Bit = true;
+        image.pixels16.assign(static_cast<size_t>(image.width) * image.height * 3, 1000);
+        image.kind = m_output == DecodeOutput::Full ? ImageKind::Full : ImageKind::Preview;
+        return image;
+    }
+
+    mutable std::atomic<int> calls{0};
+
+private:
+    DecodeOutput m_output;
+    int m_sleepMs;
+};
+
+struct Fixture
+{
+    Fixture()
+    {
+        preview = std::make_shared<SleepyBackend>(DecodeOutput::Preview, 2);
+        full = std::make_shared<SleepyBackend>(DecodeOutput::Full, 20);
+        decoders.add(preview);
+        decoders.add(full);
+    }
+
+    DecoderRegistry decoders;
+    MetricsRegistry metrics;
+    std::shared_ptr<SleepyBackend> preview;
+    std::shared_ptr<SleepyBackend> full;
+};
+
+static LoadOptions cpuOptions()
+{
+    LoadOptions options;
+    options.demosaicMode = 0;
+    return options;
+}
+
+static void loadsPreviewThenFull()
+{
+    Fixture fixture;
+    ImageLoadPipeline loader(fixture.decoders, fixture.metrics);
+    const uint64_t generation = loader.open("a.stub", cpuOptions());
+    assert(generation == 1 && loader.loading());
+    loader.wait();
+
+    auto first = loader.takeResult();
+    assert(first && first->generation == generation && first->image.kind == ImageKind::Preview);
+    assert(first->autoAdjust);
+    assert(loader.loading());
+    auto second = loader.takeResult();
+    assert(second && second->image.kind == ImageKind::Full && second->image.width == 6);
+    assert(!second->autoAdjust);
+    assert(!loader.loading());
+    assert(!loader.takeResult());
+
+    loader.collect();
+    assert(loader.inFlight() == 0);
+    const MetricsSnapshot snapshot = fixture.metrics.snapshot();
+    for (const auto &[name, value] : snapshot.gauges)
+        if (name == "memory.decoded_bytes")
+            assert(value == 0);
+}
+
+// Rapid switching: only the last file's results reach the viewer, the
+// earlier ones are counted as stale.
+static void dropsSupersededResults()
+{
+    Fixture fixture;
+    ImageLoadPipeline loader(fixture.decoders, fixture.metrics);
+    loader.open("first.stub", cpuOptions());
+    loader.open("second.stub", cpuOptions());
+    const uint64_t last = loader.open("third-file.stub", cpuOptions());
+    loader.wait();
+
+    int taken = 0;
+    while (auto result = loader.takeResult())
+    {
+        assert(result->generation == last && result->image.width == 15);
+        ++taken;
+    }
+    assert(taken == 2);
+    assert(fixture.metrics.counter("loader.superseded").value() == 2);
+    assert(fixture.metrics.counter("loader.stale_results").value() == 4);
+    assert(fixture.metrics.counter("loader.stale_bytes").value() > 0);
+    assert(fixture.metrics.histogram("loader.stale_work_ms").summary().count == 2);
+    loader.collect();
+    assert(!loader.loading() && loader.inFlight() == 0);
+}
+
+// Tethered burst: the superseded capture shows no full image, so its full
+// decode is not run at all.
+static void supersededCaptureSkipsFullDecode()
+{
+    Fixture fixture;
+    ImageLoadPipeline loader(fixture.decoders, fixture.metrics);
+    LoadOptions options = cpuOptions();
+    options.skipFullWhenSuperseded = true;
+    loader.open("first.stub", options);
+    const uint64_t last = loader.open("second.stub", options);
+    loader.wait();
+
+    int taken = 0;
+    while (auto result = loader.takeResult())
+    {
+        assert(result->generation == last);
+        ++taken;
+    }
+    assert(taken == 2);
+    assert(fixture.full->calls == 1);
+    assert(fixture.metrics.counter("loader.skipped_full").value() == 1);
+    assert(fixture.metrics.counter("loader.stale_results").value() == 1);
+    loader.collect();
+    assert(!loader.loading() && loader.inFlight() == 0);
+}
+
+// Culling shows its own preview: only the full image is decoded and pushed.
+static void skipPreviewPushesOnlyTheFull()
+{
+    Fixture fixture;
+    ImageLoadPipeline loader(fixture.decoders, fixture.metrics);
+    LoadOptions options = cpuOptions();
+    options.skipPreview = true;
+    const uint64_t generation = loader.open("a.stub", options);
+    loader.wait();
+
+    auto result = loader.takeResult();
+    assert(result && result->generation == generation && result->image.kind == ImageKind::Full);
+    assert(!loader.takeResult() && !loader.loading());
+    assert(fixture.preview->calls == 0 && fixture.full->calls == 1);
+    loader.collect();
+}
+
+// Only the newest open() writes the launch preview, and no temp file is left.
+static void previewCacheKeepsTheNewestFile()
+{
+    const fs::path dir = fs::temp_directory_path() / "photocrispy_load_pipeline_preview_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const fs::path first = dir / "first.stub";
+    const fs::path second = dir / "second.stub";
+    std::ofstream(first) << "first";
+    std::ofstream(second) << "second";
+
+    Fixture fixture;
+    ImageLoadPipeline loader(fixture.decoders, fixture.metrics);
+    LoadOptions options = cpuOptions();
+    options.previewCacheFile = dir / "last-preview.bin";
+    loader.open(first.string(), options);
+    loader.open(second.string(), options);
+    loader.wait();
+
+    assert(loadPreviewCache(options.previewCacheFile, second.string()));
+    assert(!loadPreviewCache(options.previewCacheFile, first.string()));
+    assert(fixture.metrics.histogram("preview_cache.save_ms").summary().count == 1);
+    for (const auto &entry : fs::directory_iterator(dir))
+        assert(entry.path().extension().string().rfind(".tmp", 0) != 0);
+    fs::remove_all(dir);
+}
+
+static void failedDecodeStopsLoading()
+{
+    Fixture fixture;
+    ImageLoadPipeline loader(fixture.decoders, fixture.metrics);
+    loader.open("will-fail.stub", cpuOptions());
+    loader.wait();
+    assert(!loader.takeResult());
+    assert(loader.loading());
+    loader.collect();
+    assert(!loader.loading());
+    assert(fixture.metrics.counter("loader.failed").value() == 1);
+    assert(fixture.metrics.counter("decode.sleepy-full_failed").value() == 1);
+}
+
+static void secondOpenComesFromDecodeCache()
+{
+    const fs::path dir = fs::temp_directory_path() / "photocrispy_load_pipeline_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const fs::path source = dir / "cached.stub";
+    std::ofstream(source) << "not an image";
+
+    Fixture fixture;
+    DecodeCache cache(dir / "decoded", 1 << 20);
+    ImageLoadPipeline loader(fixture.decoders, fixture.metrics);
+    loader.setDecodeCache(&cache);
+    for (int i = 0; i < 2; ++i)
+    {
+        loader.open(source.string(), cpuOptions());
+        loader.wait();
+        std::optional<LoadResult> full;
+        while (auto result = loader.takeResult())
+            full = std::move(result);
+        assert(full && full->image.kind == ImageKind::Full);
+        assert(full->image.width == static_cast<int>(source.string().size()));
+    }
+    assert(fixture.full->calls == 1);
+    assert(fixture.metrics.counter("decode_cache.misses").value() == 1);
+    assert(fixture.metrics.counter("decode_cache.hits").value() == 1);
+    fs::remove_all(dir);
+}
+
+// A decode that was superseded before it finished is not stored.
+static void supersededDecodeIsNotCached()
+{
+    const fs::path dir = fs::temp_directory_path() / "photocrispy_load_pipeline_superseded_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const fs::path first = dir / "first.stub";
+    const fs::path second = dir / "second.stub";
+    std::ofstream(first) << "first";
+    std::ofstream(second) << "second";
+
+    Fixture fixture;
+    DecodeCache cache(dir / "decoded", 1 << 20);
+    ImageLoadPipeline loader(fixture.decoders, fixture.metrics);
+    loader.setDecodeCache(&cache);
+    loader.open(first.string(), cpuOptions());
+    loader.open(second.string(), cpuOptions());
+    loader.wait();
+    assert(fixture.full->calls == 2);
+    assert(fixture.metrics.histogram("decode.cache_store_ms").summary().count == 1);
+
+    loader.open(second.string(), cpuOptions());
+    loader.wait();
+    assert(fixture.full->calls == 2);
+    loader.open(first.string(), cpuOptions());
+    loader.wait();
+    assert(fixture.full->calls == 3);
+    fs::remove_all(dir);
+}
+
+int main()
+{
+    loadsPreviewThenFull();
+    dropsSupersededResults();
+    supersededCaptureSkipsFullDecode();
+    skipPreviewPushesOnlyTheFull();
+    previewCacheKeepsTheNewestFile();
+    failedDecodeStopsLoading();
+    secondOpenComesFromDecodeCache();
+    supersededDecodeIsNotCached();
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "DevelopPipeline.h"
+#include "ImageView.h"
+#include "PreviewCache.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+static ImageData makeImage(int width, int height, int channels, bool is16Bit)
+{
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.is16Bit = is16Bit;
+    const size_t values = static_cast<size_t>(width) * height * channels;
+    if (is16Bit)
+    {
+        image.pixels16.resize(values);
+        for (size_t i = 0; i < values; ++i)
+            image.pixels16[i] = static_cast<uint16_t>(i * 257);
+    }
+    else
+    {
+        image.pixels8.resize(values);
+        for (size_t i = 0; i < values; ++i)
+            image.pixels8[i] = static_cast<uint8_t>(i);
+    }
+    return image;
+}
+
+static void imageRowsAreAlignedAndPadded()
+{
+    Image<uint16_t, 3> image(5, 3);
+    assert(image.width() == 5 && image.height() == 3);
+    // 15 values padded to 64 bytes
+    assert(image.stride() == 32);
+    ImageView<uint16_t, 3> view = image.view();
+    for (int y = 0; y < view.height; ++y)
+    {
+        assert(reinterpret_cast<uintptr_t>(view.row(y)) % kImageRowAlignment == 0);
+        for (int x = 0; x < view.width * 3; ++x)
+            assert(view.row(y)[x] == 0);
+    }
+    view.pixel(4, 2)[1] = 1234;
+
+    const ImageData packed = toImageData(image, ImageKind::Preview);
+    assert(packed.is16Bit && packed.channels == 3 && packed.kind == ImageKind::Preview);
+    assert(packed.pixels16.size() == 5 * 3 * 3);
+    assert(packed.pixels16[(2 * 5 + 4) * 3 + 1] == 1234);
+
+    const Image<uint8_t, 4> empty(0, 7);
+    assert(empty.view().empty() && empty.stride() == 0);
+}
+
+static void viewsCheckTheLayout()
+{
+    ImageData rgba8 = makeImage(4, 2, 4, false);
+    auto view = imageView<uint8_t, 4>(rgba8);
+    assert(view && view->stride == 16);
+    assert(view->pixel(1, 1)[2] == 4 * 4 + 4 + 2);
+    assert(!(imageView<uint8_t, 3>(rgba8)));
+    assert(!(imageView<uint16_t, 4>(rgba8)));
+
+    // Writes go to the ImageData
+    auto writable = imageView<uint8_t, 4>(rgba8);
+    writable->pixel(3, 0)[0] = 200;
+    assert(rgba8.pixels8[12] == 200);
+
+    rgba8.pixels8.resize(rgba8.pixels8.size() - 1);
+    assert(!(imageView<uint8_t, 4>(rgba8)));
+}
+
+static void dispatchPicksOneInstantiation()
+{
+    int channels = 0;
+    size_t valueSize = 0;
+    auto kernel = [&](auto view) {
+        channels = decltype(view)::channels;
+        valueSize = sizeof(typename decltype(view)::Value);
+    };
+    assert(dispatchImage(makeImage(2, 2, 4, true), kernel));
+    assert(channels == 4 && valueSize == 2);
+    assert(dispatchImage(makeImage(2, 2, 3, false), kernel));
+    assert(channels == 3 && valueSize == 1);
+
+    channels = 0;
+    assert(!dispatchImage(makeImage(2, 2, 1, false), kernel));
+    assert(!dispatchImage(ImageData{}, kernel));
+    assert(channels == 0);
+}
+
+static void kernelsSkipAlpha()
+{
+    const ImageData rgba16 = makeImage(3, 2, 4, true);
+    const DevelopImage develop = toDevelopImage(rgba16);
+    assert(develop.width == 3 && develop.height == 2 && develop.pixels.size() == 3 * 2 * 3);
+    for (size_t i = 0; i < 6; ++i)
+        for (size_t c = 0; c < 3; ++c)
+            assert(std::abs(develop.pixels[i * 3 + c] - rgba16.pixels16[i * 4 + c] / 65535.0f) < 1e-6f);
+
+    // Unsupported layouts give a zeroed buffer of the right size
+    const DevelopImage gray = toDevelopImage(makeImage(2, 2, 1, false));
+    assert(gray.pixels.size() == 2 * 2 * 3 && gray.pixels[0] == 0.0f);
+
+    const ImageData rgba8 = makeImage(4, 4, 4, false);
+    const ImageData small = downscaleToRgb8(rgba8, 2);
+    assert(small.width == 2 && small.height == 2 && small.channels == 3 && small.pixels8.size() == 12);
+    // Top-left 2 x 2 block, red: values 0, 4, 16, 20
+    assert(small.pixels8[0] == 10);
+}
+
+int main()
+{
+    imageRowsAreAlignedAndPadded();
+    viewsCheckTheLayout();
+    dispatchPicksOneInstantiation();
+    kernelsSkipAlpha();
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include "ImportPipeline.h"
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::vector<uint8_t> randomBytes(size_t size, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t &byte : bytes)
+        byte = static_cast<uint8_t>(random());
+    return bytes;
+}
+
+// RAF header pointing at a 64-byte baseline JPEG at offset 160, then filler.
+static std::vector<uint8_t> makeRaf(size_t size, unsigned seed)
+{
+    std::vector<uint8_t> file = randomBytes(size, seed);
+    const char magic[] = "FUJIFILMCCD-RAW 0201FF383501";
+    std::copy(magic, magic + sizeof(magic) - 1, file.begin());
+    const uint8_t pointers[] = {0, 0, 0, 160, 0, 0, 0, 64};
+    std::copy(std::begin(pointers), std::end(pointers), file.begin() + 84);
+    const uint8_t jpeg[] = {0xFF, 0xD8, 0xFF, 0xE1, 0x00, 0x04, 0x00, 0x00, 0xFF, 0xC0, 0x00, 0x02};
+    std::copy(std::begin(jpeg), std::end(jpeg), file.begin() + 160);
+    return file;
+}
+
+static void writeFile(const fs::path &path, const std::vector<uint8_t> &bytes)
+{
+    fs::create_directories(path.parent_path());
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+static std::vector<uint8_t> readFile(const fs::path &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void hashIgnoresChunking()
+{
+    const std::vector<uint8_t> bytes = randomBytes(10007, 1);
+    const uint64_t whole = hashBytes(bytes.data(), bytes.size());
+
+    ContentHash chunked;
+    size_t offset = 0;
+    for (size_t step : {1, 3, 8, 13, 4096, 5000})
+    {
+        chunked.update(bytes.data() + offset, step);
+        offset += step;
+    }
+    chunked.update(bytes.data() + offset, bytes.size() - offset);
+    assert(chunked.value() == whole);
+
+    std::vector<uint8_t> changed = bytes;
+    changed[5000] ^= 1;
+    assert(hashBytes(changed.data(), changed.size()) != whole);
+    // Trailing zeros still count
+    const uint8_t zeros[4] = {};
+    assert(hashBytes(zeros, 3) != hashBytes(zeros, 4));
+}
+
+static void copiesFlattensAndSkips()
+{
+    const fs::path root = fs::temp_directory_path() / "photocrispy_import_test";
+    fs::remove_all(root);
+    const fs::path card = root / "card";
+    const fs::path destination = root / "photos";
+
+    const std::vector<uint8_t> first = makeRaf(30000, 2);
+    const std::vector<uint8_t> second = makeRaf(20000, 3);
+    const std::vector<uint8_t> third = randomBytes(9000, 4);
+    writeFile(card / "DCIM" / "100TEST" / "a.raf", first);
+    writeFile(card / "DCIM" / "101TEST" / "a.raf", second);
+    writeFile(card / "DCIM" / "101TEST" / "B.ARW", third);
+    writeFile(card / "DCIM" / "101TEST" / "notes.txt", {1, 2, 3});
+
+    const std::vector<fs::path> sources = findImportSources(card);
+    assert(sources.size() == 3);
+
+    ImportOptions options;
+    options.filesInFlight = 2;
+    options.chunkBytes = 4096;
+    options.thumbnailEdge = 64;
+    std::mutex mutex;
+    std::vector<ImportedFile> files;
+    auto collect = [&](const ImportedFile &file) {
+        std::lock_guard<std::mutex> lock(mutex);
+        files.push_back(file);
+    };
+
+    ImportSummary summary = importFiles(sources, destination, options, collect);
+    assert(summary.copied == 3 && summary.skipped == 0 && summary.failed == 0);
+    assert(summary.bytes == first.size() + second.size() + third.size());
+    assert(!summary.cancelled);
+    assert(files.size() == 3);
+    assert(readFile(destination / "a.raf") == first);
+    assert(readFile(destination / "a-2.raf") == second);
+    assert(readFile(destination / "B.ARW") == third);
+    for (const ImportedFile &file : files)
+    {
+        assert(file.status == ImportStatus::Copied && file.error.empty());
+        const std::vector<uint8_t> content = readFile(file.destination);
+        assert(file.hash == hashBytes(content.data(), content.size()));
+        // The RAF previews come out of the copied bytes; the fake JPEG
+        // doesn't decode, so there is no thumbnail.
+        const bool isRaf = file.destination.extension() == ".raf";
+        assert(file.previews.size() == (isRaf ? 1u : 0u));
+        if (isRaf)
+            assert(file.previews[0].offset == 160 && file.previews[0].length == 64);
+        assert(!file.thumbnail);
+    }
+    for (const auto &entry : fs::directory_iterator(destination))
+        assert(entry.path().extension() != ".part");
+
+    // Same names and sizes: nothing is copied again.
+    files.clear();
+    summary = importFiles(sources, destination, options, collect);
+    assert(summary.copied == 0 && summary.skipped == 3 && summary.bytes == 0);
+    assert(files.size() == 3 && files[0].status == ImportStatus::Skipped);
+
+    fs::remove_all(root);
+}
+
+static void reportsFailuresAndCancels()
+{
+    const fs::path root = fs::temp_directory_path() / "photocrispy_import_fail_test";
+    fs::remove_all(root);
+    writeFile(root / "card" / "x.nef", randomBytes(5000, 5));
+
+    std::vector<ImportedFile> files;
+    const ImportSummary missing =
+        importFiles({root / "card" / "gone.nef"}, root / "photos", ImportOptions{},
+                    [&](const ImportedFile &file) { files.push_back(file); });
+    assert(missing.failed == 1 && files.size() == 1);
+    assert(files[0].status == ImportStatus::Failed && !files[0].error.empty());
+    assert(fs::is_empty(root / "photos"));
+
+    const std::atomic<bool> cancel{true};
+    const ImportSummary cancelled =
+        importFiles(findImportSources(root / "card"), root / "photos", ImportOptions{}, {}, &cancel);
+    assert(cancelled.cancelled && cancelled.copied == 0 && cancelled.failed == 0);
+    assert(!fs::exists(root / "photos" / "x.nef"));
+
+    fs::remove_all(root);
+}
+
+int main()
+{
+    hashIgnoresChunking();
+    copiesFlattensAndSkips();
+    reportsFailuresAndCancels();
+    return 0;
+}
@@ -30,9 +30,21 @@ static void queueReturnsItemsInFifoOrder()
     assert(!third.has_value());
 }
 
+static void sizeCountsWaitingItems()
+{
+    LoadResultQueue<QueueItem> queue;
+    assert(queue.size() == 0);
+    queue.push(QueueItem{1});
+    queue.push(QueueItem{2});
+    assert(queue.size() == 2);
+    queue.tryPop();
+    assert(queue.size() == 1);
+}
+
 int main()
 {
     emptyQueueReturnsNoValue();
     queueReturnsItemsInFifoOrder();
+    sizeCountsWaitingItems();
     return 0;
 }
@@ -0,0 +1,94 @@
+#include "MetricsRegistry.h"
+
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void countersAddFromManyThreads()
+{
+    MetricsRegistry metrics;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&metrics]() {
+            Counter &counter = metrics.counter("loads");
+            for (int i = 0; i < 1000; ++i)
+                counter.add();
+            metrics.gauge("bytes").add(10);
+            metrics.histogram("ms").record(1.0);
+        });
+    for (std::thread &thread : threads)
+        thread.join();
+
+    // Same name, same metric.
+    assert(&metrics.counter("loads") == &metrics.counter("loads"));
+    assert(metrics.counter("loads").value() == 4000);
+    assert(metrics.gauge("bytes").value() == 40);
+    assert(metrics.histogram("ms").summary().count == 4);
+}
+
+static void histogramPercentiles()
+{
+    Histogram histogram;
+    assert(histogram.summary().count == 0 && histogram.summary().p50 == 0.0);
+
+    for (int i = 100; i >= 1; --i)
+        histogram.record(i);
+    const HistogramSummary summary = histogram.summary();
+    assert(summary.count == 100);
+    assert(summary.mean == 50.5);
+    assert(summary.min == 1.0 && summary.max == 100.0);
+    assert(summary.p50 == 50.0);
+    assert(summary.p95 == 95.0);
+    assert(summary.p99 == 99.0);
+
+    const std::vector<float> recent = histogram.recent();
+    assert(recent.size() == 100 && recent.front() == 100.0f && recent.back() == 1.0f);
+}
+
+static void histogramWindowFollowsRecentSamples()
+{
+    Histogram histogram;
+    for (size_t i = 0; i < Histogram::kWindow; ++i)
+        histogram.record(1000.0);
+    for (size_t i = 0; i < Histogram::kWindow; ++i)
+        histogram.record(static_cast<double>(i % 10));
+
+    const HistogramSummary summary = histogram.summary();
+    assert(summary.count == static_cast<int64_t>(2 * Histogram::kWindow));
+    assert(summary.max == 9.0);
+
+    const std::vector<float> recent = histogram.recent();
+    assert(recent.size() == Histogram::kWindow);
+    assert(recent.front() == 0.0f && recent.back() == static_cast<float>((Histogram::kWindow - 1) % 10));
+}
+
+static void snapshotAsJson()
+{
+    MetricsRegistry metrics;
+    metrics.counter("loader.stale_results").add(3);
+    metrics.gauge("loader.in_flight").set(2);
+    metrics.histogram("frame.ms").record(16.0);
+    metrics.counter("a \"quoted\" name").add();
+
+    const MetricsSnapshot snapshot = metrics.snapshot();
+    assert(snapshot.counters.size() == 2 && snapshot.counters[0].first == "a \"quoted\" name");
+
+    const std::string json = toJson(snapshot);
+    assert(json.find("\"loader.stale_results\": 3") != std::string::npos);
+    assert(json.find("\"gauges\": {\"loader.in_flight\": 2}") != std::string::npos);
+    assert(json.find("\"frame.ms\": {\"count\": 1, \"mean\": 16,") != std::string::npos);
+    assert(json.find("\"a \\\"quoted\\\" name\": 1") != std::string::npos);
+    assert(json.front() == '{' && json.back() == '}');
+
+    assert(toJson(MetricsSnapshot{}) == "{\"counters\": {}, \"gauges\": {}, \"histograms\": {}}");
+}
+
+int main()
+{
+    countersAddFromManyThreads();
+    histogramPercentiles();
+    histogramWindowFollowsRecentSamples();
+    snapshotAsJson();
+    return 0;
+}
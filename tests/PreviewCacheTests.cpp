@@ -0,0 +1,97 @@
+#include "PreviewCache.h"
+
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static ImageData makeImage(int width, int height, uint8_t value)
+{
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.channels = 3;
+    image.kind = ImageKind::Preview;
+    image.pixels8.assign(static_cast<size_t>(width) * height * 3, value);
+    return image;
+}
+
+static fs::path writeSource(const char *name)
+{
+    const fs::path path = fs::temp_directory_path() / name;
+    std::ofstream(path, std::ios::binary) << "raw file contents";
+    return path;
+}
+
+static void downscaleKeepsAspectAndAverages()
+{
+    ImageData image = makeImage(4000, 2000, 0);
+    // Left half white: averages stay white/black away from the middle.
+    for (int y = 0; y < 2000; ++y)
+        for (int x = 0; x < 2000; ++x)
+            for (int c = 0; c < 3; ++c)
+                image.pixels8[(static_cast<size_t>(y) * 4000 + x) * 3 + c] = 255;
+
+    const ImageData small = downscaleToRgb8(image, 1000);
+    assert(small.width == 1000 && small.height == 500);
+    assert(small.pixels8[0] == 255);
+    assert(small.pixels8[(999) * 3] == 0);
+
+    // 16-bit input ends up 8-bit, small images are kept as they are.
+    ImageData wide;
+    wide.width = 2;
+    wide.height = 1;
+    wide.is16Bit = true;
+    wide.pixels16 = {65535, 0, 256, 0, 0, 0};
+    const ImageData same = downscaleToRgb8(wide, 1000);
+    assert(same.width == 2 && same.height == 1 && !same.is16Bit);
+    assert(same.pixels8[0] == 255 && same.pixels8[2] == 1);
+}
+
+static void roundTripRestoresThePreview()
+{
+    const fs::path source = writeSource("photocrispy_preview_source.arw");
+    const fs::path cache = fs::temp_directory_path() / "photocrispy_preview_cache.bin";
+
+    assert(savePreviewCache(cache, source.string(), makeImage(3000, 2000, 90)));
+    const std::optional<ImageData> restored = loadPreviewCache(cache, source.string());
+    assert(restored);
+    assert(restored->width == kPreviewCacheMaxEdge);
+    assert(restored->kind == ImageKind::Preview);
+    assert(restored->pixels8[0] == 90);
+
+    // Another file never gets this preview.
+    const fs::path other = writeSource("photocrispy_preview_other.arw");
+    assert(!loadPreviewCache(cache, other.string()));
+
+    fs::remove(source);
+    fs::remove(other);
+    fs::remove(cache);
+}
+
+static void modifiedSourceInvalidatesTheCache()
+{
+    const fs::path source = writeSource("photocrispy_preview_modified.arw");
+    const fs::path cache = fs::temp_directory_path() / "photocrispy_preview_modified.bin";
+    assert(savePreviewCache(cache, source.string(), makeImage(64, 48, 10)));
+
+    fs::last_write_time(source, fs::last_write_time(source) + std::chrono::seconds(5));
+    assert(!loadPreviewCache(cache, source.string()));
+
+    // Corrupt caches are ignored as well.
+    std::ofstream(cache, std::ios::binary | std::ios::trunc) << "PCPV";
+    assert(!loadPreviewCache(cache, source.string()));
+
+    fs::remove(source);
+    fs::remove(cache);
+}
+
+int main()
+{
+    downscaleKeepsAspectAndAverages();
+    roundTripRestoresThePreview();
+    modifiedSourceInvalidatesTheCache();
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "ProgramBinaryFile.h"
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static ProgramBinary makeBinary(size_t size)
+{
+    ProgramBinary binary;
+    binary.format = 0x8741;
+    for (size_t i = 0; i < size; ++i)
+        binary.data.push_back(static_cast<uint8_t>(i * 7));
+    return binary;
+}
+
+static void keyChangesWithSourcesAndDriver()
+{
+    const uint64_t key = programCacheKey("vs", "fs", "Mesa", "llvmpipe", "4.5");
+    assert(key == programCacheKey("vs", "fs", "Mesa", "llvmpipe", "4.5"));
+    assert(key != programCacheKey("vs ", "fs", "Mesa", "llvmpipe", "4.5"));
+    assert(key != programCacheKey("vs", "fs", "Mesa", "llvmpipe", "4.6"));
+    assert(key != programCacheKey("vs", "fs", "Mesa", "radeonsi", "4.5"));
+    // Moving text between fields is a different program.
+    assert(programCacheKey("ab", "c", "", "", "") != programCacheKey("a", "bc", "", "", ""));
+}
+
+static void roundTrip()
+{
+    const fs::path path = fs::temp_directory_path() / "photocrispy_program.bin";
+    const ProgramBinary binary = makeBinary(4096);
+    assert(writeProgramBinaryFile(path, 42, binary));
+
+    const auto loaded = readProgramBinaryFile(path, 42);
+    assert(loaded && loaded->format == binary.format && loaded->data == binary.data);
+    // Stale file for a different program or driver.
+    assert(!readProgramBinaryFile(path, 43));
+    fs::remove(path);
+    assert(!readProgramBinaryFile(path, 42));
+}
+
+static void damagedFilesAreRejected()
+{
+    const fs::path path = fs::temp_directory_path() / "photocrispy_program_damaged.bin";
+    assert(writeProgramBinaryFile(path, 7, makeBinary(1000)));
+    const auto size = fs::file_size(path);
+
+    // One flipped byte in the payload.
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(size - 10));
+        file.put('\x5A');
+    }
+    assert(!readProgramBinaryFile(path, 7));
+
+    assert(writeProgramBinaryFile(path, 7, makeBinary(1000)));
+    fs::resize_file(path, size - 1);
+    assert(!readProgramBinaryFile(path, 7));
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a program binary";
+    assert(!readProgramBinaryFile(path, 7));
+    fs::remove(path);
+}
+
+int main()
+{
+    keyChangesWithSourcesAndDriver();
+    roundTrip();
+    damagedFilesAreRejected();
+    return 0;
+}
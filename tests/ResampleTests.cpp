@@ -0,0 +1,218 @@
+#include "Resample.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+static const ResampleFilter kFilters[] = {ResampleFilter::Box, ResampleFilter::Triangle, ResampleFilter::Lanczos3};
+
+static ImageData makeImage(int width, int height, int channels, bool is16Bit)
+{
+    ImageData image;
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.is16Bit = is16Bit;
+    const size_t values = static_cast<size_t>(width) * height * channels;
+    if (is16Bit)
+        image.pixels16.resize(values);
+    else
+        image.pixels8.resize(values);
+    return image;
+}
+
+static double value(const ImageData &image, int x, int y, int c)
+{
+    const size_t index = (static_cast<size_t>(y) * image.width + x) * image.channels + c;
+    return image.is16Bit ? image.pixels16[index] : image.pixels8[index];
+}
+
+// Low frequency pattern, sampled at pixel centres of a width x height grid
+// covering the unit square, so the same function can be compared at any size.
+static double smoothPattern(double u, double v, int c)
+{
+    return 0.5 + 0.3 * std::sin(u * 6.0 + c) * std::cos(v * 4.0);
+}
+
+static ImageData makeSmooth(int width, int height, int channels, bool is16Bit)
+{
+    ImageData image = makeImage(width, height, channels, is16Bit);
+    const double maxValue = is16Bit ? 65535.0 : 255.0;
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            for (int c = 0; c < channels; ++c)
+            {
+                const size_t index = (static_cast<size_t>(y) * width + x) * channels + c;
+                const double v = smoothPattern((x + 0.5) / width, (y + 0.5) / height, c) * maxValue;
+                if (is16Bit)
+                    image.pixels16[index] = static_cast<uint16_t>(std::lround(v));
+                else
+                    image.pixels8[index] = static_cast<uint8_t>(std::lround(v));
+            }
+    return image;
+}
+
+static void testTapsAreNormalisedAndInRange()
+{
+    for (ResampleFilter filter : kFilters)
+        for (int sourceSize : {1, 7, 100, 613})
+            for (int outputSize : {1, 3, 50, 100, 250})
+            {
+                const ResampleTaps taps = computeResampleTaps(sourceSize, outputSize, filter);
+                assert(taps.taps >= 1 && taps.taps <= sourceSize);
+                for (int i = 0; i < outputSize; ++i)
+                {
+                    assert(taps.first[i] >= 0 && taps.first[i] + taps.taps <= sourceSize);
+                    if (i > 0)
+                        assert(taps.first[i] >= taps.first[i - 1]);
+                    double sum = 0.0;
+                    for (int t = 0; t < taps.taps; ++t)
+                        sum += taps.weights[static_cast<size_t>(i) * taps.taps + t];
+                    assert(std::abs(sum - 1.0) < 1e-5);
+                }
+            }
+}
+
+static void testConstantImageStaysConstant()
+{
+    for (ResampleFilter filter : kFilters)
+        for (int channels : {3, 4})
+            for (bool is16Bit : {false, true})
+            {
+                ImageData image = makeImage(97, 61, channels, is16Bit);
+                for (size_t i = 0; i < image.pixels8.size(); ++i)
+                    image.pixels8[i] = static_cast<uint8_t>(40 + 50 * (i % channels));
+                for (size_t i = 0; i < image.pixels16.size(); ++i)
+                    image.pixels16[i] = static_cast<uint16_t>(10000 + 12000 * (i % channels));
+
+                ResampleOptions options;
+                options.filter = filter;
+                for (auto size : {std::pair{31, 20}, std::pair{200, 150}})
+                {
+                    const auto resized = resampleImage(image, size.first, size.second, options);
+                    assert(resized && resized->width == size.first && resized->height == size.second);
+                    assert(resized->channels == channels && resized->is16Bit == is16Bit);
+                    for (int y = 0; y < resized->height; ++y)
+                        for (int x = 0; x < resized->width; ++x)
+                            for (int c = 0; c < channels; ++c)
+                                assert(value(*resized, x, y, c) == value(image, 0, 0, c));
+                }
+            }
+}
+
+// One-pixel checkerboard is the highest frequency there is; shrinking it by
+// four must give flat grey, not a moire of black and white.
+static void testShrinkingDoesNotAlias()
+{
+    ImageData board = makeImage(256, 256, 3, false);
+    for (int y = 0; y < 256; ++y)
+        for (int x = 0; x < 256; ++x)
+            for (int c = 0; c < 3; ++c)
+                board.pixels8[(static_cast<size_t>(y) * 256 + x) * 3 + c] = (x + y) % 2 ? 255 : 0;
+
+    for (ResampleFilter filter : kFilters)
+    {
+        ResampleOptions options;
+        options.filter = filter;
+        const auto small = resampleImage(board, 64, 64, options);
+        assert(small);
+        for (int y = 0; y < 64; ++y)
+            for (int x = 0; x < 64; ++x)
+                assert(std::abs(value(*small, x, y, 0) - 127.5) <= 2.0);
+    }
+}
+
+// Shrinks a smooth pattern and compares with the pattern rendered directly at
+// the small size.
+static void testShrinkingKeepsSmoothDetail()
+{
+    for (bool is16Bit : {false, true})
+    {
+        const ImageData large = makeSmooth(640, 480, 3, is16Bit);
+        const ImageData expected = makeSmooth(160, 120, 3, is16Bit);
+        const double maxValue = is16Bit ? 65535.0 : 255.0;
+        for (ResampleFilter filter : kFilters)
+        {
+            ResampleOptions options;
+            options.filter = filter;
+            const auto small = resampleImage(large, 160, 120, options);
+            assert(small);
+
+            double squaredError = 0.0;
+            for (int y = 0; y < 120; ++y)
+                for (int x = 0; x < 160; ++x)
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        const double difference = (value(*small, x, y, c) - value(expected, x, y, c)) / maxValue;
+                        squaredError += difference * difference;
+                    }
+            const double psnr = -10.0 * std::log10(squaredError / (160.0 * 120.0 * 3.0));
+            assert(psnr > 40.0);
+        }
+    }
+}
+
+static void testEnlargingRampIsMonotonic()
+{
+    ImageData ramp = makeImage(16, 1, 4, true);
+    for (int x = 0; x < 16; ++x)
+        for (int c = 0; c < 4; ++c)
+            ramp.pixels16[x * 4 + c] = static_cast<uint16_t>(x * 4000);
+
+    ResampleOptions options;
+    options.filter = ResampleFilter::Triangle;
+    const auto wide = resampleImage(ramp, 64, 3, options);
+    assert(wide);
+    for (int x = 1; x < 64; ++x)
+        assert(value(*wide, x, 1, 3) >= value(*wide, x - 1, 1, 3));
+    assert(value(*wide, 0, 0, 0) == 0.0 && value(*wide, 63, 2, 0) == 60000.0);
+}
+
+static void testBandsAndThreadsGiveSameResult()
+{
+    const ImageData image = makeSmooth(333, 257, 4, false);
+    ResampleOptions serial;
+    serial.threads = 1;
+    serial.bandRows = 1000;
+    const auto reference = resampleImage(image, 101, 77, serial);
+
+    ResampleOptions banded;
+    banded.bandRows = 5;
+    banded.threads = 4;
+    const auto parallel = resampleImage(image, 101, 77, banded);
+    assert(reference && parallel && reference->pixels8 == parallel->pixels8);
+}
+
+static void testResampleToFit()
+{
+    const ImageData image = makeSmooth(600, 400, 3, false);
+    const auto fitted = resampleToFit(image, 150);
+    assert(fitted && fitted->width == 150 && fitted->height == 100);
+
+    const auto untouched = resampleToFit(image, 1000);
+    assert(untouched && untouched->width == 600 && untouched->pixels8 == image.pixels8);
+}
+
+static void testRejectsBadInput()
+{
+    assert(!resampleImage(ImageData{}, 10, 10));
+    assert(!resampleImage(makeImage(10, 10, 1, false), 5, 5));
+    assert(!resampleImage(makeImage(10, 10, 3, false), 0, 5));
+    ImageData truncated = makeImage(10, 10, 3, false);
+    truncated.pixels8.resize(20);
+    assert(!resampleImage(truncated, 5, 5));
+}
+
+int main()
+{
+    testTapsAreNormalisedAndInRange();
+    testConstantImageStaysConstant();
+    testShrinkingDoesNotAlias();
+    testShrinkingKeepsSmoothDetail();
+    testEnlargingRampIsMonotonic();
+    testBandsAndThreadsGiveSameResult();
+    testResampleToFit();
+    testRejectsBadInput();
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "SessionRecording.h"
+
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static fs::path tempFile(const char *name)
+{
+    return fs::temp_directory_path() / name;
+}
+
+static SessionEvent event(SessionEventType type, int code, bool down, float x = 0.0f, float y = 0.0f)
+{
+    SessionEvent result;
+    result.type = type;
+    result.code = code;
+    result.down = down;
+    result.x = x;
+    result.y = y;
+    return result;
+}
+
+static void roundTrips()
+{
+    // Settings with blank lines and things that look like records
+    const std::string settings = "[Window][Viewer]\nPos=0,19\n\nframe 1 2 3\n[PhotoCrispy][Settings]\nLastFile=/a b.cr2\n";
+    const fs::path path = tempFile("photocrispy_session_test.txt");
+
+    SessionFrame first;
+    first.deltaTime = 1.0f / 60.0f;
+    first.displayWidth = 1280.0f;
+    first.displayHeight = 720.0f;
+    first.events = {event(SessionEventType::MousePos, 0, false, 100.25f, -3.5f),
+                    event(SessionEventType::MouseButton, 1, true),
+                    event(SessionEventType::MouseWheel, 0, false, 0.0f, -1.0f),
+                    event(SessionEventType::Key, 527, true), event(SessionEventType::Char, 0x00e9, false),
+                    event(SessionEventType::Focus, 0, false)};
+    SessionFrame empty = first;
+    empty.deltaTime = 0.0123456789f;
+    empty.events.clear();
+
+    SessionWriter writer;
+    assert(writer.open(path, 1280, 720, settings));
+    writer.writeFrame(first);
+    writer.writeFrame(empty);
+    writer.writeFrame(first);
+    assert(writer.close());
+
+    const auto recording = loadSessionRecording(path);
+    assert(recording);
+    assert(recording->windowWidth == 1280 && recording->windowHeight == 720);
+    assert(recording->settings == settings);
+    assert(recording->frames.size() == 3);
+    assert(recording->frames[1].events.empty());
+    // Floats come back bit for bit
+    assert(recording->frames[1].deltaTime == empty.deltaTime);
+    const SessionFrame &frame = recording->frames[2];
+    assert(frame.deltaTime == first.deltaTime && frame.displayHeight == 720.0f);
+    assert(frame.events.size() == first.events.size());
+    for (size_t i = 0; i < frame.events.size(); ++i)
+    {
+        const SessionEvent &a = frame.events[i];
+        const SessionEvent &b = first.events[i];
+        assert(a.type == b.type && a.code == b.code && a.down == b.down && a.x == b.x && a.y == b.y);
+    }
+    fs::remove(path);
+}
+
+static void rejectsOtherFiles()
+{
+    const fs::path path = tempFile("photocrispy_session_bad.txt");
+    assert(!loadSessionRecording(path));
+
+    const char *bad[] = {
+        "not-a-session 1\n",
+        "photocrispy-session 2\nwindow 1 1\nsettings 0\n\n",
+        "photocrispy-session 1\nwindow 1 1\nsettings 50\nshort",
+        // Event before the first frame
+        "photocrispy-session 1\nwindow 1 1\nsettings 0\n\nkey 1 1\n",
+        "photocrispy-session 1\nwindow 1 1\nsettings 0\n\nframe 0.016 1 1\nteleport 1 2\n",
+        "photocrispy-session 1\nwindow 1 1\nsettings 0\n\nframe 0.016 1 1\nmouse_pos 1\n",
+    };
+    for (const char *content : bad)
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+        assert(!loadSessionRecording(path));
+    }
+    fs::remove(path);
+}
+
+static void summarizesFrameTimes()
+{
+    std::vector<FrameTiming> frames;
+    for (int i = 1; i <= 100; ++i)
+        frames.push_back(FrameTiming{static_cast<double>(i), i % 2 ? 2.0 : -1.0});
+    const FrameTimeSummary summary = summarizeFrameTimes(frames, 90.0);
+    assert(summary.cpu.count == 100 && summary.cpu.p50 == 50.0 && summary.cpu.p95 == 95.0);
+    assert(summary.cpu.max == 100.0 && summary.cpu.min == 1.0);
+    assert(summary.gpu.count == 50 && summary.gpu.p99 == 2.0);
+    assert(summary.hitches == 10);
+    assert(summarizeFrameTimes({}).cpu.count == 0);
+
+    const fs::path path = tempFile("photocrispy_frame_times.csv");
+    assert(writeFrameTimes(path, {FrameTiming{16.5, 3.25}, FrameTiming{40.0, -1.0}}));
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    assert(content.str() == "frame,cpu_ms,gpu_ms\n0,16.500,3.250\n1,40.000,-1.000\n");
+    fs::remove(path);
+}
+
+int main()
+{
+    roundTrips();
+    rejectsOtherFiles();
+    summarizesFrameTimes();
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "graphics/textureBudget.h"
+
+#include <cassert>
+
+static void allocationsAreAccountedByRole()
+{
+    TextureBudget budget(size_t{64} * 1024 * 1024);
+    const auto source = budget.track(TextureRole::Source, TextureFormat::RGB16, 1000, 1000);
+    const auto processed = budget.track(TextureRole::Processed, TextureFormat::RGBA8, 1000, 1000);
+
+    assert(budget.usedBytes() == 8000000 + 4000000);
+    assert(budget.bytesForRole(TextureRole::Source) == 8000000);
+
+    budget.update(processed, TextureFormat::RGBA16F, 1000, 1000);
+    assert(budget.bytesForRole(TextureRole::Processed) == 8000000);
+
+    budget.release(source);
+    budget.release(processed);
+    assert(budget.usedBytes() == 0);
+    assert(budget.entries().empty());
+}
+
+static void pressureEvictsLeastRecentlyUsedCacheEntries()
+{
+    TextureBudget budget(3 * 1024 * 1024);
+    int evicted[3] = {0, 0, 0};
+    TextureBudget::Handle tiles[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        tiles[i] = budget.track(TextureRole::Tile, TextureFormat::RGBA8, 512, 512, 1,
+                                [&budget, &evicted, &tiles, i]() {
+                                    ++evicted[i];
+                                    budget.release(tiles[i]);
+                                });
+    }
+    assert(budget.usedBytes() == 3 * 1024 * 1024);
+
+    budget.touch(tiles[0]);
+    // Pinned: must not be evicted, so the oldest tile (1) goes instead.
+    budget.track(TextureRole::Source, TextureFormat::RGBA8, 512, 512);
+    assert(evicted[0] == 0 && evicted[1] == 1 && evicted[2] == 0);
+    assert(budget.evictionCount() == 1);
+    assert(budget.usedBytes() == 3 * 1024 * 1024);
+}
+
+static void formatDegradesWithMemory()
+{
+    TextureBudget roomy(size_t{1024} * 1024 * 1024);
+    assert(roomy.chooseFormat(TextureRole::Processed, 6000, 4000) == TextureFormat::RGBA16F);
+    assert(roomy.chooseFormat(TextureRole::Thumbnail, 256, 256) == TextureFormat::RGBA8);
+
+    TextureBudget tight(size_t{256} * 1024 * 1024);
+    assert(tight.chooseFormat(TextureRole::Processed, 6000, 4000) == TextureFormat::RGB10A2);
+
+    TextureBudget full(size_t{64} * 1024 * 1024);
+    assert(full.chooseFormat(TextureRole::Processed, 6000, 4000) == TextureFormat::RGBA8);
+}
+
+int main()
+{
+    allocationsAreAccountedByRole();
+    pressureEvictsLeastRecentlyUsedCacheEntries();
+    formatDegradesWithMemory();
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "ViewportTiles.h"
+
+#include <cassert>
+#include <cmath>
+
+static void levelFollowsDisplayScale()
+{
+    assert(tileLevelForScale(4.0f) == 0);
+    assert(tileLevelForScale(1.0f) == 0);
+    assert(tileLevelForScale(0.6f) == 0);
+    assert(tileLevelForScale(0.5f) == 1);
+    assert(tileLevelForScale(0.2f) == 2);
+}
+
+static void edgeTilesAreClipped()
+{
+    const ImageRect rect = tileRect(TileKey{0, 2, 1}, 512, 1200, 700);
+    assert(rect.x == 1024 && rect.y == 512);
+    assert(rect.width == 176 && rect.height == 188);
+
+    const ImageRect coarse = tileRect(TileKey{1, 0, 0}, 512, 1200, 700);
+    assert(coarse.width == 1024 && coarse.height == 700);
+}
+
+static void onlyTilesNearTheViewAreListed()
+{
+    // 8000x6000 image, 400x400 view inside tile (7, 5).
+    const ImageRect visible{7 * 512 + 50, 5 * 512 + 50, 400, 400};
+    auto tiles = tilesForView(visible, 0, 512, 0, 8000, 6000);
+    assert(tiles.size() == 1);
+    assert((tiles[0] == TileKey{0, 7, 5}));
+
+    // A margin pulls in the neighbours.
+    tiles = tilesForView(visible, 100, 512, 0, 8000, 6000);
+    assert(tiles.size() == 9);
+
+    // Views outside the image produce nothing.
+    assert(tilesForView(ImageRect{9000, 0, 100, 100}, 0, 512, 0, 8000, 6000).empty());
+}
+
+// Enough slots for the view and its margin at every scale and scroll
+// position, computed the way the viewer does.
+static void slotsCoverTheViewAndMargin()
+{
+    assert(tileSlotsForView(1920, 1080, 512) == 10 * 7);
+    for (int view : {300, 512, 1080, 1920, 3840})
+    {
+        for (float scale : {4.0f, 1.0f, 0.9f, 0.5001f, 0.5f, 0.3f, 0.2501f, 0.126f})
+        {
+            const int level = tileLevelForScale(scale);
+            const int margin = (512 << level) / 2;
+            for (int offset = 0; offset < (512 << level); offset += 37)
+            {
+                ImageRect visible;
+                visible.x = 100000 + offset;
+                visible.y = 100000 + offset / 2;
+                visible.width = static_cast<int>(std::ceil(view / scale)) + 1;
+                visible.height = static_cast<int>(std::ceil(view * 9 / 16 / scale)) + 1;
+                const size_t needed = tilesForView(visible, margin, 512, level, 1 << 30, 1 << 30).size();
+                assert(needed <= tileSlotsForView(view, view * 9 / 16, 512));
+            }
+        }
+    }
+}
+
+static void cacheReusesTilesAndEvictsLeastRecent()
+{
+    TileCache cache(2);
+    const TileKey a{0, 0, 0};
+    const TileKey b{0, 1, 0};
+    const TileKey c{0, 2, 0};
+
+    cache.beginFrame();
+    assert(!cache.find(a, 1));
+    const auto slotA = cache.acquire(a, 1);
+    const auto slotB = cache.acquire(b, 1);
+    assert(slotA && slotB && *slotA != *slotB);
+    // Both slots are in use this frame.
+    assert(!cache.acquire(c, 1));
+
+    cache.beginFrame();
+    assert(cache.find(a, 1) == slotA);
+    // b was not used this frame, so it is replaced.
+    assert(cache.acquire(c, 1) == slotB);
+    assert(!cache.find(b, 1));
+
+    // A new revision makes cached tiles stale.
+    cache.beginFrame();
+    assert(!cache.find(a, 2));
+
+    // Growing keeps what is cached and adds free slots
+    cache.grow(3);
+    assert(cache.capacity() == 3 && cache.find(a, 1) == slotA);
+    assert(cache.acquire(b, 1) == 2u);
+    cache.grow(1);
+    assert(cache.capacity() == 3);
+}
+
+int main()
+{
+    levelFollowsDisplayScale();
+    edgeTilesAreClipped();
+    onlyTilesNearTheViewAreListed();
+    slotsCoverTheViewAndMargin();
+    cacheReusesTilesAndEvictsLeastRecent();
+    return 0;
+}